@@ -0,0 +1,432 @@
+#include "ast_utils.h"
+
+using namespace std;
+
+namespace ast {
+
+void ForEachChild(Statement& node, const function<void(unique_ptr<Statement>&)>& fn) {
+    if (auto* assign = dynamic_cast<Assignment*>(&node)){
+        fn(assign->rv_);
+    } else if (auto* field = dynamic_cast<FieldAssignment*>(&node)){
+        fn(field->rv_);
+    } else if (auto* print = dynamic_cast<Print*>(&node)){
+        for (auto& arg : print->args_){
+            fn(arg);
+        }
+    } else if (auto* call = dynamic_cast<MethodCall*>(&node)){
+        fn(call->object_);
+        for (auto& arg : call->args_){
+            fn(arg);
+        }
+    } else if (auto* instance = dynamic_cast<NewInstance*>(&node)){
+        for (auto& arg : instance->args_){
+            fn(arg);
+        }
+    } else if (auto* unary = dynamic_cast<UnaryOperation*>(&node)){
+        fn(unary->statement_);
+    } else if (auto* binary = dynamic_cast<BinaryOperation*>(&node)){
+        fn(binary->lhs_);
+        fn(binary->rhs_);
+    } else if (auto* compound = dynamic_cast<Compound*>(&node)){
+        for (auto& statement : compound->args_){
+            fn(statement);
+        }
+    } else if (auto* body = dynamic_cast<MethodBody*>(&node)){
+        fn(body->body_);
+    } else if (auto* ret = dynamic_cast<Return*>(&node)){
+        fn(ret->statement_);
+    } else if (auto* definition = dynamic_cast<ClassDefinition*>(&node)){
+        for (runtime::Method& method : definition->cls_.TryAs<runtime::Class>()->Methods()){
+            if (auto* method_body = dynamic_cast<MethodBody*>(method.body.get())){
+                fn(method_body->body_);
+            }
+        }
+    } else if (auto* if_else = dynamic_cast<IfElse*>(&node)){
+        fn(if_else->condition_);
+        fn(if_else->if_body_);
+        if (if_else->else_body_){
+            fn(if_else->else_body_);
+        }
+    } else if (auto* composite = dynamic_cast<CompositeNode*>(&node)){
+        composite->ForEachChild(fn);
+    }
+}
+
+size_t CountNodes(Statement& node) {
+    size_t count = 1;
+    ForEachChild(node, [&count](unique_ptr<Statement>& child) {
+        count += CountNodes(*child);
+    });
+    return count;
+}
+
+bool ContainsClassDefinition(Statement& node) {
+    if (dynamic_cast<ClassDefinition*>(&node)){
+        return true;
+    }
+    bool found = false;
+    ForEachChild(node, [&found](unique_ptr<Statement>& child) {
+        found = found || ContainsClassDefinition(*child);
+    });
+    return found;
+}
+
+namespace {
+
+void CollectClasses(Statement& node, vector<runtime::Class*>& classes) {
+    if (auto* definition = dynamic_cast<ClassDefinition*>(&node)){
+        classes.push_back(definition->cls_.TryAs<runtime::Class>());
+    }
+    ForEachChild(node, [&classes](unique_ptr<Statement>& child) {
+        CollectClasses(*child, classes);
+    });
+}
+
+}  // namespace
+
+vector<const runtime::Class*> CollectClasses(Statement& node) {
+    vector<runtime::Class*> classes;
+    CollectClasses(node, classes);
+    return {classes.begin(), classes.end()};
+}
+
+vector<ClassMethod> CollectMethods(Statement& node) {
+    vector<runtime::Class*> classes;
+    CollectClasses(node, classes);
+    vector<ClassMethod> methods;
+    for (runtime::Class* cls : classes){
+        for (runtime::Method& method : cls->Methods()){
+            methods.push_back({cls, &method, dynamic_cast<MethodBody*>(method.body.get())});
+        }
+    }
+    return methods;
+}
+
+CompareFunction GetCompareFunction(const Comparison::Comparator& cmp) {
+    const CompareFunction* fn = cmp.target<CompareFunction>();
+    return fn ? *fn : nullptr;
+}
+
+IntCompareFunction GetIntCompareFunction(CompareFunction cmp) {
+    if (cmp == &runtime::Equal){
+        return [](int lhs, int rhs) { return lhs == rhs; };
+    }
+    if (cmp == &runtime::NotEqual){
+        return [](int lhs, int rhs) { return lhs != rhs; };
+    }
+    if (cmp == &runtime::Less){
+        return [](int lhs, int rhs) { return lhs < rhs; };
+    }
+    if (cmp == &runtime::Greater){
+        return [](int lhs, int rhs) { return lhs > rhs; };
+    }
+    if (cmp == &runtime::LessOrEqual){
+        return [](int lhs, int rhs) { return lhs <= rhs; };
+    }
+    if (cmp == &runtime::GreaterOrEqual){
+        return [](int lhs, int rhs) { return lhs >= rhs; };
+    }
+    return nullptr;
+}
+
+namespace {
+
+// Копирует все выражения из exprs. При неудаче возвращает false
+bool CloneAll(const vector<unique_ptr<Statement>>& exprs, vector<unique_ptr<Statement>>& result) {
+    result.reserve(exprs.size());
+    for (const auto& expr : exprs){
+        result.push_back(Clone(*expr));
+        if (!result.back()){
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Node>
+unique_ptr<Statement> CloneBinary(const Node& node) {
+    auto lhs = Clone(*node.lhs_);
+    auto rhs = Clone(*node.rhs_);
+    if (!lhs || !rhs){
+        return nullptr;
+    }
+    return make_unique<Node>(std::move(lhs), std::move(rhs));
+}
+
+template <typename Node>
+unique_ptr<Statement> CloneUnary(const Node& node) {
+    auto arg = Clone(*node.statement_);
+    return arg ? make_unique<Node>(std::move(arg)) : nullptr;
+}
+
+}  // namespace
+
+unique_ptr<Statement> Clone(const Statement& node) {
+    if (auto* num = dynamic_cast<const NumericConst*>(&node)){
+        return make_unique<NumericConst>(num->value_);
+    } else if (auto* str = dynamic_cast<const StringConst*>(&node)){
+        return make_unique<StringConst>(str->value_);
+    } else if (auto* boolean = dynamic_cast<const BoolConst*>(&node)){
+        return make_unique<BoolConst>(boolean->value_);
+    } else if (auto* var = dynamic_cast<const VariableValue*>(&node)){
+        return make_unique<VariableValue>(*var);
+    } else if (dynamic_cast<const None*>(&node)){
+        return make_unique<None>();
+    } else if (auto* assign = dynamic_cast<const Assignment*>(&node)){
+        auto rv = Clone(*assign->rv_);
+        return rv ? make_unique<Assignment>(assign->var_, std::move(rv)) : nullptr;
+    } else if (auto* field = dynamic_cast<const FieldAssignment*>(&node)){
+        auto rv = Clone(*field->rv_);
+        return rv ? make_unique<FieldAssignment>(field->object_, field->field_name_, std::move(rv))
+                  : nullptr;
+    } else if (auto* print = dynamic_cast<const Print*>(&node)){
+        // argument_ не используется при исполнении, поэтому не копируется
+        vector<unique_ptr<Statement>> args;
+        if (!CloneAll(print->args_, args)){
+            return nullptr;
+        }
+        auto result = make_unique<Print>(std::move(args));
+        result->name_ = print->name_;
+        return result;
+    } else if (auto* call = dynamic_cast<const MethodCall*>(&node)){
+        auto object = Clone(*call->object_);
+        vector<unique_ptr<Statement>> args;
+        if (!object || !CloneAll(call->args_, args)){
+            return nullptr;
+        }
+        return make_unique<MethodCall>(std::move(object), call->method_, std::move(args));
+    } else if (auto* instance = dynamic_cast<const NewInstance*>(&node)){
+        vector<unique_ptr<Statement>> args;
+        if (!CloneAll(instance->args_, args)){
+            return nullptr;
+        }
+        auto result = make_unique<NewInstance>(
+            instance->obj_.TryAs<runtime::ClassInstance>()->GetClass(), std::move(args));
+        result->obj_ = instance->obj_;
+        return result;
+    } else if (auto* stringify = dynamic_cast<const Stringify*>(&node)){
+        return CloneUnary(*stringify);
+    } else if (auto* not_node = dynamic_cast<const Not*>(&node)){
+        return CloneUnary(*not_node);
+    } else if (auto* add = dynamic_cast<const Add*>(&node)){
+        return CloneBinary(*add);
+    } else if (auto* sub = dynamic_cast<const Sub*>(&node)){
+        return CloneBinary(*sub);
+    } else if (auto* mult = dynamic_cast<const Mult*>(&node)){
+        return CloneBinary(*mult);
+    } else if (auto* div = dynamic_cast<const Div*>(&node)){
+        return CloneBinary(*div);
+    } else if (auto* or_node = dynamic_cast<const Or*>(&node)){
+        return CloneBinary(*or_node);
+    } else if (auto* and_node = dynamic_cast<const And*>(&node)){
+        return CloneBinary(*and_node);
+    } else if (auto* cmp = dynamic_cast<const Comparison*>(&node)){
+        auto lhs = Clone(*cmp->lhs_);
+        auto rhs = Clone(*cmp->rhs_);
+        if (!lhs || !rhs){
+            return nullptr;
+        }
+        return make_unique<Comparison>(cmp->cmp_, std::move(lhs), std::move(rhs));
+    } else if (auto* compound = dynamic_cast<const Compound*>(&node)){
+        auto result = make_unique<Compound>();
+        if (!CloneAll(compound->args_, result->args_)){
+            return nullptr;
+        }
+        return result;
+    } else if (auto* body = dynamic_cast<const MethodBody*>(&node)){
+        auto inner = Clone(*body->body_);
+        return inner ? make_unique<MethodBody>(std::move(inner)) : nullptr;
+    } else if (auto* ret = dynamic_cast<const Return*>(&node)){
+        auto value = Clone(*ret->statement_);
+        return value ? make_unique<Return>(std::move(value)) : nullptr;
+    } else if (auto* definition = dynamic_cast<const ClassDefinition*>(&node)){
+        return make_unique<ClassDefinition>(definition->cls_);
+    } else if (auto* if_else = dynamic_cast<const IfElse*>(&node)){
+        auto condition = Clone(*if_else->condition_);
+        auto if_body = Clone(*if_else->if_body_);
+        unique_ptr<Statement> else_body;
+        if (if_else->else_body_){
+            else_body = Clone(*if_else->else_body_);
+            if (!else_body){
+                return nullptr;
+            }
+        }
+        if (!condition || !if_body){
+            return nullptr;
+        }
+        return make_unique<IfElse>(std::move(condition), std::move(if_body), std::move(else_body));
+    } else if (auto* composite = dynamic_cast<const CompositeNode*>(&node)){
+        return composite->Clone();
+    }
+    return nullptr;
+}
+
+void Visitor::Walk(Statement& node) {
+    if (Dispatch(node)){
+        ForEachChild(node, [this](unique_ptr<Statement>& child) {
+            Walk(*child);
+        });
+    }
+}
+
+bool Visitor::Dispatch(Statement& node) {
+    if (auto* typed = dynamic_cast<NumericConst*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<StringConst*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<BoolConst*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<VariableValue*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Assignment*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<FieldAssignment*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<None*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Print*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<MethodCall*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<NewInstance*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Stringify*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Add*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Sub*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Mult*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Div*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Or*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<And*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Not*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Compound*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<MethodBody*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Return*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<ClassDefinition*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<IfElse*>(&node)){
+        return Visit(*typed);
+    } else if (auto* typed = dynamic_cast<Comparison*>(&node)){
+        return Visit(*typed);
+    }
+    return Visit(node);
+}
+
+bool Visitor::Visit([[maybe_unused]] Statement& node) {
+    return true;
+}
+
+bool Visitor::Visit(NumericConst& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(StringConst& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(BoolConst& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(VariableValue& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Assignment& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(FieldAssignment& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(None& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Print& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(MethodCall& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(NewInstance& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Stringify& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Add& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Sub& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Mult& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Div& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Or& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(And& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Not& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Compound& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(MethodBody& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Return& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(ClassDefinition& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(IfElse& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+bool Visitor::Visit(Comparison& node) {
+    return Visit(static_cast<Statement&>(node));
+}
+
+void Rewriter::Rewrite(unique_ptr<Statement>& slot) {
+    ForEachChild(*slot, [this](unique_ptr<Statement>& child) {
+        Rewrite(child);
+    });
+    Leave(slot);
+}
+
+}  // namespace ast
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "statement.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Вспомогательные функции для обхода и анализа дерева разбора
+namespace ast {
+
+// Функция сравнения из runtime (runtime::Less, runtime::Equal и т.д.)
+using CompareFunction = bool (*)(const runtime::ObjectHolder&, const runtime::ObjectHolder&,
+                                 runtime::Context&);
+
+// Сравнение целых чисел
+using IntCompareFunction = bool (*)(int, int);
+
+// Примесь для узлов, созданных оптимизациями: такой узел сам перечисляет своих потомков
+// для ForEachChild и может поддержать копирование поддерева
+class CompositeNode {
+public:
+    virtual ~CompositeNode() = default;
+
+    virtual void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) = 0;
+
+    // Возвращает глубокую копию узла либо nullptr, если узел не поддерживает копирование
+    [[nodiscard]] virtual std::unique_ptr<Statement> Clone() const {
+        return nullptr;
+    }
+};
+
+/*
+Вызывает fn для каждого непосредственного потомка узла node. Потомок передаётся
+по ссылке на владеющий указатель, поэтому fn может заменить его другим узлом.
+Для ClassDefinition потомками считаются тела методов класса.
+Узлы, неизвестные обходу (например, созданные оптимизациями и не унаследованные
+от CompositeNode), считаются листьями
+*/
+void ForEachChild(Statement& node, const std::function<void(std::unique_ptr<Statement>&)>& fn);
+
+// Возвращает количество узлов в поддереве node, включая тела методов классов
+size_t CountNodes(Statement& node);
+
+/*
+Возвращает true, если поддерево node содержит определение класса, включая определения
+в телах методов. Парсер связывает NewInstance с классом при разборе, поэтому такой класс
+может создаваться и вне поддерева: удаляя поддерево, оптимизация уничтожила бы класс
+*/
+bool ContainsClassDefinition(Statement& node);
+
+// Метод класса программы
+struct ClassMethod {
+    const runtime::Class* cls;
+    runtime::Method* method;
+    // Тело метода из разбора программы либо nullptr, если тело заменено оптимизацией
+    MethodBody* body;
+};
+
+// Возвращает классы, определённые в поддереве node, включая классы из тел методов,
+// в порядке обхода дерева
+std::vector<const runtime::Class*> CollectClasses(Statement& node);
+
+// Возвращает методы всех классов из CollectClasses(node)
+std::vector<ClassMethod> CollectMethods(Statement& node);
+
+// Возвращает функцию сравнения, хранящуюся в cmp, либо nullptr, если это не функция из runtime
+CompareFunction GetCompareFunction(const Comparison::Comparator& cmp);
+
+// Возвращает сравнение целых чисел, совпадающее с cmp на числах, либо nullptr
+IntCompareFunction GetIntCompareFunction(CompareFunction cmp);
+
+/*
+Возвращает глубокую копию поддерева node. Копия NewInstance возвращает тот же объект,
+что и оригинал, копия ClassDefinition ссылается на тот же класс.
+Если поддерево содержит узлы, неизвестные копированию, возвращает nullptr
+*/
+std::unique_ptr<Statement> Clone(const Statement& node);
+
+/*
+Обход дерева в прямом порядке с диспетчеризацией по типу узла.
+Наследник переопределяет нужные перегрузки Visit. Перегрузка возвращает true,
+если нужно обходить потомков узла. По умолчанию перегрузки для конкретных узлов
+вызывают Visit(Statement&), которая обрабатывает все прочие узлы.
+В наследнике, переопределяющем часть перегрузок, нужно добавить using Visitor::Visit
+*/
+class Visitor {
+public:
+    virtual ~Visitor() = default;
+
+    // Обходит поддерево node, включая тела методов классов
+    void Walk(Statement& node);
+
+protected:
+    virtual bool Visit(Statement& node);
+    virtual bool Visit(NumericConst& node);
+    virtual bool Visit(StringConst& node);
+    virtual bool Visit(BoolConst& node);
+    virtual bool Visit(VariableValue& node);
+    virtual bool Visit(Assignment& node);
+    virtual bool Visit(FieldAssignment& node);
+    virtual bool Visit(None& node);
+    virtual bool Visit(Print& node);
+    virtual bool Visit(MethodCall& node);
+    virtual bool Visit(NewInstance& node);
+    virtual bool Visit(Stringify& node);
+    virtual bool Visit(Add& node);
+    virtual bool Visit(Sub& node);
+    virtual bool Visit(Mult& node);
+    virtual bool Visit(Div& node);
+    virtual bool Visit(Or& node);
+    virtual bool Visit(And& node);
+    virtual bool Visit(Not& node);
+    virtual bool Visit(Compound& node);
+    virtual bool Visit(MethodBody& node);
+    virtual bool Visit(Return& node);
+    virtual bool Visit(ClassDefinition& node);
+    virtual bool Visit(IfElse& node);
+    virtual bool Visit(Comparison& node);
+
+private:
+    bool Dispatch(Statement& node);
+};
+
+/*
+Переписывание дерева в обратном порядке: сначала переписываются потомки узла,
+затем вызывается Leave для самого узла. Leave может заменить узел, присвоив
+slot другое значение; новый узел повторно не обходится
+*/
+class Rewriter {
+public:
+    virtual ~Rewriter() = default;
+
+    // Переписывает поддерево slot, включая тела методов классов
+    void Rewrite(std::unique_ptr<Statement>& slot);
+
+protected:
+    virtual void Leave(std::unique_ptr<Statement>& slot) = 0;
+};
+
+}  // namespace ast
@@ -0,0 +1,441 @@
+#include "bench.h"
+
+#include "lexer.h"
+#include "lexer_parallel.h"
+#include "lexer_scan.h"
+#include "parse.h"
+#include "pass_manager.h"
+#include "profile.h"
+#include "program_cache.h"
+#include "runtime.h"
+#include "threaded_code.h"
+#include "tiered.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+namespace bench {
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// Возвращает время выполнения func в наносекундах
+template <typename Func>
+double MeasureNs(Func func) {
+    const auto start = Clock::now();
+    func();
+    return static_cast<double>(
+        chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+// Линейная программа без вызовов: каждый узел дерева исполняется ровно один раз,
+// а каждая инструкция шитого кода - ровно одна диспетчеризация
+string StraightLineProgram(int lines) {
+    ostringstream program;
+    program << "a = 7\nb = 3\nc = 11\n";
+    for (int i = 0; i < lines; ++i){
+        program << "x = a * b + c - a / b + " << i << "\n";
+        program << "y = x > c and not a == b\n";
+        program << "s = 'n' + str(x)\n";
+    }
+    return program.str();
+}
+
+// Присваивания длинных выражений со всеми уровнями приоритета операций
+string ExpressionProgram(int lines) {
+    ostringstream program;
+    program << "a = 7\nb = 3\nc = 11\n";
+    for (int i = 0; i < lines; ++i){
+        program << "x = (a + b * c - (a - " << i << ") / b) * -c + a * (b + c * (a - b))\n";
+        program << "y = not a + 1 < b * c and (c >= a or not b == " << i << ") or a != c - b\n";
+        program << "z = x + a * b - c / a + (b - c) * (a + (b - (c + (a - b)))) - " << i << "\n";
+    }
+    return program.str();
+}
+
+// Вызовы небольших методов доступа к полям
+string AccessorProgram(int lines) {
+    ostringstream program;
+    program << R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    self.value = self.value + n
+
+  def get():
+    return self.value
+
+c = Counter()
+)";
+    for (int i = 0; i < lines; ++i){
+        program << "c.add(c.get() / 1000 + " << i << ")\n";
+    }
+    return program.str();
+}
+
+// Повторные чтения цепочек полей внутри метода
+string FieldChainProgram(int lines) {
+    ostringstream program;
+    program << R"(
+class Vec:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+class Body:
+  def __init__(pos, vel):
+    self.pos = pos
+    self.vel = vel
+
+  def energy():
+    return self.vel.x * self.vel.x + self.vel.y * self.vel.y + self.pos.x * self.vel.x + self.pos.y * self.vel.y
+
+b = Body(Vec(1, 2), Vec(3, 4))
+)";
+    for (int i = 0; i < lines; ++i){
+        program << "e = b.energy()\n";
+    }
+    return program.str();
+}
+
+// Рекурсивные вызовы методов с целочисленной арифметикой
+string RecursionProgram() {
+    return R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+f = Fib()
+x = f.calc(22)
+)"s;
+}
+
+// Много классов с методами, из которых вызываются только методы первого класса
+string ManyMethodsProgram(int classes) {
+    ostringstream program;
+    for (int i = 0; i < classes; ++i){
+        program << "class C" << i << ":\n"
+                << "  def __init__(x):\n"
+                << "    self.x = x\n"
+                << "  def get():\n"
+                << "    if self.x > " << i << ":\n"
+                << "      return self.x * 2 + " << i << "\n"
+                << "    return self.x - " << i << "\n"
+                << "  def describe(p):\n"
+                << "    return 'C" << i << "(' + str(self.x + p) + ')'\n";
+    }
+    program << "c = C0(5)\nx = c.get()\n";
+    return program.str();
+}
+
+void BenchmarkThreadedDispatch(ostream& out) {
+    constexpr int REPEATS = 200;
+    const string program = StraightLineProgram(200);
+
+    auto tree = ParseFromString(program);
+    threaded::CompileStats stats;
+    auto code = threaded::Compile(ParseFromString(program), &stats);
+
+    runtime::DummyContext context;
+    runtime::Closure tree_closure;
+    runtime::Closure code_closure;
+    double tree_ns = MeasureNs([&] {
+        for (int i = 0; i < REPEATS; ++i){
+            tree->Execute(tree_closure, context);
+        }
+    });
+    double code_ns = MeasureNs([&] {
+        for (int i = 0; i < REPEATS; ++i){
+            code->Execute(code_closure, context);
+        }
+    });
+
+    out << "threaded dispatch: "sv << stats.nodes << " nodes, "sv << stats.instructions
+        << " instructions"sv << endl;
+    out << "  Execute (virtual calls): "sv << tree_ns / REPEATS / stats.nodes << " ns/node"sv
+        << endl;
+    out << "  threaded code:           "sv << code_ns / REPEATS / stats.instructions
+        << " ns/instruction, "sv << code_ns / REPEATS / stats.nodes << " ns/node"sv << endl;
+
+    const string recursion = RecursionProgram();
+    auto recursion_tree = ParseFromString(recursion);
+    auto recursion_code = threaded::Compile(ParseFromString(recursion));
+    runtime::Closure closure;
+    double recursion_tree_ns = MeasureNs([&] {
+        recursion_tree->Execute(closure, context);
+    });
+    closure.clear();
+    double recursion_code_ns = MeasureNs([&] {
+        recursion_code->Execute(closure, context);
+    });
+    out << "  recursive calls: Execute "sv << recursion_tree_ns / 1e6 << " ms, threaded "sv
+        << recursion_code_ns / 1e6 << " ms"sv << endl;
+}
+
+// Рекурсия при исполнении деревом и многоуровневом исполнении, где горячий метод
+// переходит на шитый код по ходу работы программы
+void BenchmarkTiers(ostream& out) {
+    const string recursion = RecursionProgram();
+    runtime::DummyContext context;
+
+    auto tree = ParseFromString(recursion);
+    runtime::Closure tree_closure;
+    double tree_ns = MeasureNs([&] {
+        tree->Execute(tree_closure, context);
+    });
+
+    auto program = ParseFromString(recursion);
+    tiered::TierManager tiers;
+    tiers.Install(*program);
+    runtime::Closure tiered_closure;
+    double tiered_ns = MeasureNs([&] {
+        program->Execute(tiered_closure, context);
+    });
+    out << "tiered execution, recursive calls: tree "sv << tree_ns / 1e6 << " ms, tiered "sv
+        << tiered_ns / 1e6 << " ms"sv << endl;
+}
+
+// Загрузка и исполнение программы с полным и отложенным разбором тел методов
+void BenchmarkLazyParsing(ostream& out) {
+    const string program = ManyMethodsProgram(500);
+    runtime::DummyContext context;
+
+    double eager_ns = MeasureNs([&] {
+        runtime::Closure closure;
+        ParseFromString(program)->Execute(closure, context);
+    });
+    auto stats = make_shared<LazyParseStats>();
+    double lazy_ns = MeasureNs([&] {
+        istringstream input(program);
+        parse::Lexer lexer(input);
+        runtime::Closure closure;
+        ParseProgramLazily(lexer, stats)->Execute(closure, context);
+    });
+    out << "lazy parsing, "sv << stats->deferred << " methods, "sv << stats->Unmaterialized()
+        << " never called: eager "sv << eager_ns / 1e6 << " ms, lazy "sv << lazy_ns / 1e6
+        << " ms"sv << endl;
+}
+
+// Читает все лексемы программы
+size_t LexAll(parse::Lexer& lexer) {
+    size_t tokens = 1;
+    while (!lexer.CurrentToken().Is<parse::token_type::Eof>()){
+        lexer.NextToken();
+        ++tokens;
+    }
+    return tokens;
+}
+
+// Программа, в которой между строками кода идут длинные серии пустых строк и комментариев
+string SparseProgram(int lines) {
+    ostringstream program;
+    for (int i = 0; i < lines; ++i){
+        program << "x = " << i << "\n";
+        for (int j = 0; j < 50; ++j){
+            program << (j % 2 ? "\n" : "    # comment line\n");
+        }
+    }
+    return program.str();
+}
+
+// Скорость лексического анализа при чтении из потока и из буфера с текстом программы
+void BenchmarkLexer(ostream& out, string_view name, const string& program) {
+    const double megabytes = static_cast<double>(program.size()) / (1 << 20);
+
+    size_t tokens = 0;
+    double stream_ns = MeasureNs([&] {
+        istringstream input(program);
+        parse::Lexer lexer(input);
+        tokens = LexAll(lexer);
+    });
+    double buffer_ns = MeasureNs([&] {
+        parse::Lexer lexer{string_view(program)};
+        LexAll(lexer);
+    });
+    out << "lexer, "sv << name << ", "sv << megabytes << " MB, "sv << tokens << " tokens: stream "sv
+        << megabytes / (stream_ns / 1e9) << " MB/s, buffer "sv << megabytes / (buffer_ns / 1e9)
+        << " MB/s"sv << endl;
+}
+
+// Время загрузки программы (лексический анализ и разбор) с лексером в том же
+// и в отдельном потоке
+void BenchmarkPipelinedLexing(ostream& out, const string& program) {
+    const double megabytes = static_cast<double>(program.size()) / (1 << 20);
+
+    double sequential_ns = MeasureNs([&] {
+        parse::Lexer lexer{string_view(program)};
+        ParseProgram(lexer);
+    });
+    double pipelined_ns = MeasureNs([&] {
+        parse::Lexer lexer{string_view(program), parse::Pipelined{}};
+        ParseProgram(lexer);
+    });
+    out << "program loading, "sv << megabytes << " MB: single thread "sv << sequential_ns / 1e6
+        << " ms, lexer thread "sv << pipelined_ns / 1e6 << " ms"sv << endl;
+}
+
+// Скорость лексического анализа большой программы одним лексером и по частям во всех ядрах
+void BenchmarkParallelLexing(ostream& out, const string& program) {
+    const double megabytes = static_cast<double>(program.size()) / (1 << 20);
+    const size_t threads = thread::hardware_concurrency();
+
+    double sequential_ns = MeasureNs([&] {
+        parse::Lexer lexer{string_view(program)};
+        LexAll(lexer);
+    });
+    double parallel_ns = MeasureNs([&] {
+        parse::LexInParallel(program, threads);
+    });
+    out << "parallel lexing, "sv << megabytes << " MB, "sv << threads << " threads: sequential "sv
+        << megabytes / (sequential_ns / 1e9) << " MB/s, parallel "sv
+        << megabytes / (parallel_ns / 1e9) << " MB/s"sv << endl;
+}
+
+// Время разбора программы с длинными выражениями по заранее прочитанным токенам
+void BenchmarkExpressionParsing(ostream& out, const string& program) {
+    vector<parse::Token> tokens;
+    {
+        parse::Lexer lexer{string_view(program)};
+        tokens.push_back(lexer.CurrentToken());
+        while (!tokens.back().Is<parse::token_type::Eof>()){
+            tokens.push_back(lexer.NextToken());
+        }
+    }
+    const size_t token_count = tokens.size();
+    parse::Lexer lexer(std::move(tokens));
+    unique_ptr<runtime::Executable> tree;
+    double parse_ns = MeasureNs([&] {
+        tree = ParseProgram(lexer);
+    });
+    out << "expression parsing, "sv << token_count << " tokens: "sv << parse_ns / 1e6 << " ms, "sv
+        << parse_ns / static_cast<double>(token_count) << " ns/token"sv << endl;
+}
+
+// Делит текст на серии символов одного класса функциями поиска границ из lexer_scan.h
+template <typename SkipIdentifier, typename SkipSpaces, typename SkipOperation>
+size_t CountRuns(string_view text, SkipIdentifier skip_identifier, SkipSpaces skip_spaces,
+                 SkipOperation skip_operation) {
+    size_t runs = 0;
+    size_t pos = 0;
+    while (pos < text.size()){
+        const char c = text[pos];
+        if (parse::scan::IsIdentifierChar(c)){
+            pos = skip_identifier(text, pos);
+        } else if (c == ' '){
+            pos = skip_spaces(text, pos);
+        } else if (parse::scan::IsOperationChar(c)){
+            pos = skip_operation(text, pos);
+        } else {
+            ++pos;
+        }
+        ++runs;
+    }
+    return runs;
+}
+
+// Скорость поиска границ лексем векторными и посимвольными функциями.
+// В программе с длинными названиями и отступами векторный поиск заметнее
+void BenchmarkScan(ostream& out) {
+    string program;
+    for (int i = 0; i < 20000; ++i){
+        program += "        some_rather_long_variable_name_"s + to_string(i)
+            + " = another_long_variable_name_for_scanning + 1234567890\n"s;
+    }
+    const double megabytes = static_cast<double>(program.size()) / (1 << 20);
+
+    size_t simd_runs = 0;
+    size_t scalar_runs = 0;
+    double simd_ns = MeasureNs([&] {
+        simd_runs = CountRuns(program, parse::scan::SkipIdentifierChars, parse::scan::SkipSpaces,
+                              parse::scan::SkipOperationChars);
+    });
+    double scalar_ns = MeasureNs([&] {
+        scalar_runs = CountRuns(program, parse::scan::scalar::SkipIdentifierChars,
+                                parse::scan::scalar::SkipSpaces, parse::scan::scalar::SkipOperationChars);
+    });
+    if (simd_runs != scalar_runs){
+        out << "scan: different results"sv << endl;
+        return;
+    }
+    out << "scan, "sv << megabytes << " MB: simd "sv << megabytes / (simd_ns / 1e9)
+        << " MB/s, scalar "sv << megabytes / (scalar_ns / 1e9) << " MB/s"sv << endl;
+}
+
+// Запуск программы с разбором исходника и с загрузкой дерева из кэша. Оба варианта
+// включают хеширование исходника, которым проверяется актуальность кэша
+void BenchmarkProgramCache(ostream& out) {
+    const string program = ManyMethodsProgram(500);
+    const string path = (filesystem::temp_directory_path() / "mython_bench.myc").string();
+    runtime::DummyContext context;
+
+    double parse_ns = MeasureNs([&] {
+        const uint64_t hash = ast::HashSource(program);
+        auto tree = ParseFromString(program);
+        cache::SaveProgram(path, *tree, hash);
+        runtime::Closure closure;
+        tree->Execute(closure, context);
+    });
+    double cache_ns = MeasureNs([&] {
+        auto tree = cache::LoadProgram(path, ast::HashSource(program));
+        runtime::Closure closure;
+        tree->Execute(closure, context);
+    });
+    out << "program cache, "sv << filesystem::file_size(path) << " bytes: parse and save "sv
+        << parse_ns / 1e6 << " ms, load "sv << cache_ns / 1e6 << " ms"sv << endl;
+    std::remove(path.c_str());
+}
+
+// Время работы проходов и время исполнения программы на каждом уровне оптимизации
+void BenchmarkOptimizationLevels(ostream& out, string_view name, const string& program,
+                                 int repeats) {
+    out << "optimization levels, "sv << name << ':' << endl;
+    for (auto level : {opt::OptimizationLevel::O0, opt::OptimizationLevel::O1,
+                       opt::OptimizationLevel::O2}){
+        auto tree = ParseFromString(program);
+        opt::PassManager passes = opt::CreatePassManager(level);
+        passes.Run(tree);
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        double ns = MeasureNs([&] {
+            for (int i = 0; i < repeats; ++i){
+                tree->Execute(closure, context);
+            }
+        });
+        out << "  O"sv << static_cast<int>(level) << ": "sv << ns / repeats / 1e3 << " us/run"sv
+            << endl;
+        passes.PrintStatistics(out);
+    }
+}
+
+}  // namespace
+
+void RunBenchmarks(ostream& out) {
+    BenchmarkThreadedDispatch(out);
+    BenchmarkTiers(out);
+    BenchmarkLazyParsing(out);
+    BenchmarkProgramCache(out);
+    BenchmarkScan(out);
+    BenchmarkLexer(out, "methods"sv, ManyMethodsProgram(20000));
+    BenchmarkLexer(out, "sparse"sv, SparseProgram(100000));
+    BenchmarkPipelinedLexing(out, ManyMethodsProgram(20000));
+    BenchmarkParallelLexing(out, ManyMethodsProgram(100000));
+    BenchmarkExpressionParsing(out, ExpressionProgram(50000));
+    BenchmarkOptimizationLevels(out, "straight line"sv, StraightLineProgram(200), 50);
+    BenchmarkOptimizationLevels(out, "accessors"sv, AccessorProgram(300), 50);
+    BenchmarkOptimizationLevels(out, "field chains"sv, FieldChainProgram(300), 50);
+    BenchmarkOptimizationLevels(out, "recursion"sv, RecursionProgram(), 3);
+}
+
+}  // namespace bench
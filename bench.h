@@ -0,0 +1,10 @@
+#pragma once
+
+#include <iosfwd>
+
+namespace bench {
+
+// Запускает замеры производительности интерпретатора и выводит результаты в out
+void RunBenchmarks(std::ostream& out);
+
+}  // namespace bench
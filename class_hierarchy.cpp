@@ -0,0 +1,195 @@
+#include "class_hierarchy.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+bool IsSubclassOf(const runtime::Class* cls, const runtime::Class* base) {
+    for (; cls; cls = cls->GetParent()){
+        if (cls == base){
+            return true;
+        }
+    }
+    return false;
+}
+
+// Связывает вызовы в поддереве, не заходя в тела методов: они обрабатываются отдельно,
+// с известным классом self
+class Devirtualizer {
+public:
+    DevirtualizationStats stats;
+
+    Devirtualizer(const vector<const runtime::Class*>& classes, const ProgramProfile* profile)
+        : classes_(classes), profile_(profile) {
+
+    }
+
+    // Класс, в методе которого находится обрабатываемый код, либо nullptr на верхнем уровне
+    void SetSelfClass(const runtime::Class* cls) {
+        self_class_ = cls;
+    }
+
+    void Process(unique_ptr<Statement>& slot) {
+        if (!dynamic_cast<ClassDefinition*>(slot.get())){
+            ForEachChild(*slot, [this](unique_ptr<Statement>& child) {
+                Process(child);
+            });
+        }
+        Bind(slot);
+    }
+
+private:
+    const vector<const runtime::Class*>& classes_;
+    const ProgramProfile* profile_;
+    const runtime::Class* self_class_ = nullptr;
+
+    void Bind(unique_ptr<Statement>& node) {
+        auto* call = dynamic_cast<MethodCall*>(node.get());
+        if (!call){
+            return;
+        }
+
+        const runtime::Method* target = nullptr;
+        for (const runtime::Class* cls : GetReceiverClasses(*call->object_)){
+            const runtime::Method* method = cls->GetMethod(call->method_, call->args_.size());
+            if (!method){
+                continue;
+            }
+            if (target && target != method){
+                target = GetProfiledTarget(*call);
+                if (!target){
+                    stats.polymorphic++;
+                    return;
+                }
+                stats.speculative++;
+                break;
+            }
+            target = method;
+        }
+        if (!target){
+            stats.unresolved++;
+            return;
+        }
+
+        // Связанный вызов проверяет класс получателя среди всех классов программы,
+        // поэтому остаётся верным и для получателей, не учтённых анализом
+        vector<const runtime::Class*> classes;
+        for (const runtime::Class* cls : classes_){
+            if (cls->GetMethod(call->method_, call->args_.size()) == target){
+                classes.push_back(cls);
+            }
+        }
+        node = make_unique<BoundMethodCall>(std::move(call->object_), std::move(call->method_),
+                                            std::move(call->args_), *target, std::move(classes));
+        stats.bound++;
+    }
+
+    // Реализация метода в единственном классе получателя, наблюдавшемся в месте вызова
+    const runtime::Method* GetProfiledTarget(const MethodCall& call) const {
+        const SiteProfile* site = profile_ ? profile_->Find(call) : nullptr;
+        const string* name = site ? GetSingleType(site->receivers) : nullptr;
+        if (!name){
+            return nullptr;
+        }
+        for (const runtime::Class* cls : classes_){
+            if (cls->GetName().Str() == *name){
+                return cls->GetMethod(call.method_, call.args_.size());
+            }
+        }
+        return nullptr;
+    }
+
+    vector<const runtime::Class*> GetReceiverClasses(const Statement& object) const {
+        auto* var = dynamic_cast<const VariableValue*>(&object);
+        if (self_class_ && var && var->dotted_ids_ == vector<symbols::Symbol>{runtime::names::SELF}){
+            vector<const runtime::Class*> result;
+            for (const runtime::Class* cls : classes_){
+                if (IsSubclassOf(cls, self_class_)){
+                    result.push_back(cls);
+                }
+            }
+            return result;
+        }
+        return classes_;
+    }
+};
+
+}  // namespace
+
+BoundMethodCall::BoundMethodCall(unique_ptr<Statement> object, symbols::Symbol method,
+                                 vector<unique_ptr<Statement>> args, const runtime::Method& target,
+                                 vector<const runtime::Class*> classes)
+    : object_(std::move(object)), method_(method), args_(std::move(args)),
+    target_(&target), classes_(std::move(classes)) {
+
+}
+
+ObjectHolder BoundMethodCall::Execute(Closure& closure, Context& context) {
+    ObjectHolder object = object_->Execute(closure, context);
+    auto* instance = object.TryAs<runtime::ClassInstance>();
+    if (!instance){
+        return ObjectHolder::None();
+    }
+
+    const bool is_bound = find(classes_.begin(), classes_.end(), &instance->GetClass())
+                          != classes_.end();
+    if (!is_bound && !instance->HasMethod(method_, args_.size())){
+        return ObjectHolder::None();
+    }
+
+    vector<ObjectHolder> args;
+    args.reserve(args_.size());
+    for (auto& arg : args_){
+        args.push_back(arg->Execute(closure, context));
+    }
+    return is_bound ? instance->CallMethod(*target_, args, context)
+                    : instance->Call(method_, args, context);
+}
+
+void BoundMethodCall::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(object_);
+    for (auto& arg : args_){
+        fn(arg);
+    }
+}
+
+unique_ptr<Statement> BoundMethodCall::Clone() const {
+    auto object = ast::Clone(*object_);
+    if (!object){
+        return nullptr;
+    }
+    vector<unique_ptr<Statement>> args;
+    for (const auto& arg : args_){
+        args.push_back(ast::Clone(*arg));
+        if (!args.back()){
+            return nullptr;
+        }
+    }
+    return make_unique<BoundMethodCall>(std::move(object), method_, std::move(args), *target_, classes_);
+}
+
+DevirtualizationStats DevirtualizeCalls(unique_ptr<Statement>& program,
+                                        const ProgramProfile* profile) {
+    const vector<const runtime::Class*> classes = CollectClasses(*program);
+    const vector<ClassMethod> methods = CollectMethods(*program);
+
+    Devirtualizer devirtualizer(classes, profile);
+    devirtualizer.Process(program);
+    for (const auto& [cls, method, body] : methods){
+        if (body){
+            devirtualizer.SetSelfClass(cls);
+            devirtualizer.Process(body->body_);
+        }
+    }
+    return devirtualizer.stats;
+}
+
+}  // namespace ast
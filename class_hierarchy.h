@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ast_utils.h"
+#include "profile.h"
+#include "statement.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+Анализ иерархии классов программы. Все классы известны после разбора и не меняются
+во время исполнения, поэтому для вызова метода можно заранее найти все реализации,
+доступные для возможных классов получателя
+*/
+namespace ast {
+
+/*
+Вызов object.method(args), связанный с единственной реализацией target_.
+Если класс получателя входит в classes_ (классы, для которых поиск метода находит
+target_), метод вызывается без поиска по имени. Иначе выполняется обычный вызов,
+как в MethodCall
+*/
+class BoundMethodCall : public Statement, public CompositeNode {
+public:
+    BoundMethodCall(std::unique_ptr<Statement> object, symbols::Symbol method,
+                    std::vector<std::unique_ptr<Statement>> args, const runtime::Method& target,
+                    std::vector<const runtime::Class*> classes);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    [[nodiscard]] std::unique_ptr<Statement> Clone() const override;
+
+    std::unique_ptr<Statement> object_;
+    symbols::Symbol method_;
+    std::vector<std::unique_ptr<Statement>> args_;
+    const runtime::Method* target_;
+    std::vector<const runtime::Class*> classes_;
+};
+
+struct DevirtualizationStats {
+    // Вызовов, связанных с единственной реализацией
+    size_t bound = 0;
+    // Из них связанных с реализацией в классе получателя, наблюдавшемся по профилю
+    size_t speculative = 0;
+    // Вызовов, для которых доступно несколько реализаций
+    size_t polymorphic = 0;
+    // Вызовов методов, не найденных ни в одном из возможных классов получателя
+    size_t unresolved = 0;
+};
+
+/*
+Связывает вызовы методов с реализациями. Возможные классы получателя:
+для self внутри метода класса C - C и его наследники, для прочих выражений -
+все классы программы. Если реализаций несколько, а в профиле место вызова видело
+единственный класс получателя, вызов связывается с реализацией этого класса
+*/
+DevirtualizationStats DevirtualizeCalls(std::unique_ptr<Statement>& program,
+                                        const ProgramProfile* profile = nullptr);
+
+}  // namespace ast
@@ -0,0 +1,117 @@
+#include "class_hierarchy.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+// Проход без профиля
+const auto DEVIRTUALIZE = [](unique_ptr<Statement>& tree) {
+    return DevirtualizeCalls(tree);
+};
+
+void TestMonomorphicCalls() {
+    const string program = R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+
+  def title():
+    return 'shape ' + self.name
+
+class Square(Shape):
+  def area(a):
+    return a * a
+
+if 1 < 2:
+  s = Square('sq')
+else:
+  s = Shape('base')
+print s.title(), s.area(3)
+)"s;
+    DevirtualizationStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, DEVIRTUALIZE, stats), "shape sq 9\n"s);
+    // title не переопределён, area есть только у Square
+    ASSERT_EQUAL(stats.bound, 2U);
+    ASSERT_EQUAL(stats.polymorphic, 0U);
+}
+
+void TestPolymorphicCalls() {
+    const string program = R"(
+class Animal:
+  def sound():
+    return '...'
+
+  def speak():
+    return self.sound() + '!'
+
+class Dog(Animal):
+  def sound():
+    return 'woof'
+
+class Cat(Animal):
+  def sound():
+    return 'meow'
+
+  def purr():
+    return self.sound() + ' purr'
+
+a = Animal()
+d = Dog()
+c = Cat()
+print a.speak(), d.speak(), c.speak(), c.purr()
+print d.sound()
+)"s;
+    DevirtualizationStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, DEVIRTUALIZE, stats), "...! woof! meow! meow purr\nwoof\n"s);
+    // self.sound() в Animal.speak и d.sound() могут вызвать любую из трёх реализаций,
+    // прочие вызовы связаны
+    ASSERT_EQUAL(stats.polymorphic, 2U);
+    ASSERT_EQUAL(stats.bound, 5U);
+}
+
+void TestUnresolvedCalls() {
+    const string program = R"(
+class A:
+  def f():
+    return 1
+
+a = A()
+x = 5
+print a.g(), x.f(), a.f(1), a.f()
+)"s;
+    DevirtualizationStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, DEVIRTUALIZE, stats), "None None None 1\n"s);
+    ASSERT_EQUAL(stats.unresolved, 2U);
+    ASSERT_EQUAL(stats.bound, 2U);
+}
+
+void TestClone() {
+    auto program = ParseFromString(R"(
+class A:
+  def f(n):
+    return n + 1
+
+a = A()
+print a.f(1)
+)"s);
+    ASSERT_EQUAL(DevirtualizeCalls(program).bound, 1U);
+    auto copy = Clone(*program);
+    ASSERT(copy);
+    ASSERT_EQUAL(Execute(*copy), "2\n"s);
+}
+
+}  // namespace
+
+void RunClassHierarchyTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestMonomorphicCalls);
+    RUN_TEST(tr, ast::TestPolymorphicCalls);
+    RUN_TEST(tr, ast::TestUnresolvedCalls);
+    RUN_TEST(tr, ast::TestClone);
+}
+
+}  // namespace ast
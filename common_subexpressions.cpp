@@ -0,0 +1,359 @@
+#include "common_subexpressions.h"
+
+#include "class_hierarchy.h"
+#include "inlining.h"
+
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+string JoinIds(const vector<symbols::Symbol>& ids) {
+    string result;
+    for (const symbols::Symbol id : ids){
+        result += id.Str();
+        result += '.';
+    }
+    return result;
+}
+
+class Eliminator {
+public:
+    SubexpressionStats stats;
+
+    explicit Eliminator(const unordered_set<symbols::Symbol>& methods)
+        : user_str_(methods.count(runtime::names::STR) > 0),
+        user_add_(methods.count(runtime::names::ADD) > 0),
+        user_compare_(methods.count(runtime::names::EQ) > 0 || methods.count(runtime::names::LT) > 0) {
+
+    }
+
+    /*
+    Обрабатывает независимый блок кода: программу или тело метода. Если release == true
+    и блок - Compound, слоты блока удаляются после последней читающей их инструкции
+    */
+    void ProcessBlock(unique_ptr<Statement>& block, bool release) {
+        available_.clear();
+        auto* compound = release ? dynamic_cast<Compound*>(block.get()) : nullptr;
+        if (!compound){
+            block_ = nullptr;
+            Process(block, true);
+            return;
+        }
+        block_ = compound;
+        for (statement_ = 0; statement_ < compound->args_.size(); ++statement_){
+            Process(compound->args_[statement_], true);
+        }
+        block_ = nullptr;
+    }
+
+    /*
+    Отменяет сохранение цепочек, повторные чтения которых не окупают запись в слот,
+    и добавляет удаление оставшихся слотов
+    */
+    void Finish() {
+        // Слоты, удаляемые после инструкции блока с данным номером
+        map<Compound*, map<size_t, vector<symbols::Symbol>>> releases;
+        for (const Definition& definition : definitions_){
+            auto& load = static_cast<ChainLoad&>(**definition.slot);
+            // Каждое повторное чтение экономит поиск всех имён цепочки, кроме одного,
+            // а запись в слот стоит одного поиска
+            const size_t reuses = definition.uses.size();
+            if (reuses * (load.value_.dotted_ids_.size() - 1) > 1){
+                stats.chains_loaded++;
+                stats.reads_reused += reuses;
+                if (definition.inlined){
+                    definition.inlined->slots_.push_back(load.slot_);
+                } else if (definition.block){
+                    releases[definition.block][definition.last_statement].push_back(load.slot_);
+                }
+                continue;
+            }
+            for (unique_ptr<Statement>* use : definition.uses){
+                *use = make_unique<VariableValue>(load.value_);
+            }
+            *definition.slot = make_unique<VariableValue>(load.value_);
+        }
+        definitions_.clear();
+
+        // Вставка сдвигает инструкции блока, поэтому идёт с конца
+        for (auto& [block, statements] : releases){
+            for (auto it = statements.rbegin(); it != statements.rend(); ++it){
+                block->args_.insert(block->args_.begin() + static_cast<ptrdiff_t>(it->first) + 1,
+                                    make_unique<ReleaseSlots>(std::move(it->second)));
+            }
+        }
+    }
+
+private:
+    struct Available {
+        vector<symbols::Symbol> ids;
+        symbols::Symbol slot;
+        size_t definition;
+    };
+
+    struct Definition {
+        unique_ptr<Statement>* slot;
+        // Повторные чтения, заменённые чтением слота
+        vector<unique_ptr<Statement>*> uses;
+        // Блок, после инструкции last_statement которого слот больше не читается, либо nullptr
+        Compound* block;
+        size_t last_statement;
+        // Встроенный вызов, в теле которого определён слот, либо nullptr
+        InlinedCall* inlined;
+    };
+
+    const bool user_str_;
+    const bool user_add_;
+    const bool user_compare_;
+    unordered_map<string, Available> available_;
+    vector<Definition> definitions_;
+    size_t slot_count_ = 0;
+    // Обрабатываемый блок и номер его инструкции верхнего уровня
+    Compound* block_ = nullptr;
+    size_t statement_ = 0;
+    // Встроенный вызов, тело которого обрабатывается, либо nullptr
+    InlinedCall* inlined_ = nullptr;
+
+    /*
+    Обрабатывает узел в порядке исполнения. may_define == false для выражений,
+    которые исполняются не всегда или в неизвестном порядке: в них сохранённые цепочки
+    используются, но новые не сохраняются
+    */
+    void Process(unique_ptr<Statement>& slot, bool may_define) {
+        Statement& node = *slot;
+        if (auto* var = dynamic_cast<VariableValue*>(&node)){
+            ProcessRead(slot, *var, may_define);
+        } else if (auto* assign = dynamic_cast<Assignment*>(&node)){
+            Process(assign->rv_, may_define);
+            Kill(assign->var_);
+        } else if (auto* field = dynamic_cast<FieldAssignment*>(&node)){
+            // Правая часть вычисляется, только если объект - экземпляр класса
+            Process(field->rv_, false);
+            available_.clear();
+        } else if (auto* print = dynamic_cast<Print*>(&node)){
+            // Каждый аргумент выводится сразу после вычисления
+            for (auto& arg : print->args_){
+                Process(arg, may_define);
+                if (user_str_){
+                    available_.clear();
+                }
+            }
+        } else if (auto* call = dynamic_cast<MethodCall*>(&node)){
+            ProcessCall(call->object_, call->args_, may_define);
+        } else if (auto* call = dynamic_cast<BoundMethodCall*>(&node)){
+            ProcessCall(call->object_, call->args_, may_define);
+        } else if (auto* instance = dynamic_cast<NewInstance*>(&node)){
+            for (auto& arg : instance->args_){
+                Process(arg, false);
+            }
+            if (instance->obj_.TryAs<runtime::ClassInstance>()->HasMethod(runtime::names::INIT,
+                                                                          instance->args_.size())){
+                available_.clear();
+            }
+        } else if (auto* stringify = dynamic_cast<Stringify*>(&node)){
+            Process(stringify->statement_, may_define);
+            if (user_str_){
+                available_.clear();
+            }
+        } else if (auto* not_node = dynamic_cast<Not*>(&node)){
+            Process(not_node->statement_, may_define);
+        } else if (auto* cmp = dynamic_cast<Comparison*>(&node)){
+            // Порядок вычисления аргументов функции сравнения не определён
+            Process(cmp->lhs_, false);
+            Process(cmp->rhs_, false);
+            if (user_compare_){
+                available_.clear();
+            }
+        } else if (auto* binary = dynamic_cast<BinaryOperation*>(&node)){
+            Process(binary->lhs_, may_define);
+            Process(binary->rhs_, may_define);
+            if (user_add_ && dynamic_cast<Add*>(&node)){
+                available_.clear();
+            }
+        } else if (auto* compound = dynamic_cast<Compound*>(&node)){
+            for (auto& stmt : compound->args_){
+                Process(stmt, may_define);
+            }
+        } else if (auto* ret = dynamic_cast<Return*>(&node)){
+            Process(ret->statement_, may_define);
+        } else if (auto* if_else = dynamic_cast<IfElse*>(&node)){
+            ProcessIfElse(*if_else, may_define);
+        } else if (auto* definition = dynamic_cast<ClassDefinition*>(&node)){
+            Kill(definition->cls_.TryAs<runtime::Class>()->GetName());
+        } else if (auto* inlined = dynamic_cast<InlinedCall*>(&node)){
+            ProcessInlinedCall(*inlined, may_define);
+        } else if (!dynamic_cast<NumericConst*>(&node) && !dynamic_cast<StringConst*>(&node)
+                   && !dynamic_cast<BoolConst*>(&node) && !dynamic_cast<None*>(&node)){
+            // Неизвестный узел может изменить любое поле
+            available_.clear();
+        }
+    }
+
+    void ProcessRead(unique_ptr<Statement>& slot, const VariableValue& var, bool may_define) {
+        if (var.dotted_ids_.size() < 2){
+            return;
+        }
+        const string key = JoinIds(var.dotted_ids_);
+        if (auto it = available_.find(key); it != available_.end()){
+            Definition& definition = definitions_[it->second.definition];
+            definition.uses.push_back(&slot);
+            definition.last_statement = statement_;
+            slot = make_unique<VariableValue>(it->second.slot);
+        } else if (may_define){
+            const symbols::Symbol name("%cse"s + to_string(slot_count_++));
+            available_[key] = {var.dotted_ids_, name, definitions_.size()};
+            definitions_.push_back({&slot, {}, block_, statement_, inlined_});
+            VariableValue value = var;
+            slot = make_unique<ChainLoad>(name, std::move(value));
+        }
+    }
+
+    void ProcessCall(unique_ptr<Statement>& object, vector<unique_ptr<Statement>>& args,
+                     bool may_define) {
+        Process(object, may_define);
+        // Аргументы вычисляются, только если у объекта есть метод
+        for (auto& arg : args){
+            Process(arg, false);
+        }
+        available_.clear();
+    }
+
+    void ProcessIfElse(IfElse& node, bool may_define) {
+        Process(node.condition_, may_define);
+        // Условие-объект приводится к логическому значению через __str__
+        if (user_str_){
+            available_.clear();
+        }
+        auto before = available_;
+        Process(node.if_body_, may_define);
+        auto after_if = std::move(available_);
+        available_ = std::move(before);
+        if (node.else_body_){
+            Process(node.else_body_, may_define);
+        }
+        // После if доступны цепочки, сохранённые до него и не изменённые ни в одной ветке
+        for (auto it = available_.begin(); it != available_.end();){
+            auto other = after_if.find(it->first);
+            if (other == after_if.end() || other->second.slot != it->second.slot){
+                it = available_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void ProcessInlinedCall(InlinedCall& node, bool may_define) {
+        Process(node.object_, may_define);
+        for (auto& arg : node.args_){
+            Process(arg, false);
+        }
+        // Тело исполняется, только если класс получателя совпал, и присваивает self
+        available_.clear();
+        InlinedCall* outer = inlined_;
+        inlined_ = &node;
+        for (auto& stmt : node.body_){
+            Process(stmt, true);
+        }
+        if (node.result_){
+            Process(node.result_, true);
+        }
+        inlined_ = outer;
+        available_.clear();
+    }
+
+    // Удаляет цепочки, значение которых зависит от переменной name
+    void Kill(symbols::Symbol name) {
+        for (auto it = available_.begin(); it != available_.end();){
+            if (DependsOn(it->second.ids, name)){
+                it = available_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    static bool DependsOn(const vector<symbols::Symbol>& ids, symbols::Symbol name) {
+        // Если в замыкании нет self, VariableValue пропускает это имя, поэтому цепочка
+        // self.x читает переменную x
+        for (const symbols::Symbol id : ids){
+            if (id == name){
+                return true;
+            }
+            if (id != runtime::names::SELF){
+                return false;
+            }
+        }
+        return false;
+    }
+};
+
+}  // namespace
+
+ChainLoad::ChainLoad(symbols::Symbol slot, VariableValue value)
+    : slot_(slot), value_(std::move(value)) {
+
+}
+
+ObjectHolder ChainLoad::Execute(Closure& closure, Context& context) {
+    ObjectHolder value = value_.Execute(closure, context);
+    closure[slot_] = value;
+    return value;
+}
+
+void ChainLoad::ForEachChild([[maybe_unused]] const function<void(unique_ptr<Statement>&)>& fn) {
+
+}
+
+unique_ptr<Statement> ChainLoad::Clone() const {
+    return make_unique<ChainLoad>(slot_, value_);
+}
+
+ReleaseSlots::ReleaseSlots(vector<symbols::Symbol> slots)
+    : slots_(std::move(slots)) {
+
+}
+
+ObjectHolder ReleaseSlots::Execute(Closure& closure, [[maybe_unused]] Context& context) {
+    for (const symbols::Symbol slot : slots_){
+        closure.erase(slot);
+    }
+    return ObjectHolder::None();
+}
+
+void ReleaseSlots::ForEachChild([[maybe_unused]] const function<void(unique_ptr<Statement>&)>& fn) {
+
+}
+
+unique_ptr<Statement> ReleaseSlots::Clone() const {
+    return make_unique<ReleaseSlots>(slots_);
+}
+
+SubexpressionStats EliminateCommonSubexpressions(unique_ptr<Statement>& program) {
+    const vector<ClassMethod> methods = CollectMethods(*program);
+    unordered_set<symbols::Symbol> names;
+    for (const ClassMethod& method : methods){
+        names.insert(method.method->name);
+    }
+
+    Eliminator eliminator(names);
+    eliminator.ProcessBlock(program, true);
+    for (const ClassMethod& method : methods){
+        if (method.body){
+            eliminator.ProcessBlock(method.body->body_, false);
+        }
+    }
+    eliminator.Finish();
+    return eliminator.stats;
+}
+
+}  // namespace ast
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ast_utils.h"
+#include "statement.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+Устранение общих подвыражений для чтения цепочек полей вида self.a.b.c.
+Первое чтение цепочки сохраняет значение во временный слот замыкания, повторные чтения
+того же блока заменяются чтением слота, пока значение цепочки не могло измениться.
+Слоты удаляются из замыкания, когда блок больше их не читает
+*/
+namespace ast {
+
+/*
+Чтение цепочки value_ с сохранением результата в слот slot_ замыкания.
+Имена слотов начинаются с '%' и не пересекаются с именами переменных программы
+*/
+class ChainLoad : public Statement, public CompositeNode {
+public:
+    ChainLoad(symbols::Symbol slot, VariableValue value);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    [[nodiscard]] std::unique_ptr<Statement> Clone() const override;
+
+    symbols::Symbol slot_;
+    VariableValue value_;
+};
+
+// Удаляет из замыкания слоты slots_, которые больше не читаются
+class ReleaseSlots : public Statement, public CompositeNode {
+public:
+    explicit ReleaseSlots(std::vector<symbols::Symbol> slots);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    [[nodiscard]] std::unique_ptr<Statement> Clone() const override;
+
+    std::vector<symbols::Symbol> slots_;
+};
+
+struct SubexpressionStats {
+    // Цепочек, сохранённых во временные слоты
+    size_t chains_loaded = 0;
+    // Чтений цепочек, заменённых чтением слота
+    size_t reads_reused = 0;
+};
+
+/*
+Заменяет повторные чтения цепочек из двух и более имён. Значение цепочки считается
+неизменным, пока не выполнено присваивание её первому имени, присваивание полю
+любого объекта или вызов пользовательского кода (методы, __init__, а также __str__,
+__add__, __eq__, __lt__, если они объявлены в программе). Ветки if обрабатываются
+отдельно, тело каждого метода - с пустым набором сохранённых цепочек.
+Слоты программы удаляются инструкцией ReleaseSlots после последней инструкции верхнего
+уровня, которая их читает, слоты встроенного тела - вместе со слотами InlinedCall.
+Тело метода исполняется в замыкании вызова, которое удаляется при возврате, поэтому
+его слоты отдельно не удаляются
+*/
+SubexpressionStats EliminateCommonSubexpressions(std::unique_ptr<Statement>& program);
+
+}  // namespace ast
@@ -0,0 +1,162 @@
+#include "common_subexpressions.h"
+#include "inlining.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+const string POINT_CLASSES = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+class Segment:
+  def __init__(a, b):
+    self.a = a
+    self.b = b
+)"s;
+
+void TestRepeatedChains() {
+    const string program = POINT_CLASSES + R"(
+class Geometry:
+  def __init__(segment):
+    self.segment = segment
+
+  def dx2():
+    d = self.segment.b.x - self.segment.a.x
+    return d * d + self.segment.b.x * self.segment.a.x
+
+s = Segment(Point(1, 2), Point(4, 6))
+g = Geometry(s)
+print g.dx2()
+y = s.a.y + s.b.y + s.a.y * s.b.y
+print y
+)"s;
+    SubexpressionStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateCommonSubexpressions, stats), "13\n20\n"s);
+    ASSERT_EQUAL(stats.chains_loaded, 4U);
+    ASSERT_EQUAL(stats.reads_reused, 4U);
+}
+
+void TestFieldAssignmentInvalidates() {
+    const string program = POINT_CLASSES + R"(
+p = Point(1, 2)
+s = Segment(p, p)
+a = s.a.x + s.a.x
+s.a.x = 10
+b = s.a.x + s.a.x
+p.x = 20
+c = s.b.x + s.a.x
+print a, b, c
+)"s;
+    SubexpressionStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateCommonSubexpressions, stats), "2 20 40\n"s);
+    ASSERT_EQUAL(stats.chains_loaded, 2U);
+    ASSERT_EQUAL(stats.reads_reused, 2U);
+}
+
+void TestAssignmentAndCallsInvalidate() {
+    const string program = POINT_CLASSES + R"(
+class Mover:
+  def move(p):
+    p.x = p.x + 1
+
+m = Mover()
+p = Point(1, 2)
+a = p.x * p.x
+m.move(p)
+b = p.x * p.x
+p = Point(7, 0)
+c = p.x * p.x
+print a, b, c
+)"s;
+    SubexpressionStats stats;
+    // Цепочки из двух имён с одним повторным чтением не сохраняются
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateCommonSubexpressions, stats), "1 4 49\n"s);
+    ASSERT_EQUAL(stats.chains_loaded, 0U);
+}
+
+void TestBranches() {
+    const string program = POINT_CLASSES + R"(
+s = Segment(Point(1, 2), Point(3, 4))
+t = s.a.x + s.a.x
+if t > 1:
+  s.a.x = 5
+  u = s.a.x + s.a.x + s.a.x
+else:
+  u = s.a.x + s.a.x + s.a.x
+v = s.a.x + s.a.x + s.a.x
+print t, u, v
+)"s;
+    SubexpressionStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateCommonSubexpressions, stats), "2 15 15\n"s);
+    // Сохранённая до if цепочка используется в ветке else, но не после if
+    ASSERT_EQUAL(stats.chains_loaded, 3U);
+    ASSERT_EQUAL(stats.reads_reused, 8U);
+}
+
+void TestUserStrInvalidates() {
+    const string program = POINT_CLASSES + R"(
+class Noisy:
+  def __init__(p):
+    self.p = p
+
+  def __str__():
+    self.p.x = self.p.x + 1
+    return 'noisy'
+
+s = Segment(Point(1, 2), Point(3, 4))
+n = Noisy(s.a)
+print s.a.x, n, s.a.x, s.a.x
+)"s;
+    SubexpressionStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateCommonSubexpressions, stats), "1 noisy 2 2\n"s);
+}
+
+void TestSlotsAreReleased() {
+    const string program = POINT_CLASSES + R"(
+class Box:
+  def __init__(s):
+    self.s = s
+
+  def area():
+    return self.s.b.x * self.s.b.x + self.s.a.y * self.s.a.y
+
+s = Segment(Point(1, 2), Point(4, 6))
+b = Box(s)
+print b.area()
+y = s.a.y + s.a.y
+print y
+)"s;
+    auto tree = ParseFromString(program);
+    ASSERT_EQUAL(InlineMethods(tree).inlined, 1U);
+    // Цепочки тела метода, встроенного тела и программы
+    ASSERT_EQUAL(EliminateCommonSubexpressions(tree).chains_loaded, 5U);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "20\n4\n"s);
+    for (const auto& [name, value] : closure){
+        ASSERT(name.Str().front() != '%');
+    }
+}
+
+}  // namespace
+
+void RunSubexpressionTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestRepeatedChains);
+    RUN_TEST(tr, ast::TestFieldAssignmentInvalidates);
+    RUN_TEST(tr, ast::TestAssignmentAndCallsInvalidate);
+    RUN_TEST(tr, ast::TestBranches);
+    RUN_TEST(tr, ast::TestUserStrInvalidates);
+    RUN_TEST(tr, ast::TestSlotsAreReleased);
+}
+
+}  // namespace ast
@@ -0,0 +1,225 @@
+#include "constant_folding.h"
+
+#include "ast_utils.h"
+
+#include <optional>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::ObjectHolder;
+
+namespace {
+
+optional<ObjectHolder> GetConstant(Statement& node) {
+    if (auto* num = dynamic_cast<NumericConst*>(&node)){
+        return ObjectHolder::Share(num->value_);
+    }
+    if (auto* str = dynamic_cast<StringConst*>(&node)){
+        return ObjectHolder::Share(str->value_);
+    }
+    if (auto* boolean = dynamic_cast<BoolConst*>(&node)){
+        return ObjectHolder::Share(boolean->value_);
+    }
+    if (dynamic_cast<None*>(&node)){
+        return ObjectHolder::None();
+    }
+    return nullopt;
+}
+
+unique_ptr<Statement> MakeConstant(const ObjectHolder& value) {
+    if (auto* num = value.TryAs<runtime::Number>()){
+        return make_unique<NumericConst>(num->GetValue());
+    }
+    if (auto* str = value.TryAs<runtime::String>()){
+        return make_unique<StringConst>(str->GetValue());
+    }
+    if (auto* boolean = value.TryAs<runtime::Bool>()){
+        return make_unique<BoolConst>(runtime::Bool(boolean->GetValue()));
+    }
+    if (!value){
+        return make_unique<None>();
+    }
+    return nullptr;
+}
+
+bool IsNumericConst(const Statement& node, int value) {
+    auto* num = dynamic_cast<const NumericConst*>(&node);
+    return num && num->value_.GetValue() == value;
+}
+
+// Выражение, результатом которого может быть только число (либо ошибка)
+bool IsNumericExpr(const Statement& node) {
+    return dynamic_cast<const NumericConst*>(&node) || dynamic_cast<const Sub*>(&node)
+        || dynamic_cast<const Mult*>(&node) || dynamic_cast<const Div*>(&node);
+}
+
+// Выражение, результатом которого может быть только Bool (либо ошибка)
+bool IsBoolExpr(const Statement& node) {
+    return dynamic_cast<const BoolConst*>(&node) || dynamic_cast<const Not*>(&node)
+        || dynamic_cast<const Comparison*>(&node) || dynamic_cast<const Or*>(&node)
+        || dynamic_cast<const And*>(&node);
+}
+
+class Folder : public Rewriter {
+public:
+    FoldingStats stats;
+
+protected:
+    void Leave(unique_ptr<Statement>& node) override {
+        if (auto folded = TryEvaluate(*node)){
+            node = std::move(folded);
+            stats.folded++;
+        } else if (auto* if_else = dynamic_cast<IfElse*>(node.get())){
+            TryEliminateBranch(node, *if_else);
+        } else if (TrySimplify(node)){
+            stats.simplified++;
+        }
+    }
+
+private:
+    runtime::DummyContext context_;
+
+    // Вычисляет узел с постоянными операндами. Возвращает nullptr, если узел
+    // не сворачивается либо его вычисление завершилось бы ошибкой
+    unique_ptr<Statement> TryEvaluate(Statement& node) {
+        try {
+            if (auto* binary = dynamic_cast<BinaryOperation*>(&node)){
+                auto lhs = GetConstant(*binary->lhs_);
+                auto rhs = GetConstant(*binary->rhs_);
+                if (!lhs || !rhs){
+                    return nullptr;
+                }
+                return MakeConstant(EvaluateBinary(*binary, *lhs, *rhs));
+            }
+            if (auto* negation = dynamic_cast<Not*>(&node)){
+                if (!dynamic_cast<BoolConst*>(negation->statement_.get())){
+                    return nullptr;
+                }
+                return MakeConstant(Not::Apply(*GetConstant(*negation->statement_), context_));
+            }
+            if (auto* stringify = dynamic_cast<Stringify*>(&node)){
+                auto arg = GetConstant(*stringify->statement_);
+                return arg ? MakeConstant(Stringify::Apply(*arg, context_)) : nullptr;
+            }
+        } catch (const std::runtime_error&) {
+        }
+        return nullptr;
+    }
+
+    ObjectHolder EvaluateBinary(BinaryOperation& node, const ObjectHolder& lhs,
+                                const ObjectHolder& rhs) {
+        if (dynamic_cast<Add*>(&node)){
+            return Add::Apply(lhs, rhs, context_);
+        }
+        if (dynamic_cast<Sub*>(&node)){
+            return Sub::Apply(lhs, rhs, context_);
+        }
+        if (dynamic_cast<Mult*>(&node)){
+            return Mult::Apply(lhs, rhs, context_);
+        }
+        if (dynamic_cast<Div*>(&node)){
+            auto* divisor = rhs.TryAs<runtime::Number>();
+            if (divisor && divisor->GetValue() == 0){
+                throw std::runtime_error("Division by zero"s);
+            }
+            return Div::Apply(lhs, rhs, context_);
+        }
+        if (dynamic_cast<Or*>(&node)){
+            return Or::Apply(lhs, rhs, context_);
+        }
+        if (dynamic_cast<And*>(&node)){
+            return And::Apply(lhs, rhs, context_);
+        }
+        if (auto* cmp = dynamic_cast<Comparison*>(&node); cmp && GetCompareFunction(cmp->cmp_)){
+            return ObjectHolder::Own(runtime::Bool(cmp->cmp_(lhs, rhs, context_)));
+        }
+        throw std::runtime_error("Not foldable"s);
+    }
+
+    void TryEliminateBranch(unique_ptr<Statement>& node, IfElse& if_else) {
+        auto condition = GetConstant(*if_else.condition_);
+        if (!condition || !*condition){
+            return;
+        }
+        const bool taken = IfElse::IsConditionTrue(*condition, context_);
+        // Ветка с определением класса не удаляется: класс может создаваться вне неё
+        const unique_ptr<Statement>& dropped = taken ? if_else.else_body_ : if_else.if_body_;
+        if (dropped && ContainsClassDefinition(*dropped)){
+            return;
+        }
+        if (taken){
+            node = std::move(if_else.if_body_);
+        } else if (if_else.else_body_){
+            node = std::move(if_else.else_body_);
+        } else {
+            node = make_unique<None>();
+        }
+        stats.branches_eliminated++;
+    }
+
+    bool TrySimplify(unique_ptr<Statement>& node) {
+        if (auto* add = dynamic_cast<Add*>(node.get())){
+            // x + 0 и 0 + x, если x - число
+            if (IsNumericConst(*add->rhs_, 0) && IsNumericExpr(*add->lhs_)){
+                node = std::move(add->lhs_);
+                return true;
+            }
+            if (IsNumericConst(*add->lhs_, 0) && IsNumericExpr(*add->rhs_)){
+                node = std::move(add->rhs_);
+                return true;
+            }
+        } else if (auto* sub = dynamic_cast<Sub*>(node.get())){
+            // x - 0
+            if (IsNumericConst(*sub->rhs_, 0) && IsNumericExpr(*sub->lhs_)){
+                node = std::move(sub->lhs_);
+                return true;
+            }
+        } else if (auto* mult = dynamic_cast<Mult*>(node.get())){
+            // x * 1, 1 * x и -(-x), который парсер строит как Mult(Mult(x, -1), -1)
+            if (IsNumericConst(*mult->rhs_, 1) && IsNumericExpr(*mult->lhs_)){
+                node = std::move(mult->lhs_);
+                return true;
+            }
+            if (IsNumericConst(*mult->lhs_, 1) && IsNumericExpr(*mult->rhs_)){
+                node = std::move(mult->rhs_);
+                return true;
+            }
+            auto* inner = dynamic_cast<Mult*>(mult->lhs_.get());
+            if (inner && IsNumericConst(*mult->rhs_, -1) && IsNumericConst(*inner->rhs_, -1)
+                && IsNumericExpr(*inner->lhs_)){
+                node = std::move(inner->lhs_);
+                return true;
+            }
+        } else if (auto* div = dynamic_cast<Div*>(node.get())){
+            // x / 1
+            if (IsNumericConst(*div->rhs_, 1) && IsNumericExpr(*div->lhs_)){
+                node = std::move(div->lhs_);
+                return true;
+            }
+        } else if (auto* negation = dynamic_cast<Not*>(node.get())){
+            // not not x, если x - Bool
+            auto* inner = dynamic_cast<Not*>(negation->statement_.get());
+            if (inner && IsBoolExpr(*inner->statement_)){
+                node = std::move(inner->statement_);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}  // namespace
+
+FoldingStats FoldConstants(unique_ptr<Statement>& program) {
+    const size_t nodes_before = CountNodes(*program);
+
+    Folder folder;
+    folder.Rewrite(program);
+
+    folder.stats.nodes_removed = nodes_before - CountNodes(*program);
+    return folder.stats;
+}
+
+}  // namespace ast
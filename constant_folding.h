@@ -0,0 +1,29 @@
+#pragma once
+
+#include "statement.h"
+
+#include <memory>
+
+namespace ast {
+
+// Результаты свёртки констант
+struct FoldingStats {
+    // Выражений, вычисленных во время компиляции
+    size_t folded = 0;
+    // Инструкций if с постоянным условием, заменённых одной из веток
+    size_t branches_eliminated = 0;
+    // Применённых алгебраических тождеств (x + 0, x * 1, not not x и т.д.)
+    size_t simplified = 0;
+    // Количество удалённых из дерева узлов
+    size_t nodes_removed = 0;
+};
+
+/*
+Вычисляет во время компиляции арифметику, конкатенацию строк, сравнения и логические
+операции над константами, убирает ветки if с постоянным условием и упрощает
+тождества над заведомо числовыми выражениями. Выражения, вычисление которых привело бы
+к ошибке, оставляются как есть, чтобы ошибка возникла во время исполнения
+*/
+FoldingStats FoldConstants(std::unique_ptr<Statement>& program);
+
+}  // namespace ast
@@ -0,0 +1,111 @@
+#include "ast_utils.h"
+#include "constant_folding.h"
+#include "parse.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+void TestArithmetics() {
+    FoldingStats stats;
+    ASSERT_EQUAL(opt::RunVerified("print 2*5+10/2, -3, 1-2-3, 'a' + 'b', str(42) + 'x'\n"s,
+                                  FoldConstants, stats),
+                 "15 -3 -4 ab 42x\n"s);
+    ASSERT_EQUAL(stats.folded, 9U);
+
+    auto tree = ParseFromString("x = 2*5+10/2\n"s);
+    FoldConstants(tree);
+    // Compound, Assignment и единственная константа
+    ASSERT_EQUAL(CountNodes(*tree), 3U);
+}
+
+void TestComparisonsAndLogic() {
+    FoldingStats stats;
+    ASSERT_EQUAL(opt::RunVerified("print 1 < 2, 'a' == 'b', None == None, not True, True and not False\n"s,
+                                  FoldConstants, stats),
+                 "True False True False True\n"s);
+    ASSERT_EQUAL(stats.nodes_removed, 10U);
+}
+
+void TestBranchElimination() {
+    const string program = R"(
+if 2 > 1:
+  print 'yes'
+else:
+  print 'no'
+if False:
+  print 'never'
+if 'abc':
+  print 'string condition'
+else:
+  print 'is false'
+)"s;
+    FoldingStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, FoldConstants, stats), "yes\nis false\n"s);
+    ASSERT_EQUAL(stats.branches_eliminated, 3U);
+}
+
+void TestBranchWithClassDefinition() {
+    // Парсер связывает B() и C() с классами из обеих веток, поэтому ветки не удаляются
+    const string program = R"(
+if True:
+  class B:
+    def f(n):
+      return n + 1
+else:
+  class C:
+    def f(n):
+      return n - 1
+b = B()
+c = C()
+print b.f(1), c.f(1)
+)"s;
+    FoldingStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, FoldConstants, stats), "2 0\n"s);
+    ASSERT_EQUAL(stats.branches_eliminated, 0U);
+    opt::VerifyAllOptimizationLevels(program);
+}
+
+void TestIdentities() {
+    const string program = R"(
+x = 5
+y = 7
+print (x - y) * 1, 0 + x * y, - - (x / y), (x - 0) / 1, not not x < y
+)"s;
+    FoldingStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, FoldConstants, stats), "-2 35 0 5 True\n"s);
+    ASSERT_EQUAL(stats.simplified, 5U);
+
+    // Тождества не применяются к выражениям неизвестного типа
+    auto tree = ParseFromString("s = 'str'\nprint s * 1\n"s);
+    FoldConstants(tree);
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    ASSERT_THROWS(tree->Execute(closure, context), std::runtime_error);
+}
+
+void TestErrorsAreKept() {
+    for (const string& program : {"print 1 + 'a'\n"s, "print 1 / 0 < 'a'\n"s, "print 'a' - 'b'\n"s}){
+        auto tree = ParseFromString(program);
+        FoldingStats stats = FoldConstants(tree);
+        ASSERT_EQUAL(stats.folded, 0U);
+    }
+}
+
+}  // namespace
+
+void RunConstantFoldingTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestArithmetics);
+    RUN_TEST(tr, ast::TestComparisonsAndLogic);
+    RUN_TEST(tr, ast::TestBranchElimination);
+    RUN_TEST(tr, ast::TestBranchWithClassDefinition);
+    RUN_TEST(tr, ast::TestIdentities);
+    RUN_TEST(tr, ast::TestErrorsAreKept);
+}
+
+}  // namespace ast
@@ -0,0 +1,250 @@
+#include "dead_code.h"
+
+#include "ast_utils.h"
+
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+bool IsSpecialMethod(symbols::Symbol symbol) {
+    const string& name = symbol.Str();
+    return name.size() > 4 && name.compare(0, 2, "__"s) == 0
+           && name.compare(name.size() - 2, 2, "__"s) == 0;
+}
+
+// Количество аргументов вызова, соответствующее методу (как в Class::GetMethod)
+size_t GetArity(const runtime::Method& method) {
+    size_t arity = method.formal_params.size();
+    if (arity && method.formal_params.front() == runtime::names::SELF){
+        arity--;
+    }
+    return arity;
+}
+
+// Удаляет инструкции, следующие в блоке за return. Инструкции с определениями классов
+// остаются: парсер связывает с классом NewInstance и за пределами блока
+class ReturnTruncator : public Visitor {
+public:
+    size_t removed = 0;
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(Compound& node) override {
+        auto it = find_if(node.args_.begin(), node.args_.end(), [](const auto& stmt) {
+            return dynamic_cast<Return*>(stmt.get()) != nullptr;
+        });
+        if (it != node.args_.end()){
+            const auto tail = remove_if(next(it), node.args_.end(), [](const auto& stmt) {
+                return !ContainsClassDefinition(*stmt);
+            });
+            removed += node.args_.end() - tail;
+            node.args_.erase(tail, node.args_.end());
+        }
+        return true;
+    }
+};
+
+// Определение класса и метод, в теле которого оно находится
+struct DefinedClass {
+    runtime::Class* cls = nullptr;
+    const runtime::Class* outer_class = nullptr;
+    const runtime::Method* outer_method = nullptr;
+};
+
+// Собирает определения классов программы, включая классы, вложенные в методы
+class ClassFinder : public Visitor {
+public:
+    vector<DefinedClass> classes;
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(ClassDefinition& node) override {
+        auto* cls = node.cls_.TryAs<runtime::Class>();
+        classes.push_back({cls, outer_class_, outer_method_});
+
+        // Тела методов обходятся здесь, чтобы запомнить, где определены вложенные классы
+        const runtime::Class* outer_class = outer_class_;
+        const runtime::Method* outer_method = outer_method_;
+        outer_class_ = cls;
+        for (const runtime::Method& method : cls->Methods()){
+            outer_method_ = &method;
+            Walk(*method.body);
+        }
+        outer_class_ = outer_class;
+        outer_method_ = outer_method;
+        return false;
+    }
+
+private:
+    const runtime::Class* outer_class_ = nullptr;
+    const runtime::Method* outer_method_ = nullptr;
+};
+
+// Собирает имена, классы и методы, на которые ссылается код. В тела методов не заходит
+class ReferenceCollector : public Visitor {
+public:
+    unordered_set<symbols::Symbol> names;
+    unordered_set<const runtime::Class*> instantiated;
+    set<pair<symbols::Symbol, size_t>> calls;
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(VariableValue& node) override {
+        names.insert(node.dotted_ids_.front());
+        return true;
+    }
+
+    bool Visit(FieldAssignment& node) override {
+        names.insert(node.object_.dotted_ids_.front());
+        return true;
+    }
+
+    bool Visit(Print& node) override {
+        if (!node.name_.Empty()){
+            names.insert(node.name_);
+        }
+        return true;
+    }
+
+    bool Visit(MethodCall& node) override {
+        calls.emplace(node.method_, node.args_.size());
+        return true;
+    }
+
+    bool Visit(NewInstance& node) override {
+        instantiated.insert(&node.obj_.TryAs<runtime::ClassInstance>()->GetClass());
+        return true;
+    }
+
+    bool Visit(ClassDefinition&) override {
+        return false;
+    }
+};
+
+// Удаляет из блоков определения недостижимых классов
+class ClassRemover : public Visitor {
+public:
+    explicit ClassRemover(const unordered_set<const runtime::Class*>& reachable)
+        : reachable_(reachable) {
+
+    }
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(Compound& node) override {
+        node.args_.erase(remove_if(node.args_.begin(), node.args_.end(), [this](const auto& stmt) {
+            auto* definition = dynamic_cast<ClassDefinition*>(stmt.get());
+            return definition && !reachable_.count(definition->cls_.TryAs<runtime::Class>());
+        }), node.args_.end());
+        return true;
+    }
+
+private:
+    const unordered_set<const runtime::Class*>& reachable_;
+};
+
+}  // namespace
+
+DeadCodeStats EliminateDeadCode(unique_ptr<Statement>& program) {
+    DeadCodeStats stats;
+
+    ReturnTruncator truncator;
+    truncator.Walk(*program);
+    stats.statements_removed = truncator.removed;
+
+    ClassFinder finder;
+    finder.Walk(*program);
+
+    ReferenceCollector references;
+    references.Walk(*program);
+
+    unordered_map<const runtime::Class*, const DefinedClass*> definitions;
+    for (const DefinedClass& definition : finder.classes){
+        definitions[definition.cls] = &definition;
+    }
+
+    unordered_set<const runtime::Class*> reachable;
+    unordered_set<const runtime::Method*> walked;
+    // Делает достижимыми класс и его родителей. Метод, в теле которого определён
+    // достижимый класс, сохраняется вместе со своим классом
+    const function<void(const runtime::Class*)> mark_reachable = [&](const runtime::Class* cls) {
+        for (; cls && !reachable.count(cls); cls = cls->GetParent()){
+            reachable.insert(cls);
+            const auto it = definitions.find(cls);
+            if (it == definitions.end() || !it->second->outer_method
+                || !walked.insert(it->second->outer_method).second){
+                continue;
+            }
+            mark_reachable(it->second->outer_class);
+            references.Walk(*it->second->outer_method->body);
+        }
+    };
+
+    // Достижимые классы и методы ищутся до неподвижной точки: код достижимого метода
+    // может сделать достижимыми другие классы и методы
+    for (bool changed = true; changed;){
+        changed = false;
+        for (const DefinedClass& definition : finder.classes){
+            const runtime::Class* cls = definition.cls;
+            if (reachable.count(cls)){
+                continue;
+            }
+            // Класс, определённый в сохраняемом методе, тоже сохраняется
+            if (references.instantiated.count(cls) || references.names.count(cls->GetName())
+                || (definition.outer_method && walked.count(definition.outer_method))){
+                mark_reachable(cls);
+                changed = true;
+            }
+        }
+        for (const DefinedClass& definition : finder.classes){
+            if (!reachable.count(definition.cls)){
+                continue;
+            }
+            for (const runtime::Method& method : definition.cls->Methods()){
+                if (walked.count(&method)
+                    || (!IsSpecialMethod(method.name)
+                        && !references.calls.count({method.name, GetArity(method)}))){
+                    continue;
+                }
+                walked.insert(&method);
+                references.Walk(*method.body);
+                changed = true;
+            }
+        }
+    }
+
+    for (const DefinedClass& definition : finder.classes){
+        runtime::Class* cls = definition.cls;
+        if (!reachable.count(cls)){
+            stats.classes_removed++;
+            continue;
+        }
+        vector<runtime::Method> kept;
+        for (runtime::Method& method : cls->Methods()){
+            if (walked.count(&method)){
+                kept.push_back(std::move(method));
+            } else {
+                stats.methods_removed++;
+            }
+        }
+        cls->Methods() = std::move(kept);
+    }
+
+    ClassRemover remover(reachable);
+    remover.Walk(*program);
+    return stats;
+}
+
+}  // namespace ast
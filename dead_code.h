@@ -0,0 +1,34 @@
+#pragma once
+
+#include "statement.h"
+
+#include <memory>
+
+namespace ast {
+
+// Результаты удаления мёртвого кода
+struct DeadCodeStats {
+    // Инструкций, следующих за return в том же блоке
+    size_t statements_removed = 0;
+    // Определений классов, экземпляры которых не создаются и имена которых не читаются
+    size_t classes_removed = 0;
+    // Методов, которые не вызываются ни из программы, ни из достижимых методов
+    size_t methods_removed = 0;
+};
+
+/*
+Удаляет инструкции после безусловного return, определения недостижимых классов и
+недостижимые методы. Класс достижим, если в достижимом коде создаётся его экземпляр
+или читается его имя, а также если достижим его наследник. Метод достижимого класса
+достижим, если в достижимом коде есть вызов метода с тем же именем и количеством
+аргументов (класс получателя не учитывается). Специальные методы (__init__, __str__,
+__eq__, __lt__, __add__ и другие имена вида __name__) вызываются интерпретатором
+неявно и не удаляются.
+Класс, определённый в теле достижимого метода, достижим; метод, в теле которого
+определён достижимый класс, сохраняется вместе со своим классом. Инструкции после
+return, содержащие определения классов, не удаляются.
+Должно выполняться до проходов, сохраняющих ссылки на методы классов
+*/
+DeadCodeStats EliminateDeadCode(std::unique_ptr<Statement>& program);
+
+}  // namespace ast
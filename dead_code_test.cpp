@@ -0,0 +1,151 @@
+#include "dead_code.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+void TestStatementsAfterReturn() {
+    const string program = R"(
+class A:
+  def f(n):
+    if n > 0:
+      return 'positive'
+      print 'unreachable'
+    return 'other'
+    print 'unreachable'
+    n = n + 1
+
+a = A()
+print a.f(1), a.f(0)
+)"s;
+    DeadCodeStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateDeadCode, stats), "positive other\n"s);
+    ASSERT_EQUAL(stats.statements_removed, 3U);
+}
+
+void TestUnreachableClassesAndMethods() {
+    const string program = R"(
+class Unused:
+  def run():
+    return 0
+
+class Base:
+  def __init__():
+    self.n = 1
+
+  def used():
+    return self.helper(2)
+
+  def helper(k):
+    return self.n + k
+
+  def helper(k, m):
+    return k
+
+  def unused():
+    return Unused()
+
+class Derived(Base):
+  def __str__():
+    return 'derived'
+
+class Other:
+  def used():
+    return 'other'
+
+d = Derived()
+print d, d.used()
+)"s;
+    DeadCodeStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateDeadCode, stats), "derived 3\n"s);
+    // Unused создаётся только в недостижимом методе, Other нигде не упоминается
+    ASSERT_EQUAL(stats.classes_removed, 2U);
+    // Base.unused и Base.helper с двумя параметрами
+    ASSERT_EQUAL(stats.methods_removed, 2U);
+}
+
+void TestClassNameReadKeepsClass() {
+    const string program = R"(
+class Shown:
+  def f():
+    return 1
+
+print Shown
+)"s;
+    DeadCodeStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateDeadCode, stats), "Class Shown\n"s);
+    ASSERT_EQUAL(stats.classes_removed, 0U);
+    ASSERT_EQUAL(stats.methods_removed, 1U);
+}
+
+void TestNestedClasses() {
+    // Парсер связывает B() с классом B, определённым в методе недостижимого класса A
+    const string program = R"(
+class A:
+  def make():
+    class B:
+      def f(n):
+        return n + 1
+    return 0
+
+  def other():
+    return 1
+
+class C:
+  def f():
+    return 1
+    class D:
+      def g():
+        return 2
+
+class E:
+  def used():
+    return 3
+
+  def unused():
+    class F:
+      def h():
+        return 4
+
+      def dropped():
+        return 5
+    return 0
+
+class G:
+  def make():
+    class H:
+      def h():
+        return 6
+    return 0
+
+b = B()
+d = D()
+e = E()
+f = F()
+print b.f(41), d.g(), e.used(), f.h()
+)"s;
+    DeadCodeStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, EliminateDeadCode, stats), "42 2 3 4\n"s);
+    ASSERT_EQUAL(stats.statements_removed, 0U);
+    // G и вложенный в него H нигде не упоминаются
+    ASSERT_EQUAL(stats.classes_removed, 2U);
+    // A.other и F.dropped
+    ASSERT_EQUAL(stats.methods_removed, 2U);
+    opt::VerifyAllOptimizationLevels(program);
+}
+
+}  // namespace
+
+void RunDeadCodeTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestStatementsAfterReturn);
+    RUN_TEST(tr, ast::TestUnreachableClassesAndMethods);
+    RUN_TEST(tr, ast::TestClassNameReadKeepsClass);
+    RUN_TEST(tr, ast::TestNestedClasses);
+}
+
+}  // namespace ast
@@ -0,0 +1,192 @@
+#include "escape_analysis.h"
+
+#include <optional>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::Context;
+
+namespace {
+
+// Операция обобщённого арифметического узла либо 0
+char GetGenericOp(const Statement& node) {
+    if (dynamic_cast<const Add*>(&node)){
+        return '+';
+    }
+    if (dynamic_cast<const Sub*>(&node)){
+        return '-';
+    }
+    if (dynamic_cast<const Mult*>(&node)){
+        return '*';
+    }
+    if (dynamic_cast<const Div*>(&node)){
+        return '/';
+    }
+    return 0;
+}
+
+// Значение выражения - число, если вычисление завершилось без ошибки
+bool IsNumeric(const Statement& node) {
+    if (dynamic_cast<const IntExpression*>(&node) || dynamic_cast<const NumericConst*>(&node)){
+        return true;
+    }
+    const char op = GetGenericOp(node);
+    if (op == '+'){
+        // Для числа слева Add не вызывает __add__
+        return IsNumeric(*static_cast<const BinaryOperation&>(node).lhs_);
+    }
+    return op != 0;
+}
+
+// Вычисление узла размещает новый объект в куче
+bool Allocates(const Statement& node) {
+    return !dynamic_cast<const NumericConst*>(&node);
+}
+
+/*
+Числовое значение, размещаемое в куче. Узел, ни один операнд которого не таков,
+переводится на int, только если его значение потребляет другое вычисление над int:
+иначе выигрыша нет, а обобщённые узлы вида x - 1 и n < 2 распознают слитые инструкции
+*/
+bool IsUnboxable(const Statement& node) {
+    return IsNumeric(node) && Allocates(node);
+}
+
+unique_ptr<IntExpression> ToIntExpression(unique_ptr<Statement> expr) {
+    if (auto* num = dynamic_cast<NumericConst*>(expr.get())){
+        return make_unique<IntLiteral>(num->value_.GetValue());
+    }
+    return unique_ptr<IntExpression>(static_cast<IntExpression*>(expr.release()));
+}
+
+class Unboxer {
+public:
+    EscapeStats stats;
+
+    /*
+    consumed == true, если значение узла сразу потребляет вычисление над int.
+    Такой узел должен быть числовым (IsNumeric) и после обработки становится
+    IntExpression либо остаётся NumericConst
+    */
+    void Process(unique_ptr<Statement>& slot, bool consumed) {
+        Statement& node = *slot;
+        if (auto* int_of = dynamic_cast<IntOf*>(&node); int_of && IsNumeric(*int_of->expr_)){
+            // IntOf упаковывал значение выражения только для того, чтобы сразу его распаковать
+            ProcessOperand(int_of->expr_);
+            slot = ToIntExpression(std::move(int_of->expr_));
+            return;
+        }
+        if (const char op = GetGenericOp(node); op && IsNumeric(node)){
+            auto& binary = static_cast<BinaryOperation&>(node);
+            if (consumed || IsUnboxable(*binary.lhs_) || IsUnboxable(*binary.rhs_)){
+                ProcessOperand(binary.lhs_);
+                ProcessOperand(binary.rhs_);
+                slot = make_unique<NumericArithmetic>(op, std::move(binary.lhs_), std::move(binary.rhs_));
+                stats.unboxed_nodes++;
+                return;
+            }
+        }
+        if (auto* cmp = dynamic_cast<Comparison*>(&node);
+            cmp && IsNumeric(*cmp->lhs_) && IsNumeric(*cmp->rhs_)
+            && (IsUnboxable(*cmp->lhs_) || IsUnboxable(*cmp->rhs_))){
+            if (IntCompareFunction int_cmp = GetIntCompareFunction(GetCompareFunction(cmp->cmp_))){
+                ProcessOperand(cmp->lhs_);
+                ProcessOperand(cmp->rhs_);
+                slot = make_unique<IntComparison>(int_cmp, ToIntExpression(std::move(cmp->lhs_)),
+                                                  ToIntExpression(std::move(cmp->rhs_)));
+                stats.unboxed_nodes++;
+                return;
+            }
+        }
+        ForEachChild(node, [this](unique_ptr<Statement>& child) {
+            Process(child, false);
+        });
+    }
+
+private:
+    // Операнд вычисления над int: числовой операнд больше не упаковывается
+    void ProcessOperand(unique_ptr<Statement>& slot) {
+        if (IsNumeric(*slot)){
+            if (IsUnboxable(*slot)){
+                stats.allocations_avoided++;
+            }
+            Process(slot, true);
+        } else {
+            Process(slot, false);
+        }
+    }
+};
+
+// Значение операнда, если это число
+optional<int> EvaluateOperand(Statement& operand, Closure& closure, Context& context) {
+    if (auto* typed = dynamic_cast<IntExpression*>(&operand)){
+        return typed->EvaluateInt(closure, context);
+    }
+    runtime::ObjectHolder value = operand.Execute(closure, context);
+    if (auto* number = value.TryAs<runtime::Number>()){
+        return number->GetValue();
+    }
+    return nullopt;
+}
+
+}  // namespace
+
+NumericArithmetic::NumericArithmetic(char op, unique_ptr<Statement> lhs, unique_ptr<Statement> rhs)
+    : op_(op), lhs_(std::move(lhs)), rhs_(std::move(rhs)) {
+
+}
+
+int NumericArithmetic::EvaluateInt(Closure& closure, Context& context) {
+    const optional<int> lhs = EvaluateOperand(*lhs_, closure, context);
+    const optional<int> rhs = EvaluateOperand(*rhs_, closure, context);
+    switch (op_){
+        case '+':
+            if (!lhs || !rhs){
+                throw std::runtime_error("Unable to add objects"s);
+            }
+            return *lhs + *rhs;
+        case '-':
+            if (!lhs || !rhs){
+                throw std::runtime_error("Unable to subtract numbers"s);
+            }
+            return *lhs - *rhs;
+        case '*':
+            if (!lhs || !rhs){
+                throw std::runtime_error("Unable to multiplicate numbers"s);
+            }
+            return *lhs * *rhs;
+        default:
+            if (!lhs || !rhs){
+                throw std::runtime_error("Unable to divide numbers"s);
+            }
+            if (*rhs == 0){
+                throw std::runtime_error("Division by zero"s);
+            }
+            return *lhs / *rhs;
+    }
+}
+
+void NumericArithmetic::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(lhs_);
+    fn(rhs_);
+}
+
+unique_ptr<Statement> NumericArithmetic::Clone() const {
+    auto lhs = ast::Clone(*lhs_);
+    auto rhs = ast::Clone(*rhs_);
+    if (!lhs || !rhs){
+        return nullptr;
+    }
+    return make_unique<NumericArithmetic>(op_, std::move(lhs), std::move(rhs));
+}
+
+EscapeStats UnboxTemporaries(unique_ptr<Statement>& program) {
+    Unboxer unboxer;
+    unboxer.Process(program, false);
+    return unboxer.stats;
+}
+
+}  // namespace ast
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ast_utils.h"
+#include "type_inference.h"
+
+#include <memory>
+
+/*
+Анализ времени жизни промежуточных значений выражений. Результат арифметической
+операции, который сразу же потребляет другая арифметическая операция или сравнение,
+не покидает выражение, поэтому его не нужно размещать в куче через ObjectHolder::Own:
+такие операции вычисляются над int, а упаковывается только значение, которое
+сохраняется в переменную, передаётся в метод, выводится и т.д.
+*/
+namespace ast {
+
+/*
+lhs op rhs, где op - один из символов + - * /, а операнды - произвольные выражения.
+Результат всегда целое число: операнды, не являющиеся IntExpression, проверяются во время
+исполнения, и при несовпадении типов выбрасывается та же ошибка, что и в Add, Sub,
+Mult или Div. Для op == '+' левый операнд должен быть заведомо числом, иначе Add
+мог бы вызвать метод __add__
+*/
+class NumericArithmetic : public IntExpression, public CompositeNode {
+public:
+    NumericArithmetic(char op, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
+
+    // При делении на ноль выбрасывает runtime_error, как IntArithmetic
+    int EvaluateInt(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    [[nodiscard]] std::unique_ptr<Statement> Clone() const override;
+
+    char op_;
+    std::unique_ptr<Statement> lhs_;
+    std::unique_ptr<Statement> rhs_;
+};
+
+struct EscapeStats {
+    // Арифметических операций, переведённых на вычисление без упаковки
+    size_t unboxed_nodes = 0;
+    // Промежуточных значений, которые больше не размещаются в куче при каждом вычислении
+    size_t allocations_avoided = 0;
+};
+
+/*
+Переводит на вычисление без упаковки арифметику, промежуточные результаты которой
+не покидают выражение, а также сравнения двух таких результатов.
+Выполняется после специализации типов: узлы IntExpression считаются числовыми
+*/
+EscapeStats UnboxTemporaries(std::unique_ptr<Statement>& program);
+
+}  // namespace ast
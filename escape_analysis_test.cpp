@@ -0,0 +1,78 @@
+#include "escape_analysis.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+void TestTemporariesInExpressions() {
+    const string program = R"(
+class Rect:
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+  def diff(other):
+    return self.w * self.h - other.w * other.h + 1
+
+a = Rect(3, 4)
+b = Rect(1, 2)
+print a.area(), a.diff(b)
+x = 7
+if x * 2 > a.area() - 1:
+  print 'bigger'
+print x - 1, x * 1
+)"s;
+    EscapeStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, UnboxTemporaries, stats), "12 11\nbigger\n6 7\n"s);
+    // В diff: Add, Sub и обе Mult; в условии - Mult, Sub и сравнение.
+    // self.w * self.h в area, x - 1 и x * 1 остаются обобщёнными
+    ASSERT_EQUAL(stats.unboxed_nodes, 7U);
+    ASSERT_EQUAL(stats.allocations_avoided, 5U);
+}
+
+void TestErrorsArePreserved() {
+    EscapeStats stats;
+    ASSERT_EQUAL(opt::RunVerified("x = 'a'\nprint x * 2 + 1\n"s, UnboxTemporaries, stats),
+                 "error: Unable to multiplicate numbers"s);
+    ASSERT_EQUAL(stats.unboxed_nodes, 2U);
+    ASSERT_EQUAL(opt::RunVerified("x = 'a'\nprint 2 * 3 + x\n"s, UnboxTemporaries, stats),
+                 "error: Unable to add objects"s);
+    ASSERT_EQUAL(opt::RunVerified("x = None\nprint 1 - 2 * x\n"s, UnboxTemporaries, stats),
+                 "error: Unable to multiplicate numbers"s);
+}
+
+void TestUserAddIsNotUnboxed() {
+    const string program = R"(
+class Money:
+  def __init__(v):
+    self.v = v
+
+  def __add__(n):
+    return self.v + n
+
+m = Money(5)
+print m + 2 * 3, 2 * 3 + 1
+)"s;
+    EscapeStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, UnboxTemporaries, stats), "11 7\n"s);
+    // m + 2 * 3 вызывает __add__, поэтому Add остаётся обобщённым
+    ASSERT_EQUAL(stats.unboxed_nodes, 2U);
+}
+
+}  // namespace
+
+void RunEscapeAnalysisTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestTemporariesInExpressions);
+    RUN_TEST(tr, ast::TestErrorsArePreserved);
+    RUN_TEST(tr, ast::TestUserAddIsNotUnboxed);
+}
+
+}  // namespace ast
@@ -0,0 +1,522 @@
+#include "inlining.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+// Классы, экземпляры которых заведомо хранятся в переменных
+using ClassState = unordered_map<symbols::Symbol, const runtime::Class*>;
+
+// Копия тела метода, пригодного для встраивания
+struct InlineTemplate {
+    vector<unique_ptr<Statement>> body;
+    unique_ptr<Statement> result;
+    size_t nodes = 0;
+};
+
+/*
+Проверяет, что инструкции тела метода можно исполнять в замыкании вызывающего кода:
+в них нет return и вложенных присваиваний переменным, вызовов метода с тем же именем,
+а читаются только параметры, self и уже присвоенные локальные переменные
+*/
+class InlineChecker : public Visitor {
+public:
+    InlineChecker(symbols::Symbol method, const unordered_set<symbols::Symbol>& defined)
+        : method_(method), defined_(defined) {
+
+    }
+
+    bool ok = true;
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(Statement&) override {
+        ok = false;
+        return false;
+    }
+
+    bool Visit(NumericConst&) override {
+        return true;
+    }
+
+    bool Visit(StringConst&) override {
+        return true;
+    }
+
+    bool Visit(BoolConst&) override {
+        return true;
+    }
+
+    bool Visit(None&) override {
+        return true;
+    }
+
+    bool Visit(VariableValue& node) override {
+        Check(node.dotted_ids_.front());
+        return ok;
+    }
+
+    bool Visit(FieldAssignment& node) override {
+        // Для объекта, не являющегося экземпляром класса, FieldAssignment обращается
+        // к переменной с именем поля, поэтому допускаются только поля self
+        if (node.object_.dotted_ids_ != vector<symbols::Symbol>{runtime::names::SELF}){
+            ok = false;
+        }
+        return ok;
+    }
+
+    bool Visit(Print& node) override {
+        if (!node.name_.Empty()){
+            Check(node.name_);
+        }
+        return ok;
+    }
+
+    bool Visit(MethodCall& node) override {
+        if (node.method_ == method_){
+            ok = false;
+        }
+        return ok;
+    }
+
+    bool Visit(NewInstance&) override {
+        return true;
+    }
+
+    bool Visit(Stringify&) override {
+        return true;
+    }
+
+    bool Visit(Add&) override {
+        return true;
+    }
+
+    bool Visit(Sub&) override {
+        return true;
+    }
+
+    bool Visit(Mult&) override {
+        return true;
+    }
+
+    bool Visit(Div&) override {
+        return true;
+    }
+
+    bool Visit(Or&) override {
+        return true;
+    }
+
+    bool Visit(And&) override {
+        return true;
+    }
+
+    bool Visit(Not&) override {
+        return true;
+    }
+
+    bool Visit(Comparison&) override {
+        return true;
+    }
+
+    bool Visit(Compound&) override {
+        return true;
+    }
+
+    bool Visit(IfElse&) override {
+        return true;
+    }
+
+private:
+    symbols::Symbol method_;
+    const unordered_set<symbols::Symbol>& defined_;
+
+    void Check(symbols::Symbol name) {
+        if (!defined_.count(name)){
+            ok = false;
+        }
+    }
+};
+
+// Добавляет prefix к именам переменных, читаемых и присваиваемых в поддереве
+class Renamer : public Visitor {
+public:
+    // Имена после переименования
+    unordered_set<symbols::Symbol> renamed;
+
+    explicit Renamer(string prefix)
+        : prefix_(std::move(prefix)) {
+
+    }
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(VariableValue& node) override {
+        node.dotted_ids_.front() = Rename(node.dotted_ids_.front());
+        return true;
+    }
+
+    bool Visit(Assignment& node) override {
+        node.var_ = Rename(node.var_);
+        return true;
+    }
+
+    bool Visit(FieldAssignment& node) override {
+        node.object_.dotted_ids_.front() = Rename(node.object_.dotted_ids_.front());
+        return true;
+    }
+
+    bool Visit(Print& node) override {
+        if (!node.name_.Empty()){
+            node.name_ = Rename(node.name_);
+        }
+        return true;
+    }
+
+private:
+    string prefix_;
+
+    symbols::Symbol Rename(symbols::Symbol name) {
+        const symbols::Symbol result(prefix_ + name.Str());
+        renamed.insert(result);
+        return result;
+    }
+};
+
+// Удаляет слоты встроенного тела из замыкания по завершении вызова, в том числе при исключении
+class SlotsGuard {
+public:
+    SlotsGuard(Closure& closure, const vector<symbols::Symbol>& slots)
+        : closure_(closure), slots_(slots) {
+
+    }
+
+    SlotsGuard(const SlotsGuard&) = delete;
+    SlotsGuard& operator=(const SlotsGuard&) = delete;
+
+    ~SlotsGuard() {
+        for (const symbols::Symbol slot : slots_){
+            closure_.erase(slot);
+        }
+    }
+
+private:
+    Closure& closure_;
+    const vector<symbols::Symbol>& slots_;
+};
+
+bool IsCheckedStatement(Statement& node, symbols::Symbol method,
+                        const unordered_set<symbols::Symbol>& defined) {
+    InlineChecker checker(method, defined);
+    checker.Walk(node);
+    return checker.ok;
+}
+
+unique_ptr<InlineTemplate> PrepareTemplate(const runtime::Method& method,
+                                           const InliningOptions& options) {
+    auto* method_body = dynamic_cast<MethodBody*>(method.body.get());
+    if (!method_body){
+        return nullptr;
+    }
+    size_t max_nodes = options.max_callee_nodes;
+    if (const SiteProfile* site = options.profile ? options.profile->Find(*method_body) : nullptr;
+        site && site->count >= options.hot_call_count){
+        max_nodes = max(max_nodes, options.max_hot_callee_nodes);
+    }
+    if (CountNodes(*method_body->body_) > max_nodes){
+        return nullptr;
+    }
+    unordered_set<symbols::Symbol> defined(method.formal_params.begin(), method.formal_params.end());
+    if (defined.count(runtime::names::SELF)){
+        return nullptr;
+    }
+    defined.insert(runtime::names::SELF);
+
+    vector<Statement*> statements;
+    if (auto* compound = dynamic_cast<Compound*>(method_body->body_.get())){
+        for (auto& statement : compound->args_){
+            statements.push_back(statement.get());
+        }
+    } else {
+        statements.push_back(method_body->body_.get());
+    }
+
+    auto result = make_unique<InlineTemplate>();
+    result->nodes = CountNodes(*method_body->body_);
+    for (size_t i = 0; i < statements.size(); ++i){
+        Statement* checked = statements[i];
+        auto* ret = dynamic_cast<Return*>(checked);
+        auto* assign = dynamic_cast<Assignment*>(checked);
+        if (ret){
+            if (i + 1 != statements.size()){
+                return nullptr;
+            }
+            checked = ret->statement_.get();
+        } else if (assign){
+            checked = assign->rv_.get();
+        }
+        if (!IsCheckedStatement(*checked, method.name, defined)){
+            return nullptr;
+        }
+
+        auto copy = Clone(*checked);
+        if (!copy){
+            return nullptr;
+        }
+        if (ret){
+            result->result = std::move(copy);
+        } else if (assign){
+            defined.insert(assign->var_);
+            result->body.push_back(make_unique<Assignment>(assign->var_, std::move(copy)));
+        } else {
+            result->body.push_back(std::move(copy));
+        }
+    }
+    return result;
+}
+
+bool IsCoreExpression(const Statement& node) {
+    return dynamic_cast<const VariableValue*>(&node) || dynamic_cast<const FieldAssignment*>(&node)
+        || dynamic_cast<const None*>(&node) || dynamic_cast<const Print*>(&node)
+        || dynamic_cast<const MethodCall*>(&node) || dynamic_cast<const NewInstance*>(&node)
+        || dynamic_cast<const UnaryOperation*>(&node) || dynamic_cast<const BinaryOperation*>(&node)
+        || dynamic_cast<const Return*>(&node) || dynamic_cast<const NumericConst*>(&node)
+        || dynamic_cast<const StringConst*>(&node) || dynamic_cast<const BoolConst*>(&node);
+}
+
+class Inliner {
+public:
+    InliningStats stats;
+
+    explicit Inliner(const InliningOptions& options)
+        : options_(options) {
+
+    }
+
+    void Run(unique_ptr<Statement>& program) {
+        const vector<ClassMethod> methods = CollectMethods(*program);
+        // Копии тел снимаются до встраивания, чтобы встроенный код не зависел от порядка обхода
+        for (const auto& [cls, method, body] : methods){
+            if (!body){
+                continue;
+            }
+            classes_[cls->GetName().Str()] = cls;
+            if (auto prepared = PrepareTemplate(*method, options_)){
+                templates_[method] = std::move(prepared);
+            }
+        }
+
+        caller_ = "top level"s;
+        ClassState state;
+        Process(program, state);
+
+        for (const auto& [cls, method, body] : methods){
+            if (!body){
+                continue;
+            }
+            caller_ = cls->GetName().Str() + '.' + method->name.Str();
+            ClassState method_state{{runtime::names::SELF, cls}};
+            Process(body->body_, method_state);
+        }
+    }
+
+private:
+    const InliningOptions& options_;
+    unordered_map<const runtime::Method*, unique_ptr<InlineTemplate>> templates_;
+    unordered_map<string, const runtime::Class*> classes_;
+    string caller_;
+
+    static const runtime::Class* GetReceiverClass(const Statement& expr, const ClassState& state) {
+        if (auto* instance = dynamic_cast<const NewInstance*>(&expr)){
+            return &instance->obj_.TryAs<runtime::ClassInstance>()->GetClass();
+        }
+        if (auto* var = dynamic_cast<const VariableValue*>(&expr); var && var->dotted_ids_.size() == 1){
+            auto it = state.find(var->dotted_ids_.front());
+            return it != state.end() ? it->second : nullptr;
+        }
+        return nullptr;
+    }
+
+    void Process(unique_ptr<Statement>& slot, ClassState& state) {
+        Statement& node = *slot;
+        if (auto* compound = dynamic_cast<Compound*>(&node)){
+            for (auto& statement : compound->args_){
+                Process(statement, state);
+            }
+        } else if (auto* assign = dynamic_cast<Assignment*>(&node)){
+            Process(assign->rv_, state);
+            if (const runtime::Class* cls = GetReceiverClass(*assign->rv_, state)){
+                state[assign->var_] = cls;
+            } else {
+                state.erase(assign->var_);
+            }
+        } else if (auto* if_else = dynamic_cast<IfElse*>(&node)){
+            Process(if_else->condition_, state);
+            ClassState else_state = state;
+            Process(if_else->if_body_, state);
+            if (if_else->else_body_){
+                Process(if_else->else_body_, else_state);
+            }
+            for (auto it = state.begin(); it != state.end();){
+                auto other = else_state.find(it->first);
+                it = other != else_state.end() && other->second == it->second ? next(it) : state.erase(it);
+            }
+        } else if (auto* definition = dynamic_cast<ClassDefinition*>(&node)){
+            state.erase(definition->cls_.TryAs<runtime::Class>()->GetName());
+        } else if (IsCoreExpression(node)){
+            ForEachChild(node, [this, &state](unique_ptr<Statement>& child) {
+                Process(child, state);
+            });
+            if (auto* call = dynamic_cast<MethodCall*>(&node)){
+                TryInline(slot, *call, state);
+            }
+        } else {
+            // Узел, созданный другими оптимизациями, может присваивать переменные
+            ClassState copy = state;
+            ForEachChild(node, [this, &copy](unique_ptr<Statement>& child) {
+                Process(child, copy);
+            });
+            state.clear();
+        }
+    }
+
+    // Класс единственного получателя, наблюдавшегося в месте вызова, либо nullptr
+    const runtime::Class* GetProfiledClass(const SiteProfile& site) const {
+        const string* name = GetSingleType(site.receivers);
+        auto it = name ? classes_.find(*name) : classes_.end();
+        return it != classes_.end() ? it->second : nullptr;
+    }
+
+    void TryInline(unique_ptr<Statement>& slot, MethodCall& call, const ClassState& state) {
+        const SiteProfile* site = options_.profile ? options_.profile->Find(call) : nullptr;
+        if (site && !site->count){
+            stats.cold++;
+            return;
+        }
+        const runtime::Class* cls = GetReceiverClass(*call.object_, state);
+        // InlinedCall проверяет класс получателя, поэтому класс из профиля можно предполагать
+        const bool speculative = !cls && site;
+        if (speculative){
+            cls = GetProfiledClass(*site);
+        }
+        if (!cls){
+            return;
+        }
+        const runtime::Method* method = cls->GetMethod(call.method_, call.args_.size());
+        auto it = method ? templates_.find(method) : templates_.end();
+        if (it == templates_.end()){
+            return;
+        }
+        const InlineTemplate& callee = *it->second;
+        if (stats.nodes_added + callee.nodes > options_.max_growth_nodes){
+            stats.over_budget++;
+            return;
+        }
+
+        const string prefix = "%i"s + to_string(stats.inlined) + ':';
+        Renamer renamer(prefix);
+        vector<unique_ptr<Statement>> body;
+        for (const auto& statement : callee.body){
+            body.push_back(Clone(*statement));
+            renamer.Walk(*body.back());
+        }
+        unique_ptr<Statement> result;
+        if (callee.result){
+            result = Clone(*callee.result);
+            renamer.Walk(*result);
+        }
+        vector<symbols::Symbol> params;
+        for (const symbols::Symbol param : method->formal_params){
+            params.emplace_back(prefix + param.Str());
+        }
+        const symbols::Symbol self(prefix + "self"s);
+        unordered_set<symbols::Symbol> slots = std::move(renamer.renamed);
+        slots.insert(params.begin(), params.end());
+        slots.insert(self);
+
+        stats.sites.push_back(cls->GetName().Str() + '.' + call.method_.Str() + " -> "s + caller_
+                              + (speculative ? " (profile)"s : ""s));
+        stats.inlined++;
+        stats.speculative += speculative;
+        stats.nodes_added += callee.nodes;
+        auto inlined = make_unique<InlinedCall>(std::move(call.object_), call.method_,
+                                                std::move(call.args_), *cls, std::move(params), self,
+                                                vector<symbols::Symbol>(slots.begin(), slots.end()),
+                                                std::move(body), std::move(result));
+        slot = std::move(inlined);
+    }
+};
+
+}  // namespace
+
+InlinedCall::InlinedCall(unique_ptr<Statement> object, symbols::Symbol method,
+                         vector<unique_ptr<Statement>> args, const runtime::Class& cls,
+                         vector<symbols::Symbol> params, symbols::Symbol self, vector<symbols::Symbol> slots,
+                         vector<unique_ptr<Statement>> body, unique_ptr<Statement> result)
+    : object_(std::move(object)), method_(std::move(method)), args_(std::move(args)),
+    class_(&cls), params_(std::move(params)), self_(std::move(self)), slots_(std::move(slots)),
+    body_(std::move(body)), result_(std::move(result)) {
+
+}
+
+ObjectHolder InlinedCall::Execute(Closure& closure, Context& context) {
+    ObjectHolder object = object_->Execute(closure, context);
+    auto* instance = object.TryAs<runtime::ClassInstance>();
+    if (!instance || &instance->GetClass() != class_){
+        if (!instance || !instance->HasMethod(method_, args_.size())){
+            return ObjectHolder::None();
+        }
+        vector<ObjectHolder> args;
+        args.reserve(args_.size());
+        for (auto& arg : args_){
+            args.push_back(arg->Execute(closure, context));
+        }
+        return instance->Call(method_, args, context);
+    }
+
+    // Слоты читаются только встроенным телом, поэтому аргументы можно записывать
+    // в них сразу после вычисления. self, как и в ClassInstance::Call, не владеет объектом
+    SlotsGuard guard(closure, slots_);
+    for (size_t i = 0; i < args_.size(); ++i){
+        closure[params_[i]] = args_[i]->Execute(closure, context);
+    }
+    closure[self_] = ObjectHolder::Share(*instance);
+
+    for (auto& statement : body_){
+        statement->Execute(closure, context);
+    }
+    return result_ ? result_->Execute(closure, context) : ObjectHolder::None();
+}
+
+void InlinedCall::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(object_);
+    for (auto& arg : args_){
+        fn(arg);
+    }
+    for (auto& statement : body_){
+        fn(statement);
+    }
+    if (result_){
+        fn(result_);
+    }
+}
+
+InliningStats InlineMethods(unique_ptr<Statement>& program, const InliningOptions& options) {
+    Inliner inliner(options);
+    inliner.Run(program);
+    return inliner.stats;
+}
+
+}  // namespace ast
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ast_utils.h"
+#include "profile.h"
+#include "statement.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+Встраивание небольших методов в места вызова. Тело метода копируется в вызывающий
+код, параметры и локальные переменные метода переименовываются в слоты замыкания
+вызывающего кода, поэтому при встроенном вызове не создаётся новое замыкание и не
+выбрасывается исключение для возврата значения
+*/
+namespace ast {
+
+/*
+Встроенный вызов object.method(args). Если объект - экземпляр класса class_
+(не наследника), аргументы записываются в слоты params_, затем исполняются
+инструкции body_ и возвращается значение result_ (либо None). После вызова, в том
+числе завершённого исключением, слоты slots_ удаляются из замыкания.
+Иначе выполняется обычный вызов метода, как в MethodCall
+*/
+class InlinedCall : public Statement, public CompositeNode {
+public:
+    InlinedCall(std::unique_ptr<Statement> object, symbols::Symbol method,
+                std::vector<std::unique_ptr<Statement>> args, const runtime::Class& cls,
+                std::vector<symbols::Symbol> params, symbols::Symbol self,
+                std::vector<symbols::Symbol> slots, std::vector<std::unique_ptr<Statement>> body,
+                std::unique_ptr<Statement> result);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    std::unique_ptr<Statement> object_;
+    symbols::Symbol method_;
+    std::vector<std::unique_ptr<Statement>> args_;
+    const runtime::Class* class_;
+    // Имена слотов для параметров метода и для self
+    std::vector<symbols::Symbol> params_;
+    symbols::Symbol self_;
+    // Все слоты встроенного тела: параметры, self и локальные переменные метода
+    std::vector<symbols::Symbol> slots_;
+    std::vector<std::unique_ptr<Statement>> body_;
+    // Выражение из завершающей инструкции return; nullptr, если её нет
+    std::unique_ptr<Statement> result_;
+};
+
+struct InliningOptions {
+    // Наибольший размер встраиваемого тела метода в узлах дерева
+    size_t max_callee_nodes = 24;
+    // Наибольшее суммарное количество узлов, добавляемых в программу встраиванием
+    size_t max_growth_nodes = 4000;
+    // Профиль предыдущего запуска либо nullptr
+    const ProgramProfile* profile = nullptr;
+    // Наибольший размер тела метода, вызванного по профилю не менее hot_call_count раз
+    size_t max_hot_callee_nodes = 64;
+    size_t hot_call_count = 100;
+};
+
+struct InliningStats {
+    // Количество встроенных вызовов
+    size_t inlined = 0;
+    // Количество узлов, добавленных в программу
+    size_t nodes_added = 0;
+    // Вызовов, не встроенных из-за превышения бюджета
+    size_t over_budget = 0;
+    // Вызовов, встроенных по классу получателя из профиля
+    size_t speculative = 0;
+    // Вызовов, не встроенных, потому что по профилю они не исполнялись
+    size_t cold = 0;
+    // Описание встроенных вызовов: "Class.method -> вызывающий код"
+    std::vector<std::string> sites;
+};
+
+/*
+Встраивает вызовы методов, класс получателя которых известен: объект создан
+выражением ClassName(...) и присвоен переменной на всех путях к месту вызова,
+либо получатель - self внутри метода класса. Встраиваются нерекурсивные методы без
+инструкций return, кроме завершающей, не больше options.max_callee_nodes узлов.
+С профилем класс получателя берётся из профиля, если в месте вызова наблюдался
+единственный класс, часто вызываемые методы встраиваются при размере до
+options.max_hot_callee_nodes узлов, а неисполнявшиеся вызовы не встраиваются
+*/
+InliningStats InlineMethods(std::unique_ptr<Statement>& program, const InliningOptions& options = {});
+
+}  // namespace ast
@@ -0,0 +1,189 @@
+#include "inlining.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+// Проход с параметрами по умолчанию
+const auto INLINE = [](unique_ptr<Statement>& tree) {
+    return InlineMethods(tree);
+};
+
+bool HasSite(const InliningStats& stats, const string& site) {
+    return find(stats.sites.begin(), stats.sites.end(), site) != stats.sites.end();
+}
+
+void TestGettersAndSetters() {
+    const string program = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    self.value = self.value + n
+
+  def get():
+    return self.value
+
+c = Counter()
+c.add(5)
+c.add(2)
+print c.get()
+)"s;
+    InliningStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, INLINE, stats), "7\n"s);
+    ASSERT_EQUAL(stats.inlined, 3U);
+    ASSERT(HasSite(stats, "Counter.add -> top level"s));
+    ASSERT(HasSite(stats, "Counter.get -> top level"s));
+}
+
+void TestLocalsDoNotClash() {
+    const string program = R"(
+class Calc:
+  def square(x):
+    y = x * x
+    return y
+
+y = 3
+x = 10
+calc = Calc()
+print calc.square(y), x, y
+print calc.square(calc.square(2))
+)"s;
+    InliningStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, INLINE, stats), "9 10 3\n16\n"s);
+    ASSERT_EQUAL(stats.inlined, 3U);
+}
+
+void TestReceiverClassGuard() {
+    const string program = R"(
+class Base:
+  def name():
+    return 'base'
+
+  def describe():
+    return 'I am ' + self.name()
+
+class Derived(Base):
+  def name():
+    return 'derived'
+
+b = Base()
+d = Derived()
+print b.describe(), d.describe()
+if d.name() == 'derived':
+  o = d
+else:
+  o = b
+print o.describe()
+)"s;
+    InliningStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, INLINE, stats), "I am base I am derived\nI am derived\n"s);
+    // Вызов self.name() внутри Base.describe встроен с проверкой класса Base
+    ASSERT(HasSite(stats, "Base.name -> Base.describe"s));
+    // Класс o после if неизвестен
+    ASSERT(HasSite(stats, "Derived.name -> top level"s));
+    ASSERT_EQUAL(stats.inlined, 4U);
+}
+
+void TestNotInlinable() {
+    const string program = R"(
+class Math:
+  def fact(n):
+    if n < 2:
+      return 1
+    return n * self.fact(n - 1)
+
+  def sign(n):
+    if n < 0:
+      return -1
+    return 1
+
+  def late(n):
+    r = n + later
+    later = 1
+    return r
+
+m = Math()
+print m.fact(5), m.sign(-3)
+)"s;
+    InliningStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, INLINE, stats), "120 -1\n"s);
+    ASSERT_EQUAL(stats.inlined, 0U);
+}
+
+void TestBudget() {
+    const string program = R"(
+class P:
+  def __init__(v):
+    self.v = v
+
+  def twice():
+    return self.v + self.v
+
+p = P(4)
+print p.twice(), p.twice(), p.twice()
+)"s;
+    InliningOptions options;
+    options.max_growth_nodes = 10;
+    const auto inline_with_options = [&options](unique_ptr<Statement>& tree) {
+        return InlineMethods(tree, options);
+    };
+    InliningStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, inline_with_options, stats), "8 8 8\n"s);
+    ASSERT_EQUAL(stats.inlined, 2U);
+    ASSERT_EQUAL(stats.over_budget, 1U);
+
+    options.max_callee_nodes = 2;
+    ASSERT_EQUAL(opt::RunVerified(program, inline_with_options, stats), "8 8 8\n"s);
+    ASSERT_EQUAL(stats.inlined, 0U);
+}
+
+// Возвращает true, если в замыкании остались слоты встроенных вызовов
+bool HasInlineSlots(const runtime::Closure& closure) {
+    return any_of(closure.begin(), closure.end(), [](const auto& item) {
+        return item.first.Str().rfind("%i"s, 0) == 0;
+    });
+}
+
+void TestSlotsAreReleased() {
+    const string program = R"(
+class Calc:
+  def diff(x):
+    y = 10 - x
+    return y
+
+calc = Calc()
+print calc.diff(2)
+z = calc.diff('a')
+)"s;
+    auto tree = ParseFromString(program);
+    ASSERT_EQUAL(InlineMethods(tree).inlined, 2U);
+
+    // Слоты удаляются и после обычного возврата, и после исключения во встроенном теле
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    ASSERT_THROWS(tree->Execute(closure, context), std::runtime_error);
+    ASSERT_EQUAL(context.output.str(), "8\n"s);
+    ASSERT(!HasInlineSlots(closure));
+}
+
+}  // namespace
+
+void RunInliningTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestGettersAndSetters);
+    RUN_TEST(tr, ast::TestLocalsDoNotClash);
+    RUN_TEST(tr, ast::TestReceiverClassGuard);
+    RUN_TEST(tr, ast::TestNotInlinable);
+    RUN_TEST(tr, ast::TestBudget);
+    RUN_TEST(tr, ast::TestSlotsAreReleased);
+}
+
+}  // namespace ast
@@ -1,32 +1,106 @@
 #include "lexer.h"
+#include "lexer_pipeline.h"
+#include "lexer_scan.h"
 
 #include <algorithm>
+#include <array>
 #include <charconv>
+#include <stdexcept>
 #include <unordered_map>
 
 using namespace std;
 
 namespace parse {
 
-bool operator==(const Token& lhs, const Token& rhs) {
-    using namespace token_type;
+namespace {
+
+// Ключевое слово или операция из двух символов и соответствующий токен
+struct ReservedWord {
+    string_view word;
+    Token token;
+};
+
+constexpr array<ReservedWord, 16> RESERVED_WORDS = {{
+    {"class"sv, token_type::Class{}}, {"return"sv, token_type::Return{}},
+    {"if"sv, token_type::If{}}, {"else"sv, token_type::Else{}},
+    {"def"sv, token_type::Def{}}, {"print"sv, token_type::Print{}},
+    {"and"sv, token_type::And{}}, {"or"sv, token_type::Or{}},
+    {"not"sv, token_type::Not{}}, {"None"sv, token_type::None{}},
+    {"True"sv, token_type::True{}}, {"False"sv, token_type::False{}},
+    {"!="sv, token_type::NotEq{}}, {"=="sv, token_type::Eq{}},
+    {">="sv, token_type::GreaterOrEq{}}, {"<="sv, token_type::LessOrEq{}},
+}};
+
+constexpr size_t MIN_RESERVED_LENGTH = 2;
+constexpr size_t MAX_RESERVED_LENGTH = 6;
+
+/*
+Совершенный хеш зарезервированных слов: по первому и последнему символам и длине
+слова каждое слово попадает в свою ячейку таблицы из RESERVED_SLOTS ячеек.
+Множитель подбирается при компиляции
+*/
+constexpr size_t RESERVED_SLOTS = 32;
+
+constexpr size_t ReservedHash(string_view word, unsigned multiplier) {
+    return (static_cast<unsigned char>(word.front()) * multiplier
+            + static_cast<unsigned char>(word.back()) + word.size()) % RESERVED_SLOTS;
+}
 
-    if (lhs.index() != rhs.index()) {
-        return false;
+constexpr bool IsPerfectHash(unsigned multiplier) {
+    array<bool, RESERVED_SLOTS> used{};
+    for (const ReservedWord& reserved : RESERVED_WORDS){
+        const size_t slot = ReservedHash(reserved.word, multiplier);
+        if (used[slot]){
+            return false;
+        }
+        used[slot] = true;
     }
-    if (lhs.Is<Char>()) {
-        return lhs.As<Char>().value == rhs.As<Char>().value;
+    return true;
+}
+
+constexpr unsigned FindHashMultiplier() {
+    for (unsigned multiplier = 1; multiplier < 1024; ++multiplier){
+        if (IsPerfectHash(multiplier)){
+            return multiplier;
+        }
     }
-    if (lhs.Is<Number>()) {
-        return lhs.As<Number>().value == rhs.As<Number>().value;
+    return 0;
+}
+
+constexpr unsigned HASH_MULTIPLIER = FindHashMultiplier();
+static_assert(HASH_MULTIPLIER != 0, "no perfect hash for reserved words");
+
+// Номер слова в RESERVED_WORDS для каждой ячейки, -1 для пустых ячеек
+constexpr array<int8_t, RESERVED_SLOTS> MakeReservedSlots() {
+    array<int8_t, RESERVED_SLOTS> slots{};
+    for (auto& slot : slots){
+        slot = -1;
+    }
+    for (size_t i = 0; i < RESERVED_WORDS.size(); ++i){
+        slots[ReservedHash(RESERVED_WORDS[i].word, HASH_MULTIPLIER)] = static_cast<int8_t>(i);
     }
-    if (lhs.Is<String>()) {
-        return lhs.As<String>().value == rhs.As<String>().value;
+    return slots;
+}
+
+constexpr array<int8_t, RESERVED_SLOTS> RESERVED_SLOTS_TABLE = MakeReservedSlots();
+
+// Зарезервированное слово, совпадающее с word, либо nullptr
+const ReservedWord* FindReservedWord(string_view word) {
+    if (word.size() < MIN_RESERVED_LENGTH || word.size() > MAX_RESERVED_LENGTH){
+        return nullptr;
     }
-    if (lhs.Is<Id>()) {
-        return lhs.As<Id>().value == rhs.As<Id>().value;
+    const int8_t index = RESERVED_SLOTS_TABLE[ReservedHash(word, HASH_MULTIPLIER)];
+    if (index < 0 || RESERVED_WORDS[index].word != word){
+        return nullptr;
     }
-    return true;
+    return &RESERVED_WORDS[index];
+}
+
+}  // namespace
+
+bool operator==(const Token& lhs, const Token& rhs) {
+    // Одинаковые идентификаторы и строки имеют одинаковые номера в таблицах
+    return lhs.Kind() == rhs.Kind() && lhs.Payload() == rhs.Payload();
 }
 
 bool operator!=(const Token& lhs, const Token& rhs) {
@@ -76,61 +150,130 @@ ostream& operator<<(ostream& os, const Token& rhs) {
 }
 
 Lexer::Lexer(istream& input)
-    : input_(input) {
+    : input_(&input) {
     ParseInputStream_();
 }
+
+Lexer::Lexer(string_view source)
+    : source_(source) {
+    ParseInputStream_();
+}
+
+Lexer::Lexer(vector<Token> tokens)
+    : tokens_list_(make_move_iterator(tokens.begin()), make_move_iterator(tokens.end())),
+      eof(true) {
+
+}
+
+Lexer::Lexer(vector<Token> tokens, exception_ptr error)
+    : tokens_list_(make_move_iterator(tokens.begin()), make_move_iterator(tokens.end())),
+      eof(true),
+      error_(move(error)) {
+    // Ошибка в первой строке выбрасывается при создании лексера, как и при разборе текста
+    if (tokens_list_.empty() && error_){
+        rethrow_exception(error_);
+    }
+}
+
+Lexer::Lexer(istream& input, Pipelined)
+    : pipeline_(make_unique<TokenPipeline>(input)) {
+    ParseInputStream_();
+}
+
+Lexer::Lexer(string_view source, Pipelined)
+    : pipeline_(make_unique<TokenPipeline>(source)) {
+    ParseInputStream_();
+}
+
+Lexer::~Lexer() = default;
 // Возвращает ссылку на текущий токен или token_type::Eof, если поток токенов закончился
 const Token& Lexer::CurrentToken() const {
-    return tokens_list_.at(current_token_);
+    return tokens_list_.front();
 }
 
 // Возвращает следующий токен, либо token_type::Eof, если поток токенов закончился
 Token Lexer::NextToken() {
-    current_token_++;
-    if (current_token_ >= tokens_list_.size() && !ParseInputStream_()){
-        current_token_--;
-        return tokens_list_.back();
+    if (tokens_list_.size() == 1 && !ParseInputStream_()){
+        return tokens_list_.front();
+    }
+    tokens_list_.pop_front();
+    return tokens_list_.front();
+}
+
+size_t Lexer::GetBufferedTokenCount() const {
+    return tokens_list_.size();
+}
+
+bool Lexer::ReadLine_(string_view& line){
+    size_t end = scan::FindChar(source_, source_pos_, '\n');
+    while (end == source_.size() && input_ != nullptr){
+        // Начало строки уже просмотрено, поиск продолжается с дочитанного блока
+        const size_t scanned = end - source_pos_;
+        if (!FillInputBuffer_()){
+            break;
+        }
+        end = scan::FindChar(source_, source_pos_ + scanned, '\n');
+    }
+    if (source_pos_ >= source_.size()){
+        return false;
     }
-    return tokens_list_.at(current_token_);
+    line = source_.substr(source_pos_, end - source_pos_);
+    source_pos_ = min(end + 1, source_.size());
+    return true;
+}
+
+bool Lexer::FillInputBuffer_(){
+    input_buffer_.erase(0, source_pos_);
+    source_pos_ = 0;
+    const size_t kept = input_buffer_.size();
+    input_buffer_.resize(kept + INPUT_CHUNK_SIZE);
+    input_->read(input_buffer_.data() + kept, INPUT_CHUNK_SIZE);
+    const size_t read = static_cast<size_t>(input_->gcount());
+    input_buffer_.resize(kept + read);
+    source_ = input_buffer_;
+    return read > 0;
 }
 
 bool Lexer::ParseInputStream_(){
-    string line;
+    string_view line;
     size_t line_len;
     size_t line_iter = 0;
     char c;
     char quote;
     int indent = 0;
-    int comment;
+    size_t comment;
 
-    if (!getline(input_, line)){
-        if (!eof){
-            eof = true;
-            for (int in = 0; in < previous_indent_; ++in){
-                tokens_list_.push_back(token_type::Dedent());
-            }
-            tokens_list_.push_back(token_type::Eof());
-            return true;
-        }
-        return false;
+    if (pipeline_){
+        return pipeline_->Receive(tokens_list_);
     }
-    
-    comment = FindComment_(line);
-    if (comment != -1){
-        line = line.substr(0, comment);
+    if (error_){
+        rethrow_exception(error_);
     }
 
-    if (IsLineEmpty_(line)){
-        return ParseInputStream_();
-    }
+    // Пустые строки и строки из одного комментария пропускаются
+    do {
+        if (!ReadLine_(line)){
+            if (!eof){
+                eof = true;
+                for (int in = 0; in < previous_indent_; ++in){
+                    tokens_list_.push_back(token_type::Dedent());
+                }
+                tokens_list_.push_back(token_type::Eof());
+                return true;
+            }
+            return false;
+        }
+
+        comment = scan::FindComment(line);
+        if (comment != string_view::npos){
+            line = line.substr(0, comment);
+        }
+    } while (IsLineEmpty_(line));
 
     // Проходимся по пробелам в начале строки
     // и создаем токены отступа
-    while(line.at(line_iter) == ' '){
-        indent += 1;
-        line_iter++;
-    }
-    indent /= 2;
+    line_iter = scan::SkipSpaces(line, 0);
+    indent = static_cast<int>(line_iter) / 2;
     if (indent != previous_indent_){
         for (int in = 0; in < abs(indent - previous_indent_); ++in){
             if (indent > previous_indent_)
@@ -144,9 +287,9 @@ bool Lexer::ParseInputStream_(){
     // Пробегаем до конца строки и делим ее на слова
     line_len = line.length();
     while (line_iter < line_len){
-        c = line.at(line_iter);
+        c = line[line_iter];
         if (c == ' '){
-            line_iter++;
+            line_iter = scan::SkipSpaces(line, line_iter);
             continue;
         }
 
@@ -181,54 +324,45 @@ bool Lexer::ParseInputStream_(){
 
         // операция или набор символов
         if (IsOperationChar_(c)){
-            tmp_string = "";
-            while (line_iter < line_len && IsOperationChar_(c) && c != ' '){
-                tmp_string += c;
-                if (++line_iter < line_len)    
-                    c = line.at(line_iter);
-            }
-            AppendTokensList_(tmp_string);
+            const size_t word_begin = line_iter;
+            line_iter = scan::SkipOperationChars(line, line_iter);
+            AppendTokensList_(line.substr(word_begin, line_iter - word_begin));
             continue;
         }
 
         // название переменной
         if (IsVariableChar_(c)){
-            tmp_string = "";
-            while (line_iter < line_len && (IsVariableChar_(c) || IsDigit_(c)) && c != ' '){
-                tmp_string += c;
-                if (++line_iter < line_len)    
-                    c = line.at(line_iter);
-            }
-            AppendTokensList_(tmp_string);
+            const size_t word_begin = line_iter;
+            line_iter = scan::SkipIdentifierChars(line, line_iter);
+            AppendTokensList_(line.substr(word_begin, line_iter - word_begin));
             continue;
         }
 
         // строка
-        if (c == '\'' || c == '"'){
+        if (scan::HasClass(c, scan::QUOTE)){
             quote = c;
             size_t begin = line_iter + 1;
             size_t pos = 0;
             while (1){
-                pos = line.find(quote, begin);
+                pos = scan::FindChar(line, begin, quote);
+                if (pos >= line_len){
+                    pos = string::npos;
+                }
                 if (pos == string::npos || (line.at(pos - 1) != '\\' && line.at(pos) == quote))
                     break;
                 begin = pos + 1;
             }
-            tmp_string = line.substr(line_iter, pos - line_iter + 1);
+            const string_view word = line.substr(line_iter, pos - line_iter + 1);
             line_iter += pos - line_iter + 1;
-            AppendTokensList_(tmp_string);
+            AppendTokensList_(word);
             continue;
         }
 
         // число
         if (IsDigit_(c)){
-            tmp_string = "";
-            while (line_iter < line_len && IsDigit_(c) && c != ' '){
-                tmp_string += c;
-                if (++line_iter < line_len)    
-                    c = line.at(line_iter);
-            }
-            AppendTokensList_(tmp_string);
+            const size_t word_begin = line_iter;
+            line_iter = scan::SkipDigits(line, line_iter);
+            AppendTokensList_(line.substr(word_begin, line_iter - word_begin));
             continue;
         }
     }
@@ -237,31 +371,11 @@ bool Lexer::ParseInputStream_(){
     return true;
 }
 
-int Lexer::FindComment_(const string& word){
-    char c;
-    bool single_quote = false;
-    bool double_quote = false;
-
-    for (size_t i = 0; i < word.length(); ++i){
-        c = word.at(i);
-        if (c == '\'' && !double_quote)
-            single_quote = !single_quote;
-        else if (c == '\"' && !single_quote)
-            double_quote = !double_quote;
-        else if (c == '#' && !single_quote && !double_quote){
-            return i;
-        }
-    }
-    return -1;
-}
-
 bool Lexer::IsVariableChar_(char c){
-    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')
-        return true;
-    return false;
+    return scan::IsIdentifierChar(c);
 }
 
-bool Lexer::IsVariableName_(const string& word){
+bool Lexer::IsVariableName_(string_view word){
     if (!(IsVariableChar_(word.at(0)) && !IsDigit_(word.at(0))))
         return false;
     for (size_t i = 1; i < word.length(); ++i){
@@ -272,12 +386,10 @@ bool Lexer::IsVariableName_(const string& word){
 }
 
 bool Lexer::IsDigit_(char c){
-    if (c >= '0' && c <= '9')
-        return true;
-    return false;
+    return scan::IsDigit(c);
 }
 
-bool Lexer::IsNumber_(const string& word){
+bool Lexer::IsNumber_(string_view word){
     for (char c : word){
         if (!IsDigit_(c))
             return false;
@@ -286,15 +398,10 @@ bool Lexer::IsNumber_(const string& word){
 }
 
 bool Lexer::IsOperationChar_(char c){
-    if (c == '.' || c == ',' || c == '(' || c == ')' ||
-        c == '>' || c == '<' || c == ':' || c == '=' ||
-        c == '+' || c == '-' || c == '*' || c == '/' ||
-        c == '!' || c == '?')
-        return true;
-    return false;
+    return scan::IsOperationChar(c);
 }
 
-bool Lexer::IsOperatinString_(const string& word){
+bool Lexer::IsOperatinString_(string_view word){
     for (char c : word){
         if (!IsOperationChar_(c))
             return false;
@@ -302,20 +409,19 @@ bool Lexer::IsOperatinString_(const string& word){
     return true;
 }
 
-bool Lexer::IsLineEmpty_(const string& word){
-    if (word.length() == 0)
-        return true;
-    for (size_t i = 0; i < word.length(); ++i){
-        if (word.at(i) != ' ')
-            return false;
-    }
-    return true;
+bool Lexer::IsLineEmpty_(string_view word){
+    return scan::SkipSpaces(word, 0) == word.size();
 }	
 
-string Lexer::EscSeqHandler_(const string& word){
+string_view Lexer::EscSeqHandler_(string_view word){
     size_t word_len;
     char c, escaped_char;
-    string result_str;
+
+    if (word.find_first_of("\\\n\r"sv) == string_view::npos){
+        return word;
+    }
+    string& result_str = unescaped_;
+    result_str.clear();
 
     word_len = word.length();
     for (size_t i = 0; i < word_len; ++i){
@@ -356,17 +462,12 @@ string Lexer::EscSeqHandler_(const string& word){
     return result_str;
 } 
 
-void Lexer::AppendTokensList_(const string& word){
+void Lexer::AppendTokensList_(string_view word){
     optional<Token> keyword_token;
-    if ((keyword_token = KeyWordToToken_(word))){ // ключевое слово
+    if ((keyword_token = KeyWordToToken_(word))){ // ключевое слово или операция из двух символов
         tokens_list_.push_back(keyword_token.value());
         return;
     }
-    optional<Token> operation_token;
-    if ((operation_token = OperationToToken_(word))){ // операция
-        tokens_list_.push_back(operation_token.value());
-        return;
-    }
     if (IsOperatinString_(word)){ // набор символов
         for (char c : word){
             token_type::Char char_token;
@@ -377,62 +478,36 @@ void Lexer::AppendTokensList_(const string& word){
     }
     if (IsNumber_(word)){ // число
         token_type::Number number_token;
-        number_token.value = stoi(word);
+        if (from_chars(word.data(), word.data() + word.size(), number_token.value).ec != errc{}){
+            throw LexerError("Number is out of range: "s + string(word));
+        }
         tokens_list_.push_back(number_token);
         return;
     }
-    if (IsVariableName_(word)){ // переменная (id)
-        token_type::Id id_token;
-        id_token.value = word;
-        tokens_list_.push_back(id_token);
-        return;
-    }
-    if (word.at(0) == '\'' || word.at(0) == '\"'){ // строка
-        token_type::String str_token;
-        str_token.value = EscSeqHandler_(word.substr(1, word.length() - 2));
-        tokens_list_.push_back(str_token);  
-        return;
+    try {
+        if (IsVariableName_(word)){ // переменная (id)
+            token_type::Id id_token;
+            id_token.value = symbols::Symbol(word);
+            tokens_list_.push_back(id_token);
+            return;
+        }
+        if (word.at(0) == '\'' || word.at(0) == '\"'){ // строка
+            token_type::String str_token;
+            str_token.value = EscSeqHandler_(word.substr(1, word.length() - 2));
+            tokens_list_.push_back(str_token);
+            return;
+        }
+    } catch (const length_error&) {
+        // Таблицы символов общие для процесса и вмещают SymbolTable::MAX_SIZE строк
+        throw LexerError("Too many distinct identifiers or string constants"s);
     }
     throw LexerError("invalid input");
 }
 
-optional<Token> Lexer::KeyWordToToken_(const string& word){
-    if (word == "class"s)
-        return token_type::Class();
-    else if (word == "return"s)
-        return token_type::Return();
-    else if (word == "if"s)
-        return token_type::If();
-    else if (word == "else"s)
-        return token_type::Else();
-    else if (word == "def"s)
-        return token_type::Def();
-    else if (word == "print"s)
-        return token_type::Print();
-    else if (word == "and"s)
-        return token_type::And();
-    else if (word == "or"s)
-        return token_type::Or();
-    else if (word == "None"s)
-        return token_type::None();
-    else if (word == "True"s)
-        return token_type::True();
-    else if (word == "False"s)
-        return token_type::False();
-    else if (word == "not"s)
-        return token_type::Not();
-    return nullopt;
-}
-
-optional<Token> Lexer::OperationToToken_(const string& word){
-    if (word == "!=")
-        return token_type::NotEq();
-    else if (word == "==")
-        return token_type::Eq();
-    else if (word == ">=")
-        return token_type::GreaterOrEq();
-    else if (word == "<=")
-        return token_type::LessOrEq();
+optional<Token> Lexer::KeyWordToToken_(string_view word){
+    if (const ReservedWord* reserved = FindReservedWord(word)){
+        return reserved->token;
+    }
     return nullopt;
 }
 
@@ -1,15 +1,23 @@
 #pragma once
 
+#include "symbols.h"
+
+#include <cstdint>
 #include <iosfwd>
 #include <optional>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <variant>
 #include <vector>
 #include <algorithm>
 #include <typeinfo>
+#include <type_traits>
 
 namespace parse {
 
@@ -19,8 +27,11 @@ struct Number {  // Лексема «число»
     int value;   // число
 };
 
+// Значения лексем String ссылаются на тексты в таблице symbols::StringConstants()
+// и действительны всё время работы программы. Таблицы идентификаторов и строк вмещают
+// symbols::SymbolTable::MAX_SIZE различных текстов; при переполнении лексер выбрасывает LexerError
 struct Id { // Лексема «идентификатор»
-    std::string value;  // Имя идентификатора
+    symbols::Symbol value;  // Имя идентификатора
 };
 
 struct Char { // Лексема «символ»
@@ -28,7 +39,7 @@ struct Char { // Лексема «символ»
 };
 
 struct String { // Лексема «строковая константа»
-    std::string value;
+    std::string_view value;
 };
 
 struct Class {};    // Лексема «class»
@@ -54,33 +65,120 @@ struct False {};        // Лексема «False»
 
 }  // namespace token_type
 
-using TokenBase
-    = std::variant<token_type::Number, token_type::Id, token_type::Char, token_type::String,
-                   token_type::Class, token_type::Return, token_type::If, token_type::Else,
-                   token_type::Def, token_type::Newline, token_type::Print, token_type::Indent,
-                   token_type::Dedent, token_type::And, token_type::Or, token_type::Not,
-                   token_type::Eq, token_type::NotEq, token_type::LessOrEq, token_type::GreaterOrEq,
-                   token_type::None, token_type::True, token_type::False, token_type::Eof>;
+namespace detail {
+
+template <typename... Types>
+struct TypeList {};
+
+// Номер типа T в списке Types
+template <typename T, typename List>
+struct TypeIndex;
+
+template <typename T, typename... Rest>
+struct TypeIndex<T, TypeList<T, Rest...>> : std::integral_constant<uint8_t, 0> {};
+
+template <typename T, typename First, typename... Rest>
+struct TypeIndex<T, TypeList<First, Rest...>>
+    : std::integral_constant<uint8_t, 1 + TypeIndex<T, TypeList<Rest...>>::value> {};
+
+}  // namespace detail
+
+using TokenTypes
+    = detail::TypeList<token_type::Number, token_type::Id, token_type::Char, token_type::String,
+                       token_type::Class, token_type::Return, token_type::If, token_type::Else,
+                       token_type::Def, token_type::Newline, token_type::Print, token_type::Indent,
+                       token_type::Dedent, token_type::And, token_type::Or, token_type::Not,
+                       token_type::Eq, token_type::NotEq, token_type::LessOrEq, token_type::GreaterOrEq,
+                       token_type::None, token_type::True, token_type::False, token_type::Eof>;
+
+// Вид токена - номер его типа в TokenTypes
+template <typename T>
+inline constexpr uint8_t TOKEN_KIND = detail::TypeIndex<T, TokenTypes>::value;
+
+/*
+Токен занимает 8 байт: вид и 32-битное значение. Число и символ хранятся в значении
+непосредственно, а для идентификатора и строки значение - номер текста в таблицах
+symbols::Identifiers() и symbols::StringConstants(). Поэтому токены копируются
+как два целых числа, а одинаковые идентификаторы и строки сравниваются по номерам
+*/
+class Token {
+public:
+    constexpr Token(token_type::Number number)
+        : kind_(TOKEN_KIND<token_type::Number>), payload_(static_cast<uint32_t>(number.value)) {
+    }
+
+    constexpr Token(token_type::Char c)
+        : kind_(TOKEN_KIND<token_type::Char>), payload_(static_cast<unsigned char>(c.value)) {
+    }
+
+    Token(token_type::Id id)
+        : kind_(TOKEN_KIND<token_type::Id>), payload_(id.value.Id()) {
+    }
+
+    Token(token_type::String str)
+        : kind_(TOKEN_KIND<token_type::String>), payload_(symbols::StringConstants().Intern(str.value)) {
+    }
 
-struct Token : TokenBase {
-    using TokenBase::TokenBase;
+    // Токены без значения
+    template <typename T, std::enable_if_t<std::is_empty_v<T>, int> = 0>
+    constexpr Token(T)
+        : kind_(TOKEN_KIND<T>) {
+    }
+
+    template <typename T>
+    [[nodiscard]] constexpr bool Is() const {
+        return kind_ == TOKEN_KIND<T>;
+    }
 
+    // Значение токена типа T. Выбрасывает std::bad_variant_access, если токен другого типа
     template <typename T>
-    [[nodiscard]] bool Is() const {
-        return std::holds_alternative<T>(*this);
+    [[nodiscard]] T As() const {
+        if (!Is<T>()) {
+            throw std::bad_variant_access();
+        }
+        return Get_<T>();
     }
 
     template <typename T>
-    [[nodiscard]] const T& As() const {
-        return std::get<T>(*this);
+    [[nodiscard]] std::optional<T> TryAs() const {
+        if (!Is<T>()) {
+            return std::nullopt;
+        }
+        return Get_<T>();
+    }
+
+    [[nodiscard]] constexpr uint8_t Kind() const {
+        return kind_;
+    }
+
+    // Число, код символа или номер текста в таблице; 0 для токенов без значения
+    [[nodiscard]] constexpr uint32_t Payload() const {
+        return payload_;
     }
 
+private:
+    uint8_t kind_;
+    uint32_t payload_ = 0;
+
     template <typename T>
-    [[nodiscard]] const T* TryAs() const {
-        return std::get_if<T>(this);
+    T Get_() const {
+        if constexpr (std::is_same_v<T, token_type::Number>) {
+            return {static_cast<int>(payload_)};
+        } else if constexpr (std::is_same_v<T, token_type::Char>) {
+            return {static_cast<char>(payload_)};
+        } else if constexpr (std::is_same_v<T, token_type::Id>) {
+            return {symbols::Symbol::FromId(payload_)};
+        } else if constexpr (std::is_same_v<T, token_type::String>) {
+            return {symbols::StringConstants().Name(payload_)};
+        } else {
+            return T{};
+        }
     }
 };
 
+static_assert(sizeof(Token) == 8);
+static_assert(std::is_trivially_copyable_v<Token>);
+
 bool operator==(const Token& lhs, const Token& rhs);
 bool operator!=(const Token& lhs, const Token& rhs);
 
@@ -91,25 +189,55 @@ public:
     using std::runtime_error::runtime_error;
 };
 
+class TokenPipeline;
+
+// Признак конвейерного лексера: токены читает отдельный поток (см. lexer_pipeline.h)
+struct Pipelined {};
+
 class Lexer {
 public:
     explicit Lexer(std::istream& input);
 
+    // Разбирает текст программы source, не копируя его по строкам. Буфер source
+    // должен существовать, пока лексер читает программу
+    explicit Lexer(std::string_view source);
+
+    // Повторно выдаёт ранее прочитанные токены tokens. Последним токеном должен быть Eof
+    explicit Lexer(std::vector<Token> tokens);
+
+    // Повторно выдаёт токены tokens, прочитанные до ошибки error, и выбрасывает её
+    // при попытке прочитать токен после них. Если error пуст, последним токеном должен быть Eof
+    Lexer(std::vector<Token> tokens, std::exception_ptr error);
+
+    // Читает input или source в отдельном потоке, пока парсер разбирает уже полученные токены.
+    // Ошибка лексера выбрасывается, когда парсер доходит до места ошибки
+    Lexer(std::istream& input, Pipelined);
+    Lexer(std::string_view source, Pipelined);
+
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
+
+    ~Lexer();
+
     // Возвращает ссылку на текущий токен или token_type::Eof, если поток токенов закончился
     [[nodiscard]] const Token& CurrentToken() const;
 
-    // Возвращает следующий токен, либо token_type::Eof, если поток токенов закончился
+    // Возвращает следующий токен, либо token_type::Eof, если поток токенов закончился.
+    // Ссылки на предыдущие токены и их значения становятся недействительными
     Token NextToken();
 
-    // Если текущий токен имеет тип T, метод возвращает ссылку на него.
+    // Количество токенов, прочитанных, но ещё не пройденных (включая текущий)
+    [[nodiscard]] size_t GetBufferedTokenCount() const;
+
+    // Если текущий токен имеет тип T, метод возвращает его значение.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T>
-    const T& Expect() const {
+    T Expect() const {
         using namespace std::literals;
         const Token& token = this->CurrentToken();
-        if (!std::holds_alternative<T>(token))
+        if (!token.Is<T>())
             throw LexerError("Invalid expectation"s);
-        return std::get<T>(token);
+        return token.As<T>();
     }
 
     // Метод проверяет, что текущий токен имеет тип T, а сам токен содержит значение value.
@@ -118,15 +246,14 @@ public:
     void Expect(const U& value) const {
         using namespace std::literals;
         const Token& token = this->CurrentToken();
-        if (!std::holds_alternative<T>(token) ||
-            (std::holds_alternative<T>(token) && std::get<T>(token).value != value))
+        if (!token.Is<T>() || token.As<T>().value != value)
             throw LexerError("Invalid expectation"s);
     }
 
-    // Если следующий токен имеет тип T, метод возвращает ссылку на него.
+    // Если следующий токен имеет тип T, метод возвращает его значение.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T>
-    const T& ExpectNext() {
+    T ExpectNext() {
         using namespace std::literals;
         this->NextToken();
         return Expect<T>();
@@ -142,53 +269,69 @@ public:
     }
 
 private:
-    std::vector<Token> tokens_list_;
-    std::istream& input_;
-    std::string tmp_string;
-    size_t current_token_ = 0;
+    // Очередь токенов: текущий токен и токены до конца последней прочитанной строки.
+    // Пройденные токены освобождаются, поэтому память не растёт с размером программы
+    std::deque<Token> tokens_list_;
+    // nullptr, если лексер читает буфер source_ либо выдаёт готовые токены
+    std::istream* input_ = nullptr;
+    // Текст, из которого выделяются строки: буфер source либо input_buffer_
+    std::string_view source_;
+    size_t source_pos_ = 0;
+    // Непрочитанная часть потока, которая дочитывается блоками по INPUT_CHUNK_SIZE байтов
+    std::string input_buffer_;
+    // Строковая константа после замены escape-последовательностей
+    std::string unescaped_;
     bool eof = false;
     int previous_indent_ = 0;
+    // Ошибка, выбрасываемая после готовых токенов, переданных в конструктор
+    std::exception_ptr error_;
+    // Поток, из которого берутся токены в конвейерном режиме; иначе nullptr
+    std::unique_ptr<TokenPipeline> pipeline_;
+
+    static constexpr size_t INPUT_CHUNK_SIZE = 64 * 1024;
 
-    // Читает строку из потока, разбивает ее на токены
-    // и добавляет их в вектор tokens_list_
+    // Читает очередную непустую строку, разбивает ее на токены
+    // и добавляет их в очередь tokens_list_. В конвейерном режиме добавляет пачку токенов из pipeline_
     bool ParseInputStream_();
 
-    // Находит первое появление символа # в строке,
-    // не ограниченного кавычками
-    int FindComment_(const std::string& word);
+    // Читает очередную строку программы. Строка действительна до следующего вызова.
+    // Возвращает false, если строки закончились
+    bool ReadLine_(std::string_view& line);
+
+    // Отбрасывает прочитанные строки и дочитывает блок потока в input_buffer_.
+    // Возвращает false, если поток закончился
+    bool FillInputBuffer_();
 
     // Является ли char c символом названия переменной
     bool IsVariableChar_(char c);
 
     // Содержит ли строка название переменной
-    bool IsVariableName_(const std::string& word);
+    bool IsVariableName_(std::string_view word);
 
     // Является ли char c цифрой
     bool IsDigit_(char c);
 
     // Содержит ли строка число
-    bool IsNumber_(const std::string& word);
+    bool IsNumber_(std::string_view word);
 
     // Является ли char c отдельным символом
     bool IsOperationChar_(char c);
 
     // Содержит ли строка операцию
-    bool IsOperatinString_(const std::string& word);
+    bool IsOperatinString_(std::string_view word);
 
     // Если строка пустая или содержит только пробелы
-    bool IsLineEmpty_(const std::string& word);
+    bool IsLineEmpty_(std::string_view word);
 
-    // Обработчик escape-последовательностей для строки
-    std::string EscSeqHandler_(const std::string& word);
+    // Обработчик escape-последовательностей для строки. Строка без escape-последовательностей
+    // возвращается как есть, иначе результат записывается в unescaped_
+    std::string_view EscSeqHandler_(std::string_view word);
 
     // Переводит любую строку в токен
-    void AppendTokensList_(const std::string& word);
-
-    // Переводит строку с ключевым словом в токен
-    std::optional<Token> KeyWordToToken_(const std::string& word);
+    void AppendTokensList_(std::string_view word);
 
-    // Переводит строку с операцией в токен
-    std::optional<Token> OperationToToken_(const std::string& word);
+    // Переводит строку с ключевым словом или операцией из двух символов в токен
+    std::optional<Token> KeyWordToToken_(std::string_view word);
 
 };
 
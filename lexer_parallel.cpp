@@ -0,0 +1,130 @@
+#include "lexer_parallel.h"
+#include "lexer_scan.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+using namespace std;
+
+namespace parse {
+
+namespace {
+
+// Токены части программы, разобранной с нулевого отступа
+struct ChunkTokens {
+    vector<Token> tokens;
+    exception_ptr error;
+};
+
+// Делит source на не более чем count частей, каждая из которых заканчивается
+// переводом строки либо концом текста
+vector<string_view> SplitAtLines(string_view source, size_t count) {
+    vector<string_view> chunks;
+    size_t begin = 0;
+    for (size_t i = 1; i < count && begin < source.size(); ++i){
+        const size_t target = max(begin, source.size() / count * i);
+        const size_t end = min(scan::FindChar(source, target, '\n') + 1, source.size());
+        chunks.push_back(source.substr(begin, end - begin));
+        begin = end;
+    }
+    if (begin < source.size() || chunks.empty()){
+        chunks.push_back(source.substr(begin));
+    }
+    return chunks;
+}
+
+void LexChunk(string_view chunk, ChunkTokens& result) {
+    try {
+        Lexer lexer(chunk);
+        while (!lexer.CurrentToken().Is<token_type::Eof>()){
+            result.tokens.push_back(lexer.CurrentToken());
+            lexer.NextToken();
+        }
+        result.tokens.push_back(lexer.CurrentToken());
+    } catch (...) {
+        result.error = current_exception();
+    }
+}
+
+// Добавляет в tokens токены перехода с отступа from на отступ to
+void AppendIndentChange(vector<Token>& tokens, size_t from, size_t to) {
+    for (; from < to; ++from){
+        tokens.push_back(token_type::Indent{});
+    }
+    for (; from > to; --from){
+        tokens.push_back(token_type::Dedent{});
+    }
+}
+
+}  // namespace
+
+vector<Token> LexInParallel(string_view source, size_t threads) {
+    exception_ptr error;
+    vector<Token> result = LexInParallel(source, threads, error);
+    if (error){
+        rethrow_exception(error);
+    }
+    return result;
+}
+
+vector<Token> LexInParallel(string_view source, size_t threads, exception_ptr& error) {
+    const size_t count = clamp<size_t>(source.size() / MIN_CHUNK_SIZE, 1, max<size_t>(threads, 1));
+    const vector<string_view> chunks = SplitAtLines(source, count);
+
+    vector<ChunkTokens> lexed(chunks.size());
+    vector<thread> workers;
+    workers.reserve(chunks.size() - 1);
+    for (size_t i = 1; i < chunks.size(); ++i){
+        workers.emplace_back(LexChunk, chunks[i], ref(lexed[i]));
+    }
+    LexChunk(chunks[0], lexed[0]);
+    for (thread& worker : workers){
+        worker.join();
+    }
+
+    size_t total = 0;
+    for (const ChunkTokens& chunk : lexed){
+        total += chunk.tokens.size();
+    }
+    vector<Token> result;
+    result.reserve(total);
+
+    // Лексер части начинает её отступом первой непустой строки, считая от нуля,
+    // а в конце закрывает отступ последней строки. Эти токены заменяются переходом
+    // с отступа последней строки предыдущей части
+    size_t indent = 0;
+    for (const ChunkTokens& chunk : lexed){
+        const vector<Token>& tokens = chunk.tokens;
+        // Лексер части с ошибкой успел выдать токены строк до неё, без Dedent и Eof в конце
+        if (chunk.error){
+            const auto body_begin = find_if(tokens.begin(), tokens.end(), [](const Token& token) {
+                return !token.Is<token_type::Indent>();
+            });
+            if (body_begin != tokens.end()){
+                AppendIndentChange(result, indent, static_cast<size_t>(body_begin - tokens.begin()));
+                result.insert(result.end(), body_begin, tokens.end());
+            }
+            error = chunk.error;
+            return result;
+        }
+        // Часть только из пустых строк и комментариев состоит из одного Eof
+        if (tokens.size() == 1){
+            continue;
+        }
+        const auto body_begin = find_if(tokens.begin(), tokens.end(), [](const Token& token) {
+            return !token.Is<token_type::Indent>();
+        });
+        const auto body_end = find_if(next(tokens.rbegin()), tokens.rend(), [](const Token& token) {
+            return !token.Is<token_type::Dedent>();
+        }).base();
+        AppendIndentChange(result, indent, static_cast<size_t>(body_begin - tokens.begin()));
+        result.insert(result.end(), body_begin, body_end);
+        indent = static_cast<size_t>(tokens.end() - 1 - body_end);
+    }
+    AppendIndentChange(result, indent, 0);
+    result.push_back(token_type::Eof{});
+    return result;
+}
+
+}  // namespace parse
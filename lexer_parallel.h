@@ -0,0 +1,36 @@
+#pragma once
+
+#include "lexer.h"
+
+#include <cstddef>
+#include <exception>
+#include <string_view>
+#include <vector>
+
+/*
+Параллельный лексический анализ программы, прочитанной целиком. Текст делится на
+части по границам строк, и каждая часть разбирается отдельным лексером в своём потоке.
+Строки программы разбираются независимо друг от друга, кроме отступов: лексер части
+считает отступы от нуля. Поэтому после разбора токены Indent и Dedent в начале и в конце
+каждой части заменяются по отступам соседних частей, и получаются те же токены, что
+выдаёт Lexer для всего текста.
+Части разбираются до начала разбора программы, поэтому ошибка лексера в поздней части
+обнаруживается раньше ошибки парсера в ранней. Чтобы парсер выбросил ту же ошибку, что и
+с Lexer, токены до ошибки передаются в Lexer вместе с ошибкой, и она выбрасывается,
+только когда парсер доходит до места ошибки
+*/
+namespace parse {
+
+// Части короче MIN_CHUNK_SIZE байтов не выделяются: их разбор дешевле запуска потока
+inline constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+// Токены программы source вплоть до Eof, разобранные не более чем в threads потоках.
+// Ошибка лексера в любой части выбрасывается после разбора всех частей; из нескольких
+// ошибок выбрасывается ближайшая к началу программы
+std::vector<Token> LexInParallel(std::string_view source, size_t threads);
+
+// Токены программы source до первой ошибки лексера, которая сохраняется в error.
+// Если ошибки нет, error пуст, а последний токен - Eof
+std::vector<Token> LexInParallel(std::string_view source, size_t threads, std::exception_ptr& error);
+
+}  // namespace parse
@@ -0,0 +1,128 @@
+#include "lexer_parallel.h"
+#include "parse.h"
+#include "runtime.h"
+#include "test_runner_p.h"
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace parse {
+
+namespace {
+
+vector<Token> LexSequentially(string_view source) {
+    Lexer lexer(source);
+    vector<Token> tokens = {lexer.CurrentToken()};
+    while (!tokens.back().Is<token_type::Eof>()) {
+        tokens.push_back(lexer.NextToken());
+    }
+    return tokens;
+}
+
+// Тексты тестов делятся не больше чем на PARTS частей
+constexpr size_t PARTS = 4;
+
+// Вложенные классы, методы и условия длиной больше min_size байтов, чтобы границы
+// частей попадали на разные отступы. Между блоками встречаются длинные серии
+// пустых строк и комментариев
+string NestedProgram(size_t min_size) {
+    string program;
+    for (int i = 0; program.size() <= min_size; ++i) {
+        const string index = to_string(i);
+        program += "class C"s + index + ":\n  def get(x):\n    if x > "s + index + ":\n"s
+                   + "      if x > 1:\n        return 'deep # not a comment'\n"s
+                   + "      return x\n    # comment\n\n    return 'c\\n' + str(x)\n"s;
+        if (i % 97 == 0) {
+            for (int j = 0; j < 3000; ++j) {
+                program += j % 2 ? "\n"s : "      # indented comment\n"s;
+            }
+        }
+        program += "x"s + index + " = C"s + index + "()\n"s;
+    }
+    return program;
+}
+
+void TestMatchesSequential() {
+    const string program = NestedProgram(MIN_CHUNK_SIZE * PARTS);
+    const vector<Token> expected = LexSequentially(program);
+    for (size_t threads : {0U, 1U, 2U, 3U, 4U, 16U}) {
+        ASSERT_EQUAL(LexInParallel(program, threads), expected);
+    }
+}
+
+void TestOpenIndentAtEnd() {
+    // Программа заканчивается внутри тела метода без перевода строки
+    string program = NestedProgram(MIN_CHUNK_SIZE * PARTS)
+                     + "class Last:\n  def get():\n    return 1"s;
+    ASSERT_EQUAL(LexInParallel(program, PARTS), LexSequentially(program));
+}
+
+void TestSmallAndEmptySources() {
+    for (string_view program : {""sv, "\n\n# comment\n"sv, "x = 1"sv, "if x:\n  y = 2\n"sv}) {
+        ASSERT_EQUAL(LexInParallel(program, 4), LexSequentially(program));
+    }
+}
+
+void TestEarliestErrorIsThrown() {
+    string program = NestedProgram(MIN_CHUNK_SIZE * PARTS);
+    const size_t middle = program.find('\n', program.size() / 2) + 1;
+    program.insert(middle, "y = 99999999999\n"s);
+    program += "z = 88888888888\n"s;
+    try {
+        LexInParallel(program, PARTS);
+        ASSERT(false);
+    } catch (const LexerError& e) {
+        ASSERT_EQUAL(string(e.what()), "Number is out of range: 99999999999"s);
+    }
+}
+
+// Сообщение исключения, выброшенного при разборе программы, либо пустая строка
+template <typename MakeLexer>
+string ParseErrorMessage(MakeLexer make_lexer) {
+    try {
+        auto lexer = make_lexer();
+        ParseProgram(*lexer);
+    } catch (const exception& e) {
+        return e.what();
+    }
+    return {};
+}
+
+void TestErrorIsDeferredUntilParserReachesIt() {
+    // Ошибка парсера в первой части выбрасывается раньше ошибки лексера в последней
+    string program = NestedProgram(MIN_CHUNK_SIZE * PARTS);
+    program.insert(program.find('\n') + 1, "y = = 1\n"s);
+    program += "z = 88888888888\n"s;
+    const auto parallel = [&program] {
+        exception_ptr error;
+        vector<Token> tokens = LexInParallel(program, PARTS, error);
+        ASSERT(error != nullptr);
+        return make_unique<Lexer>(move(tokens), error);
+    };
+    const string expected = ParseErrorMessage([&program] {
+        return make_unique<Lexer>(string_view(program));
+    });
+    ASSERT(!expected.empty() && expected.find("88888888888"s) == string::npos);
+    ASSERT_EQUAL(ParseErrorMessage(parallel), expected);
+
+    // Без ошибки парсера выбрасывается ошибка лексера, как при разборе одним лексером
+    program = NestedProgram(MIN_CHUNK_SIZE * PARTS) + "z = 88888888888\n"s;
+    ASSERT_EQUAL(ParseErrorMessage(parallel), "Number is out of range: 88888888888"s);
+    ASSERT_THROWS(Lexer(vector<Token>{}, make_exception_ptr(LexerError("first line"s))), LexerError);
+}
+
+}  // namespace
+
+void RunLexerParallelTests(TestRunner& tr) {
+    RUN_TEST(tr, parse::TestMatchesSequential);
+    RUN_TEST(tr, parse::TestOpenIndentAtEnd);
+    RUN_TEST(tr, parse::TestSmallAndEmptySources);
+    RUN_TEST(tr, parse::TestEarliestErrorIsThrown);
+    RUN_TEST(tr, parse::TestErrorIsDeferredUntilParserReachesIt);
+}
+
+}  // namespace parse
@@ -0,0 +1,91 @@
+#include "lexer_pipeline.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace parse {
+
+TokenPipeline::TokenPipeline(istream& input)
+    : producer_([this, &input] {
+          Run_([&input] {
+              return Lexer(input);
+          });
+      }) {
+}
+
+TokenPipeline::TokenPipeline(string_view source)
+    : producer_([this, source] {
+          Run_([source] {
+              return Lexer(source);
+          });
+      }) {
+}
+
+TokenPipeline::~TokenPipeline() {
+    stopped_.store(true, memory_order_release);
+    producer_.join();
+}
+
+bool TokenPipeline::Receive(deque<Token>& out) {
+    const auto append = [&out](const Token& token) {
+        out.push_back(token);
+    };
+    while (true){
+        // finished_ читается до очереди: после него производитель уже ничего не добавит
+        const bool finished = finished_.load(memory_order_acquire);
+        if (queue_.Pop(BATCH_SIZE, append) > 0){
+            return true;
+        }
+        if (finished){
+            if (error_){
+                rethrow_exception(error_);
+            }
+            return false;
+        }
+        this_thread::yield();
+    }
+}
+
+void TokenPipeline::Produce_(Lexer& lexer) {
+    vector<Token> batch;
+    batch.reserve(BATCH_SIZE);
+    while (true){
+        const Token& token = lexer.CurrentToken();
+        batch.push_back(token);
+        const bool eof = token.Is<token_type::Eof>();
+        if (eof || batch.size() == BATCH_SIZE){
+            if (!Send_(batch.data(), batch.size())){
+                return;
+            }
+            batch.clear();
+        }
+        if (eof){
+            return;
+        }
+        try {
+            lexer.NextToken();
+        } catch (...) {
+            // Токены до ошибки доходят до потребителя раньше исключения
+            Send_(batch.data(), batch.size());
+            throw;
+        }
+    }
+}
+
+bool TokenPipeline::Send_(const Token* tokens, size_t count) {
+    while (count > 0){
+        if (stopped_.load(memory_order_acquire)){
+            return false;
+        }
+        const size_t sent = queue_.Push(tokens, count);
+        tokens += sent;
+        count -= sent;
+        if (count > 0){
+            this_thread::yield();
+        }
+    }
+    return true;
+}
+
+}  // namespace parse
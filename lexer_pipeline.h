@@ -0,0 +1,131 @@
+#pragma once
+
+#include "lexer.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+/*
+Конвейерный лексический анализ: лексер работает в отдельном потоке и передаёт
+токены парсеру через очередь без блокировок, поэтому разбор строки на токены
+идёт одновременно с разбором предыдущих строк парсером
+*/
+namespace parse {
+
+/*
+Кольцевой буфер фиксированного размера для одного производителя и одного потребителя.
+Каждый индекс изменяет только один поток, поэтому синхронизация сводится к
+публикации индекса с memory_order_release и чтению с memory_order_acquire
+*/
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    // Кладёт в очередь до count элементов из items. Вызывается только производителем.
+    // Возвращает количество помещённых элементов
+    size_t Push(const T* items, size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        count = std::min(count, Capacity - (tail - head));
+        for (size_t i = 0; i < count; ++i){
+            new (slots_[(tail + i) & (Capacity - 1)].bytes) T(items[i]);
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Передаёт до count элементов функции consume(const T&) и удаляет их из очереди.
+    // Вызывается только потребителем. Возвращает количество извлечённых элементов
+    template <typename Consume>
+    size_t Pop(size_t count, Consume consume) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        count = std::min(count, tail - head);
+        for (size_t i = 0; i < count; ++i){
+            consume(*std::launder(reinterpret_cast<const T*>(slots_[(head + i) & (Capacity - 1)].bytes)));
+        }
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    // Место под элемент без конструктора по умолчанию
+    struct Slot {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+
+    // Индексы растут монотонно; позиция в буфере - остаток от деления на Capacity.
+    // Индексы лежат в разных кэш-линиях, чтобы потоки не мешали друг другу
+    alignas(64) std::atomic<size_t> head_ = 0;
+    alignas(64) std::atomic<size_t> tail_ = 0;
+    alignas(64) std::array<Slot, Capacity> slots_;
+};
+
+/*
+Поток, разбирающий программу на токены. Токены передаются пачками по BATCH_SIZE.
+Исключение лексера сохраняется и выбрасывается потребителю после того, как он
+получит все токены, прочитанные до ошибки
+*/
+class TokenPipeline {
+public:
+    static constexpr size_t QUEUE_CAPACITY = 16 * 1024;
+    static constexpr size_t BATCH_SIZE = 256;
+
+    // Запускает поток, читающий input. Поток должен существовать, пока работает конвейер
+    explicit TokenPipeline(std::istream& input);
+
+    // Запускает поток, читающий буфер source. Буфер должен существовать, пока работает конвейер
+    explicit TokenPipeline(std::string_view source);
+
+    TokenPipeline(const TokenPipeline&) = delete;
+    TokenPipeline& operator=(const TokenPipeline&) = delete;
+
+    // Останавливает поток, даже если токены прочитаны не все
+    ~TokenPipeline();
+
+    // Ожидает очередную пачку токенов и добавляет её в конец out.
+    // Возвращает false, если токены закончились.
+    // Выбрасывает исключение, которым завершился лексер
+    bool Receive(std::deque<Token>& out);
+
+private:
+    SpscQueue<Token, QUEUE_CAPACITY> queue_;
+    // Производитель больше не положит токенов в очередь
+    std::atomic<bool> finished_ = false;
+    // Потребитель закрыл конвейер
+    std::atomic<bool> stopped_ = false;
+    // Исключение лексера; записывается до finished_
+    std::exception_ptr error_;
+    std::thread producer_;
+
+    // Передаёт токены lexer в очередь до Eof или остановки конвейера
+    void Produce_(Lexer& lexer);
+
+    // Кладёт в очередь count токенов, ожидая освобождения места.
+    // Возвращает false, если конвейер остановлен
+    bool Send_(const Token* tokens, size_t count);
+
+    // Исполняется в потоке producer_: создаёт лексер вызовом make_lexer и передаёт его токены
+    template <typename MakeLexer>
+    void Run_(MakeLexer make_lexer) {
+        try {
+            Lexer lexer = make_lexer();
+            Produce_(lexer);
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+        finished_.store(true, std::memory_order_release);
+    }
+};
+
+}  // namespace parse
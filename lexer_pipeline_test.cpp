@@ -0,0 +1,106 @@
+#include "lexer_pipeline.h"
+#include "parse.h"
+#include "runtime.h"
+#include "statement.h"
+#include "test_runner_p.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace parse {
+
+namespace {
+
+// Программа из classes классов, токены которой не помещаются в одну пачку и в очередь
+string ManyClassesProgram(int classes) {
+    string program;
+    for (int i = 0; i < classes; ++i) {
+        const string index = to_string(i);
+        program += "class C"s + index + ":\n  def get(x):\n    # comment\n\n"s
+                   + "    return x + "s + index + " * 'tab\\t'\n"s;
+    }
+    return program;
+}
+
+// В классе ManyClassesProgram больше 20 токенов: столько классов проходят очередь
+// по кругу чуть больше одного раза
+constexpr int WRAPPING_CLASSES = TokenPipeline::QUEUE_CAPACITY / 20;
+
+void TestQueueWrapsAround() {
+    SpscQueue<int, 8> queue;
+    vector<int> popped;
+    const auto append = [&popped](int value) {
+        popped.push_back(value);
+    };
+    const int items[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+    ASSERT_EQUAL(queue.Push(items, 10), 8U);
+    ASSERT_EQUAL(queue.Push(items + 8, 2), 0U);
+    ASSERT_EQUAL(queue.Pop(5, append), 5U);
+    // Элементы 8 и 9 записываются в начало буфера
+    ASSERT_EQUAL(queue.Push(items + 8, 2), 2U);
+    ASSERT_EQUAL(queue.Pop(100, append), 5U);
+    ASSERT_EQUAL(queue.Pop(100, append), 0U);
+    ASSERT_EQUAL(popped, vector<int>(begin(items), end(items)));
+}
+
+void TestPipelinedTokensMatchSequential() {
+    const string program = ManyClassesProgram(WRAPPING_CLASSES);
+    Lexer sequential{string_view(program)};
+    istringstream input(program);
+    Lexer pipelined(input, Pipelined{});
+    size_t tokens = 1;
+    while (!sequential.CurrentToken().Is<token_type::Eof>()) {
+        ASSERT_EQUAL(pipelined.CurrentToken(), sequential.CurrentToken());
+        sequential.NextToken();
+        pipelined.NextToken();
+        ++tokens;
+    }
+    ASSERT_EQUAL(pipelined.CurrentToken(), Token(token_type::Eof{}));
+    ASSERT_EQUAL(pipelined.NextToken(), Token(token_type::Eof{}));
+    ASSERT(tokens > TokenPipeline::QUEUE_CAPACITY);
+}
+
+void TestErrorAfterPrecedingTokens() {
+    Lexer lexer("x = 1\ny = 99999999999\n"sv, Pipelined{});
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Id{"x"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'='}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Number{1}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_THROWS(lexer.NextToken(), LexerError);
+}
+
+void TestStopsBeforeEof() {
+    // Лексер уничтожается, когда поток ждёт места в заполненной очереди
+    const string program = ManyClassesProgram(WRAPPING_CLASSES);
+    Lexer lexer{string_view(program), Pipelined{}};
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Class{}));
+}
+
+void TestParsePipelined() {
+    const string program = ManyClassesProgram(100)
+                           + "class Sum:\n  def add(a, b):\n    return a + b\n\n"s
+                           + "s = Sum()\nprint s.add(2, 3)\n"s;
+    Lexer lexer{string_view(program), Pipelined{}};
+    auto tree = ParseProgram(lexer);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "5\n"s);
+}
+
+}  // namespace
+
+void RunLexerPipelineTests(TestRunner& tr) {
+    RUN_TEST(tr, parse::TestQueueWrapsAround);
+    RUN_TEST(tr, parse::TestPipelinedTokensMatchSequential);
+    RUN_TEST(tr, parse::TestErrorAfterPrecedingTokens);
+    RUN_TEST(tr, parse::TestStopsBeforeEof);
+    RUN_TEST(tr, parse::TestParsePipelined);
+}
+
+}  // namespace parse
@@ -0,0 +1,287 @@
+#include "lexer_scan.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace parse::scan {
+
+namespace scalar {
+
+namespace {
+
+template <typename Predicate>
+size_t SkipWhile(string_view text, size_t pos, Predicate predicate) {
+    while (pos < text.size() && predicate(text[pos])){
+        ++pos;
+    }
+    return pos;
+}
+
+}  // namespace
+
+size_t SkipSpaces(string_view text, size_t pos) {
+    return SkipWhile(text, pos, [](char c) {
+        return HasClass(c, SPACE);
+    });
+}
+
+size_t SkipIdentifierChars(string_view text, size_t pos) {
+    return SkipWhile(text, pos, IsIdentifierChar);
+}
+
+size_t SkipDigits(string_view text, size_t pos) {
+    return SkipWhile(text, pos, IsDigit);
+}
+
+size_t SkipOperationChars(string_view text, size_t pos) {
+    return SkipWhile(text, pos, IsOperationChar);
+}
+
+size_t FindChar(string_view text, size_t pos, char c) {
+    return SkipWhile(text, pos, [c](char other) {
+        return other != c;
+    });
+}
+
+size_t FindComment(string_view line) {
+    bool single_quote = false;
+    bool double_quote = false;
+    for (size_t i = 0; i < line.size(); ++i){
+        const char c = line[i];
+        if (c == '\'' && !double_quote){
+            single_quote = !single_quote;
+        } else if (c == '"' && !single_quote){
+            double_quote = !double_quote;
+        } else if (c == '#' && !single_quote && !double_quote){
+            return i;
+        }
+    }
+    return string_view::npos;
+}
+
+}  // namespace scalar
+
+#if defined(__SSE2__)
+
+namespace {
+
+/*
+Операции над регистром из WIDTH байтов. Сравнения дают 0xFF в байтах, подходящих
+под условие, а Mask собирает старшие биты байтов: бит i соответствует байту i
+*/
+struct Sse2 {
+    using Vector = __m128i;
+    static constexpr size_t WIDTH = 16;
+
+    static Vector Load(const char* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+    static Vector Splat(char c) {
+        return _mm_set1_epi8(c);
+    }
+
+    static Vector Eq(Vector a, Vector b) {
+        return _mm_cmpeq_epi8(a, b);
+    }
+
+    static Vector Or(Vector a, Vector b) {
+        return _mm_or_si128(a, b);
+    }
+
+    static Vector And(Vector a, Vector b) {
+        return _mm_and_si128(a, b);
+    }
+
+    // lo <= x <= hi для байтов со знаком; байты вне ASCII отрицательны и в диапазон не попадают
+    static Vector InRange(Vector x, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                             _mm_cmplt_epi8(x, _mm_set1_epi8(static_cast<char>(hi + 1))));
+    }
+
+    static uint32_t Mask(Vector v) {
+        return static_cast<uint32_t>(_mm_movemask_epi8(v));
+    }
+};
+
+#if defined(__AVX2__)
+struct Avx2 {
+    using Vector = __m256i;
+    static constexpr size_t WIDTH = 32;
+
+    static Vector Load(const char* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    static Vector Splat(char c) {
+        return _mm256_set1_epi8(c);
+    }
+
+    static Vector Eq(Vector a, Vector b) {
+        return _mm256_cmpeq_epi8(a, b);
+    }
+
+    static Vector Or(Vector a, Vector b) {
+        return _mm256_or_si256(a, b);
+    }
+
+    static Vector And(Vector a, Vector b) {
+        return _mm256_and_si256(a, b);
+    }
+
+    static Vector InRange(Vector x, char lo, char hi) {
+        return _mm256_and_si256(
+            _mm256_cmpgt_epi8(x, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), x));
+    }
+
+    static uint32_t Mask(Vector v) {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+    }
+};
+using Simd = Avx2;
+#else
+using Simd = Sse2;
+#endif
+
+constexpr uint32_t FULL_MASK = Simd::WIDTH == 32 ? 0xFFFFFFFFu : 0xFFFFu;
+
+template <typename V>
+typename V::Vector IdentifierClass(typename V::Vector x) {
+    // Для букв установка бита 0x20 даёт строчную букву
+    const auto letters = V::InRange(V::Or(x, V::Splat(0x20)), 'a', 'z');
+    return V::Or(V::Or(letters, V::InRange(x, '0', '9')), V::Eq(x, V::Splat('_')));
+}
+
+template <typename V>
+typename V::Vector OperationClass(typename V::Vector x) {
+    auto result = V::Eq(x, V::Splat('.'));
+    for (const char c : {',', '(', ')', '>', '<', ':', '=', '+', '-', '*', '/', '!', '?'}){
+        result = V::Or(result, V::Eq(x, V::Splat(c)));
+    }
+    return result;
+}
+
+/*
+Пропускает символы, для которых classify возвращает установленные байты.
+Хвост короче регистра обрабатывается посимвольной функцией tail
+*/
+template <typename Classify, typename Tail>
+size_t SkipClass(string_view text, size_t pos, Classify classify, Tail tail) {
+    const char* data = text.data();
+    while (pos + Simd::WIDTH <= text.size()){
+        const uint32_t outside = ~Simd::Mask(classify(Simd::Load(data + pos))) & FULL_MASK;
+        if (outside){
+            return pos + __builtin_ctz(outside);
+        }
+        pos += Simd::WIDTH;
+    }
+    return tail(text, pos);
+}
+
+}  // namespace
+
+size_t SkipSpaces(string_view text, size_t pos) {
+    return SkipClass(text, pos, [](Simd::Vector x) {
+        return Simd::Eq(x, Simd::Splat(' '));
+    }, scalar::SkipSpaces);
+}
+
+size_t SkipIdentifierChars(string_view text, size_t pos) {
+    return SkipClass(text, pos, IdentifierClass<Simd>, scalar::SkipIdentifierChars);
+}
+
+size_t SkipDigits(string_view text, size_t pos) {
+    return SkipClass(text, pos, [](Simd::Vector x) {
+        return Simd::InRange(x, '0', '9');
+    }, scalar::SkipDigits);
+}
+
+size_t SkipOperationChars(string_view text, size_t pos) {
+    return SkipClass(text, pos, OperationClass<Simd>, scalar::SkipOperationChars);
+}
+
+size_t FindChar(string_view text, size_t pos, char c) {
+    const Simd::Vector needle = Simd::Splat(c);
+    const char* data = text.data();
+    while (pos + Simd::WIDTH <= text.size()){
+        if (const uint32_t found = Simd::Mask(Simd::Eq(Simd::Load(data + pos), needle))){
+            return pos + __builtin_ctz(found);
+        }
+        pos += Simd::WIDTH;
+    }
+    return scalar::FindChar(text, pos, c);
+}
+
+size_t FindComment(string_view line) {
+    // Блок ищется на кавычки и '#' целиком, а состояние кавычек меняется только в найденных позициях
+    const Simd::Vector hash = Simd::Splat('#');
+    const Simd::Vector single = Simd::Splat('\'');
+    const Simd::Vector dbl = Simd::Splat('"');
+    bool single_quote = false;
+    bool double_quote = false;
+    const auto visit = [&](char c) {
+        if (c == '\'' && !double_quote){
+            single_quote = !single_quote;
+        } else if (c == '"' && !single_quote){
+            double_quote = !double_quote;
+        } else if (c == '#' && !single_quote && !double_quote){
+            return true;
+        }
+        return false;
+    };
+
+    const char* data = line.data();
+    size_t pos = 0;
+    for (; pos + Simd::WIDTH <= line.size(); pos += Simd::WIDTH){
+        const Simd::Vector block = Simd::Load(data + pos);
+        uint32_t special = Simd::Mask(Simd::Or(Simd::Or(Simd::Eq(block, hash), Simd::Eq(block, single)),
+                                               Simd::Eq(block, dbl)));
+        while (special){
+            const size_t i = pos + __builtin_ctz(special);
+            if (visit(data[i])){
+                return i;
+            }
+            special &= special - 1;
+        }
+    }
+    for (; pos < line.size(); ++pos){
+        if (visit(data[pos])){
+            return pos;
+        }
+    }
+    return string_view::npos;
+}
+
+#else
+
+size_t SkipSpaces(string_view text, size_t pos) {
+    return scalar::SkipSpaces(text, pos);
+}
+
+size_t SkipIdentifierChars(string_view text, size_t pos) {
+    return scalar::SkipIdentifierChars(text, pos);
+}
+
+size_t SkipDigits(string_view text, size_t pos) {
+    return scalar::SkipDigits(text, pos);
+}
+
+size_t SkipOperationChars(string_view text, size_t pos) {
+    return scalar::SkipOperationChars(text, pos);
+}
+
+size_t FindChar(string_view text, size_t pos, char c) {
+    return scalar::FindChar(text, pos, c);
+}
+
+size_t FindComment(string_view line) {
+    return scalar::FindComment(line);
+}
+
+#endif
+
+}  // namespace parse::scan
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*
+Поиск границ лексем в строке программы. Функции классифицируют по 16 байт (SSE2)
+или по 32 байта (AVX2, если компилятор собирает код с -mavx2) за шаг, а остаток
+строки короче регистра обрабатывают по одному символу. Без SSE2 используются
+посимвольные версии из пространства имён scalar, по которым проверяется векторный код.
+Символы вне ASCII не относятся ни к одному классу
+*/
+namespace parse::scan {
+
+// Позиции не меньше text.size() означают, что подходящий символ не найден
+
+// Первый символ, начиная с pos, отличный от пробела
+size_t SkipSpaces(std::string_view text, size_t pos);
+
+// Первый символ, начиная с pos, не являющийся буквой, цифрой или '_'
+size_t SkipIdentifierChars(std::string_view text, size_t pos);
+
+// Первый символ, начиная с pos, не являющийся цифрой
+size_t SkipDigits(std::string_view text, size_t pos);
+
+// Первый символ, начиная с pos, не входящий в набор символов операций . , ( ) > < : = + - * / ! ?
+size_t SkipOperationChars(std::string_view text, size_t pos);
+
+// Первое вхождение символа c, начиная с pos
+size_t FindChar(std::string_view text, size_t pos, char c);
+
+// Первый символ '#', не ограниченный кавычками, либо std::string_view::npos.
+// Кавычка другого вида внутри строки и escape-последовательности не учитываются
+size_t FindComment(std::string_view line);
+
+namespace scalar {
+
+size_t SkipSpaces(std::string_view text, size_t pos);
+size_t SkipIdentifierChars(std::string_view text, size_t pos);
+size_t SkipDigits(std::string_view text, size_t pos);
+size_t SkipOperationChars(std::string_view text, size_t pos);
+size_t FindChar(std::string_view text, size_t pos, char c);
+size_t FindComment(std::string_view line);
+
+}  // namespace scalar
+
+// Классы символов, общие для векторных и посимвольных функций. Символ может
+// относиться к нескольким классам: цифра одновременно и символ названия
+enum CharClass : uint8_t {
+    SPACE = 1 << 0,
+    DIGIT = 1 << 1,
+    IDENTIFIER = 1 << 2,
+    OPERATION = 1 << 3,
+    QUOTE = 1 << 4,
+};
+
+// Таблица классов для всех 256 значений байта, строится при компиляции
+constexpr std::array<uint8_t, 256> MakeCharClasses() {
+    std::array<uint8_t, 256> classes{};
+    classes[static_cast<unsigned char>(' ')] |= SPACE;
+    for (unsigned char c = '0'; c <= '9'; ++c){
+        classes[c] |= DIGIT | IDENTIFIER;
+    }
+    for (unsigned char c = 'a'; c <= 'z'; ++c){
+        classes[c] |= IDENTIFIER;
+        classes[c - 'a' + 'A'] |= IDENTIFIER;
+    }
+    classes[static_cast<unsigned char>('_')] |= IDENTIFIER;
+    for (const char c : std::string_view(".,()><:=+-*/!?")){
+        classes[static_cast<unsigned char>(c)] |= OPERATION;
+    }
+    classes[static_cast<unsigned char>('\'')] |= QUOTE;
+    classes[static_cast<unsigned char>('"')] |= QUOTE;
+    return classes;
+}
+
+inline constexpr std::array<uint8_t, 256> CHAR_CLASSES = MakeCharClasses();
+
+constexpr bool HasClass(char c, CharClass char_class) {
+    return (CHAR_CLASSES[static_cast<unsigned char>(c)] & char_class) != 0;
+}
+
+constexpr bool IsIdentifierChar(char c) {
+    return HasClass(c, IDENTIFIER);
+}
+
+constexpr bool IsDigit(char c) {
+    return HasClass(c, DIGIT);
+}
+
+constexpr bool IsOperationChar(char c) {
+    return HasClass(c, OPERATION);
+}
+
+}  // namespace parse::scan
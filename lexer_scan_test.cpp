@@ -0,0 +1,87 @@
+#include "lexer_scan.h"
+#include "test_runner_p.h"
+
+#include <random>
+#include <string>
+
+using namespace std;
+
+namespace parse {
+
+namespace {
+
+// Строки из символов, встречающихся в программах, и байтов вне ASCII.
+// Длины перебираются так, чтобы попасть на границы 16- и 32-байтовых блоков.
+// Набор невелик: тесты выполняются при каждом запуске интерпретатора
+vector<string> RandomLines() {
+    const string alphabet = "aZz_09 .,()<>:=+-*/!?#'\"\\\t`{[@\x7f\x80\xff"s;
+    mt19937 gen(43);
+    uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    uniform_int_distribution<int> run(0, 40);
+    vector<string> lines;
+    for (size_t len = 0; len < 70; ++len){
+        for (int variant = 0; variant < 3; ++variant){
+            string line;
+            // Длинные серии одного класса проверяют векторный цикл, а не только хвост
+            while (line.size() < len){
+                const char c = alphabet[pick(gen)];
+                line.append(min<size_t>(run(gen) % 3 == 0 ? run(gen) : 1, len - line.size()), c);
+            }
+            lines.push_back(move(line));
+        }
+    }
+    return lines;
+}
+
+void TestSkipMatchesScalar() {
+    for (const string& line : RandomLines()){
+        for (size_t pos = 0; pos <= line.size(); ++pos){
+            ASSERT_EQUAL(scan::SkipSpaces(line, pos), scan::scalar::SkipSpaces(line, pos));
+            ASSERT_EQUAL(scan::SkipIdentifierChars(line, pos), scan::scalar::SkipIdentifierChars(line, pos));
+            ASSERT_EQUAL(scan::SkipDigits(line, pos), scan::scalar::SkipDigits(line, pos));
+            ASSERT_EQUAL(scan::SkipOperationChars(line, pos), scan::scalar::SkipOperationChars(line, pos));
+            for (const char c : {'\'', '"', '#', '\x80'}){
+                ASSERT_EQUAL(scan::FindChar(line, pos, c), scan::scalar::FindChar(line, pos, c));
+            }
+        }
+    }
+}
+
+void TestFindCommentMatchesScalar() {
+    for (const string& line : RandomLines()){
+        ASSERT_EQUAL(scan::FindComment(line), scan::scalar::FindComment(line));
+    }
+}
+
+void TestCharacterClasses() {
+    const string identifier = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+    ASSERT_EQUAL(scan::SkipIdentifierChars(identifier + "@", 0), identifier.size());
+    // Соседи диапазонов букв и цифр в ASCII не являются символами названий
+    for (const char c : {'@', '[', '`', '{', '/', ':', '\x80', '\xc1', '\xdf', '\xfa'}){
+        ASSERT(!scan::IsIdentifierChar(c));
+        ASSERT_EQUAL(scan::SkipIdentifierChars(string(20, 'a') + c + string(20, 'b'), 0), 20U);
+    }
+    ASSERT_EQUAL(scan::SkipDigits("0123456789012345678901234567890123456789x"s, 0), 40U);
+    ASSERT_EQUAL(scan::SkipOperationChars(".,()><:=+-*/!?.,()><:=+-*/!?.,()><:=+-*/!? "s, 0), 42U);
+    ASSERT_EQUAL(scan::SkipSpaces(string(50, ' '), 0), 50U);
+}
+
+void TestFindComment() {
+    ASSERT_EQUAL(scan::FindComment("x = 1"s), string_view::npos);
+    ASSERT_EQUAL(scan::FindComment("x = 1 # comment"s), 6U);
+    ASSERT_EQUAL(scan::FindComment("s = 'not # a comment' # comment"s), 22U);
+    ASSERT_EQUAL(scan::FindComment("s = \"it's # inside\" + 'say \"#\"' #"s), 32U);
+    const string padding(37, ' ');
+    ASSERT_EQUAL(scan::FindComment(padding + "'#" + padding + "'" + padding + "#"), padding.size() * 3 + 3);
+}
+
+}  // namespace
+
+void RunLexerScanTests(TestRunner& tr) {
+    RUN_TEST(tr, parse::TestSkipMatchesScalar);
+    RUN_TEST(tr, parse::TestFindCommentMatchesScalar);
+    RUN_TEST(tr, parse::TestCharacterClasses);
+    RUN_TEST(tr, parse::TestFindComment);
+}
+
+}  // namespace parse
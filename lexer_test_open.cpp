@@ -351,6 +351,165 @@ abc#
         ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
     }
 }
+
+void TestBufferedSource() {
+    const string program = R"(
+class Greeter:
+  def greet(name):
+    return 'hello, ' + name + "\t!" # comment
+g = Greeter()
+print g.greet('world'), 42 >= 7
+)"s;
+
+    istringstream is(program);
+    Lexer stream_lexer(is);
+    Lexer buffer_lexer{string_view(program)};
+    const char* const source_begin = program.data();
+    const char* const source_end = source_begin + program.size();
+    while (true) {
+        const Token& token = buffer_lexer.CurrentToken();
+        ASSERT_EQUAL(token, stream_lexer.CurrentToken());
+        // Значения хранятся в таблицах строк, одинаковые тексты - в одном экземпляре
+        if (const auto id = token.TryAs<token_type::Id>()) {
+            ASSERT(id->value.Str().data() < source_begin || id->value.Str().data() >= source_end);
+            const auto stream_id = stream_lexer.CurrentToken().As<token_type::Id>();
+            ASSERT(id->value.Str().data() == stream_id.value.Str().data());
+        } else if (const auto str = token.TryAs<token_type::String>()) {
+            ASSERT(str->value.data() < source_begin || str->value.data() >= source_end);
+        }
+        if (token.Is<token_type::Eof>()) {
+            break;
+        }
+        buffer_lexer.NextToken();
+        stream_lexer.NextToken();
+    }
+}
+
+// Поток с программой из lines одинаковых классов, текст которой создаётся по мере чтения
+class GeneratedProgramBuf : public std::streambuf {
+public:
+    explicit GeneratedProgramBuf(int classes)
+        : classes_(classes) {
+
+    }
+
+protected:
+    int_type underflow() override {
+        if (next_class_ == classes_) {
+            return traits_type::eof();
+        }
+        const string index = to_string(next_class_++);
+        chunk_ = "class C"s + index + ":\n  def get(x):\n    # comment\n\n"s
+                 + "    return x + "s + index + " * 'tab\\t'\n"s;
+        setg(chunk_.data(), chunk_.data(), chunk_.data() + chunk_.size());
+        return traits_type::to_int_type(chunk_.front());
+    }
+
+private:
+    int classes_;
+    int next_class_ = 0;
+    string chunk_;
+};
+
+void TestLargeStreamUsesBoundedMemory() {
+    // Около 200 КБ текста: поток читается несколькими блоками по 64 КБ
+    constexpr int CLASSES = 3000;
+    GeneratedProgramBuf buf(CLASSES);
+    const size_t identifiers_before = symbols::Identifiers().Size();
+    const size_t strings_before = symbols::StringConstants().Size();
+    istream input(&buf);
+    Lexer lexer(input);
+
+    size_t tokens = 1;
+    size_t max_buffered = 0;
+    size_t ids = 0;
+    while (!lexer.CurrentToken().Is<token_type::Eof>()) {
+        max_buffered = std::max(max_buffered, lexer.GetBufferedTokenCount());
+        if (const auto id = lexer.CurrentToken().TryAs<token_type::Id>()) {
+            ids += id->value == "x"sv;
+        }
+        lexer.NextToken();
+        ++tokens;
+    }
+    // Class Id : Newline Indent Def Id ( Id ) : Newline Indent Return Id + Number * String
+    // Newline Dedent Dedent
+    ASSERT_EQUAL(tokens, 22U * CLASSES + 1);
+    ASSERT_EQUAL(ids, 2U * CLASSES);
+    // Лексер хранит только токены текущей строки программы
+    ASSERT(max_buffered <= 10U);
+    // Имена классов различны, остальные идентификаторы и строка общие для всех классов
+    ASSERT(symbols::Identifiers().Size() - identifiers_before <= CLASSES + 3U);
+    ASSERT(symbols::StringConstants().Size() - strings_before <= 1U);
+}
+
+void TestLongRunOfEmptyLines() {
+    // Пустые строки и комментарии пропускаются в цикле, а не рекурсией: на ста тысячах
+    // строк рекурсивный пропуск переполняет стек. Около 650 КБ пропускаемых строк,
+    // поэтому серия пересекает несколько границ блока чтения в 64 КБ
+    string program = "x = 1\n"s;
+    for (int i = 0; i < 100000; ++i) {
+        program += i % 2 ? "  # comment\n"sv : "\n"sv;
+    }
+    program += "y = 2"s;
+
+    istringstream input(program);
+    Lexer lexer(input);
+    vector<Token> expected = {Token(token_type::Id{"x"s}), token_type::Char{'='},
+                              token_type::Number{1}, token_type::Newline{},
+                              Token(token_type::Id{"y"s}), token_type::Char{'='},
+                              token_type::Number{2}, token_type::Newline{}, token_type::Eof{}};
+    for (const Token& token : expected) {
+        ASSERT_EQUAL(lexer.CurrentToken(), token);
+        lexer.NextToken();
+    }
+}
+
+void TestLinesCrossInputChunks() {
+    // Строки длиннее блока чтения (64 КБ) и строки на границах блоков
+    constexpr int CONDITIONS = 2500;
+    string program = "long_"s + string(70000, 'a') + " = 'x'\n"s;
+    for (int i = 0; i < CONDITIONS; ++i) {
+        program += "if v"s + to_string(i) + ":\n  print 'line', "s + to_string(i) + "\n"s;
+    }
+    program += "tail"s;
+
+    istringstream input(program);
+    Lexer stream_lexer(input);
+    Lexer buffer_lexer{string_view(program)};
+    size_t tokens = 1;
+    while (!buffer_lexer.CurrentToken().Is<token_type::Eof>()) {
+        ASSERT_EQUAL(stream_lexer.CurrentToken(), buffer_lexer.CurrentToken());
+        stream_lexer.NextToken();
+        buffer_lexer.NextToken();
+        ++tokens;
+    }
+    ASSERT(stream_lexer.CurrentToken().Is<token_type::Eof>());
+    // long_a... = 'x' Newline, 11 токенов на условие и 2 токена хвоста
+    ASSERT_EQUAL(tokens, 4U + 11U * CONDITIONS + 2U + 1U);
+}
+
+void TestReservedWordLookalikes() {
+    // Слова с теми же первым, последним символом или длиной, что и ключевые слова
+    istringstream input("cls classes Class iff fi ef nonE Trie flase ant nt dof printf rn or_ ="s);
+    Lexer lexer(input);
+    size_t ids = 0;
+    while (lexer.CurrentToken().Is<token_type::Id>()) {
+        ++ids;
+        lexer.NextToken();
+    }
+    ASSERT_EQUAL(ids, 15U);
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Char{'='}));
+
+    istringstream operations("=! <> >< !! == <= >="s);
+    Lexer operation_lexer(operations);
+    for (char c : "=!<>><!!"s) {
+        ASSERT_EQUAL(operation_lexer.CurrentToken(), Token(token_type::Char{c}));
+        operation_lexer.NextToken();
+    }
+    ASSERT_EQUAL(operation_lexer.CurrentToken(), Token(token_type::Eq{}));
+    ASSERT_EQUAL(operation_lexer.NextToken(), Token(token_type::LessOrEq{}));
+    ASSERT_EQUAL(operation_lexer.NextToken(), Token(token_type::GreaterOrEq{}));
+}
 }  // namespace
 
 void RunOpenLexerTests(TestRunner& tr) {
@@ -367,6 +526,11 @@ void RunOpenLexerTests(TestRunner& tr) {
     RUN_TEST(tr, parse::TestMythonProgram);
     RUN_TEST(tr, parse::TestAlwaysEmitsNewlineAtTheEndOfNonemptyLine);
     RUN_TEST(tr, parse::TestCommentsAreIgnored);
+    RUN_TEST(tr, parse::TestBufferedSource);
+    RUN_TEST(tr, parse::TestLargeStreamUsesBoundedMemory);
+    RUN_TEST(tr, parse::TestLongRunOfEmptyLines);
+    RUN_TEST(tr, parse::TestLinesCrossInputChunks);
+    RUN_TEST(tr, parse::TestReservedWordLookalikes);
 }
 
 }  // namespace parse
\ No newline at end of file
@@ -1,35 +1,282 @@
+#include "bench.h"
 #include "lexer.h"
+#include "lexer_parallel.h"
 #include "parse.h"
+#include "pass_manager.h"
+#include "profile.h"
+#include "program_cache.h"
 #include "runtime.h"
 #include "statement.h"
 #include "test_runner_p.h"
+#include "threaded_code.h"
+#include "tiered.h"
 
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
 namespace parse {
 void RunOpenLexerTests(TestRunner& tr);
+void RunLexerScanTests(TestRunner& tr);
+void RunLexerPipelineTests(TestRunner& tr);
+void RunLexerParallelTests(TestRunner& tr);
 }  // namespace parse
 
 namespace ast {
 void RunUnitTests(TestRunner& tr);
-}
+void RunSuperinstructionsTests(TestRunner& tr);
+void RunConstantFoldingTests(TestRunner& tr);
+void RunTypeInferenceTests(TestRunner& tr);
+void RunInliningTests(TestRunner& tr);
+void RunClassHierarchyTests(TestRunner& tr);
+void RunSubexpressionTests(TestRunner& tr);
+void RunDeadCodeTests(TestRunner& tr);
+void RunEscapeAnalysisTests(TestRunner& tr);
+void RunMemoizationTests(TestRunner& tr);
+void RunProfileTests(TestRunner& tr);
+}  // namespace ast
 namespace runtime {
 void RunObjectHolderTests(TestRunner& tr);
 void RunObjectsTests(TestRunner& tr);
 }  // namespace runtime
+namespace threaded {
+void RunThreadedCodeTests(TestRunner& tr);
+}  // namespace threaded
+namespace tiered {
+void RunTieredTests(TestRunner& tr);
+}  // namespace tiered
+namespace cache {
+void RunProgramCacheTests(TestRunner& tr);
+}  // namespace cache
+namespace symbols {
+void RunSymbolTableTests(TestRunner& tr);
+}  // namespace symbols
+namespace opt {
+void RunPassManagerTests(TestRunner& tr);
+}  // namespace opt
 
 void TestParseProgram(TestRunner& tr);
 
 namespace {
 
-void RunMythonProgram(istream& input, ostream& output) {
-    parse::Lexer lexer(input);
-    auto program = ParseProgram(lexer);
+// Параметры запуска интерпретатора
+struct Options {
+    // Исполнять программу шитым кодом (--threaded)
+    bool threaded = false;
+    // Компилировать горячие методы в шитый код в фоновом потоке (--tiered)
+    bool tiered = false;
+    // Разбирать тела методов при первом вызове (--lazy-parse)
+    bool lazy_parse = false;
+    // Читать токены в отдельном потоке одновременно с разбором (--lex-thread)
+    bool lex_thread = false;
+    // Разбирать текст на токены по частям во всех ядрах (--lex-parallel)
+    bool lex_parallel = false;
+    // Запустить замеры производительности вместо программы (--bench)
+    bool bench = false;
+    // Уровень оптимизации дерева (-O0, -O1, -O2)
+    opt::OptimizationLevel level = opt::OptimizationLevel::O0;
+    // Вывести в cerr статистику оптимизационных проходов (--opt-stats)
+    bool opt_stats = false;
+    // Размер кэша результатов чистых методов (--memoize[=N]); 0 - без запоминания
+    size_t memoize_capacity = 0;
+    // Файл, в который записывается профиль исполнения (--profile-generate=FILE).
+    // При записи профиля оптимизации не выполняются
+    string profile_generate;
+    // Файл с профилем предыдущего запуска для оптимизаций (--profile-use=FILE)
+    string profile_use;
+    // Файл кэша разобранной программы (--cache=FILE). Устаревший кэш перезаписывается
+    string cache;
+
+    // Хеш текста программы нужен только профилям и кэшу
+    [[nodiscard]] bool NeedsSourceHash() const {
+        return !profile_generate.empty() || !profile_use.empty() || !cache.empty();
+    }
+};
+
+constexpr size_t DEFAULT_MEMOIZE_CAPACITY = 1024;
+
+Options ParseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i){
+        const string_view arg = argv[i];
+        if (arg == "--threaded"sv){
+            options.threaded = true;
+        } else if (arg == "--tiered"sv){
+            options.tiered = true;
+        } else if (arg == "--lazy-parse"sv){
+            options.lazy_parse = true;
+        } else if (arg == "--lex-thread"sv){
+            options.lex_thread = true;
+        } else if (arg == "--lex-parallel"sv){
+            options.lex_parallel = true;
+        } else if (arg == "--bench"sv){
+            options.bench = true;
+        } else if (arg == "--opt-stats"sv){
+            options.opt_stats = true;
+        } else if (arg == "--memoize"sv){
+            options.memoize_capacity = DEFAULT_MEMOIZE_CAPACITY;
+        } else if (arg.substr(0, 10) == "--memoize="sv){
+            const string value(arg.substr(10));
+            size_t parsed = 0;
+            int capacity = 0;
+            // Нечисловое и слишком большое значения оставляют capacity нулевым, а хвост
+            // после числа, который stoi пропускает, виден по parsed
+            try {
+                capacity = std::stoi(value, &parsed);
+            } catch (const std::invalid_argument&) {
+            } catch (const std::out_of_range&) {
+            }
+            if (parsed != value.size() || capacity <= 0){
+                throw std::invalid_argument("Memoization cache size must be a positive integer"s);
+            }
+            options.memoize_capacity = static_cast<size_t>(capacity);
+        } else if (arg.substr(0, 19) == "--profile-generate="sv){
+            options.profile_generate = arg.substr(19);
+        } else if (arg.substr(0, 14) == "--profile-use="sv){
+            options.profile_use = arg.substr(14);
+        } else if (arg.substr(0, 8) == "--cache="sv){
+            options.cache = arg.substr(8);
+        } else if (arg.size() > 1 && arg[0] == '-' && arg[1] == 'O'){
+            options.level = opt::ParseOptimizationLevel(arg.substr(1));
+        } else {
+            throw std::invalid_argument("Unknown option "s + argv[i]);
+        }
+    }
+    if (options.threaded && options.tiered){
+        throw std::invalid_argument("--threaded cannot be combined with --tiered"s);
+    }
+    if (options.lex_thread && options.lex_parallel){
+        throw std::invalid_argument("--lex-thread cannot be combined with --lex-parallel"s);
+    }
+    // Отложенные тела методов неизвестны проходам и многоуровневому исполнению
+    if (options.lazy_parse
+        && (options.level != opt::OptimizationLevel::O0 || options.memoize_capacity
+            || options.tiered || !options.profile_generate.empty()
+            || !options.profile_use.empty())){
+        throw std::invalid_argument(
+            "--lazy-parse cannot be combined with -O1, -O2, --memoize, --tiered or profiles"s);
+    }
+    if (options.lazy_parse && !options.cache.empty()){
+        throw std::invalid_argument("--lazy-parse cannot be combined with --cache"s);
+    }
+    if (!options.profile_generate.empty() && !options.profile_use.empty()){
+        throw std::invalid_argument("--profile-generate cannot be combined with --profile-use"s);
+    }
+    return options;
+}
+
+// Читает профиль из файла path. Профиль другой программы не используется
+optional<ast::Profile> LoadProfile(const string& path, uint64_t source_hash) {
+    ifstream in(path);
+    if (!in){
+        throw std::runtime_error("Unable to open profile "s + path);
+    }
+    ast::Profile profile = ast::ReadProfile(in);
+    if (profile.source_hash != source_hash){
+        cerr << "Profile "sv << path << " was recorded for another program, ignored"sv << endl;
+        return nullopt;
+    }
+    return profile;
+}
+
+void RunMythonProgram(istream& input, ostream& output, const Options& options = {}) {
+    // Текст читается целиком, только если нужен его хеш или параллельный лексер.
+    // Иначе лексер читает поток сам и держит в памяти лишь окно токенов
+    optional<string> source;
+    if (options.NeedsSourceHash() || options.lex_parallel){
+        source.emplace(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    }
+    // Профиль и кэш сопоставляются программе по хешу её текста
+    uint64_t source_hash = 0;
+    if (options.NeedsSourceHash()){
+        source_hash = ast::HashSource(*source);
+    }
+    shared_ptr<LazyParseStats> lazy_stats;
+    unique_ptr<runtime::Executable> program;
+    if (!options.cache.empty()){
+        program = cache::LoadProgram(options.cache, source_hash);
+    }
+    if (!program){
+        optional<parse::Lexer> lexer;
+        if (options.lex_parallel){
+            // Ошибка лексера выбрасывается, когда парсер доходит до неё, как при разборе одним лексером
+            exception_ptr lex_error;
+            vector<parse::Token> tokens = parse::LexInParallel(*source, thread::hardware_concurrency(), lex_error);
+            lexer.emplace(move(tokens), lex_error);
+        } else if (source && options.lex_thread){
+            lexer.emplace(string_view(*source), parse::Pipelined{});
+        } else if (source){
+            lexer.emplace(string_view(*source));
+        } else if (options.lex_thread){
+            lexer.emplace(input, parse::Pipelined{});
+        } else {
+            lexer.emplace(input);
+        }
+        if (options.lazy_parse){
+            lazy_stats = make_shared<LazyParseStats>();
+            program = ParseProgramLazily(*lexer, lazy_stats);
+        } else {
+            program = ParseProgram(*lexer);
+        }
+        // Кэш записывается до оптимизаций: в нём хранится дерево, полученное от парсера
+        if (!options.cache.empty()){
+            cache::SaveProgram(options.cache, *program, source_hash);
+        }
+    }
+
+    optional<ast::Profile> profile;
+    if (!options.profile_use.empty()){
+        profile = LoadProfile(options.profile_use, source_hash);
+    }
+    shared_ptr<ast::Profile> recording;
+    opt::PassManager passes;
+    if (!options.profile_generate.empty()){
+        recording = ast::InstrumentProgram(program, source_hash);
+    } else {
+        passes = opt::CreatePassManager(options.level, options.memoize_capacity,
+                                        profile ? &*profile : nullptr);
+        passes.Run(program);
+    }
+
+    if (options.threaded){
+        program = threaded::Compile(std::move(program));
+    }
+    tiered::TierManager tiers;
+    if (options.tiered){
+        tiers.Install(*program);
+    }
     runtime::SimpleContext context{output};
     runtime::Closure closure;
     program->Execute(closure, context);
+
+    if (recording){
+        ofstream out(options.profile_generate);
+        if (!out){
+            throw std::runtime_error("Unable to write profile "s + options.profile_generate);
+        }
+        ast::WriteProfile(out, *recording);
+    }
+
+    // Статистика выводится после исполнения: отчёты проходов включают счётчики кэшей
+    if (options.opt_stats){
+        passes.PrintStatistics(cerr);
+        if (options.tiered){
+            tiers.PrintStatistics(cerr);
+        }
+        if (lazy_stats){
+            cerr << "lazy parsing: "sv << lazy_stats->materialized << " of "sv
+                 << lazy_stats->deferred << " method bodies parsed, "sv
+                 << lazy_stats->Unmaterialized() << " never called\n"sv;
+        }
+    }
 }
 
 void TestSimplePrints() {
@@ -43,6 +290,8 @@ print
 print None
 )");
 
+    opt::VerifyAllOptimizationLevels(input.str());
+
     ostringstream output;
     RunMythonProgram(input, output);
 
@@ -62,6 +311,8 @@ x = None
 print x, y
 )");
 
+    opt::VerifyAllOptimizationLevels(input.str());
+
     ostringstream output;
     RunMythonProgram(input, output);
 
@@ -71,6 +322,8 @@ print x, y
 void TestArithmetics() {
     istringstream input("print 1+2+3+4+5, 1*2*3*4*5, 1-2-3-4-5, 36/4/3, 2*5+10/2");
 
+    opt::VerifyAllOptimizationLevels(input.str());
+
     ostringstream output;
     RunMythonProgram(input, output);
 
@@ -104,6 +357,8 @@ d.do_add(x)
 print y.value
 )");
 
+    opt::VerifyAllOptimizationLevels(input.str());
+
     ostringstream output;
     RunMythonProgram(input, output);
 
@@ -113,10 +368,28 @@ print y.value
 void TestAll() {
     TestRunner tr;
     parse::RunOpenLexerTests(tr);
+    parse::RunLexerScanTests(tr);
+    parse::RunLexerPipelineTests(tr);
+    parse::RunLexerParallelTests(tr);
+    symbols::RunSymbolTableTests(tr);
     runtime::RunObjectHolderTests(tr);
     runtime::RunObjectsTests(tr);
     ast::RunUnitTests(tr);
     TestParseProgram(tr);
+    threaded::RunThreadedCodeTests(tr);
+    tiered::RunTieredTests(tr);
+    ast::RunSuperinstructionsTests(tr);
+    ast::RunConstantFoldingTests(tr);
+    opt::RunPassManagerTests(tr);
+    cache::RunProgramCacheTests(tr);
+    ast::RunTypeInferenceTests(tr);
+    ast::RunInliningTests(tr);
+    ast::RunClassHierarchyTests(tr);
+    ast::RunSubexpressionTests(tr);
+    ast::RunDeadCodeTests(tr);
+    ast::RunEscapeAnalysisTests(tr);
+    ast::RunMemoizationTests(tr);
+    ast::RunProfileTests(tr);
 
     RUN_TEST(tr, TestSimplePrints);
     RUN_TEST(tr, TestAssignments);
@@ -126,11 +399,16 @@ void TestAll() {
 
 }  // namespace
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
-        TestAll();
+        const Options options = ParseOptions(argc, argv);
+        if (options.bench){
+            bench::RunBenchmarks(cout);
+            return 0;
+        }
 
-        RunMythonProgram(cin, cout);
+        TestAll();
+        RunMythonProgram(cin, cout, options);
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return 1;
@@ -0,0 +1,320 @@
+#include "memoization.h"
+
+#include "ast_utils.h"
+
+#include <set>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+bool IsSpecialMethod(symbols::Symbol symbol) {
+    const string& name = symbol.Str();
+    return name.size() > 4 && name.compare(0, 2, "__"s) == 0
+           && name.compare(name.size() - 2, 2, "__"s) == 0;
+}
+
+vector<symbols::Symbol> GetParams(const runtime::Method& method) {
+    vector<symbols::Symbol> params = method.formal_params;
+    if (!params.empty() && params.front() == runtime::names::SELF){
+        params.erase(params.begin());
+    }
+    return params;
+}
+
+using CallSignature = pair<symbols::Symbol, size_t>;
+
+// Проверяет тело одного метода: находит побочные эффекты и собирает вызываемые методы
+class PurityChecker : public Visitor {
+public:
+    bool pure = true;
+    set<CallSignature> calls;
+
+    PurityChecker(bool user_str, bool user_add, bool user_compare)
+        : user_str_(user_str), user_add_(user_add), user_compare_(user_compare) {
+
+    }
+
+protected:
+    using Visitor::Visit;
+
+    // Узлы, не перечисленные ниже, неизвестны анализу
+    bool Visit(Statement&) override {
+        return Impure();
+    }
+
+    bool Visit(NumericConst&) override {
+        return true;
+    }
+
+    bool Visit(StringConst&) override {
+        return true;
+    }
+
+    bool Visit(BoolConst&) override {
+        return true;
+    }
+
+    bool Visit(None&) override {
+        return true;
+    }
+
+    bool Visit(VariableValue& node) override {
+        // Чтение поля: результат зависит не только от аргументов. Значение self тоже:
+        // ключ кэша включает класс объекта, но не сам объект
+        return (node.dotted_ids_.size() == 1 && node.dotted_ids_.front() != runtime::names::SELF)
+               || Impure();
+    }
+
+    bool Visit(Assignment&) override {
+        return true;
+    }
+
+    bool Visit(MethodCall& node) override {
+        calls.emplace(node.method_, node.args_.size());
+        // Вызов метода у self не читает сам объект: чистота вызываемого метода
+        // проверяется по его телу
+        auto* receiver = dynamic_cast<VariableValue*>(node.object_.get());
+        if (!receiver || receiver->dotted_ids_.size() != 1
+            || receiver->dotted_ids_.front() != runtime::names::SELF){
+            return true;
+        }
+        for (auto& arg : node.args_){
+            Walk(*arg);
+        }
+        return false;
+    }
+
+    bool Visit(Stringify&) override {
+        return !user_str_ || Impure();
+    }
+
+    bool Visit(Add&) override {
+        return !user_add_ || Impure();
+    }
+
+    bool Visit(Sub&) override {
+        return true;
+    }
+
+    bool Visit(Mult&) override {
+        return true;
+    }
+
+    bool Visit(Div&) override {
+        return true;
+    }
+
+    bool Visit(Or&) override {
+        return true;
+    }
+
+    bool Visit(And&) override {
+        return true;
+    }
+
+    bool Visit(Not&) override {
+        return true;
+    }
+
+    bool Visit(Comparison&) override {
+        return !user_compare_ || Impure();
+    }
+
+    bool Visit(Compound&) override {
+        return true;
+    }
+
+    bool Visit(MethodBody&) override {
+        return true;
+    }
+
+    bool Visit(Return&) override {
+        return true;
+    }
+
+    bool Visit(IfElse&) override {
+        // Условие-объект приводится к логическому значению через __str__
+        return !user_str_ || Impure();
+    }
+
+private:
+    const bool user_str_;
+    const bool user_add_;
+    const bool user_compare_;
+
+    bool Impure() {
+        pure = false;
+        return false;
+    }
+};
+
+// Дописывает к key значение, если его можно использовать в ключе кэша
+bool AppendKey(const ObjectHolder& value, string& key) {
+    if (!value){
+        key += 'n';
+    } else if (auto* number = value.TryAs<runtime::Number>()){
+        key += 'i';
+        key += to_string(number->GetValue());
+    } else if (auto* str = value.TryAs<runtime::String>()){
+        key += 's';
+        key += to_string(str->GetValue().size());
+        key += ':';
+        key += str->GetValue();
+    } else if (auto* boolean = value.TryAs<runtime::Bool>()){
+        key += boolean->GetValue() ? "b1"s : "b0"s;
+    } else {
+        return false;
+    }
+    key += ';';
+    return true;
+}
+
+bool IsCacheable(const ObjectHolder& value) {
+    return !value || value.TryAs<runtime::Number>() || value.TryAs<runtime::String>()
+           || value.TryAs<runtime::Bool>();
+}
+
+}  // namespace
+
+PureMethods FindPureMethods(Statement& program) {
+    const vector<ClassMethod> methods = CollectMethods(program);
+
+    set<symbols::Symbol> names;
+    for (const auto& [cls, method, body] : methods){
+        names.insert(method->name);
+    }
+    const bool user_str = names.count(runtime::names::STR) > 0;
+    const bool user_add = names.count(runtime::names::ADD) > 0;
+    const bool user_compare = names.count(runtime::names::EQ) > 0 || names.count(runtime::names::LT) > 0;
+
+    // Чистота методов без учёта вызовов и вызываемые ими методы
+    struct Candidate {
+        const runtime::Method* method;
+        CallSignature signature;
+        bool pure;
+        set<CallSignature> calls;
+    };
+    vector<Candidate> candidates;
+    for (const auto& [cls, method, body] : methods){
+        PurityChecker checker(user_str, user_add, user_compare);
+        checker.Walk(*method->body);
+        candidates.push_back({method, {method->name, GetParams(*method).size()}, checker.pure,
+                              std::move(checker.calls)});
+    }
+
+    // Метод перестаёт считаться чистым, если вызывает метод с сигнатурой, у которой
+    // есть нечистая реализация. Повторяется до неподвижной точки
+    for (bool changed = true; changed;){
+        changed = false;
+        set<CallSignature> impure;
+        for (const Candidate& candidate : candidates){
+            if (!candidate.pure){
+                impure.insert(candidate.signature);
+            }
+        }
+        for (Candidate& candidate : candidates){
+            if (!candidate.pure){
+                continue;
+            }
+            for (const CallSignature& call : candidate.calls){
+                if (impure.count(call)){
+                    candidate.pure = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    PureMethods result;
+    for (const Candidate& candidate : candidates){
+        if (candidate.pure && !IsSpecialMethod(candidate.method->name)){
+            result.insert(candidate.method->body.get());
+        }
+    }
+    return result;
+}
+
+double MemoStats::HitRate() const {
+    const size_t lookups = hits + misses;
+    return lookups ? static_cast<double>(hits) / lookups : 0.0;
+}
+
+MemoizedMethodBody::MemoizedMethodBody(shared_ptr<runtime::Executable> body, vector<symbols::Symbol> params,
+                                       size_t capacity)
+    : body_(std::move(body)), params_(std::move(params)), capacity_(capacity) {
+
+}
+
+ObjectHolder MemoizedMethodBody::Execute(Closure& closure, Context& context) {
+    string key;
+    bool cacheable = true;
+    if (auto it = closure.find(runtime::names::SELF); it != closure.end()){
+        if (auto* instance = it->second.TryAs<runtime::ClassInstance>()){
+            key += to_string(reinterpret_cast<uintptr_t>(&instance->GetClass()));
+            key += ';';
+        }
+    }
+    for (const symbols::Symbol param : params_){
+        auto it = closure.find(param);
+        if (it == closure.end() || !AppendKey(it->second, key)){
+            cacheable = false;
+            break;
+        }
+    }
+    if (!cacheable){
+        stats_.uncached++;
+        return body_->Execute(closure, context);
+    }
+
+    if (auto it = index_.find(key); it != index_.end()){
+        stats_.hits++;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+
+    ObjectHolder result = body_->Execute(closure, context);
+    if (!IsCacheable(result)){
+        stats_.uncached++;
+        return result;
+    }
+    stats_.misses++;
+    // Рекурсивные вызовы могли уже добавить запись с тем же ключом
+    if (index_.count(key)){
+        return result;
+    }
+    if (!entries_.empty() && entries_.size() >= capacity_){
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+        stats_.evictions++;
+    }
+    entries_.emplace_front(key, result);
+    index_[std::move(key)] = entries_.begin();
+    return result;
+}
+
+const MemoStats& MemoizedMethodBody::GetStats() const {
+    return stats_;
+}
+
+MemoizedMethods MemoizeMethods(Statement& program, const PureMethods& pure, size_t capacity) {
+    MemoizedMethods result;
+    for (const auto& [cls, method, body] : CollectMethods(program)){
+        if (!pure.count(method->body.get())){
+            continue;
+        }
+        auto memoized = make_shared<MemoizedMethodBody>(method->body, GetParams(*method), capacity);
+        method->body = memoized;
+        result.emplace_back(cls->GetName().Str() + "."s + method->name.Str(), std::move(memoized));
+    }
+    return result;
+}
+
+}  // namespace ast
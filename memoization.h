@@ -0,0 +1,82 @@
+#pragma once
+
+#include "statement.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/*
+Запоминание результатов чистых методов. Метод чист, если он не пишет в поля, не читает
+поля (в том числе через self.x), не выводит текст, не создаёт объекты и вызывает только
+чистые методы. Результат такого метода определяется классом получателя и значениями
+аргументов, поэтому его можно взять из кэша
+*/
+namespace ast {
+
+// Тела чистых методов программы
+using PureMethods = std::unordered_set<const runtime::Executable*>;
+
+/*
+Находит чистые методы программы. Вызов object.m(args) считается чистым, если чисты все
+методы программы с именем m и тем же количеством параметров. Если в программе объявлены
+__str__, __add__, __eq__ или __lt__, операции, которые могут их вызвать, считаются
+нечистыми. Специальные методы (__init__, __str__ и т.д.) в результат не входят.
+Анализ выполняется над деревом, которое ещё не изменяли оптимизационные проходы
+*/
+PureMethods FindPureMethods(Statement& program);
+
+struct MemoStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    // Записей, вытесненных из заполненного кэша
+    size_t evictions = 0;
+    // Вызовов, аргументы или результат которых нельзя сохранить в кэше
+    size_t uncached = 0;
+
+    [[nodiscard]] double HitRate() const;
+};
+
+/*
+Тело метода с кэшем результатов. Ключ кэша - класс self и значения аргументов; в кэше
+сохраняются вызовы, все аргументы и результат которых - числа, строки, логические
+значения или None. При заполнении кэша вытесняется запись, к которой дольше всего
+не обращались
+*/
+class MemoizedMethodBody : public runtime::Executable {
+public:
+    MemoizedMethodBody(std::shared_ptr<runtime::Executable> body, std::vector<symbols::Symbol> params,
+                       size_t capacity);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const MemoStats& GetStats() const;
+
+private:
+    using Entry = std::pair<std::string, runtime::ObjectHolder>;
+
+    std::shared_ptr<runtime::Executable> body_;
+    // Имена параметров метода без self
+    std::vector<symbols::Symbol> params_;
+    size_t capacity_;
+    // Записи в порядке от последней использованной к давно не использованной
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    MemoStats stats_;
+};
+
+// Запомненный метод: "Class.method" и его тело
+using MemoizedMethods = std::vector<std::pair<std::string, std::shared_ptr<MemoizedMethodBody>>>;
+
+/*
+Заменяет тела методов из pure телами с кэшем на capacity записей.
+Замещённые методы больше не видны проходам, обходящим тела методов, поэтому
+это последнее преобразование дерева
+*/
+MemoizedMethods MemoizeMethods(Statement& program, const PureMethods& pure, size_t capacity);
+
+}  // namespace ast
@@ -0,0 +1,219 @@
+#include "memoization.h"
+#include "ast_utils.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+#include <set>
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+// Имена чистых методов в виде "Class.method"
+set<string> GetPureNames(Statement& program) {
+    const PureMethods pure = FindPureMethods(program);
+    set<string> names;
+    for (const auto& [cls, method, body] : CollectMethods(program)){
+        if (pure.count(method->body.get())){
+            names.insert(cls->GetName().Str() + "."s + method->name.Str());
+        }
+    }
+    return names;
+}
+
+const string FIB = R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+f = Fib()
+print f.calc(25)
+)"s;
+
+// Вывод FIB. Исполнение без кэша заняло бы сотни тысяч вызовов при каждом запуске тестов
+const string FIB_OUTPUT = "75025\n"s;
+
+void TestPurity() {
+    auto program = ParseFromString(R"(
+class B:
+  def get():
+    return 1
+
+class A:
+  def __init__():
+    self.x = 1
+
+  def square(n):
+    return n * n
+
+  def sum_squares(a, b):
+    t = self.square(a)
+    return t + self.square(b)
+
+  def field():
+    return self.x
+
+  def setter(v):
+    self.x = v
+
+  def calls_setter(v):
+    self.setter(v)
+    return v
+
+  def noisy(n):
+    print n
+    return n
+
+  def create():
+    return B()
+
+  def name(s):
+    return 'name: ' + str(s)
+
+  def ident():
+    return str(self)
+
+  def pass_self():
+    return self.square(self)
+
+print 1
+)"s);
+    ASSERT_EQUAL(GetPureNames(*program),
+                 (set<string>{"A.square"s, "A.sum_squares"s, "A.name"s, "B.get"s}));
+}
+
+void TestUserOperatorsAreImpure() {
+    auto program = ParseFromString(R"(
+class A:
+  def __add__(other):
+    print 'add'
+    return 1
+
+  def add(a, b):
+    return a + b
+
+  def mult(a, b):
+    return a * b
+
+print 1
+)"s);
+    ASSERT_EQUAL(GetPureNames(*program), (set<string>{"A.mult"s}));
+}
+
+void TestNestedClassOverridesMethod() {
+    // Inner.m печатает, поэтому вызывающий его B.f нечист
+    const string program = R"(
+class B:
+  def m():
+    return 1
+
+  def f():
+    return self.m()
+
+class Maker:
+  def make():
+    class Inner(B):
+      def m():
+        print 'side'
+        return 2
+    return 0
+
+i = Inner()
+print i.f()
+print i.f()
+)"s;
+    const string output = opt::VerifyOptimization(program, [](unique_ptr<Statement>& tree) {
+        MemoizeMethods(*tree, FindPureMethods(*tree), 16);
+    }).output;
+    ASSERT_EQUAL(output, "side\n2\nside\n2\n"s);
+}
+
+void TestInstancesAreDistinguished() {
+    // Без __str__ объект выводится по адресу, поэтому ident различен у разных объектов
+    const string program = R"(
+class A:
+  def ident():
+    return str(self)
+
+a = A()
+b = A()
+print a.ident() == b.ident(), a.ident() == a.ident()
+)"s;
+    const string output = opt::VerifyOptimization(program, [](unique_ptr<Statement>& tree) {
+        MemoizeMethods(*tree, FindPureMethods(*tree), 16);
+    }).output;
+    ASSERT_EQUAL(output, "False True\n"s);
+}
+
+void TestMemoizedRecursion() {
+    auto program = ParseFromString(FIB);
+    const PureMethods pure = FindPureMethods(*program);
+    const MemoizedMethods memoized = MemoizeMethods(*program, pure, 100);
+    ASSERT_EQUAL(memoized.size(), 1U);
+    ASSERT_EQUAL(memoized.front().first, "Fib.calc"s);
+
+    ASSERT_EQUAL(Execute(*program), FIB_OUTPUT);
+    const MemoStats& stats = memoized.front().second->GetStats();
+    ASSERT_EQUAL(stats.misses, 26U);
+    // Второй вызов calc(n - 2) берётся из кэша для всех n, кроме 2
+    ASSERT_EQUAL(stats.hits, 23U);
+    ASSERT_EQUAL(stats.evictions, 0U);
+}
+
+void TestEvictionAndUncachedCalls() {
+    const string source = R"(
+class Box:
+  def __init__(v):
+    self.v = v
+
+class M:
+  def id(x):
+    return x
+
+m = M()
+b = Box(1)
+print m.id(1), m.id(2), m.id(1), m.id(3), m.id(1), m.id(2)
+x = m.id(b)
+print m.id('s'), m.id(None), m.id(True)
+)"s;
+    auto reference = ParseFromString(source);
+    const string expected = Execute(*reference);
+
+    auto program = ParseFromString(source);
+    const MemoizedMethods memoized = MemoizeMethods(*program, FindPureMethods(*program), 2);
+    ASSERT_EQUAL(Execute(*program), expected);
+
+    const MemoStats& stats = memoized.front().second->GetStats();
+    // 1 2 [1] 3 (вытесняет 2) [1] 2 (вытесняет 3), затем 's', None, True
+    ASSERT_EQUAL(stats.hits, 2U);
+    ASSERT_EQUAL(stats.misses, 7U);
+    ASSERT_EQUAL(stats.evictions, 5U);
+    ASSERT_EQUAL(stats.uncached, 1U);
+}
+
+void TestWithOptimizations() {
+    for (auto level : {opt::OptimizationLevel::O0, opt::OptimizationLevel::O2}){
+        auto program = ParseFromString(FIB);
+        opt::CreatePassManager(level, 16).Run(program);
+        ASSERT_EQUAL(Execute(*program), FIB_OUTPUT);
+    }
+}
+
+}  // namespace
+
+void RunMemoizationTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestPurity);
+    RUN_TEST(tr, ast::TestUserOperatorsAreImpure);
+    RUN_TEST(tr, ast::TestNestedClassOverridesMethod);
+    RUN_TEST(tr, ast::TestInstancesAreDistinguished);
+    RUN_TEST(tr, ast::TestMemoizedRecursion);
+    RUN_TEST(tr, ast::TestEvictionAndUncachedCalls);
+    RUN_TEST(tr, ast::TestWithOptimizations);
+}
+
+}  // namespace ast
@@ -3,26 +3,160 @@
 #include "lexer.h"
 #include "statement.h"
 
+#include <sstream>
+
 using namespace std;
 
 namespace TokenType = parse::token_type;
 
 namespace {
 bool operator==(const parse::Token& token, char c) {
-    const auto* p = token.TryAs<TokenType::Char>();
-    return p != nullptr && p->value == c;
+    const auto p = token.TryAs<TokenType::Char>();
+    return p && p->value == c;
 }
 
 bool operator!=(const parse::Token& token, char c) {
     return !(token == c);
 }
 
+// Приоритеты операций выражения: чем больше приоритет, тем сильнее операция связывает операнды
+enum Precedence {
+    PREC_LOWEST,  // выражение целиком: в начале, в скобках и в аргументах вызова
+    PREC_OR,
+    PREC_AND,
+    PREC_NOT,  // операнд not - сравнение или арифметическое выражение
+    PREC_COMPARISON,
+    PREC_ADDITIVE,
+    PREC_MULTIPLICATIVE,  // операнд унарного минуса - одно первичное выражение
+};
+
+using ExpressionPtr = unique_ptr<ast::Statement>;
+
+// Бинарная операция: приоритет и создание узла по операндам
+struct BinaryOperator {
+    Precedence precedence;
+    ExpressionPtr (*make)(ExpressionPtr lhs, ExpressionPtr rhs);
+};
+
+template <typename Node>
+ExpressionPtr MakeBinary(ExpressionPtr lhs, ExpressionPtr rhs) {
+    return make_unique<Node>(std::move(lhs), std::move(rhs));
+}
+
+template <bool (*Compare)(const runtime::ObjectHolder&, const runtime::ObjectHolder&,
+                          runtime::Context&)>
+ExpressionPtr MakeComparison(ExpressionPtr lhs, ExpressionPtr rhs) {
+    return make_unique<ast::Comparison>(Compare, std::move(lhs), std::move(rhs));
+}
+
+// Таблица бинарных операций в порядке возрастания приоритета
+enum BinaryOperatorIndex { OP_OR, OP_AND, OP_LESS, OP_GREATER, OP_EQUAL, OP_NOT_EQUAL,
+                           OP_LESS_OR_EQUAL, OP_GREATER_OR_EQUAL, OP_ADD, OP_SUB, OP_MULT, OP_DIV };
+
+const BinaryOperator BINARY_OPERATORS[] = {
+    {PREC_OR, MakeBinary<ast::Or>},
+    {PREC_AND, MakeBinary<ast::And>},
+    {PREC_COMPARISON, MakeComparison<runtime::Less>},
+    {PREC_COMPARISON, MakeComparison<runtime::Greater>},
+    {PREC_COMPARISON, MakeComparison<runtime::Equal>},
+    {PREC_COMPARISON, MakeComparison<runtime::NotEqual>},
+    {PREC_COMPARISON, MakeComparison<runtime::LessOrEqual>},
+    {PREC_COMPARISON, MakeComparison<runtime::GreaterOrEqual>},
+    {PREC_ADDITIVE, MakeBinary<ast::Add>},
+    {PREC_ADDITIVE, MakeBinary<ast::Sub>},
+    {PREC_MULTIPLICATIVE, MakeBinary<ast::Mult>},
+    {PREC_MULTIPLICATIVE, MakeBinary<ast::Div>},
+};
+
+// Операция, которую обозначает лексема token, или nullptr
+const BinaryOperator* FindBinaryOperator(const parse::Token& token) {
+    switch (token.Kind()) {
+        case parse::TOKEN_KIND<TokenType::Or>:
+            return &BINARY_OPERATORS[OP_OR];
+        case parse::TOKEN_KIND<TokenType::And>:
+            return &BINARY_OPERATORS[OP_AND];
+        case parse::TOKEN_KIND<TokenType::Eq>:
+            return &BINARY_OPERATORS[OP_EQUAL];
+        case parse::TOKEN_KIND<TokenType::NotEq>:
+            return &BINARY_OPERATORS[OP_NOT_EQUAL];
+        case parse::TOKEN_KIND<TokenType::LessOrEq>:
+            return &BINARY_OPERATORS[OP_LESS_OR_EQUAL];
+        case parse::TOKEN_KIND<TokenType::GreaterOrEq>:
+            return &BINARY_OPERATORS[OP_GREATER_OR_EQUAL];
+        case parse::TOKEN_KIND<TokenType::Char>:
+            switch (static_cast<char>(token.Payload())) {
+                case '<':
+                    return &BINARY_OPERATORS[OP_LESS];
+                case '>':
+                    return &BINARY_OPERATORS[OP_GREATER];
+                case '+':
+                    return &BINARY_OPERATORS[OP_ADD];
+                case '-':
+                    return &BINARY_OPERATORS[OP_SUB];
+                case '*':
+                    return &BINARY_OPERATORS[OP_MULT];
+                case '/':
+                    return &BINARY_OPERATORS[OP_DIV];
+                default:
+                    return nullptr;
+            }
+        default:
+            return nullptr;
+    }
+}
+
+// Операция, ожидающая разбора своего (правого) операнда
+struct PendingOperation {
+    enum Kind { BINARY, NOT, NEGATE, PARENTHESES };
+
+    Kind kind;
+    const BinaryOperator* binary;  // для BINARY
+    // Приоритет, с которым продолжается разбор после свёртки операции
+    Precedence outer;
+};
+
+// Классы программы в порядке объявления. Ссылки не владеющие: классами владеют
+// узлы ClassDefinition дерева, а владеющая ссылка из тела метода на собственный
+// класс образовала бы цикл
+using DeclaredClasses = vector<pair<symbols::Symbol, runtime::ObjectHolder>>;
+
+// Тело метода, токены которого разбираются при первом вызове
+class LazyMethodBody : public runtime::Executable {
+public:
+    LazyMethodBody(vector<parse::Token> tokens, shared_ptr<const DeclaredClasses> classes,
+                   size_t visible_classes, shared_ptr<LazyParseStats> stats)
+        : tokens_(std::move(tokens)), classes_(std::move(classes)),
+          visible_classes_(visible_classes), stats_(std::move(stats)) {
+        ++stats_->deferred;
+    }
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+private:
+    vector<parse::Token> tokens_;
+    // Телу видны первые visible_classes_ классов - объявленные до тела метода
+    shared_ptr<const DeclaredClasses> classes_;
+    size_t visible_classes_;
+    shared_ptr<LazyParseStats> stats_;
+    unique_ptr<ast::MethodBody> body_;
+};
+
 class Parser {
 public:
     explicit Parser(parse::Lexer& lexer)
         : lexer_(lexer) {
     }
 
+    // Тела методов разбираются при первом вызове, если lazy_stats не nullptr
+    Parser(parse::Lexer& lexer, runtime::Closure declared_classes,
+           shared_ptr<LazyParseStats> lazy_stats)
+        : lexer_(lexer), declared_classes_(std::move(declared_classes)),
+          lazy_stats_(std::move(lazy_stats)) {
+        if (lazy_stats_) {
+            declaration_order_ = make_shared<DeclaredClasses>();
+        }
+    }
+
     // Program -> eps
     //          | Statement \n Program
     unique_ptr<ast::Statement> ParseProgram() {
@@ -34,6 +168,15 @@ public:
         return result;
     }
 
+    // MethodBody -> Suite
+    unique_ptr<ast::MethodBody> ParseMethodBody() {
+        return make_unique<ast::MethodBody>(ParseSuite());
+    }
+
+    [[nodiscard]] const runtime::Closure& GetDeclaredClasses() const {
+        return declared_classes_;
+    }
+
 private:
     // Suite -> NEWLINE INDENT (Statement)+ DEDENT
     unique_ptr<ast::Statement> ParseSuite()  // NOLINT
@@ -66,9 +209,9 @@ private:
             lexer_.ExpectNext<TokenType::Char>('(');
 
             if (lexer_.NextToken().Is<TokenType::Id>()) {
-                m.formal_params.push_back(lexer_.Expect<TokenType::Id>().value);
+                m.formal_params.emplace_back(lexer_.Expect<TokenType::Id>().value);
                 while (lexer_.NextToken() == ',') {
-                    m.formal_params.push_back(lexer_.ExpectNext<TokenType::Id>().value);
+                    m.formal_params.emplace_back(lexer_.ExpectNext<TokenType::Id>().value);
                 }
             }
 
@@ -76,29 +219,82 @@ private:
             lexer_.ExpectNext<TokenType::Char>(':');
             lexer_.NextToken();
 
-            m.body = std::make_unique<ast::MethodBody>(ParseSuite());  // NOLINT
+            if (lazy_stats_) {
+                m.body = ParseLazyMethodBody();
+            } else {
+                m.body = std::make_unique<ast::MethodBody>(ParseSuite());  // NOLINT
+            }
 
             result.push_back(std::move(m));
         }
         return result;
     }
 
+    // Находит конец Suite по балансу отступов и возвращает его токены, завершённые Eof
+    vector<parse::Token> SkipSuite(bool& declares_class) {
+        lexer_.Expect<TokenType::Newline>();
+        vector<parse::Token> tokens{lexer_.CurrentToken()};
+        lexer_.ExpectNext<TokenType::Indent>();
+
+        int depth = 0;
+        do {
+            const parse::Token& token = lexer_.CurrentToken();
+            if (token.Is<TokenType::Eof>()) {
+                throw ParseError("Unexpected end of file in method body"s);
+            }
+            if (token.Is<TokenType::Indent>()) {
+                ++depth;
+            } else if (token.Is<TokenType::Dedent>()) {
+                --depth;
+            } else if (token.Is<TokenType::Class>()) {
+                declares_class = true;
+            }
+            tokens.push_back(token);
+            lexer_.NextToken();
+        } while (depth > 0);
+
+        tokens.push_back(TokenType::Eof{});
+        return tokens;
+    }
+
+    unique_ptr<runtime::Executable> ParseLazyMethodBody() {
+        bool declares_class = false;
+        vector<parse::Token> tokens = SkipSuite(declares_class);
+        if (!declares_class) {
+            // Телу видны классы, объявленные до него, включая классы из тел
+            // предыдущих методов того же класса
+            return make_unique<LazyMethodBody>(std::move(tokens), declaration_order_,
+                                               declaration_order_->size(), lazy_stats_);
+        }
+
+        // Классы, объявленные в теле, должны быть видны программе сразу
+        parse::Lexer body_lexer(std::move(tokens));
+        Parser body_parser(body_lexer, declared_classes_, nullptr);
+        auto body = body_parser.ParseMethodBody();
+        for (const auto& [name, cls] : body_parser.GetDeclaredClasses()) {
+            if (declared_classes_.insert({name, cls}).second) {
+                declaration_order_->emplace_back(name, runtime::ObjectHolder::Share(*cls));
+            }
+        }
+        return body;
+    }
+
     // ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
     unique_ptr<ast::Statement> ParseClassDefinition()  // NOLINT
     {
-        string class_name = lexer_.Expect<TokenType::Id>().value;
+        const symbols::Symbol class_name = lexer_.Expect<TokenType::Id>().value;
 
         lexer_.NextToken();
 
         const runtime::Class* base_class = nullptr;
         if (lexer_.CurrentToken() == '(') {
-            auto name = lexer_.ExpectNext<TokenType::Id>().value;
+            const symbols::Symbol name = lexer_.ExpectNext<TokenType::Id>().value;
             lexer_.ExpectNext<TokenType::Char>(')');
             lexer_.NextToken();
 
             auto it = declared_classes_.find(name);
             if (it == declared_classes_.end()) {
-                throw ParseError("Base class "s + name + " not found for class "s + class_name);
+                throw ParseError("Base class "s + name.Str() + " not found for class "s + class_name.Str());
             }
             base_class = static_cast<const runtime::Class*>(it->second.Get());  // NOLINT
         }
@@ -118,17 +314,20 @@ private:
         });
 
         if (!inserted) {
-            throw ParseError("Class "s + class_name + " already exists"s);
+            throw ParseError("Class "s + class_name.Str() + " already exists"s);
+        }
+        if (lazy_stats_) {
+            declaration_order_->emplace_back(class_name, runtime::ObjectHolder::Share(*it->second));
         }
 
         return make_unique<ast::ClassDefinition>(it->second);
     }
 
-    vector<string> ParseDottedIds() {
-        vector<string> result(1, lexer_.Expect<TokenType::Id>().value);
+    vector<symbols::Symbol> ParseDottedIds() {
+        vector<symbols::Symbol> result(1, lexer_.Expect<TokenType::Id>().value);
 
         while (lexer_.NextToken() == '.') {
-            result.push_back(lexer_.ExpectNext<TokenType::Id>().value);
+            result.emplace_back(lexer_.ExpectNext<TokenType::Id>().value);
         }
 
         return result;
@@ -139,24 +338,24 @@ private:
     unique_ptr<ast::Statement> ParseAssignmentOrCall() {
         lexer_.Expect<TokenType::Id>();
 
-        vector<string> id_list = ParseDottedIds();
-        string last_name = id_list.back();
+        vector<symbols::Symbol> id_list = ParseDottedIds();
+        const symbols::Symbol last_name = id_list.back();
         id_list.pop_back();
 
         if (lexer_.CurrentToken() == '=') {
             lexer_.NextToken();
 
             if (id_list.empty()) {
-                return make_unique<ast::Assignment>(std::move(last_name), ParseTest());
+                return make_unique<ast::Assignment>(last_name, ParseTest());
             }
             return make_unique<ast::FieldAssignment>(ast::VariableValue{std::move(id_list)},
-                                                     std::move(last_name), ParseTest());
+                                                     last_name, ParseTest());
         }
         lexer_.Expect<TokenType::Char>('(');
         lexer_.NextToken();
 
         if (id_list.empty()) {
-            throw ParseError("Mython doesn't support functions, only methods: "s + last_name);
+            throw ParseError("Mython doesn't support functions, only methods: "s + last_name.Str());
         }
 
         vector<unique_ptr<ast::Statement>> args;
@@ -167,72 +366,25 @@ private:
         lexer_.NextToken();
 
         return make_unique<ast::MethodCall>(make_unique<ast::VariableValue>(std::move(id_list)),
-                                            std::move(last_name), std::move(args));
-    }
-
-    // Expr -> Adder ['+'/'-' Adder]*
-    unique_ptr<ast::Statement> ParseExpression()  // NOLINT
-    {
-        unique_ptr<ast::Statement> result = ParseAdder();
-        while (lexer_.CurrentToken() == '+' || lexer_.CurrentToken() == '-') {
-            char op = lexer_.CurrentToken().As<TokenType::Char>().value;
-            lexer_.NextToken();
-
-            if (op == '+') {
-                result = make_unique<ast::Add>(std::move(result), ParseAdder());
-            } else {
-                result = make_unique<ast::Sub>(std::move(result), ParseAdder());
-            }
-        }
-        return result;
+                                            last_name, std::move(args));
     }
 
-    // Adder -> Mult ['*'/'/' Mult]*
-    unique_ptr<ast::Statement> ParseAdder()  // NOLINT
+    // Primary -> NUMBER
+    //          | STRING
+    //          | NONE
+    //          | TRUE
+    //          | FALSE
+    //          | DottedIds '(' ExprList ')'
+    //          | DottedIds
+    unique_ptr<ast::Statement> ParsePrimary()  // NOLINT
     {
-        unique_ptr<ast::Statement> result = ParseMult();
-        while (lexer_.CurrentToken() == '*' || lexer_.CurrentToken() == '/') {
-            char op = lexer_.CurrentToken().As<TokenType::Char>().value;
-            lexer_.NextToken();
-
-            if (op == '*') {
-                result = make_unique<ast::Mult>(std::move(result), ParseMult());
-            } else {
-                result = make_unique<ast::Div>(std::move(result), ParseMult());
-            }
-        }
-        return result;
-    }
-
-    // Mult -> '(' Expr ')'
-    //       | NUMBER
-    //       | '-' Mult
-    //       | STRING
-    //       | NONE
-    //       | TRUE
-    //       | FALSE
-    //       | DottedIds '(' ExprList ')'
-    //       | DottedIds
-    unique_ptr<ast::Statement> ParseMult()  // NOLINT
-    {
-        if (lexer_.CurrentToken() == '(') {
-            lexer_.NextToken();
-            auto result = ParseTest();
-            lexer_.Expect<TokenType::Char>(')');
-            lexer_.NextToken();
-            return result;
-        }
-        if (lexer_.CurrentToken() == '-') {
-            lexer_.NextToken();
-            return make_unique<ast::Mult>(ParseMult(), make_unique<ast::NumericConst>(-1));
-        }
-        if (const auto* num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
+        if (const auto num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
             int result = num->value;
             lexer_.NextToken();
             return make_unique<ast::NumericConst>(result);
         }
-        if (const auto* str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
-            string result = str->value;
+        if (const auto str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
+            string result(str->value);
             lexer_.NextToken();
             return make_unique<ast::StringConst>(std::move(result));
         }
@@ -253,7 +405,7 @@ private:
     }
 
     std::unique_ptr<ast::Statement> ParseDottedIdsInMultExpr() {
-        vector<string> names = ParseDottedIds();
+        vector<symbols::Symbol> names = ParseDottedIds();
 
         if (lexer_.CurrentToken() == '(') {
             // various calls
@@ -269,20 +421,20 @@ private:
 
             if (!names.empty()) {
                 return make_unique<ast::MethodCall>(
-                    make_unique<ast::VariableValue>(std::move(names)), std::move(method_name),
+                    make_unique<ast::VariableValue>(std::move(names)), method_name,
                     std::move(args));
             }
             if (auto it = declared_classes_.find(method_name); it != declared_classes_.end()) {
                 return make_unique<ast::NewInstance>(
                     static_cast<const runtime::Class&>(*it->second), std::move(args));  // NOLINT
             }
-            if (method_name == "str"sv) {
+            if (method_name.Str() == "str"sv) {
                 if (args.size() != 1) {
                     throw ParseError("Function str takes exactly one argument"s);
                 }
                 return make_unique<ast::Stringify>(std::move(args.front()));
             }
-            throw ParseError("Unknown call to "s + method_name + "()"s);
+            throw ParseError("Unknown call to "s + method_name.Str() + "()"s);
         }
         return make_unique<ast::VariableValue>(std::move(names));
     }
@@ -327,73 +479,91 @@ private:
     // AndTest -> NotTest [AND NotTest]
     // NotTest -> [NOT] NotTest
     //          | Comparison
-    unique_ptr<ast::Statement> ParseTest()  // NOLINT
-    {
-        auto result = ParseAndTest();
-        while (lexer_.CurrentToken().Is<TokenType::Or>()) {
-            lexer_.NextToken();
-            result = make_unique<ast::Or>(std::move(result), ParseAndTest());
-        }
-        return result;
-    }
-
-    unique_ptr<ast::Statement> ParseAndTest()  // NOLINT
-    {
-        auto result = ParseNotTest();
-        while (lexer_.CurrentToken().Is<TokenType::And>()) {
-            lexer_.NextToken();
-            result = make_unique<ast::And>(std::move(result), ParseNotTest());
-        }
-        return result;
-    }
-
-    unique_ptr<ast::Statement> ParseNotTest()  // NOLINT
-    {
-        if (lexer_.CurrentToken().Is<TokenType::Not>()) {
-            lexer_.NextToken();
-            return make_unique<ast::Not>(ParseNotTest());  // NOLINT
-        }
-        return ParseComparison();
-    }
-
     // Comparison -> Expr [COMP_OP Expr]
-    unique_ptr<ast::Statement> ParseComparison()  // NOLINT
-    {
-        auto result = ParseExpression();
-
-        const auto tok = lexer_.CurrentToken();
-
-        if (tok == '<') {
-            lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Less, std::move(result),
-                                                ParseExpression());
-        }
-        if (tok == '>') {
-            lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Greater, std::move(result),
-                                                ParseExpression());
-        }
-        if (tok.Is<TokenType::Eq>()) {
-            lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Equal, std::move(result),
-                                                ParseExpression());
-        }
-        if (tok.Is<TokenType::NotEq>()) {
-            lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::NotEqual, std::move(result),
-                                                ParseExpression());
-        }
-        if (tok.Is<TokenType::LessOrEq>()) {
-            lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::LessOrEqual, std::move(result),
-                                                ParseExpression());
-        }
-        if (tok.Is<TokenType::GreaterOrEq>()) {
-            lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
-                                                ParseExpression());
+    // Expr -> Adder ['+'/'-' Adder]*
+    // Adder -> Mult ['*'/'/' Mult]*
+    // Mult -> '(' LogicalExpr ')'
+    //       | '-' Mult
+    //       | Primary
+    //
+    // Разбор по приоритетам операций: правый операнд операции разбирается, пока следующая
+    // операция связывает сильнее неё. Операции, ждущие свой операнд, лежат в стеке pending,
+    // поэтому глубина вложенности скобок и цепочек not не ограничена стеком вызовов.
+    // Стеки общие для всех выражений; вложенный разбор аргументов вызова работает над
+    // элементами внешнего выражения и возвращает стеки к прежнему размеру
+    unique_ptr<ast::Statement> ParseTest() {
+        auto& pending = pending_operations_;
+        auto& operands = operands_;
+        const size_t pending_base = pending.size();
+        Precedence min = PREC_LOWEST;
+        while (true) {
+            // Префиксные операции и открывающие скобки перед операндом
+            const parse::Token& token = lexer_.CurrentToken();
+            if (token.Is<TokenType::Not>() && min <= PREC_NOT) {
+                pending.push_back({PendingOperation::NOT, nullptr, min});
+                min = PREC_NOT;
+                lexer_.NextToken();
+                continue;
+            }
+            if (token == '-') {
+                pending.push_back({PendingOperation::NEGATE, nullptr, min});
+                min = PREC_MULTIPLICATIVE;
+                lexer_.NextToken();
+                continue;
+            }
+            if (token == '(') {
+                pending.push_back({PendingOperation::PARENTHESES, nullptr, min});
+                min = PREC_LOWEST;
+                lexer_.NextToken();
+                continue;
+            }
+            operands.push_back(ParsePrimary());
+
+            // Операции, правый операнд которых закончился, сворачиваются в узлы дерева.
+            // Сравнения не составляются в цепочки: сравнение после сравнения завершает выражение
+            bool after_comparison = false;
+            while (true) {
+                const BinaryOperator* op = FindBinaryOperator(lexer_.CurrentToken());
+                if (op && op->precedence > min
+                    && !(after_comparison && op->precedence == PREC_COMPARISON)) {
+                    pending.push_back({PendingOperation::BINARY, op, min});
+                    min = op->precedence;
+                    lexer_.NextToken();
+                    break;
+                }
+                if (pending.size() == pending_base) {
+                    auto result = std::move(operands.back());
+                    operands.pop_back();
+                    return result;
+                }
+                const PendingOperation operation = pending.back();
+                pending.pop_back();
+                min = operation.outer;
+                switch (operation.kind) {
+                    case PendingOperation::BINARY: {
+                        auto rhs = std::move(operands.back());
+                        operands.pop_back();
+                        operands.back() = operation.binary->make(std::move(operands.back()),
+                                                                 std::move(rhs));
+                        after_comparison = after_comparison
+                                           || operation.binary->precedence == PREC_COMPARISON;
+                        break;
+                    }
+                    case PendingOperation::NOT:
+                        operands.back() = make_unique<ast::Not>(std::move(operands.back()));
+                        break;
+                    case PendingOperation::NEGATE:
+                        operands.back() = make_unique<ast::Mult>(std::move(operands.back()),
+                                                                 make_unique<ast::NumericConst>(-1));
+                        break;
+                    case PendingOperation::PARENTHESES:
+                        lexer_.Expect<TokenType::Char>(')');
+                        lexer_.NextToken();
+                        after_comparison = false;
+                        break;
+                }
+            }
         }
-        return result;
     }
 
     // Statement -> SimpleStatement Newline
@@ -439,10 +609,40 @@ private:
 
     parse::Lexer& lexer_;
     runtime::Closure declared_classes_;
+    shared_ptr<LazyParseStats> lazy_stats_;
+    shared_ptr<DeclaredClasses> declaration_order_;
+    // Стеки разбора выражений в ParseTest
+    vector<PendingOperation> pending_operations_;
+    vector<unique_ptr<ast::Statement>> operands_;
 };
 
+runtime::ObjectHolder LazyMethodBody::Execute(runtime::Closure& closure,
+                                              runtime::Context& context) {
+    if (!body_) {
+        // Токены сохраняются до успешного разбора, чтобы ошибка повторялась при каждом вызове
+        runtime::Closure classes(classes_->begin(), classes_->begin() + visible_classes_);
+        parse::Lexer lexer(tokens_);
+        body_ = Parser(lexer, std::move(classes), nullptr).ParseMethodBody();
+        tokens_ = {};
+        classes_.reset();
+        ++stats_->materialized;
+    }
+    return body_->Execute(closure, context);
+}
+
 }  // namespace
 
 unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer) {
     return Parser{lexer}.ParseProgram();
+}
+
+unique_ptr<runtime::Executable> ParseFromString(const string& program) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    return ParseProgram(lexer);
+}
+
+unique_ptr<runtime::Executable> ParseProgramLazily(parse::Lexer& lexer,
+                                                   shared_ptr<LazyParseStats> stats) {
+    return Parser{lexer, {}, std::move(stats)}.ParseProgram();
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <stdexcept>
+#include <string>
 
 namespace parse {
 class Lexer;
@@ -15,4 +16,30 @@ struct ParseError : std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
-std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer);
\ No newline at end of file
+// Счётчики отложенного разбора тел методов
+struct LazyParseStats {
+    // Тел методов, разбор которых отложен до первого вызова
+    size_t deferred = 0;
+    // Из них разобрано при вызове
+    size_t materialized = 0;
+
+    // Тел, которые так и не понадобились
+    [[nodiscard]] size_t Unmaterialized() const {
+        return deferred - materialized;
+    }
+};
+
+std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer);
+
+// Разбирает программу, заданную строкой
+std::unique_ptr<runtime::Executable> ParseFromString(const std::string& program);
+
+/*
+Разбирает программу, откладывая разбор тел методов: при загрузке только находится
+граница тела по балансу отступов, а токены тела сохраняются и разбираются при первом
+вызове метода. Ошибка разбора тела выбрасывается как ParseError при этом вызове.
+Отложенные тела неизвестны оптимизационным проходам и обходам дерева.
+Тела, объявляющие классы, разбираются сразу, чтобы классы были видны остальной программе
+*/
+std::unique_ptr<runtime::Executable> ParseProgramLazily(parse::Lexer& lexer,
+                                                        std::shared_ptr<LazyParseStats> stats);
@@ -1,5 +1,7 @@
 #include "lexer.h"
 #include "parse.h"
+#include "pass_manager.h"
+#include "program_cache.h"
 #include "statement.h"
 #include "test_runner_p.h"
 
@@ -8,6 +10,9 @@ using namespace std;
 namespace parse {
 
 unique_ptr<ast::Statement> ParseProgramFromString(const string& program) {
+    // Оптимизированная программа должна вести себя так же, как исходная
+    opt::VerifyAllOptimizationLevels(program);
+
     istringstream is(program);
     parse::Lexer lexer(is);
     return ParseProgram(lexer);
@@ -244,6 +249,186 @@ print r, c, t1, t2
                  "Rect(10x20) Circle(52) Triangle(3, 4, 5) Wrong triangle\n"s);
 }
 
+unique_ptr<ast::Statement> ParseLazilyFromString(const string& program,
+                                                shared_ptr<LazyParseStats> stats) {
+    istringstream is(program);
+    parse::Lexer lexer(is);
+    return ParseProgramLazily(lexer, std::move(stats));
+}
+
+void TestLazyMethodBodies() {
+    const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def Unused():
+    if self.x > 0:
+      if self.y > 0:
+        return 1
+    return Missing()
+
+  def __str__():
+    return '(' + str(self.x) + '; ' + str(self.y) + ')'
+
+class Segment:
+  def __init__(a, b):
+    self.a = a
+    self.b = b
+
+  def Start():
+    return Point(self.a.x, self.a.y)
+
+  def Length():
+    return 0
+
+s = Segment(Point(1, 2), Point(3, 4))
+print s.Start(), s.Start()
+)"s;
+
+    auto stats = make_shared<LazyParseStats>();
+    auto tree = ParseLazilyFromString(program, stats);
+    ASSERT_EQUAL(stats->deferred, 6U);
+    ASSERT_EQUAL(stats->materialized, 0U);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "(1; 2) (1; 2)\n"s);
+    // Unused и Length не вызывались
+    ASSERT_EQUAL(stats->materialized, 4U);
+    ASSERT_EQUAL(stats->Unmaterialized(), 2U);
+}
+
+void TestLazyMethodBodyErrors() {
+    // Ошибка в теле метода обнаруживается при первом вызове
+    const string program = R"(
+class Broken:
+  def Later():
+    return Later()
+
+  def Fine():
+    return 1
+
+b = Broken()
+print b.Fine()
+x = b.Later()
+)"s;
+
+    auto stats = make_shared<LazyParseStats>();
+    auto tree = ParseLazilyFromString(program, stats);
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    ASSERT_THROWS(tree->Execute(closure, context), ParseError);
+    ASSERT_EQUAL(context.output.str(), "1\n"s);
+    ASSERT_THROWS(tree->Execute(closure, context), ParseError);
+    ASSERT_EQUAL(stats->materialized, 1U);
+}
+
+void TestLazyParsingKeepsNestedClasses() {
+    // Класс, объявленный в теле метода, виден программе после разбора тела
+    const string program = R"(
+class Outer:
+  def Make():
+    class Inner:
+      def Get():
+        return 42
+    return 0
+
+i = Inner()
+print i.Get()
+)"s;
+
+    auto stats = make_shared<LazyParseStats>();
+    auto tree = ParseLazilyFromString(program, stats);
+    ASSERT_EQUAL(stats->deferred, 0U);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "42\n"s);
+}
+
+void TestLazyBodySeesClassesOfEarlierMethods() {
+    // Отложенному телу виден класс, объявленный в теле предыдущего метода того же класса
+    const string program = R"(
+class A:
+  def m1():
+    class Inner:
+      def get():
+        return 5
+    return 0
+
+  def m2():
+    inner = Inner()
+    return inner.get()
+
+a = A()
+print a.m2()
+)"s;
+
+    auto stats = make_shared<LazyParseStats>();
+    auto tree = ParseLazilyFromString(program, stats);
+    ASSERT_EQUAL(stats->deferred, 1U);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "5\n"s);
+}
+
+// Дерево программы в виде кэша: выражения с одинаковой структурой дают одинаковый кэш
+string SerializeTree(const string& program) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer);
+    ostringstream out;
+    cache::WriteProgram(out, *tree, 0);
+    return out.str();
+}
+
+void TestOperatorPrecedence() {
+    // Скобки не создают узлов, поэтому расставленные явно скобки не меняют дерево
+    const vector<pair<string, string>> equivalent = {
+        {"a + b * c - d / e"s, "(a + (b * c)) - (d / e)"s},
+        {"a - b - c"s, "(a - b) - c"s},
+        {"not a == b and c or d and e"s, "((not (a == b)) and c) or (d and e)"s},
+        {"not not a < b + c"s, "not (not (a < (b + c)))"s},
+        {"-a * -b.c(1, x or y)"s, "(-(a)) * (-(b.c(1, (x or y))))"s},
+        {"a <= b or c >= d"s, "(a <= b) or (c >= d)"s},
+    };
+    for (const auto& [expression, parenthesized] : equivalent) {
+        ASSERT_EQUAL(SerializeTree("x = "s + expression + "\n"s),
+                     SerializeTree("x = "s + parenthesized + "\n"s));
+    }
+    ASSERT(SerializeTree("x = (a + b) * c\n"s) != SerializeTree("x = a + b * c\n"s));
+    // Сравнения не составляются в цепочки, а not не может быть операндом сравнения
+    ASSERT_THROWS(SerializeTree("x = a < b < c\n"s), parse::LexerError);
+    ASSERT_THROWS(SerializeTree("x = (a == b == c)\n"s), parse::LexerError);
+    ASSERT_THROWS(SerializeTree("x = a < not b\n"s), parse::LexerError);
+    ASSERT_THROWS(SerializeTree("x = (a + b\n"s), parse::LexerError);
+}
+
+void TestDeeplyNestedExpressions() {
+    // Глубина скобок и цепочек not не ограничена стеком вызовов парсера
+    constexpr int DEPTH = 200000;
+    const string program = "x = "s + string(DEPTH, '(') + "1 + 2"s + string(DEPTH, ')') + "\n"s
+                           + "y = "s;
+    string nots;
+    for (int i = 0; i < 10001; ++i) {
+        nots += "not "s;
+    }
+    istringstream input(program + nots + "False\nprint x, y\n"s);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "3 True\n"s);
+}
+
 }  // namespace parse
 
 void TestParseProgram(TestRunner& tr) {
@@ -255,4 +440,10 @@ void TestParseProgram(TestRunner& tr) {
     RUN_TEST(tr, parse::TestRecursion2);
     RUN_TEST(tr, parse::TestComplexLogicalExpression);
     RUN_TEST(tr, parse::TestClassicalPolymorphism);
+    RUN_TEST(tr, parse::TestLazyMethodBodies);
+    RUN_TEST(tr, parse::TestLazyMethodBodyErrors);
+    RUN_TEST(tr, parse::TestLazyParsingKeepsNestedClasses);
+    RUN_TEST(tr, parse::TestLazyBodySeesClassesOfEarlierMethods);
+    RUN_TEST(tr, parse::TestOperatorPrecedence);
+    RUN_TEST(tr, parse::TestDeeplyNestedExpressions);
 }
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "pass_manager.h"
+
+#include "ast_utils.h"
+#include "class_hierarchy.h"
+#include "common_subexpressions.h"
+#include "constant_folding.h"
+#include "dead_code.h"
+#include "escape_analysis.h"
+#include "inlining.h"
+#include "memoization.h"
+#include "parse.h"
+#include "profile.h"
+#include "superinstructions.h"
+#include "type_inference.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace opt {
+
+namespace {
+
+// Профиль предыдущего запуска, который проход profile сопоставляет дереву для следующих проходов
+struct ProfilePlan {
+    ast::Profile recorded;
+    unique_ptr<ast::ProgramProfile> attached;
+};
+
+class ProfilePass : public Pass {
+public:
+    explicit ProfilePass(shared_ptr<ProfilePlan> plan)
+        : plan_(std::move(plan)) {
+
+    }
+
+    string_view GetName() const override {
+        return "profile"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        plan_->attached = make_unique<ast::ProgramProfile>(*program, plan_->recorded);
+        reordered_ = ast::ReorderBranches(*program, *plan_->attached);
+        return reordered_;
+    }
+
+    void PrintReport(ostream& out) const override {
+        out << "  sites: "sv << plan_->attached->GetSiteCount() << ", branches reordered: "sv
+            << reordered_ << '\n';
+    }
+
+private:
+    shared_ptr<ProfilePlan> plan_;
+    size_t reordered_ = 0;
+};
+
+class ConstantFoldingPass : public Pass {
+public:
+    string_view GetName() const override {
+        return "constant-folding"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        const ast::FoldingStats stats = ast::FoldConstants(program);
+        return stats.folded + stats.branches_eliminated + stats.simplified;
+    }
+};
+
+class DeadCodePass : public Pass {
+public:
+    string_view GetName() const override {
+        return "dead-code"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        stats_ = ast::EliminateDeadCode(program);
+        return stats_.statements_removed + stats_.classes_removed + stats_.methods_removed;
+    }
+
+    void PrintReport(ostream& out) const override {
+        out << "  statements after return: "sv << stats_.statements_removed
+            << ", classes: "sv << stats_.classes_removed
+            << ", methods: "sv << stats_.methods_removed << '\n';
+    }
+
+private:
+    ast::DeadCodeStats stats_;
+};
+
+class InliningPass : public Pass {
+public:
+    explicit InliningPass(shared_ptr<ProfilePlan> profile)
+        : profile_(std::move(profile)) {
+
+    }
+
+    string_view GetName() const override {
+        return "inlining"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        ast::InliningOptions options;
+        options.profile = profile_->attached.get();
+        stats_ = ast::InlineMethods(program, options);
+        return stats_.inlined;
+    }
+
+    void PrintReport(ostream& out) const override {
+        // Одинаковые места вызова выводятся одной строкой в порядке первого появления
+        vector<pair<string_view, size_t>> sites;
+        for (const string& site : stats_.sites){
+            auto it = find_if(sites.begin(), sites.end(), [&site](const auto& counted) {
+                return counted.first == site;
+            });
+            if (it == sites.end()){
+                sites.emplace_back(site, 1);
+            } else {
+                it->second++;
+            }
+        }
+        for (const auto& [site, count] : sites){
+            out << "  inlined "sv << site;
+            if (count > 1){
+                out << " x"sv << count;
+            }
+            out << '\n';
+        }
+        if (stats_.over_budget){
+            out << "  not inlined over budget: "sv << stats_.over_budget << '\n';
+        }
+        if (stats_.cold){
+            out << "  not inlined cold: "sv << stats_.cold << '\n';
+        }
+    }
+
+private:
+    shared_ptr<ProfilePlan> profile_;
+    ast::InliningStats stats_;
+};
+
+class DevirtualizationPass : public Pass {
+public:
+    explicit DevirtualizationPass(shared_ptr<ProfilePlan> profile)
+        : profile_(std::move(profile)) {
+
+    }
+
+    string_view GetName() const override {
+        return "devirtualization"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        stats_ = ast::DevirtualizeCalls(program, profile_->attached.get());
+        return stats_.bound;
+    }
+
+    void PrintReport(ostream& out) const override {
+        out << "  bound: "sv << stats_.bound;
+        if (stats_.speculative){
+            out << " (by profile: "sv << stats_.speculative << ')';
+        }
+        out << ", polymorphic: "sv << stats_.polymorphic << ", unresolved: "sv
+            << stats_.unresolved << '\n';
+    }
+
+private:
+    shared_ptr<ProfilePlan> profile_;
+    ast::DevirtualizationStats stats_;
+};
+
+class SubexpressionPass : public Pass {
+public:
+    string_view GetName() const override {
+        return "common-subexpressions"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        stats_ = ast::EliminateCommonSubexpressions(program);
+        return stats_.reads_reused;
+    }
+
+    void PrintReport(ostream& out) const override {
+        out << "  chains loaded: "sv << stats_.chains_loaded << ", reads reused: "sv
+            << stats_.reads_reused << '\n';
+    }
+
+private:
+    ast::SubexpressionStats stats_;
+};
+
+class TypeSpecializationPass : public Pass {
+public:
+    explicit TypeSpecializationPass(shared_ptr<ProfilePlan> profile)
+        : profile_(std::move(profile)) {
+
+    }
+
+    string_view GetName() const override {
+        return "type-specialization"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        return ast::SpecializeTypes(program, profile_->attached.get()).Total();
+    }
+
+private:
+    shared_ptr<ProfilePlan> profile_;
+};
+
+class EscapeAnalysisPass : public Pass {
+public:
+    string_view GetName() const override {
+        return "escape-analysis"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        stats_ = ast::UnboxTemporaries(program);
+        return stats_.unboxed_nodes;
+    }
+
+    void PrintReport(ostream& out) const override {
+        out << "  allocations avoided per evaluation: "sv << stats_.allocations_avoided << '\n';
+    }
+
+private:
+    ast::EscapeStats stats_;
+};
+
+class SuperinstructionsPass : public Pass {
+public:
+    string_view GetName() const override {
+        return "superinstructions"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        return ast::FuseSuperinstructions(program).Total();
+    }
+};
+
+// Результаты анализа чистоты, которые использует запоминание в конце конвейера
+struct MemoizationPlan {
+    ast::PureMethods pure;
+    ast::MemoizedMethods memoized;
+};
+
+class PurityAnalysisPass : public Pass {
+public:
+    explicit PurityAnalysisPass(shared_ptr<MemoizationPlan> plan)
+        : plan_(std::move(plan)) {
+
+    }
+
+    string_view GetName() const override {
+        return "purity-analysis"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        plan_->pure = ast::FindPureMethods(*program);
+        return 0;
+    }
+
+    void PrintReport(ostream& out) const override {
+        out << "  pure methods: "sv << plan_->pure.size() << '\n';
+    }
+
+private:
+    shared_ptr<MemoizationPlan> plan_;
+};
+
+class MemoizationPass : public Pass {
+public:
+    MemoizationPass(shared_ptr<MemoizationPlan> plan, size_t capacity)
+        : plan_(std::move(plan)), capacity_(capacity) {
+
+    }
+
+    string_view GetName() const override {
+        return "memoization"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        plan_->memoized = ast::MemoizeMethods(*program, plan_->pure, capacity_);
+        return plan_->memoized.size();
+    }
+
+    // Счётчики кэша заполняются во время исполнения программы
+    void PrintReport(ostream& out) const override {
+        for (const auto& [name, body] : plan_->memoized){
+            const ast::MemoStats& stats = body->GetStats();
+            out << "  memoized "sv << name << ": hits "sv << stats.hits << ", misses "sv
+                << stats.misses << ", evictions "sv << stats.evictions << ", uncached "sv
+                << stats.uncached << ", hit rate "sv << static_cast<int>(stats.HitRate() * 100)
+                << "%\n"sv;
+        }
+    }
+
+private:
+    shared_ptr<MemoizationPlan> plan_;
+    size_t capacity_;
+};
+
+ExecutionResult Execute(ast::Statement& program) {
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    ExecutionResult result;
+    try {
+        program.Execute(closure, context);
+    } catch (const ast::ObjectThrow&) {
+        result.error = "return outside of method"s;
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+    result.output = context.output.str();
+    return result;
+}
+
+// Исполняет program до и после преобразования optimize; name называет преобразование в сообщении
+ExecutionResult VerifyTransformation(const string& program, const string& name,
+                                     const Optimization& optimize) {
+    auto reference = ParseFromString(program);
+    auto optimized = ParseFromString(program);
+    optimize(optimized);
+
+    const ExecutionResult expected = Execute(*reference);
+    ExecutionResult actual = Execute(*optimized);
+    if (expected.output != actual.output || expected.error != actual.error){
+        ostringstream message;
+        message << name << " changed program behavior: expected output \""sv << expected.output
+                << "\" error \""sv << expected.error << "\", got output \""sv << actual.output
+                << "\" error \""sv << actual.error << '"';
+        throw std::logic_error(message.str());
+    }
+    return actual;
+}
+
+}  // namespace
+
+void PassManager::AddPass(unique_ptr<Pass> pass) {
+    passes_.push_back(std::move(pass));
+}
+
+void PassManager::Run(unique_ptr<ast::Statement>& program) {
+    using Clock = chrono::steady_clock;
+
+    statistics_.clear();
+    size_t nodes = ast::CountNodes(*program);
+    for (auto& pass : passes_){
+        PassStatistics stats;
+        stats.name = pass->GetName();
+        stats.nodes_before = nodes;
+
+        const auto start = Clock::now();
+        stats.changes = pass->Run(program);
+        stats.milliseconds = chrono::duration<double, milli>(Clock::now() - start).count();
+
+        nodes = ast::CountNodes(*program);
+        stats.nodes_after = nodes;
+        statistics_.push_back(std::move(stats));
+    }
+}
+
+size_t PassManager::GetPassCount() const {
+    return passes_.size();
+}
+
+const vector<PassStatistics>& PassManager::GetStatistics() const {
+    return statistics_;
+}
+
+void PassManager::PrintStatistics(ostream& out) const {
+    for (size_t i = 0; i < statistics_.size(); ++i){
+        const PassStatistics& stats = statistics_[i];
+        // Форматирование задаётся в отдельном потоке, чтобы не менять флаги out
+        ostringstream line;
+        line << left << setw(20) << stats.name << right << fixed << setprecision(3)
+            << setw(10) << stats.milliseconds << " ms  "sv
+            << "nodes "sv << stats.nodes_before << " -> "sv << stats.nodes_after
+            << ", changes "sv << stats.changes << '\n';
+        out << line.str();
+        passes_[i]->PrintReport(out);
+    }
+}
+
+OptimizationLevel ParseOptimizationLevel(string_view name) {
+    if (name == "O0"sv){
+        return OptimizationLevel::O0;
+    }
+    if (name == "O1"sv){
+        return OptimizationLevel::O1;
+    }
+    if (name == "O2"sv){
+        return OptimizationLevel::O2;
+    }
+    throw std::invalid_argument("Unknown optimization level "s + string(name));
+}
+
+PassManager CreatePassManager(OptimizationLevel level, size_t memoize_capacity,
+                              const ast::Profile* profile) {
+    PassManager manager;
+    auto profile_plan = make_shared<ProfilePlan>();
+    if (profile){
+        // Места профиля нумеруются по дереву сразу после разбора
+        profile_plan->recorded = *profile;
+        manager.AddPass(make_unique<ProfilePass>(profile_plan));
+    }
+    auto plan = make_shared<MemoizationPlan>();
+    if (memoize_capacity){
+        // Чистота определяется по исходному дереву, которое понимает анализ
+        manager.AddPass(make_unique<PurityAnalysisPass>(plan));
+    }
+    if (level >= OptimizationLevel::O1){
+        manager.AddPass(make_unique<ConstantFoldingPass>());
+        // Свёртка убирает ветки с постоянным условием, поэтому выполняется раньше
+        manager.AddPass(make_unique<DeadCodePass>());
+    }
+    if (level >= OptimizationLevel::O2){
+        manager.AddPass(make_unique<InliningPass>(profile_plan));
+        manager.AddPass(make_unique<DevirtualizationPass>(profile_plan));
+        manager.AddPass(make_unique<SubexpressionPass>());
+        manager.AddPass(make_unique<TypeSpecializationPass>(profile_plan));
+        manager.AddPass(make_unique<EscapeAnalysisPass>());
+        // Прочие проходы обходят слитые инструкции, но не распознают их шаблоны,
+        // поэтому этот проход - последний из уровня
+        manager.AddPass(make_unique<SuperinstructionsPass>());
+    }
+    if (memoize_capacity){
+        // Запомненные методы скрыты от прочих проходов, поэтому они выполняются раньше
+        manager.AddPass(make_unique<MemoizationPass>(plan, memoize_capacity));
+    }
+    return manager;
+}
+
+ExecutionResult VerifyOptimization(const string& program, const Optimization& optimize) {
+    return VerifyTransformation(program, "Optimization"s, optimize);
+}
+
+void VerifyOptimization(const string& program, OptimizationLevel level) {
+    const string name = "Optimization level O"s + to_string(static_cast<int>(level));
+    VerifyTransformation(program, name, [level](unique_ptr<ast::Statement>& tree) {
+        CreatePassManager(level).Run(tree);
+    });
+}
+
+void VerifyAllOptimizationLevels(const string& program) {
+    for (OptimizationLevel level : {OptimizationLevel::O1, OptimizationLevel::O2}){
+        VerifyOptimization(program, level);
+    }
+}
+
+}  // namespace opt
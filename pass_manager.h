@@ -0,0 +1,125 @@
+#pragma once
+
+#include "profile.h"
+#include "statement.h"
+
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+Менеджер оптимизационных проходов над деревом разбора. Проходы выполняются
+между ParseProgram и Execute в порядке добавления; для каждого прохода
+замеряется время работы и количество узлов дерева до и после него
+*/
+namespace opt {
+
+// Оптимизационный проход над деревом программы
+class Pass {
+public:
+    virtual ~Pass() = default;
+
+    [[nodiscard]] virtual std::string_view GetName() const = 0;
+
+    // Преобразует дерево program. Возвращает количество выполненных изменений
+    virtual size_t Run(std::unique_ptr<ast::Statement>& program) = 0;
+
+    // Выводит подробности последнего выполнения прохода
+    virtual void PrintReport([[maybe_unused]] std::ostream& out) const {
+    }
+};
+
+// Статистика одного выполнения прохода
+struct PassStatistics {
+    std::string name;
+    double milliseconds = 0;
+    size_t nodes_before = 0;
+    size_t nodes_after = 0;
+    size_t changes = 0;
+};
+
+class PassManager {
+public:
+    void AddPass(std::unique_ptr<Pass> pass);
+
+    // Выполняет все проходы над program
+    void Run(std::unique_ptr<ast::Statement>& program);
+
+    [[nodiscard]] size_t GetPassCount() const;
+
+    // Статистика проходов, выполненных последним вызовом Run
+    [[nodiscard]] const std::vector<PassStatistics>& GetStatistics() const;
+
+    void PrintStatistics(std::ostream& out) const;
+
+private:
+    std::vector<std::unique_ptr<Pass>> passes_;
+    std::vector<PassStatistics> statistics_;
+};
+
+/*
+Уровни оптимизации:
+O0 - дерево исполняется без изменений;
+O1 - свёртка констант и удаление мёртвого кода;
+O2 - O1, встраивание методов, связывание вызовов по иерархии классов, устранение
+     повторных чтений полей, специализация по выведенным типам, вычисление промежуточных
+     значений без упаковки и слитые инструкции
+*/
+enum class OptimizationLevel {
+    O0,
+    O1,
+    O2,
+};
+
+// Возвращает уровень по имени "O0", "O1" или "O2". Для прочих имён выбрасывает invalid_argument
+OptimizationLevel ParseOptimizationLevel(std::string_view name);
+
+/*
+Создаёт менеджер с набором проходов уровня level. Если memoize_capacity больше нуля,
+результаты чистых методов запоминаются в кэше на memoize_capacity записей для каждого метода.
+Если задан профиль предыдущего запуска программы, первым выполняется проход, переставляющий
+ветки if по профилю, а встраивание, связывание вызовов и специализация учитывают профиль
+*/
+PassManager CreatePassManager(OptimizationLevel level, size_t memoize_capacity = 0,
+                              const ast::Profile* profile = nullptr);
+
+// Вывод программы и сообщение об ошибке, если исполнение завершилось исключением
+struct ExecutionResult {
+    std::string output;
+    std::string error;
+};
+
+// Преобразование дерева программы, проверяемое VerifyOptimization
+using Optimization = std::function<void(std::unique_ptr<ast::Statement>&)>;
+
+/*
+Разбирает program дважды, преобразует одно из деревьев функцией optimize и исполняет оба.
+Выбрасывает logic_error, если вывод программ либо сообщения об ошибках различаются.
+Возвращает результат исполнения преобразованной программы
+*/
+ExecutionResult VerifyOptimization(const std::string& program, const Optimization& optimize);
+
+// Проверяет program так же, как предыдущая функция, с проходами уровня level
+void VerifyOptimization(const std::string& program, OptimizationLevel level);
+
+/*
+Проверяет program функцией VerifyOptimization, преобразуя дерево проходом pass.
+Статистика, которую возвращает pass, записывается в stats. Возвращает вывод
+преобразованной программы; сообщение об ошибке дописывается к нему после "error: "
+*/
+template <typename Pass, typename Stats>
+std::string RunVerified(const std::string& program, Pass pass, Stats& stats) {
+    const ExecutionResult result
+        = VerifyOptimization(program, [&pass, &stats](std::unique_ptr<ast::Statement>& tree) {
+              stats = pass(tree);
+          });
+    return result.error.empty() ? result.output : result.output + "error: " + result.error;
+}
+
+// Проверяет программу на всех уровнях оптимизации
+void VerifyAllOptimizationLevels(const std::string& program);
+
+}  // namespace opt
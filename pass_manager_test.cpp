@@ -0,0 +1,154 @@
+#include "ast_utils.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace opt {
+
+namespace {
+
+// Собирает имена переменных, читаемых программой
+class VariableCollector : public ast::Visitor {
+public:
+    vector<string> names;
+    size_t other_nodes = 0;
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(ast::VariableValue& node) override {
+        names.push_back(node.dotted_ids_.front().Str());
+        return true;
+    }
+
+    bool Visit(ast::Statement&) override {
+        other_nodes++;
+        return true;
+    }
+};
+
+// Заменяет все числовые константы нулём
+class ZeroRewriter : public ast::Rewriter {
+public:
+    size_t replaced = 0;
+
+protected:
+    void Leave(unique_ptr<ast::Statement>& slot) override {
+        if (dynamic_cast<ast::NumericConst*>(slot.get())){
+            slot = make_unique<ast::NumericConst>(0);
+            replaced++;
+        }
+    }
+};
+
+class ZeroPass : public Pass {
+public:
+    string_view GetName() const override {
+        return "zero"sv;
+    }
+
+    size_t Run(unique_ptr<ast::Statement>& program) override {
+        ZeroRewriter rewriter;
+        rewriter.Rewrite(program);
+        return rewriter.replaced;
+    }
+};
+
+void TestVisitorDispatch() {
+    auto tree = ParseFromString(R"(
+class A:
+  def f(x):
+    return x + y
+
+a = A()
+print a.f(z)
+)"s);
+    VariableCollector collector;
+    collector.Walk(*tree);
+    ASSERT_EQUAL(collector.names, (vector<string>{"x"s, "y"s, "a"s, "z"s}));
+    ASSERT_EQUAL(collector.names.size() + collector.other_nodes, ast::CountNodes(*tree));
+}
+
+void TestPassManagerStatistics() {
+    auto tree = ParseFromString("x = 1 + 2\nprint x * 3\n"s);
+    const size_t nodes = ast::CountNodes(*tree);
+
+    PassManager manager;
+    manager.AddPass(make_unique<ZeroPass>());
+    manager.Run(tree);
+
+    ASSERT_EQUAL(manager.GetStatistics().size(), 1U);
+    const PassStatistics& stats = manager.GetStatistics().front();
+    ASSERT_EQUAL(stats.name, "zero"s);
+    ASSERT_EQUAL(stats.changes, 3U);
+    ASSERT_EQUAL(stats.nodes_before, nodes);
+    ASSERT_EQUAL(stats.nodes_after, nodes);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "0\n"s);
+
+    ostringstream out;
+    manager.PrintStatistics(out);
+    ASSERT(out.str().find("zero"s) != string::npos);
+}
+
+void TestOptimizationLevels() {
+    ASSERT_EQUAL(CreatePassManager(OptimizationLevel::O0).GetPassCount(), 0U);
+    ASSERT(CreatePassManager(OptimizationLevel::O1).GetPassCount() > 0U);
+    ASSERT(CreatePassManager(OptimizationLevel::O2).GetPassCount()
+           > CreatePassManager(OptimizationLevel::O1).GetPassCount());
+    ASSERT(ParseOptimizationLevel("O2"sv) == OptimizationLevel::O2);
+    ASSERT_THROWS(ParseOptimizationLevel("O9"sv), std::invalid_argument);
+
+    const string program = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    self.value = self.value + n
+    if self.value > 2 * 3:
+      return 'big'
+    return 'small'
+
+c = Counter()
+print c.add(1 + 2), c.add(4), c.value
+)"s;
+    auto tree = ParseFromString(program);
+    PassManager manager = CreatePassManager(OptimizationLevel::O2);
+    manager.Run(tree);
+    // Свёртка констант уменьшает дерево, а счётчик узлов охватывает всё дерево
+    ASSERT(manager.GetStatistics().front().nodes_after < manager.GetStatistics().front().nodes_before);
+    ASSERT_EQUAL(manager.GetStatistics().back().nodes_after, ast::CountNodes(*tree));
+    VerifyAllOptimizationLevels(program);
+}
+
+void TestVerificationKeepsErrors() {
+    // Ошибка должна возникать и в оптимизированной программе
+    VerifyAllOptimizationLevels("print 1\nprint 1 + None\n"s);
+    VerifyAllOptimizationLevels("print undefined_variable\n"s);
+
+    const ExecutionResult result = VerifyOptimization("print 1\nprint 1 + None\n"s, [](auto&) {});
+    ASSERT_EQUAL(result.output, "1\n"s);
+    ASSERT(!result.error.empty());
+    // Преобразование, меняющее вывод программы, обнаруживается
+    ASSERT_THROWS(VerifyOptimization("print 1\n"s, [](unique_ptr<ast::Statement>& tree) {
+                      tree = ParseFromString("print 2\n"s);
+                  }),
+                  std::logic_error);
+}
+
+}  // namespace
+
+void RunPassManagerTests(TestRunner& tr) {
+    RUN_TEST(tr, opt::TestVisitorDispatch);
+    RUN_TEST(tr, opt::TestPassManagerStatistics);
+    RUN_TEST(tr, opt::TestOptimizationLevels);
+    RUN_TEST(tr, opt::TestVerificationKeepsErrors);
+}
+
+}  // namespace opt
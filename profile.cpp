@@ -0,0 +1,533 @@
+#include "profile.h"
+
+#include <iomanip>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <unordered_set>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+constexpr string_view PROFILE_HEADER = "mython-profile"sv;
+constexpr int PROFILE_VERSION = 1;
+
+struct Site {
+    SiteKind kind;
+    Statement* node;
+    // Для SiteKind::Method - метод, телом которого является node
+    runtime::Method* method;
+};
+
+optional<SiteKind> GetSiteKind(const Statement& node) {
+    if (dynamic_cast<const MethodCall*>(&node)){
+        return SiteKind::Call;
+    }
+    if (dynamic_cast<const IfElse*>(&node)){
+        return SiteKind::Branch;
+    }
+    if (dynamic_cast<const Add*>(&node)){
+        return SiteKind::Add;
+    }
+    if (dynamic_cast<const Comparison*>(&node)){
+        return SiteKind::Comparison;
+    }
+    return nullopt;
+}
+
+// Поле узла-места, в котором хранится его место профиля
+const SiteProfile*& GetSiteField(const Site& site) {
+    if (site.kind == SiteKind::Method){
+        return static_cast<MethodBody&>(*site.node).profile_site_;
+    }
+    if (site.kind == SiteKind::Call){
+        return static_cast<MethodCall&>(*site.node).profile_site_;
+    }
+    if (site.kind == SiteKind::Branch){
+        return static_cast<IfElse&>(*site.node).profile_site_;
+    }
+    return static_cast<BinaryOperation&>(*site.node).profile_site_;
+}
+
+// Место профиля, записанное в узле, либо nullptr
+const SiteProfile* GetNodeSite(const Statement& node) {
+    if (auto* call = dynamic_cast<const MethodCall*>(&node)){
+        return call->profile_site_;
+    }
+    if (auto* if_else = dynamic_cast<const IfElse*>(&node)){
+        return if_else->profile_site_;
+    }
+    if (auto* binary = dynamic_cast<const BinaryOperation*>(&node)){
+        return binary->profile_site_;
+    }
+    if (auto* body = dynamic_cast<const MethodBody*>(&node)){
+        return body->profile_site_;
+    }
+    return nullptr;
+}
+
+// Места профиля в прямом порядке обхода. Место тела метода предшествует местам внутри него
+void CollectSites(Statement& node, vector<Site>& sites) {
+    if (auto* definition = dynamic_cast<ClassDefinition*>(&node)){
+        for (runtime::Method& method : definition->cls_.TryAs<runtime::Class>()->Methods()){
+            if (auto* body = dynamic_cast<MethodBody*>(method.body.get())){
+                sites.push_back({SiteKind::Method, body, &method});
+                CollectSites(*body->body_, sites);
+            }
+        }
+        return;
+    }
+    if (const optional<SiteKind> kind = GetSiteKind(node)){
+        sites.push_back({*kind, &node, nullptr});
+    }
+    ForEachChild(node, [&sites](unique_ptr<Statement>& child) {
+        CollectSites(*child, sites);
+    });
+}
+
+vector<Site> CollectSites(Statement& program) {
+    vector<Site> sites;
+    CollectSites(program, sites);
+    return sites;
+}
+
+// Счётчик, встроенный в дерево: считает вычисления выражения expr_ и наблюдаемые типы его значения
+class SiteProbe : public Statement, public CompositeNode {
+public:
+    enum class Role {
+        // Условие if: считаются проверки
+        Condition,
+        // Ветка if: считаются её исполнения
+        Taken,
+        Receiver,
+        Lhs,
+        Rhs,
+    };
+
+    SiteProbe(unique_ptr<Statement> expr, shared_ptr<Profile> profile, size_t site, Role role)
+        : expr_(std::move(expr)), profile_(std::move(profile)), site_(site), role_(role) {
+
+    }
+
+    ObjectHolder Execute(Closure& closure, Context& context) override {
+        SiteProfile& site = profile_->sites[site_];
+        switch (role_){
+            case Role::Condition:
+                site.count++;
+                return expr_->Execute(closure, context);
+            case Role::Taken:
+                // Считается до исполнения: ветка может завершиться инструкцией return
+                site.taken++;
+                return expr_->Execute(closure, context);
+            default:
+                break;
+        }
+        ObjectHolder value = expr_->Execute(closure, context);
+        TypeCounts& types = role_ == Role::Receiver ? site.receivers
+                            : role_ == Role::Lhs    ? site.lhs
+                                                    : site.rhs;
+        types[GetTypeName(value)]++;
+        if (role_ != Role::Rhs){
+            site.count++;
+        }
+        return value;
+    }
+
+    void ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) override {
+        fn(expr_);
+    }
+
+private:
+    unique_ptr<Statement> expr_;
+    shared_ptr<Profile> profile_;
+    size_t site_;
+    Role role_;
+};
+
+// Тело метода, считающее вызовы
+class MethodProbe : public runtime::Executable {
+public:
+    MethodProbe(shared_ptr<runtime::Executable> body, shared_ptr<Profile> profile, size_t site)
+        : body_(std::move(body)), profile_(std::move(profile)), site_(site) {
+
+    }
+
+    ObjectHolder Execute(Closure& closure, Context& context) override {
+        profile_->sites[site_].count++;
+        return body_->Execute(closure, context);
+    }
+
+private:
+    shared_ptr<runtime::Executable> body_;
+    shared_ptr<Profile> profile_;
+    size_t site_;
+};
+
+void WriteTypes(ostream& out, const TypeCounts& types) {
+    out << ' ' << types.size();
+    for (const auto& [name, count] : types){
+        out << ' ' << name << ' ' << count;
+    }
+}
+
+void ReadTypes(istream& in, TypeCounts& types) {
+    size_t size = 0;
+    in >> size;
+    for (size_t i = 0; in && i < size; ++i){
+        string name;
+        size_t count = 0;
+        in >> name >> count;
+        types[name] = count;
+    }
+}
+
+// Собирает операнды-переменные операций + и сравнений в теле метода и присваиваемые переменные
+class OperandCollector : public Visitor {
+public:
+    unordered_set<symbols::Symbol> assigned;
+    // Имя переменной и типы, наблюдавшиеся у операнда
+    vector<pair<symbols::Symbol, const TypeCounts*>> operands;
+
+    explicit OperandCollector(const ProgramProfile& profile)
+        : profile_(profile) {
+
+    }
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(Assignment& node) override {
+        assigned.insert(node.var_);
+        return true;
+    }
+
+    bool Visit(Add& node) override {
+        Record(node);
+        return true;
+    }
+
+    bool Visit(Comparison& node) override {
+        Record(node);
+        return true;
+    }
+
+private:
+    const ProgramProfile& profile_;
+
+    void Record(BinaryOperation& node) {
+        const SiteProfile* site = profile_.Find(node);
+        if (!site || !site->count){
+            return;
+        }
+        RecordOperand(*node.lhs_, site->lhs);
+        RecordOperand(*node.rhs_, site->rhs);
+    }
+
+    void RecordOperand(const Statement& operand, const TypeCounts& types) {
+        if (auto* var = dynamic_cast<const VariableValue*>(&operand); var && var->dotted_ids_.size() == 1){
+            operands.emplace_back(var->dotted_ids_.front(), &types);
+        }
+    }
+};
+
+// Сравнение, истинное ровно тогда, когда cmp ложно, и вызывающее те же методы операндов
+CompareFunction GetInverse(CompareFunction cmp) {
+    if (cmp == &runtime::Equal){
+        return &runtime::NotEqual;
+    }
+    if (cmp == &runtime::NotEqual){
+        return &runtime::Equal;
+    }
+    if (cmp == &runtime::Less){
+        return &runtime::GreaterOrEqual;
+    }
+    if (cmp == &runtime::GreaterOrEqual){
+        return &runtime::Less;
+    }
+    if (cmp == &runtime::Greater){
+        return &runtime::LessOrEqual;
+    }
+    if (cmp == &runtime::LessOrEqual){
+        return &runtime::Greater;
+    }
+    return nullptr;
+}
+
+class BranchReorderer : public Visitor {
+public:
+    size_t reordered = 0;
+
+    explicit BranchReorderer(const ProgramProfile& profile)
+        : profile_(profile) {
+
+    }
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(IfElse& node) override {
+        const SiteProfile* site = profile_.Find(node);
+        if (site && node.else_body_ && site->taken * 2 < site->count && Invert(node.condition_)){
+            swap(node.if_body_, node.else_body_);
+            reordered++;
+        }
+        return true;
+    }
+
+private:
+    const ProgramProfile& profile_;
+
+    static bool Invert(unique_ptr<Statement>& condition) {
+        // not применим только к Bool, поэтому снимается лишь со сравнения
+        if (auto* negation = dynamic_cast<Not*>(condition.get());
+            negation && dynamic_cast<Comparison*>(negation->statement_.get())){
+            condition = std::move(negation->statement_);
+            return true;
+        }
+        if (auto* cmp = dynamic_cast<Comparison*>(condition.get())){
+            if (CompareFunction inverse = GetInverse(GetCompareFunction(cmp->cmp_))){
+                cmp->cmp_ = inverse;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}  // namespace
+
+uint64_t HashSource(string_view source) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : source){
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+string GetTypeName(const ObjectHolder& value) {
+    if (!value){
+        return "%none"s;
+    }
+    if (auto* instance = value.TryAs<runtime::ClassInstance>()){
+        return instance->GetClass().GetName().Str();
+    }
+    if (value.TryAs<runtime::Number>()){
+        return "%int"s;
+    }
+    if (value.TryAs<runtime::String>()){
+        return "%str"s;
+    }
+    if (value.TryAs<runtime::Bool>()){
+        return "%bool"s;
+    }
+    return "%object"s;
+}
+
+const string* GetSingleType(const TypeCounts& types) {
+    return types.size() == 1 ? &types.begin()->first : nullptr;
+}
+
+void WriteProfile(ostream& out, const Profile& profile) {
+    out << PROFILE_HEADER << ' ' << PROFILE_VERSION << ' ' << hex << profile.source_hash << dec
+        << ' ' << profile.sites.size() << '\n';
+    for (size_t i = 0; i < profile.sites.size(); ++i){
+        const SiteProfile& site = profile.sites[i];
+        if (!site.count){
+            continue;
+        }
+        out << static_cast<char>(site.kind) << ' ' << i << ' ' << site.count;
+        switch (site.kind){
+            case SiteKind::Branch:
+                out << ' ' << site.taken;
+                break;
+            case SiteKind::Call:
+                WriteTypes(out, site.receivers);
+                break;
+            case SiteKind::Add:
+            case SiteKind::Comparison:
+                WriteTypes(out, site.lhs);
+                WriteTypes(out, site.rhs);
+                break;
+            case SiteKind::Method:
+                break;
+        }
+        out << '\n';
+    }
+}
+
+Profile ReadProfile(istream& in) {
+    string header;
+    int version = 0;
+    size_t size = 0;
+    Profile profile;
+    in >> header >> version >> hex >> profile.source_hash >> dec >> size;
+    if (!in || header != PROFILE_HEADER){
+        throw std::runtime_error("Invalid profile header"s);
+    }
+    if (version != PROFILE_VERSION){
+        throw std::runtime_error("Unsupported profile version "s + to_string(version));
+    }
+    profile.sites.resize(size);
+
+    char kind = 0;
+    while (in >> kind){
+        size_t index = 0;
+        in >> index;
+        if (!in || index >= size){
+            throw std::runtime_error("Invalid profile site"s);
+        }
+        SiteProfile& site = profile.sites[index];
+        site.kind = static_cast<SiteKind>(kind);
+        in >> site.count;
+        switch (site.kind){
+            case SiteKind::Branch:
+                in >> site.taken;
+                break;
+            case SiteKind::Call:
+                ReadTypes(in, site.receivers);
+                break;
+            case SiteKind::Add:
+            case SiteKind::Comparison:
+                ReadTypes(in, site.lhs);
+                ReadTypes(in, site.rhs);
+                break;
+            case SiteKind::Method:
+                break;
+            default:
+                throw std::runtime_error("Unknown profile site kind "s + kind);
+        }
+        if (!in){
+            throw std::runtime_error("Invalid profile site "s + to_string(index));
+        }
+    }
+    return profile;
+}
+
+shared_ptr<Profile> InstrumentProgram(unique_ptr<Statement>& program, uint64_t source_hash) {
+    using Role = SiteProbe::Role;
+
+    const vector<Site> sites = CollectSites(*program);
+    auto profile = make_shared<Profile>();
+    profile->source_hash = source_hash;
+    profile->sites.resize(sites.size());
+
+    auto wrap = [&profile](unique_ptr<Statement>& slot, size_t site, Role role) {
+        slot = make_unique<SiteProbe>(std::move(slot), profile, site, role);
+    };
+    for (size_t i = 0; i < sites.size(); ++i){
+        const Site& site = sites[i];
+        profile->sites[i].kind = site.kind;
+        switch (site.kind){
+            case SiteKind::Method:
+                site.method->body = make_shared<MethodProbe>(site.method->body, profile, i);
+                break;
+            case SiteKind::Call:
+                wrap(static_cast<MethodCall&>(*site.node).object_, i, Role::Receiver);
+                break;
+            case SiteKind::Branch: {
+                auto& if_else = static_cast<IfElse&>(*site.node);
+                wrap(if_else.condition_, i, Role::Condition);
+                wrap(if_else.if_body_, i, Role::Taken);
+                break;
+            }
+            case SiteKind::Add:
+            case SiteKind::Comparison: {
+                auto& binary = static_cast<BinaryOperation&>(*site.node);
+                wrap(binary.lhs_, i, Role::Lhs);
+                wrap(binary.rhs_, i, Role::Rhs);
+                break;
+            }
+        }
+    }
+    return profile;
+}
+
+ProgramProfile::ProgramProfile(Statement& program, Profile profile)
+    : profile_(std::move(profile)) {
+
+    const vector<Site> sites = CollectSites(program);
+    if (sites.size() != profile_.sites.size()){
+        throw std::runtime_error("Profile does not match the program"s);
+    }
+    for (size_t i = 0; i < sites.size(); ++i){
+        SiteProfile& site = profile_.sites[i];
+        if (site.count && site.kind != sites[i].kind){
+            throw std::runtime_error("Profile does not match the program"s);
+        }
+        site.kind = sites[i].kind;
+        GetSiteField(sites[i]) = &site;
+    }
+
+    for (size_t i = 0; i < sites.size(); ++i){
+        const Site& site = sites[i];
+        if (site.kind != SiteKind::Method){
+            continue;
+        }
+        OperandCollector collector(*this);
+        collector.Walk(*static_cast<MethodBody&>(*site.node).body_);
+
+        for (const symbols::Symbol param : site.method->formal_params){
+            if (param == runtime::names::SELF || collector.assigned.count(param)){
+                continue;
+            }
+            const string* type = nullptr;
+            bool consistent = true;
+            for (const auto& [name, types] : collector.operands){
+                if (name != param){
+                    continue;
+                }
+                const string* single = GetSingleType(*types);
+                if (!single || (type && *type != *single)){
+                    consistent = false;
+                    break;
+                }
+                type = single;
+            }
+            if (consistent && type){
+                parameters_[&profile_.sites[i]][param] = *type;
+            }
+        }
+    }
+}
+
+const SiteProfile* ProgramProfile::Find(const Statement& node) const {
+    const SiteProfile* site = GetNodeSite(node);
+    // Узел мог быть сопоставлен другому профилю той же программы
+    const less<const SiteProfile*> before;
+    if (!site || before(site, profile_.sites.data())
+        || !before(site, profile_.sites.data() + profile_.sites.size())){
+        return nullptr;
+    }
+    return site;
+}
+
+const string* ProgramProfile::GetParameterType(const Statement& body, symbols::Symbol param) const {
+    const SiteProfile* site = Find(body);
+    auto it = parameters_.find(site);
+    if (it == parameters_.end()){
+        return nullptr;
+    }
+    auto type = it->second.find(param);
+    return type != it->second.end() ? &type->second : nullptr;
+}
+
+size_t ProgramProfile::GetSiteCount() const {
+    return profile_.sites.size();
+}
+
+size_t ReorderBranches(Statement& program, const ProgramProfile& profile) {
+    BranchReorderer reorderer(profile);
+    reorderer.Walk(program);
+    return reorderer.reordered;
+}
+
+}  // namespace ast
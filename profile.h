@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ast_utils.h"
+#include "statement.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+Профиль исполнения программы. Профиль записывается во время запуска без оптимизаций,
+сохраняется в файл и при следующем запуске той же программы сопоставляется дереву
+до оптимизационных проходов, чтобы встраивание, связывание вызовов, специализация
+и порядок веток учитывали поведение программы с первого вызова.
+Места профиля нумеруются в прямом порядке обхода дерева сразу после разбора, поэтому
+профиль подходит только к программе с тем же текстом (проверяется по хешу исходника)
+*/
+namespace ast {
+
+enum class SiteKind : char {
+    Method = 'm',
+    Call = 'c',
+    Branch = 'b',
+    Add = 'a',
+    Comparison = 'k',
+};
+
+// Количество наблюдений каждого типа значения. Экземпляры классов записываются
+// именем класса, значения встроенных типов - как "%int", "%str", "%bool", "%none"
+using TypeCounts = std::map<std::string, size_t>;
+
+struct SiteProfile {
+    SiteKind kind = SiteKind::Method;
+    // Method - количество вызовов метода, Call, Add и Comparison - количество вычислений
+    // выражения, Branch - количество проверок условия
+    size_t count = 0;
+    // Branch: сколько раз исполнялась ветка if
+    size_t taken = 0;
+    // Call: типы получателя
+    TypeCounts receivers;
+    // Add, Comparison: типы операндов
+    TypeCounts lhs;
+    TypeCounts rhs;
+};
+
+struct Profile {
+    uint64_t source_hash = 0;
+    std::vector<SiteProfile> sites;
+};
+
+// Хеш текста программы, по которому профиль сопоставляется программе
+uint64_t HashSource(std::string_view source);
+
+// Имя типа значения в записи профиля
+std::string GetTypeName(const runtime::ObjectHolder& value);
+
+// Если наблюдался единственный тип, возвращает его имя, иначе nullptr
+const std::string* GetSingleType(const TypeCounts& types);
+
+/*
+Записывает профиль в компактном текстовом виде: заголовок и по строке на каждое
+место, которое исполнялось хотя бы раз
+*/
+void WriteProfile(std::ostream& out, const Profile& profile);
+
+// Читает профиль, записанный WriteProfile. Выбрасывает runtime_error, если запись повреждена
+Profile ReadProfile(std::istream& in);
+
+/*
+Встраивает в program счётчики, которые заполняют возвращаемый профиль во время исполнения.
+program должна быть деревом сразу после разбора; оптимизационные проходы
+к инструментированному дереву не применяются
+*/
+std::shared_ptr<Profile> InstrumentProgram(std::unique_ptr<Statement>& program,
+                                           uint64_t source_hash);
+
+/*
+Профиль, сопоставленный узлам дерева. Место профиля хранится в самом узле (profile_site_),
+поэтому узлы, созданные оптимизационными проходами, профиля не имеют, даже если занимают
+память удалённого узла
+*/
+class ProgramProfile {
+public:
+    // program должна быть деревом сразу после разбора. Выбрасывает runtime_error,
+    // если места профиля не совпадают с местами программы
+    ProgramProfile(Statement& program, Profile profile);
+
+    ProgramProfile(const ProgramProfile&) = delete;
+    ProgramProfile& operator=(const ProgramProfile&) = delete;
+
+    // Профиль места node (MethodCall, IfElse, Add, Comparison или тела метода) либо nullptr
+    [[nodiscard]] const SiteProfile* Find(const Statement& node) const;
+
+    /*
+    Тип параметра param метода с телом body, если в профиле параметр всегда имел этот тип
+    в операциях + и сравнениях, а метод не присваивает параметру другое значение.
+    Иначе nullptr
+    */
+    [[nodiscard]] const std::string* GetParameterType(const Statement& body,
+                                                      symbols::Symbol param) const;
+
+    [[nodiscard]] size_t GetSiteCount() const;
+
+private:
+    Profile profile_;
+    // Типы параметров по месту тела метода
+    std::unordered_map<const SiteProfile*, std::unordered_map<symbols::Symbol, std::string>> parameters_;
+};
+
+/*
+Переставляет ветки if, у которых по профилю чаще исполнялась ветка else: условие
+заменяется противоположным, если это можно сделать без изменения поведения
+(сравнение либо not). Горячая ветка становится первой и в шитом коде исполняется
+без перехода. Профиль продолжает описывать исходный порядок веток.
+Возвращает количество переставленных if
+*/
+size_t ReorderBranches(Statement& program, const ProgramProfile& profile);
+
+}  // namespace ast
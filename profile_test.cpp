@@ -0,0 +1,215 @@
+#include "profile.h"
+#include "class_hierarchy.h"
+#include "inlining.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+#include "type_inference.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+// Исполняет инструментированную программу и возвращает записанный профиль
+Profile Record(const string& source) {
+    auto program = ParseFromString(source);
+    const shared_ptr<Profile> profile = InstrumentProgram(program, HashSource(source));
+    Execute(*program);
+    return *profile;
+}
+
+const string SHAPES = R"(
+class Square:
+  def __init__(s):
+    self.s = s
+
+  def area():
+    return self.s * self.s
+
+class Circle:
+  def __init__(r):
+    self.r = r
+
+  def area():
+    return 3 * self.r * self.r
+
+class Factory:
+  def make(kind):
+    if kind == 'square':
+      return Square(2)
+    return Circle(1)
+
+  def count():
+    return 10
+
+class Sum:
+  def run(shape, n):
+    if n < 1:
+      return 0
+    else:
+      return shape.area() + self.run(shape, n - 1)
+
+f = Factory()
+s = Sum()
+print s.run(f.make('square'), f.count())
+)"s;
+
+void TestRecordProfile() {
+    const string source = R"(
+class A:
+  def f(x):
+    if x < 2:
+      return x + 1
+    return x
+
+a = A()
+print a.f(1), a.f(5)
+)"s;
+    auto program = ParseFromString(source);
+    const shared_ptr<Profile> profile = InstrumentProgram(program, HashSource(source));
+    ASSERT_EQUAL(Execute(*program), "2 5\n"s);
+
+    ostringstream written;
+    WriteProfile(written, *profile);
+    ostringstream expected;
+    expected << "mython-profile 1 "sv << hex << HashSource(source) << dec << " 6\n"sv
+             << "m 0 2\n"sv
+             << "b 1 2 1\n"sv
+             << "k 2 2 1 %int 2 1 %int 2\n"sv
+             << "a 3 1 1 %int 1 1 %int 1\n"sv
+             << "c 4 1 1 A 1\n"sv
+             << "c 5 1 1 A 1\n"sv;
+    ASSERT_EQUAL(written.str(), expected.str());
+
+    istringstream input(written.str());
+    const Profile read = ReadProfile(input);
+    ASSERT_EQUAL(read.source_hash, profile->source_hash);
+    ASSERT_EQUAL(read.sites.size(), 6U);
+    ASSERT_EQUAL(read.sites[1].taken, 1U);
+    ASSERT(read.sites[2].lhs == profile->sites[2].lhs);
+    ASSERT(read.sites[4].receivers == profile->sites[4].receivers);
+}
+
+void TestInvalidProfile() {
+    const Profile profile = Record(SHAPES);
+    auto other = ParseFromString("x = 1\nprint x + 1\n"s);
+    try {
+        ProgramProfile attached(*other, profile);
+        ASSERT(false);
+    } catch (const std::runtime_error&) {
+    }
+
+    for (const string& text : {"profile 1 0 0"s, "mython-profile 2 0 0"s, "mython-profile 1 0 2\nc 5 1"s,
+                               "mython-profile 1 0 2\nz 0 1"s}){
+        istringstream input(text);
+        try {
+            ReadProfile(input);
+            ASSERT(false);
+        } catch (const std::runtime_error&) {
+        }
+    }
+}
+
+void TestProfileGuidedDecisions() {
+    const Profile profile = Record(SHAPES);
+
+    {
+        auto program = ParseFromString(SHAPES);
+        ProgramProfile attached(*program, profile);
+        // if n < 1 исполнялся 11 раз, а его ветка if - однажды
+        ASSERT_EQUAL(ReorderBranches(*program, attached), 1U);
+        ASSERT_EQUAL(Execute(*program), "40\n"s);
+    }
+    {
+        auto program = ParseFromString(SHAPES);
+        ProgramProfile attached(*program, profile);
+        InliningOptions options;
+        options.profile = &attached;
+        const InliningStats stats = InlineMethods(program, options);
+        ASSERT_EQUAL(stats.speculative, 1U);
+        ASSERT_EQUAL(stats.sites.back(), "Square.area -> Sum.run (profile)"s);
+        ASSERT_EQUAL(Execute(*program), "40\n"s);
+    }
+    {
+        auto program = ParseFromString(SHAPES);
+        ProgramProfile attached(*program, profile);
+        const DevirtualizationStats stats = DevirtualizeCalls(program, &attached);
+        ASSERT_EQUAL(stats.speculative, 1U);
+        ASSERT_EQUAL(stats.polymorphic, 0U);
+        ASSERT_EQUAL(Execute(*program), "40\n"s);
+    }
+    {
+        // Аргумент f.count() неизвестен выводу типов, а в профиле n всегда целое
+        auto program = ParseFromString(SHAPES);
+        const size_t guarded = SpecializeTypes(program).guarded_methods;
+
+        program = ParseFromString(SHAPES);
+        ProgramProfile attached(*program, profile);
+        ASSERT_EQUAL(SpecializeTypes(program, &attached).guarded_methods, guarded + 1);
+        ASSERT_EQUAL(Execute(*program), "40\n"s);
+    }
+}
+
+void TestNewNodesHaveNoProfile() {
+    const Profile profile = Record(SHAPES);
+    auto program = ParseFromString(SHAPES);
+    ProgramProfile attached(*program, profile);
+
+    // Последняя инструкция программы - print с вызовом s.run(...)
+    auto& print = static_cast<Print&>(*static_cast<Compound&>(*program).args_.back());
+    auto& call = static_cast<MethodCall&>(*print.args_.front());
+    ASSERT(attached.Find(call) != nullptr);
+
+    // Узел, созданный на месте удалённого, может занять его память, но профиля не получает
+    auto object = std::move(call.object_);
+    auto method = call.method_;
+    auto args = std::move(call.args_);
+    print.args_.front().reset();
+    print.args_.front() = make_unique<MethodCall>(std::move(object), method, std::move(args));
+    ASSERT(attached.Find(*print.args_.front()) == nullptr);
+    ASSERT_EQUAL(Execute(*program), "40\n"s);
+}
+
+void TestSpeculationFallsBack() {
+    // Профиль, по которому вызов shape.area() видел только круги, а параметр n был строкой
+    Profile profile = Record(SHAPES);
+    for (SiteProfile& site : profile.sites){
+        if (site.receivers.count("Square"s)){
+            site.receivers = {{"Circle"s, site.count}};
+        }
+        if (site.kind == SiteKind::Comparison && site.lhs.count("%int"s)){
+            site.lhs = {{"%str"s, site.count}};
+        }
+    }
+
+    for (auto level : {opt::OptimizationLevel::O1, opt::OptimizationLevel::O2}){
+        auto program = ParseFromString(SHAPES);
+        opt::CreatePassManager(level, 0, &profile).Run(program);
+        ASSERT_EQUAL(Execute(*program), "40\n"s);
+    }
+}
+
+void TestWithAllPasses() {
+    const Profile profile = Record(SHAPES);
+    for (auto level : {opt::OptimizationLevel::O0, opt::OptimizationLevel::O1,
+                       opt::OptimizationLevel::O2}){
+        auto program = ParseFromString(SHAPES);
+        opt::CreatePassManager(level, 16, &profile).Run(program);
+        ASSERT_EQUAL(Execute(*program), "40\n"s);
+    }
+}
+
+}  // namespace
+
+void RunProfileTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestRecordProfile);
+    RUN_TEST(tr, ast::TestInvalidProfile);
+    RUN_TEST(tr, ast::TestProfileGuidedDecisions);
+    RUN_TEST(tr, ast::TestNewNodesHaveNoProfile);
+    RUN_TEST(tr, ast::TestSpeculationFallsBack);
+    RUN_TEST(tr, ast::TestWithAllPasses);
+}
+
+}  // namespace ast
@@ -0,0 +1,579 @@
+#include "program_cache.h"
+
+#include "ast_utils.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace cache {
+
+using namespace ast;
+using runtime::ObjectHolder;
+
+namespace {
+
+constexpr char MAGIC[4] = {'M', 'Y', 'C', '\0'};
+// Увеличивается при любом изменении формата, чтобы старые кэши считались устаревшими
+constexpr uint32_t VERSION = 1;
+// Для необязательных ссылок на классы (родитель): 0 - отсутствует, иначе индекс + 1
+constexpr uint32_t NO_CLASS = 0;
+
+enum class Tag : uint8_t {
+    // Отсутствующий необязательный узел (ветка else)
+    Empty,
+    Number,
+    String,
+    Bool,
+    None,
+    Variable,
+    Assignment,
+    FieldAssignment,
+    Print,
+    MethodCall,
+    NewInstance,
+    Stringify,
+    Add,
+    Sub,
+    Mult,
+    Div,
+    Or,
+    And,
+    Not,
+    Compound,
+    Return,
+    ClassDefinition,
+    IfElse,
+    Comparison,
+};
+
+// Функции сравнения в порядке их кодов в кэше
+const CompareFunction COMPARATORS[] = {
+    &runtime::Equal, &runtime::NotEqual, &runtime::Less,
+    &runtime::Greater, &runtime::LessOrEqual, &runtime::GreaterOrEqual,
+};
+constexpr size_t COMPARATOR_COUNT = sizeof(COMPARATORS) / sizeof(COMPARATORS[0]);
+
+template <typename T>
+bool Is(const Statement& node) {
+    // Узлы, унаследованные оптимизациями от узлов парсера, несут дополнительное состояние
+    return typeid(node) == typeid(T);
+}
+
+class Writer {
+public:
+    explicit Writer(uint64_t source_hash)
+        : source_hash_(source_hash) {
+
+    }
+
+    void WriteNode(const Statement* node) {
+        if (node == nullptr){
+            PutTag(Tag::Empty);
+        } else if (Is<NumericConst>(*node)){
+            PutTag(Tag::Number);
+            Put(static_cast<int32_t>(static_cast<const NumericConst&>(*node).value_.GetValue()));
+        } else if (Is<StringConst>(*node)){
+            PutTag(Tag::String);
+            PutString(static_cast<const StringConst&>(*node).value_.GetValue());
+        } else if (Is<BoolConst>(*node)){
+            PutTag(Tag::Bool);
+            Put(static_cast<uint8_t>(static_cast<const BoolConst&>(*node).value_.GetValue()));
+        } else if (Is<None>(*node)){
+            PutTag(Tag::None);
+        } else if (Is<VariableValue>(*node)){
+            PutTag(Tag::Variable);
+            PutNames(static_cast<const VariableValue&>(*node).dotted_ids_);
+        } else if (Is<Assignment>(*node)){
+            const auto& assignment = static_cast<const Assignment&>(*node);
+            PutTag(Tag::Assignment);
+            PutName(assignment.var_);
+            WriteNode(assignment.rv_.get());
+        } else if (Is<FieldAssignment>(*node)){
+            const auto& assignment = static_cast<const FieldAssignment&>(*node);
+            PutTag(Tag::FieldAssignment);
+            PutNames(assignment.object_.dotted_ids_);
+            PutName(assignment.field_name_);
+            WriteNode(assignment.rv_.get());
+        } else if (Is<Print>(*node)){
+            const auto& print = static_cast<const Print&>(*node);
+            // Парсер создаёт print только со списком аргументов
+            if (print.argument_ || !print.name_.Empty()){
+                Unsupported(*node);
+            }
+            PutTag(Tag::Print);
+            WriteNodes(print.args_);
+        } else if (Is<MethodCall>(*node)){
+            const auto& call = static_cast<const MethodCall&>(*node);
+            PutTag(Tag::MethodCall);
+            WriteNode(call.object_.get());
+            PutName(call.method_);
+            WriteNodes(call.args_);
+        } else if (Is<NewInstance>(*node)){
+            const auto& instance = static_cast<const NewInstance&>(*node);
+            PutTag(Tag::NewInstance);
+            Put(GetClassIndex(instance.obj_.TryAs<runtime::ClassInstance>()->GetClass()));
+            WriteNodes(instance.args_);
+        } else if (Is<Stringify>(*node)){
+            WriteUnary(Tag::Stringify, static_cast<const UnaryOperation&>(*node));
+        } else if (Is<Not>(*node)){
+            WriteUnary(Tag::Not, static_cast<const UnaryOperation&>(*node));
+        } else if (Is<Add>(*node)){
+            WriteBinary(Tag::Add, static_cast<const BinaryOperation&>(*node));
+        } else if (Is<Sub>(*node)){
+            WriteBinary(Tag::Sub, static_cast<const BinaryOperation&>(*node));
+        } else if (Is<Mult>(*node)){
+            WriteBinary(Tag::Mult, static_cast<const BinaryOperation&>(*node));
+        } else if (Is<Div>(*node)){
+            WriteBinary(Tag::Div, static_cast<const BinaryOperation&>(*node));
+        } else if (Is<Or>(*node)){
+            WriteBinary(Tag::Or, static_cast<const BinaryOperation&>(*node));
+        } else if (Is<And>(*node)){
+            WriteBinary(Tag::And, static_cast<const BinaryOperation&>(*node));
+        } else if (Is<Comparison>(*node)){
+            const auto& comparison = static_cast<const Comparison&>(*node);
+            PutTag(Tag::Comparison);
+            Put(GetComparatorCode(*node, comparison.cmp_));
+            WriteNode(comparison.lhs_.get());
+            WriteNode(comparison.rhs_.get());
+        } else if (Is<Compound>(*node)){
+            PutTag(Tag::Compound);
+            WriteNodes(static_cast<const Compound&>(*node).args_);
+        } else if (Is<Return>(*node)){
+            PutTag(Tag::Return);
+            WriteNode(static_cast<const Return&>(*node).statement_.get());
+        } else if (Is<IfElse>(*node)){
+            const auto& if_else = static_cast<const IfElse&>(*node);
+            PutTag(Tag::IfElse);
+            WriteNode(if_else.condition_.get());
+            WriteNode(if_else.if_body_.get());
+            WriteNode(if_else.else_body_.get());
+        } else if (Is<ClassDefinition>(*node)){
+            PutTag(Tag::ClassDefinition);
+            WriteClass(*static_cast<const ClassDefinition&>(*node).cls_.TryAs<runtime::Class>());
+        } else {
+            Unsupported(*node);
+        }
+    }
+
+    // Заголовок и пул строк предшествуют узлам, поэтому записываются после обхода дерева
+    void Finish(ostream& out) const {
+        out.write(MAGIC, sizeof(MAGIC));
+        WriteRaw(out, VERSION);
+        WriteRaw(out, source_hash_);
+        WriteRaw(out, static_cast<uint32_t>(pool_.size()));
+        for (const string* str : pool_){
+            WriteRaw(out, static_cast<uint32_t>(str->size()));
+            out.write(str->data(), static_cast<streamsize>(str->size()));
+        }
+        out.write(nodes_.data(), static_cast<streamsize>(nodes_.size()));
+    }
+
+private:
+    uint64_t source_hash_;
+    string nodes_;
+    // Строки пула хранятся в ключах словаря, адреса которых не меняются при вставке
+    unordered_map<string, uint32_t> pool_index_;
+    vector<const string*> pool_;
+    unordered_map<const runtime::Class*, uint32_t> classes_;
+
+    template <typename T>
+    static void WriteRaw(ostream& out, T value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    void Put(T value) {
+        nodes_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void PutTag(Tag tag) {
+        Put(static_cast<uint8_t>(tag));
+    }
+
+    void PutString(const string& str) {
+        auto [it, inserted] = pool_index_.emplace(str, static_cast<uint32_t>(pool_.size()));
+        if (inserted){
+            pool_.push_back(&it->first);
+        }
+        Put(it->second);
+    }
+
+    // Имена записываются текстом: номера символов различаются между запусками
+    void PutName(symbols::Symbol name) {
+        PutString(name.Str());
+    }
+
+    void PutNames(const vector<symbols::Symbol>& names) {
+        Put(static_cast<uint32_t>(names.size()));
+        for (const symbols::Symbol name : names){
+            PutName(name);
+        }
+    }
+
+    void WriteNodes(const vector<unique_ptr<Statement>>& nodes) {
+        Put(static_cast<uint32_t>(nodes.size()));
+        for (const auto& node : nodes){
+            WriteNode(node.get());
+        }
+    }
+
+    void WriteUnary(Tag tag, const UnaryOperation& node) {
+        PutTag(tag);
+        WriteNode(node.statement_.get());
+    }
+
+    void WriteBinary(Tag tag, const BinaryOperation& node) {
+        PutTag(tag);
+        WriteNode(node.lhs_.get());
+        WriteNode(node.rhs_.get());
+    }
+
+    // Классы нумеруются в порядке объявления; парсер допускает ссылки только на объявленные
+    uint32_t GetClassIndex(const runtime::Class& cls) const {
+        auto it = classes_.find(&cls);
+        if (it == classes_.end()){
+            throw std::invalid_argument("Class "s + cls.GetName().Str() + " is used before its definition"s);
+        }
+        return it->second;
+    }
+
+    void WriteClass(const runtime::Class& cls) {
+        PutName(cls.GetName());
+        Put(cls.GetParent() ? GetClassIndex(*cls.GetParent()) + 1 : NO_CLASS);
+        Put(static_cast<uint32_t>(cls.Methods().size()));
+        for (const runtime::Method& method : cls.Methods()){
+            auto* body = dynamic_cast<const MethodBody*>(method.body.get());
+            if (body == nullptr || !Is<MethodBody>(*body)){
+                throw std::invalid_argument("Method "s + cls.GetName().Str() + '.' + method.name.Str()
+                                            + " has no parsed body and cannot be cached"s);
+            }
+            PutName(method.name);
+            PutNames(method.formal_params);
+            WriteNode(body->body_.get());
+        }
+        // Тела методов не ссылаются на свой класс, поэтому он регистрируется после них
+        classes_.emplace(&cls, static_cast<uint32_t>(classes_.size()));
+    }
+
+    static uint8_t GetComparatorCode(const Statement& node, const Comparison::Comparator& cmp) {
+        const CompareFunction fn = GetCompareFunction(cmp);
+        for (size_t i = 0; i < COMPARATOR_COUNT; ++i){
+            if (fn != nullptr && COMPARATORS[i] == fn){
+                return static_cast<uint8_t>(i);
+            }
+        }
+        Unsupported(node);
+        return 0;
+    }
+
+    [[noreturn]] static void Unsupported(const Statement& node) {
+        throw std::invalid_argument("Node "s + typeid(node).name() + " cannot be cached"s);
+    }
+};
+
+class Reader {
+public:
+    explicit Reader(string_view data)
+        : data_(data) {
+
+    }
+
+    // Возвращает false, если data - не кэш этой версии формата для исходника source_hash
+    bool ReadHeader(uint64_t source_hash) {
+        if (data_.size() < sizeof(MAGIC) || memcmp(data_.data(), MAGIC, sizeof(MAGIC)) != 0){
+            return false;
+        }
+        pos_ = sizeof(MAGIC);
+        if (Get<uint32_t>() != VERSION || Get<uint64_t>() != source_hash){
+            return false;
+        }
+        const size_t count = GetCount();
+        pool_.reserve(count);
+        for (size_t i = 0; i < count; ++i){
+            const auto size = Get<uint32_t>();
+            pool_.push_back(GetBytes(size));
+        }
+        return true;
+    }
+
+    unique_ptr<Statement> ReadNode() {
+        const auto tag = static_cast<Tag>(Get<uint8_t>());
+        switch (tag){
+        case Tag::Empty:
+            return nullptr;
+        case Tag::Number:
+            return make_unique<NumericConst>(runtime::Number(Get<int32_t>()));
+        case Tag::String:
+            return make_unique<StringConst>(runtime::String(GetString()));
+        case Tag::Bool:
+            return make_unique<BoolConst>(runtime::Bool(Get<uint8_t>() != 0));
+        case Tag::None:
+            return make_unique<None>();
+        case Tag::Variable:
+            return make_unique<VariableValue>(GetNames());
+        case Tag::Assignment: {
+            const symbols::Symbol var = GetName();
+            return make_unique<Assignment>(var, ReadRequired());
+        }
+        case Tag::FieldAssignment: {
+            VariableValue object(GetNames());
+            const symbols::Symbol field = GetName();
+            return make_unique<FieldAssignment>(std::move(object), field, ReadRequired());
+        }
+        case Tag::Print:
+            return make_unique<Print>(ReadNodes());
+        case Tag::MethodCall: {
+            auto object = ReadRequired();
+            const symbols::Symbol method = GetName();
+            return make_unique<MethodCall>(std::move(object), method, ReadNodes());
+        }
+        case Tag::NewInstance: {
+            const runtime::Class& cls = GetClass(Get<uint32_t>());
+            return make_unique<NewInstance>(cls, ReadNodes());
+        }
+        case Tag::Stringify:
+            return make_unique<Stringify>(ReadRequired());
+        case Tag::Not:
+            return make_unique<Not>(ReadRequired());
+        case Tag::Add:
+            return ReadBinary<Add>();
+        case Tag::Sub:
+            return ReadBinary<Sub>();
+        case Tag::Mult:
+            return ReadBinary<Mult>();
+        case Tag::Div:
+            return ReadBinary<Div>();
+        case Tag::Or:
+            return ReadBinary<Or>();
+        case Tag::And:
+            return ReadBinary<And>();
+        case Tag::Comparison: {
+            const auto code = Get<uint8_t>();
+            if (code >= COMPARATOR_COUNT){
+                throw CacheError("Unknown comparison in program cache"s);
+            }
+            auto lhs = ReadRequired();
+            return make_unique<Comparison>(COMPARATORS[code], std::move(lhs), ReadRequired());
+        }
+        case Tag::Compound: {
+            auto result = make_unique<Compound>();
+            result->args_ = ReadNodes();
+            return result;
+        }
+        case Tag::Return:
+            return make_unique<Return>(ReadRequired());
+        case Tag::IfElse: {
+            auto condition = ReadRequired();
+            auto if_body = ReadRequired();
+            return make_unique<IfElse>(std::move(condition), std::move(if_body), ReadNode());
+        }
+        case Tag::ClassDefinition:
+            return make_unique<ClassDefinition>(ReadClass());
+        }
+        throw CacheError("Unknown node in program cache"s);
+    }
+
+    [[nodiscard]] bool AtEnd() const {
+        return pos_ == data_.size();
+    }
+
+private:
+    string_view data_;
+    size_t pos_ = 0;
+    // Строки пула указывают в data_
+    vector<string_view> pool_;
+    vector<ObjectHolder> classes_;
+
+    string_view GetBytes(size_t size) {
+        if (data_.size() - pos_ < size){
+            throw CacheError("Program cache is truncated"s);
+        }
+        string_view result = data_.substr(pos_, size);
+        pos_ += size;
+        return result;
+    }
+
+    template <typename T>
+    T Get() {
+        T value;
+        memcpy(&value, GetBytes(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    // Количество элементов последовательности. Каждый элемент занимает хотя бы один байт,
+    // поэтому повреждённое количество отвергается до выделения памяти под элементы
+    size_t GetCount() {
+        const auto count = Get<uint32_t>();
+        if (count > data_.size() - pos_){
+            throw CacheError("Invalid element count in program cache"s);
+        }
+        return count;
+    }
+
+    string GetString() {
+        const auto index = Get<uint32_t>();
+        if (index >= pool_.size()){
+            throw CacheError("Invalid string reference in program cache"s);
+        }
+        return string(pool_[index]);
+    }
+
+    symbols::Symbol GetName() {
+        return symbols::Symbol(GetString());
+    }
+
+    vector<symbols::Symbol> GetNames() {
+        vector<symbols::Symbol> result(GetCount());
+        for (symbols::Symbol& name : result){
+            name = GetName();
+        }
+        return result;
+    }
+
+    const runtime::Class& GetClass(uint32_t index) const {
+        if (index >= classes_.size()){
+            throw CacheError("Invalid class reference in program cache"s);
+        }
+        return *classes_[index].TryAs<runtime::Class>();
+    }
+
+    unique_ptr<Statement> ReadRequired() {
+        auto node = ReadNode();
+        if (!node){
+            throw CacheError("Missing node in program cache"s);
+        }
+        return node;
+    }
+
+    vector<unique_ptr<Statement>> ReadNodes() {
+        vector<unique_ptr<Statement>> result(GetCount());
+        for (auto& node : result){
+            node = ReadRequired();
+        }
+        return result;
+    }
+
+    template <typename T>
+    unique_ptr<Statement> ReadBinary() {
+        auto lhs = ReadRequired();
+        return make_unique<T>(std::move(lhs), ReadRequired());
+    }
+
+    ObjectHolder ReadClass() {
+        const symbols::Symbol name = GetName();
+        const auto parent = Get<uint32_t>();
+        const runtime::Class* parent_class = parent == NO_CLASS ? nullptr : &GetClass(parent - 1);
+        vector<runtime::Method> methods(GetCount());
+        for (runtime::Method& method : methods){
+            method.name = GetName();
+            method.formal_params = GetNames();
+            method.body = make_unique<MethodBody>(ReadRequired());
+        }
+        classes_.push_back(ObjectHolder::Own(runtime::Class(name, std::move(methods),
+                                                            parent_class)));
+        return classes_.back();
+    }
+};
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0){
+            return;
+        }
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && info.st_size > 0){
+            void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE,
+                              fd, 0);
+            if (data != MAP_FAILED){
+                data_ = data;
+                size_ = static_cast<size_t>(info.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_ != nullptr){
+            munmap(data_, size_);
+        }
+    }
+
+    // Пустое представление, если файл не удалось отобразить
+    [[nodiscard]] string_view GetData() const {
+        return {static_cast<const char*>(data_), size_};
+    }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace
+
+void WriteProgram(ostream& out, runtime::Executable& program, uint64_t source_hash) {
+    Writer writer(source_hash);
+    writer.WriteNode(&program);
+    writer.Finish(out);
+}
+
+unique_ptr<runtime::Executable> ReadProgram(string_view data, uint64_t source_hash) {
+    Reader reader(data);
+    if (!reader.ReadHeader(source_hash)){
+        return nullptr;
+    }
+    auto program = reader.ReadNode();
+    if (!program || !reader.AtEnd()){
+        throw CacheError("Program cache is corrupted"s);
+    }
+    return program;
+}
+
+unique_ptr<runtime::Executable> LoadProgram(const string& path, uint64_t source_hash) {
+    const MappedFile file(path);
+    try {
+        return ReadProgram(file.GetData(), source_hash);
+    } catch (const CacheError&) {
+        return nullptr;
+    }
+}
+
+void SaveProgram(const string& path, runtime::Executable& program, uint64_t source_hash) {
+    // Запись во временный файл не оставляет недописанный кэш на месте прежнего
+    const string tmp_path = path + ".tmp"s;
+    try {
+        {
+            ofstream out(tmp_path, ios::binary);
+            if (!out){
+                throw std::runtime_error("Unable to write program cache "s + path);
+            }
+            WriteProgram(out, program, source_hash);
+            if (!out){
+                throw std::runtime_error("Unable to write program cache "s + path);
+            }
+        }
+        filesystem::rename(tmp_path, path);
+    } catch (...) {
+        std::error_code ignored;
+        filesystem::remove(tmp_path, ignored);
+        throw;
+    }
+}
+
+}  // namespace cache
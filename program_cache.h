@@ -0,0 +1,50 @@
+#pragma once
+
+#include "statement.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/*
+Кэш разобранной программы (.myc). Дерево программы сразу после разбора записывается
+в компактном двоичном виде: заголовок с хешем исходника, пул строк (имена и строковые
+константы без повторов) и узлы дерева в прямом порядке, в том числе классы с телами
+методов. При загрузке файл отображается в память, строки пула читаются без копирования,
+а узлы восстанавливаются за один проход без лексера и парсера.
+Кэш с другим хешем исходника считается устаревшим и не используется
+*/
+namespace cache {
+
+class CacheError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/*
+Записывает в out программу program, только что полученную от парсера.
+Выбрасывает std::invalid_argument, если дерево содержит узлы, которые создаёт не парсер
+(например, после оптимизационных проходов или с отложенными телами методов)
+*/
+void WriteProgram(std::ostream& out, runtime::Executable& program, uint64_t source_hash);
+
+/*
+Восстанавливает программу из содержимого кэша data. Возвращает nullptr, если data
+не является кэшем этой версии формата или записан для исходника с другим хешем.
+Выбрасывает CacheError, если кэш повреждён
+*/
+std::unique_ptr<runtime::Executable> ReadProgram(std::string_view data, uint64_t source_hash);
+
+/*
+Загружает программу из файла кэша path, отображая его в память. Возвращает nullptr,
+если файла нет, он устарел или повреждён
+*/
+std::unique_ptr<runtime::Executable> LoadProgram(const std::string& path, uint64_t source_hash);
+
+// Записывает кэш программы в файл path. Выбрасывает std::runtime_error, если файл не записан
+void SaveProgram(const std::string& path, runtime::Executable& program, uint64_t source_hash);
+
+}  // namespace cache
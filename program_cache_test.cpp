@@ -0,0 +1,209 @@
+#include "program_cache.h"
+#include "pass_manager.h"
+#include "profile.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+namespace cache {
+
+namespace {
+
+string Serialize(ast::Statement& program, uint64_t source_hash) {
+    ostringstream out;
+    WriteProgram(out, program, source_hash);
+    return out.str();
+}
+
+const string PROGRAM = R"(
+class Shape:
+  def __str__():
+    return "Shape"
+
+  def area():
+    return None
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+  def __str__():
+    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
+
+class Factory:
+  def make(n):
+    class Square(Rect):
+      def kind():
+        return 'square'
+    if n > 0 and not n == 1 or False:
+      return Rect(n, n + 1)
+    else:
+      return Shape()
+
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    self.value = self.value + n
+    return self
+
+f = Factory()
+r = f.make(3)
+s = Square(2, 2)
+c = Counter()
+c.add(10)
+c.add(-4)
+print r, r.area(), f.make(0), s.kind(), s.area()
+print c.value, c.value / 2, c.value - 1, c.value <= 6, c.value >= 7, c.value != 6, c.value < 1
+print True, None, "it's", "a\tb"
+)"s;
+
+void TestRoundTrip() {
+    const uint64_t hash = ast::HashSource(PROGRAM);
+    auto original = ParseFromString(PROGRAM);
+    const string data = Serialize(*original, hash);
+
+    auto loaded = ReadProgram(data, hash);
+    ASSERT(loaded != nullptr);
+    ASSERT_EQUAL(Execute(*loaded), Execute(*ParseFromString(PROGRAM)));
+    // Повторная запись загруженной программы даёт тот же кэш
+    ASSERT_EQUAL(Serialize(*loaded, hash), data);
+
+}
+
+void TestOptimizeLoadedProgram() {
+    const string program = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    self.value = self.value + n * 2
+
+  def get():
+    return self.value
+
+c = Counter()
+c.add(1 + 2)
+c.add(c.get())
+print c.get(), c.get() > 10
+)"s;
+    const uint64_t hash = ast::HashSource(program);
+    const string data = Serialize(*ParseFromString(program), hash);
+    for (auto level : {opt::OptimizationLevel::O1, opt::OptimizationLevel::O2}){
+        auto optimized = ReadProgram(data, hash);
+        opt::CreatePassManager(level).Run(optimized);
+        ASSERT_EQUAL(Execute(*optimized), "18 True\n"s);
+    }
+}
+
+void TestStringPool() {
+    string program = "x = 'repeated constant'\n";
+    for (int i = 0; i < 100; ++i){
+        program += "x = 'repeated constant'\n";
+    }
+    auto tree = ParseFromString(program);
+    const string data = Serialize(*tree, 0);
+    ASSERT(data.size() < 1500U);
+    ASSERT_EQUAL(data.find("repeated constant"s), data.rfind("repeated constant"s));
+}
+
+void TestStaleAndCorruptedCache() {
+    const uint64_t hash = ast::HashSource(PROGRAM);
+    auto tree = ParseFromString(PROGRAM);
+    const string data = Serialize(*tree, hash);
+
+    ASSERT(ReadProgram(data, hash + 1) == nullptr);
+    ASSERT(ReadProgram("not a cache"s, hash) == nullptr);
+    ASSERT(ReadProgram(""s, hash) == nullptr);
+
+    string other_version = data;
+    other_version[4] = static_cast<char>(other_version[4] + 1);
+    ASSERT(ReadProgram(other_version, hash) == nullptr);
+
+    ASSERT_THROWS(ReadProgram(data.substr(0, data.size() - 3), hash), CacheError);
+    ASSERT_THROWS(ReadProgram(data + "x"s, hash), CacheError);
+}
+
+void TestCorruptedCounts() {
+    const uint64_t hash = ast::HashSource(PROGRAM);
+    const string data = Serialize(*ParseFromString(PROGRAM), hash);
+    const auto get_count = [&data](size_t offset) {
+        uint32_t value;
+        memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    };
+
+    // Количество строк пула следует за сигнатурой, версией и хешем исходника
+    const size_t pool_offset = 16;
+    // Пул - это длины строк и их байты, за ним идёт тег корневого Compound
+    size_t compound_offset = pool_offset + sizeof(uint32_t);
+    for (uint32_t i = 0, count = get_count(pool_offset); i < count; ++i){
+        compound_offset += sizeof(uint32_t) + get_count(compound_offset);
+    }
+    ++compound_offset;
+    ASSERT(get_count(compound_offset) > 0U);
+
+    // Количества не больше оставшихся байтов отвергаются до выделения памяти
+    for (const size_t offset : {pool_offset, compound_offset}){
+        for (const uint32_t count : {0xFFFFFFFFU, static_cast<uint32_t>(data.size())}){
+            string corrupted = data;
+            memcpy(corrupted.data() + offset, &count, sizeof(count));
+            ASSERT_THROWS(ReadProgram(corrupted, hash), CacheError);
+        }
+    }
+}
+
+void TestOptimizedTreeIsRejected() {
+    auto tree = ParseFromString("x = 1\ny = x + 2 * 3\nprint y\n"s);
+    opt::CreatePassManager(opt::OptimizationLevel::O2).Run(tree);
+    ostringstream out;
+    ASSERT_THROWS(WriteProgram(out, *tree, 0), std::invalid_argument);
+}
+
+void TestFileCache() {
+    const string path = (filesystem::temp_directory_path() / "mython_cache_test.myc").string();
+    std::remove(path.c_str());
+
+    const uint64_t hash = ast::HashSource(PROGRAM);
+    ASSERT(LoadProgram(path, hash) == nullptr);
+
+    auto tree = ParseFromString(PROGRAM);
+    SaveProgram(path, *tree, hash);
+    auto loaded = LoadProgram(path, hash);
+    ASSERT(loaded != nullptr);
+    ASSERT_EQUAL(Execute(*loaded), Execute(*ParseFromString(PROGRAM)));
+    ASSERT(LoadProgram(path, hash + 1) == nullptr);
+
+    {
+        ofstream out(path, ios::binary | ios::app);
+        out << "garbage"s;
+    }
+    ASSERT(LoadProgram(path, hash) == nullptr);
+    std::remove(path.c_str());
+}
+
+}  // namespace
+
+void RunProgramCacheTests(TestRunner& tr) {
+    RUN_TEST(tr, cache::TestRoundTrip);
+    RUN_TEST(tr, cache::TestOptimizeLoadedProgram);
+    RUN_TEST(tr, cache::TestStringPool);
+    RUN_TEST(tr, cache::TestStaleAndCorruptedCache);
+    RUN_TEST(tr, cache::TestCorruptedCounts);
+    RUN_TEST(tr, cache::TestOptimizedTreeIsRejected);
+    RUN_TEST(tr, cache::TestFileCache);
+}
+
+}  // namespace cache
@@ -52,7 +52,7 @@ bool IsTrue(const ObjectHolder& object) {
 }
 
 void ClassInstance::Print(std::ostream& os, Context& context) {
-    const Method *method_str = cls_.GetMethod("__str__"s);
+    const Method *method_str = cls_.GetMethod(names::STR);
     if (method_str){
         ObjectHolder holder = method_str->body.get()->Execute(closure_, context);
         if (holder.Get())
@@ -62,7 +62,7 @@ void ClassInstance::Print(std::ostream& os, Context& context) {
     }
 }
 
-bool ClassInstance::HasMethod(const std::string& method, size_t argument_count) const {
+bool ClassInstance::HasMethod(symbols::Symbol method, size_t argument_count) const {
     return cls_.HasMethod(method, argument_count);
 }
 
@@ -74,28 +74,37 @@ const Closure& ClassInstance::Fields() const {
     return closure_;
 }
 
+const Class& ClassInstance::GetClass() const {
+    return cls_;
+}
+
 ClassInstance::ClassInstance(const Class& cls)
     : cls_(cls) {
     
 }
 
-ObjectHolder ClassInstance::Call(const std::string& name, const std::vector<ObjectHolder>& actual_args,
+ObjectHolder ClassInstance::Call(symbols::Symbol name, const std::vector<ObjectHolder>& actual_args,
                       Context& context){
     const Method *method;
     if (!HasMethod(name, actual_args.size()) || !(method = cls_.GetMethod(name, actual_args.size())))
         throw std::runtime_error("Method does not exist"s);
-    
+
+    return CallMethod(*method, actual_args, context);
+}
+
+ObjectHolder ClassInstance::CallMethod(const Method& method, const std::vector<ObjectHolder>& actual_args,
+                                       Context& context){
     Closure closure;
     for (size_t i = 0; i < actual_args.size(); ++i){
-        closure[method->formal_params.at(i)] = actual_args.at(i);
+        closure[method.formal_params.at(i)] = actual_args.at(i);
     }
-    if (!closure.count("self"s))
-        closure["self"s] = ObjectHolder::Share(*this);
+    if (!closure.count(names::SELF))
+        closure[names::SELF] = ObjectHolder::Share(*this);
 
-    return method->body.get()->Execute(closure, context);
+    return method.body.get()->Execute(closure, context);
 }
 
-Class::Class(std::string name, std::vector<Method> methods, const Class* parent)
+Class::Class(symbols::Symbol name, std::vector<Method> methods, const Class* parent)
     : name_(name), parent_(parent) {
     methods_.reserve(methods.size());
     for (Method method : methods){
@@ -103,14 +112,14 @@ Class::Class(std::string name, std::vector<Method> methods, const Class* parent)
     }
 }
 
-const Method* Class::GetMethod(const std::string& name, size_t args_count) const{      
+const Method* Class::GetMethod(symbols::Symbol name, size_t args_count) const{      
     const Class* cls = this;
 
     while (cls){
         for (const Method& method : cls->methods_){
             if (method.name == name){                    
                 size_t formal_params_size = method.formal_params.size();                
-                if (formal_params_size && method.formal_params.at(0) == "self"s){
+                if (formal_params_size && method.formal_params.at(0) == names::SELF){
                     formal_params_size--;
                 }
                 if (formal_params_size == args_count){
@@ -124,7 +133,7 @@ const Method* Class::GetMethod(const std::string& name, size_t args_count) const
     return nullptr;
 }
 
-const Method* Class::GetMethod(const std::string& name) const {      
+const Method* Class::GetMethod(symbols::Symbol name) const {      
     const Class* cls = this;
 
     while (cls){
@@ -139,21 +148,33 @@ const Method* Class::GetMethod(const std::string& name) const {
     return nullptr;
 }
 
-[[nodiscard]] inline const std::string& Class::GetName() const {
+symbols::Symbol Class::GetName() const {
     return name_;
 }
 
+const Class* Class::GetParent() const {
+    return parent_;
+}
+
+std::vector<Method>& Class::Methods() {
+    return methods_;
+}
+
+const std::vector<Method>& Class::Methods() const {
+    return methods_;
+}
+
 void Class::Print(ostream& os, [[maybe_unused]]Context& context) {
     os << "Class "s << GetName();
 }
 
-bool Class::HasMethod(const std::string& name, size_t argument_count) const{
+bool Class::HasMethod(symbols::Symbol name, size_t argument_count) const{
     const Class* cls = this;
     while (cls){
         for (const Method& method : cls->methods_){
             if (method.name == name){
                 size_t formal_params_size = method.formal_params.size();
-                if (formal_params_size && method.formal_params.at(0) == "self"s){
+                if (formal_params_size && method.formal_params.at(0) == names::SELF){
                     formal_params_size--;
                 }
                 if (formal_params_size == argument_count){
@@ -196,8 +217,8 @@ bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context){
             return false;
         }
     }
-    if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod("__eq__", 1)){
-        return lhs.TryAs<ClassInstance>()->Call("__eq__", {rhs}, context).TryAs<Bool>()->GetValue();
+    if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod(names::EQ, 1)){
+        return lhs.TryAs<ClassInstance>()->Call(names::EQ, {rhs}, context).TryAs<Bool>()->GetValue();
     }
     throw std::runtime_error("Can not compare objects for equality");
 }
@@ -224,8 +245,8 @@ bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
             return false;
         }
     }
-    if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod("__lt__", 1)){
-        return lhs.TryAs<ClassInstance>()->Call("__lt__", {rhs}, context).TryAs<Bool>()->GetValue();
+    if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod(names::LT, 1)){
+        return lhs.TryAs<ClassInstance>()->Call(names::LT, {rhs}, context).TryAs<Bool>()->GetValue();
     }
     throw std::runtime_error("Cannot compare objects for less");
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "symbols.h"
+
 #include <memory>
 #include <sstream>
 #include <string>
@@ -106,7 +108,17 @@ private:
 
 
 // Таблица символов, связывающая имя объекта с его значением
-using Closure = std::unordered_map<std::string, ObjectHolder>;
+using Closure = std::unordered_map<symbols::Symbol, ObjectHolder>;
+
+// Имена, которые интерпретатор использует при исполнении программы
+namespace names {
+inline const symbols::Symbol SELF{"self"};
+inline const symbols::Symbol INIT{"__init__"};
+inline const symbols::Symbol STR{"__str__"};
+inline const symbols::Symbol ADD{"__add__"};
+inline const symbols::Symbol EQ{"__eq__"};
+inline const symbols::Symbol LT{"__lt__"};
+}  // namespace names
 
 // Интерфейс для выполнения действий над объектами Mython
 class Executable {
@@ -135,9 +147,9 @@ public:
 // Метод класса
 struct Method {
     // Имя метода
-    std::string name;
+    symbols::Symbol name;
     // Имена формальных параметров метода
-    std::vector<std::string> formal_params;
+    std::vector<symbols::Symbol> formal_params;
     // Тело метода
     std::shared_ptr<Executable> body;
 };
@@ -153,25 +165,34 @@ class Class : public Object {
 public:
     // Создаёт класс с именем name и набором методов methods, унаследованный от класса parent
     // Если parent равен nullptr, то создаётся базовый класс
-    explicit Class(std::string name, std::vector<Method> methods, const Class* parent);
+    explicit Class(symbols::Symbol name, std::vector<Method> methods, const Class* parent);
 
     // Возвращает указатель на метод name или nullptr, если метод с таким именем отсутствует
-    [[nodiscard]] const Method* GetMethod(const std::string& name, size_t args_count) const;
+    [[nodiscard]] const Method* GetMethod(symbols::Symbol name, size_t args_count) const;
 
     // Возвращает указатель на метод name или nullptr, если метод с таким именем отсутствует
-    [[nodiscard]] const Method* GetMethod(const std::string& name) const;
+    [[nodiscard]] const Method* GetMethod(symbols::Symbol name) const;
 
     // Возвращает имя класса
-    [[nodiscard]] const std::string& GetName() const;
+    [[nodiscard]] symbols::Symbol GetName() const;
 
     // Выводит в os строку "Class <имя класса>", например "Class cat"
     void Print(std::ostream& os, [[maybe_unused]]Context& context) override;
 
     // Возвращает true, если объект имеет метод method, принимающий argument_count параметров
-    [[nodiscard]] bool HasMethod(const std::string& name, size_t argument_count) const;
+    [[nodiscard]] bool HasMethod(symbols::Symbol name, size_t argument_count) const;
+
+    // Возвращает родительский класс либо nullptr для базового класса
+    [[nodiscard]] const Class* GetParent() const;
+
+    // Возвращает ссылку на методы, объявленные в самом классе (без учёта родителей)
+    [[nodiscard]] std::vector<Method>& Methods();
+
+    // Возвращает константную ссылку на методы, объявленные в самом классе
+    [[nodiscard]] const std::vector<Method>& Methods() const;
 
 private:
-    std::string name_;
+    symbols::Symbol name_;
     std::vector<Method> methods_;
     const Class* parent_;
 };
@@ -194,11 +215,16 @@ public:
      * Если ни сам класс, ни его родители не содержат метод method, метод выбрасывает исключение
      * runtime_error
      */
-    ObjectHolder Call(const std::string& name, const std::vector<ObjectHolder>& actual_args,
+    ObjectHolder Call(symbols::Symbol name, const std::vector<ObjectHolder>& actual_args,
                       Context& context);
 
+    // Вызывает у объекта заранее найденный метод method (например, метод, выбранный
+    // анализом иерархии классов). Наличие метода у класса объекта не проверяется
+    ObjectHolder CallMethod(const Method& method, const std::vector<ObjectHolder>& actual_args,
+                            Context& context);
+
     // Возвращает true, если объект имеет метод method, принимающий argument_count параметров
-    [[nodiscard]] bool HasMethod(const std::string& method, size_t argument_count) const;
+    [[nodiscard]] bool HasMethod(symbols::Symbol method, size_t argument_count) const;
 
     // Возвращает ссылку на Closure, содержащий поля объекта
     [[nodiscard]] Closure& Fields();
@@ -206,6 +232,9 @@ public:
     // Возвращает константную ссылку на Closure, содержащую поля объекта
     [[nodiscard]] const Closure& Fields() const;
 
+    // Возвращает класс, экземпляром которого является объект
+    [[nodiscard]] const Class& GetClass() const;
+
 private:
     const Class& cls_;
     Closure closure_;
@@ -11,11 +11,6 @@ using runtime::Closure;
 using runtime::Context;
 using runtime::ObjectHolder;
 
-namespace {
-const string ADD_METHOD = "__add__"s;
-const string INIT_METHOD = "__init__"s;
-}  // namespace
-
 ObjectThrow::ObjectThrow(runtime::ObjectHolder obj)
     : obj_(obj) {
 
@@ -30,16 +25,16 @@ ObjectHolder Assignment::Execute(Closure& closure, Context& context) {
     return closure[var_];
 }
 
-Assignment::Assignment(std::string var, std::shared_ptr<Statement> rv)
-    : var_(var), rv_(rv) {
+Assignment::Assignment(symbols::Symbol var, std::unique_ptr<Statement> rv)
+    : var_(var), rv_(std::move(rv)) {
 
 }
 
-VariableValue::VariableValue(const std::string& var_name){
+VariableValue::VariableValue(symbols::Symbol var_name){
     dotted_ids_.push_back(var_name);
 }
 
-VariableValue::VariableValue(std::vector<std::string> dotted_ids)
+VariableValue::VariableValue(std::vector<symbols::Symbol> dotted_ids)
     : dotted_ids_(dotted_ids) {
 
 }
@@ -50,10 +45,10 @@ ObjectHolder VariableValue::Execute(runtime::Closure& closure, [[maybe_unused]]r
     
     for (size_t i = 0; i < dotted_ids_.size() - 1; ++i){
         if (!closure_->count(dotted_ids_.at(i))){
-            if (dotted_ids_.at(i) == "self"s){
+            if (dotted_ids_.at(i) == runtime::names::SELF){
                 continue;
             }
-            throw std::runtime_error(dotted_ids_.at(i) + ": unknown variable"s);
+            throw std::runtime_error(dotted_ids_.at(i).Str() + ": unknown variable"s);
         }
         if ((obj = (*closure_)[dotted_ids_.at(i)].TryAs<runtime::ClassInstance>()) == nullptr){
             throw std::runtime_error("Undefined class field"s);
@@ -66,7 +61,7 @@ ObjectHolder VariableValue::Execute(runtime::Closure& closure, [[maybe_unused]]r
     return (*closure_)[dotted_ids_.back()];
 }
 
-unique_ptr<Print> Print::Variable(const std::string& name){
+unique_ptr<Print> Print::Variable(symbols::Symbol name){
         return std::make_unique<Print>(name);
     }
 
@@ -93,12 +88,7 @@ ObjectHolder Print::Execute(runtime::Closure& closure, runtime::Context& context
         }
     }
     for (size_t i=0; i<args_.size(); ++i){
-        runtime::ObjectHolder obj = args_.at(i).get()->Execute(closure, context);
-        if (obj.Get()){
-            obj.Get()->Print(context.GetOutputStream(), context);
-        } else {
-            context.GetOutputStream() << "None";
-        }
+        PrintObject(args_.at(i).get()->Execute(closure, context), context);
         if (i != args_.size() - 1){
             context.GetOutputStream() << " ";
         } else {
@@ -108,7 +98,15 @@ ObjectHolder Print::Execute(runtime::Closure& closure, runtime::Context& context
     return runtime::ObjectHolder::None();    
 }
 
-MethodCall::MethodCall(std::unique_ptr<Statement> object, std::string method,
+void Print::PrintObject(const runtime::ObjectHolder& obj, runtime::Context& context) {
+    if (obj.Get()){
+        obj.Get()->Print(context.GetOutputStream(), context);
+    } else {
+        context.GetOutputStream() << "None";
+    }
+}
+
+MethodCall::MethodCall(std::unique_ptr<Statement> object, symbols::Symbol method,
             std::vector<std::unique_ptr<Statement>> args)
     : object_(std::move(object)), method_(method) {
     args_.reserve(args.size());
@@ -136,7 +134,10 @@ ObjectHolder MethodCall::Execute(runtime::Closure& closure, runtime::Context& co
 }
 
 ObjectHolder Stringify::Execute(runtime::Closure& closure, runtime::Context& context) {
-    runtime::ObjectHolder obj = statement_.get()->Execute(closure, context);
+    return Apply(statement_.get()->Execute(closure, context), context);
+}
+
+ObjectHolder Stringify::Apply(const runtime::ObjectHolder& obj, runtime::Context& context) {
     if (obj.Get()){
         std::ostringstream str;
         obj.Get()->Print(str, context);
@@ -148,6 +149,11 @@ ObjectHolder Stringify::Execute(runtime::Closure& closure, runtime::Context& con
 ObjectHolder Add::Execute(runtime::Closure& closure, runtime::Context& context) {
     runtime::ObjectHolder lhs = lhs_.get()->Execute(closure, context);
     runtime::ObjectHolder rhs = rhs_.get()->Execute(closure, context);
+    return Apply(lhs, rhs, context);
+}
+
+ObjectHolder Add::Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                        runtime::Context& context) {
 
     if (runtime::Number *left = lhs.TryAs<runtime::Number>(),
         *right = rhs.TryAs<runtime::Number>();
@@ -158,8 +164,8 @@ ObjectHolder Add::Execute(runtime::Closure& closure, runtime::Context& context)
         left && right){
         return runtime::ObjectHolder::Own<runtime::String>(left->GetValue() + right->GetValue());
     } else if (runtime::ClassInstance* instance = lhs.TryAs<runtime::ClassInstance>(); 
-        instance && instance->HasMethod(ADD_METHOD, 1)){
-        return instance->Call(ADD_METHOD, {rhs}, context);
+        instance && instance->HasMethod(runtime::names::ADD, 1)){
+        return instance->Call(runtime::names::ADD, {rhs}, context);
     }
 
     throw std::runtime_error("Unable to add objects"s);
@@ -168,6 +174,11 @@ ObjectHolder Add::Execute(runtime::Closure& closure, runtime::Context& context)
 ObjectHolder Sub::Execute(runtime::Closure& closure, runtime::Context& context) {
     runtime::ObjectHolder lhs = lhs_.get()->Execute(closure, context);
     runtime::ObjectHolder rhs = rhs_.get()->Execute(closure, context);
+    return Apply(lhs, rhs, context);
+}
+
+ObjectHolder Sub::Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                        [[maybe_unused]] runtime::Context& context) {
 
     if (runtime::Number *left = lhs.TryAs<runtime::Number>(),
         *right = rhs.TryAs<runtime::Number>();
@@ -181,6 +192,11 @@ ObjectHolder Sub::Execute(runtime::Closure& closure, runtime::Context& context)
 ObjectHolder Mult::Execute(runtime::Closure& closure, runtime::Context& context) {
     runtime::ObjectHolder lhs = lhs_.get()->Execute(closure, context);
     runtime::ObjectHolder rhs = rhs_.get()->Execute(closure, context);
+    return Apply(lhs, rhs, context);
+}
+
+ObjectHolder Mult::Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                         [[maybe_unused]] runtime::Context& context) {
 
     if (runtime::Number *left = lhs.TryAs<runtime::Number>(),
         *right = rhs.TryAs<runtime::Number>();
@@ -194,6 +210,11 @@ ObjectHolder Mult::Execute(runtime::Closure& closure, runtime::Context& context)
 ObjectHolder Div::Execute(runtime::Closure& closure, runtime::Context& context) {
     runtime::ObjectHolder lhs = lhs_.get()->Execute(closure, context);
     runtime::ObjectHolder rhs = rhs_.get()->Execute(closure, context);
+    return Apply(lhs, rhs, context);
+}
+
+ObjectHolder Div::Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                        [[maybe_unused]] runtime::Context& context) {
 
     if (runtime::Number *left = lhs.TryAs<runtime::Number>(),
         *right = rhs.TryAs<runtime::Number>();
@@ -225,13 +246,13 @@ ClassDefinition::ClassDefinition(runtime::ObjectHolder cls)
 }
 
 ObjectHolder ClassDefinition::Execute(runtime::Closure& closure, [[maybe_unused]] runtime::Context& context) {
-    std::string class_name = cls_.TryAs<runtime::Class>()->GetName();
+    const symbols::Symbol class_name = cls_.TryAs<runtime::Class>()->GetName();
     closure[class_name] = cls_;
     return closure[class_name];
 }
 
-FieldAssignment::FieldAssignment(VariableValue object, std::string field_name, std::shared_ptr<Statement> rv)
-:  object_(object), field_name_(field_name), rv_(rv) {
+FieldAssignment::FieldAssignment(VariableValue object, symbols::Symbol field_name, std::unique_ptr<Statement> rv)
+:  object_(object), field_name_(field_name), rv_(std::move(rv)) {
 
 }
 
@@ -252,10 +273,7 @@ IfElse::IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement>
 }
 
 ObjectHolder IfElse::Execute(runtime::Closure& closure, runtime::Context& context) {     
-    std::ostringstream out;
-    condition_.get()->Execute(closure, context).Get()->Print(out, context);
-
-    if (out.str() == "True"s || out.str() == "1"s){
+    if (IsConditionTrue(condition_.get()->Execute(closure, context), context)){
         return if_body_.get()->Execute(closure, context);
     } else if (else_body_.get()){   
         return else_body_.get()->Execute(closure, context);
@@ -264,9 +282,29 @@ ObjectHolder IfElse::Execute(runtime::Closure& closure, runtime::Context& contex
     }
 }
 
+bool IfElse::IsConditionTrue(const runtime::ObjectHolder& condition, runtime::Context& context) {
+    if (runtime::Bool* value = condition.TryAs<runtime::Bool>()){
+        return value->GetValue();
+    }
+    if (runtime::Number* value = condition.TryAs<runtime::Number>()){
+        return value->GetValue() == 1;
+    }
+    if (!condition.Get()){
+        throw std::runtime_error("Condition is None"s);
+    }
+    std::ostringstream out;
+    condition.Get()->Print(out, context);
+    return out.str() == "True"s || out.str() == "1"s;
+}
+
 ObjectHolder Or::Execute(runtime::Closure& closure, runtime::Context& context) {
     runtime::ObjectHolder lhs = lhs_.get()->Execute(closure, context);
     runtime::ObjectHolder rhs = rhs_.get()->Execute(closure, context);
+    return Apply(lhs, rhs, context);
+}
+
+ObjectHolder Or::Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                       [[maybe_unused]] runtime::Context& context) {
 
     if (runtime::Bool *left = lhs.TryAs<runtime::Bool>(); left && left->GetValue()){         
         return runtime::ObjectHolder::Own<runtime::Bool>(true);
@@ -279,6 +317,11 @@ ObjectHolder Or::Execute(runtime::Closure& closure, runtime::Context& context) {
 ObjectHolder And::Execute(runtime::Closure& closure, runtime::Context& context) {
     runtime::ObjectHolder lhs = lhs_.get()->Execute(closure, context);
     runtime::ObjectHolder rhs = rhs_.get()->Execute(closure, context);
+    return Apply(lhs, rhs, context);
+}
+
+ObjectHolder And::Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                        [[maybe_unused]] runtime::Context& context) {
 
     if (runtime::Bool *left = lhs.TryAs<runtime::Bool>();
         !left || !left->GetValue()){     
@@ -291,7 +334,11 @@ ObjectHolder And::Execute(runtime::Closure& closure, runtime::Context& context)
 }
 
 ObjectHolder Not::Execute(runtime::Closure& closure, runtime::Context& context) {        
-    return runtime::ObjectHolder::Own<runtime::Bool>(!(statement_.get()->Execute(closure, context).TryAs<runtime::Bool>()->GetValue()));
+    return Apply(statement_.get()->Execute(closure, context), context);
+}
+
+ObjectHolder Not::Apply(const runtime::ObjectHolder& arg, [[maybe_unused]] runtime::Context& context) {
+    return runtime::ObjectHolder::Own<runtime::Bool>(!(arg.TryAs<runtime::Bool>()->GetValue()));
 }
 
 Comparison::Comparison(Comparator cmp, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs)
@@ -322,7 +369,7 @@ NewInstance::NewInstance(const runtime::Class& class_, std::vector<std::unique_p
 
 ObjectHolder NewInstance::Execute([[maybe_unused]] runtime::Closure& closure, [[maybe_unused]] runtime::Context& context) {
     if (runtime::ClassInstance* instance = obj_.TryAs<runtime::ClassInstance>();
-        instance && instance->HasMethod(INIT_METHOD, args_.size())){         
+        instance && instance->HasMethod(runtime::names::INIT, args_.size())){         
         std::vector<runtime::ObjectHolder> args_to_pass;
 
         args_to_pass.reserve(args_.size());
@@ -330,7 +377,7 @@ ObjectHolder NewInstance::Execute([[maybe_unused]] runtime::Closure& closure, [[
             args_to_pass.push_back(args_.at(i).get()->Execute(closure, context));
         }
 
-        instance->Call(INIT_METHOD, args_to_pass, context);
+        instance->Call(runtime::names::INIT, args_to_pass, context);
     }
 
     return obj_;
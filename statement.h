@@ -6,6 +6,10 @@
 
 namespace ast {
 
+// Место профиля исполнения (profile.h). Узлы, которые бывают местами профиля, хранят
+// в поле profile_site_ место, сопоставленное им ProgramProfile после разбора
+struct SiteProfile;
+
 class ObjectThrow : public std::exception{
 public:
     ObjectThrow(runtime::ObjectHolder obj);
@@ -33,7 +37,6 @@ public:
         return runtime::ObjectHolder::Share(value_);
     }
 
-private:
     T value_;
 };
 
@@ -48,41 +51,39 @@ x = circle.center.x
 */
 class VariableValue : public Statement {
 public:
-    explicit VariableValue(const std::string& var_name);
+    explicit VariableValue(symbols::Symbol var_name);
 
-    explicit VariableValue(std::vector<std::string> dotted_ids);
+    explicit VariableValue(std::vector<symbols::Symbol> dotted_ids);
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, [[maybe_unused]]runtime::Context& context) override;
 
-private:
     std::string var_name_;
-    std::vector<std::string> dotted_ids_;
+    std::vector<symbols::Symbol> dotted_ids_;
 
 };
 
 // Присваивает переменной, имя которой задано в параметре var, значение выражения rv
 class Assignment : public Statement {
 public:
-    Assignment(std::string var, std::shared_ptr<Statement> rv);
+    Assignment(symbols::Symbol var, std::unique_ptr<Statement> rv);
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
-    std::string var_;
-    std::shared_ptr<Statement> rv_;
+    symbols::Symbol var_;
+    std::unique_ptr<Statement> rv_;
 };
 
 
 // Присваивает полю object.field_name значение выражения rv
 class FieldAssignment : public Statement {
 public:
-    FieldAssignment(VariableValue object, std::string field_name, std::shared_ptr<Statement> rv);
+    FieldAssignment(VariableValue object, symbols::Symbol field_name, std::unique_ptr<Statement> rv);
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
     VariableValue object_;
-    std::string field_name_;
-    std::shared_ptr<Statement> rv_;
+    symbols::Symbol field_name_;
+    std::unique_ptr<Statement> rv_;
 };
 
 // Значение None
@@ -97,7 +98,7 @@ public:
 // Команда print
 class Print : public Statement {
 public:
-    Print(std::string name)
+    Print(symbols::Symbol name)
         : name_(name) {
 
     }
@@ -109,32 +110,33 @@ public:
     explicit Print(std::vector<std::unique_ptr<Statement>> args);
 
     // Инициализирует команду print для вывода значения переменной name
-    static std::unique_ptr<Print> Variable(const std::string& name);
+    static std::unique_ptr<Print> Variable(symbols::Symbol name);
 
     // Во время выполнения команды print вывод должен осуществляться в поток, возвращаемый из
     // context.GetOutputStream()
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
+    // Выводит значение obj (либо None) в поток вывода контекста
+    static void PrintObject(const runtime::ObjectHolder& obj, runtime::Context& context);
+
     std::unique_ptr<Statement> argument_;
     std::vector<std::unique_ptr<Statement>> args_;
-    std::string name_;
+    symbols::Symbol name_;
    
 };
 
 // Вызывает метод object.method со списком параметров args
 class MethodCall : public Statement {
 public:
-    MethodCall(std::unique_ptr<Statement> object, std::string method,
+    MethodCall(std::unique_ptr<Statement> object, symbols::Symbol method,
                std::vector<std::unique_ptr<Statement>> args);
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
     std::unique_ptr<Statement> object_;
-    std::string method_;
+    symbols::Symbol method_;
     std::vector<std::unique_ptr<Statement>> args_;
-
+    const SiteProfile* profile_site_ = nullptr;
 };
 
 /*
@@ -159,7 +161,6 @@ public:
     // Возвращает объект, содержащий значение типа ClassInstance
     runtime::ObjectHolder Execute([[maybe_unused]] runtime::Closure& closure, [[maybe_unused]] runtime::Context& context) override;
 
-private:
     runtime::ObjectHolder obj_;
     std::vector<std::unique_ptr<Statement>> args_;
 };
@@ -181,6 +182,9 @@ public:
     using UnaryOperation::UnaryOperation;
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // Вычисляет результат операции над уже вычисленным аргументом
+    static runtime::ObjectHolder Apply(const runtime::ObjectHolder& arg, runtime::Context& context);
 };
 
 // Родительский класс Бинарная операция с аргументами lhs и rhs
@@ -193,6 +197,7 @@ public:
 
     std::unique_ptr<Statement> lhs_;
     std::unique_ptr<Statement> rhs_;
+    const SiteProfile* profile_site_ = nullptr;
 };
 
 // Возвращает результат операции + над аргументами lhs и rhs
@@ -206,6 +211,10 @@ public:
     //  объект1 + объект2, если у объект1 - пользовательский класс с методом _add__(rhs)
     // В противном случае при вычислении выбрасывается runtime_error
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // Вычисляет результат операции над уже вычисленными аргументами
+    static runtime::ObjectHolder Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                       runtime::Context& context);
 };
 
 // Возвращает результат вычитания аргументов lhs и rhs
@@ -217,6 +226,10 @@ public:
     //  число - число
     // Если lhs и rhs - не числа, выбрасывается исключение runtime_error
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // Вычисляет результат операции над уже вычисленными аргументами
+    static runtime::ObjectHolder Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                       runtime::Context& context);
 };
 
 // Возвращает результат умножения аргументов lhs и rhs
@@ -228,6 +241,10 @@ public:
     //  число * число
     // Если lhs и rhs - не числа, выбрасывается исключение runtime_error
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // Вычисляет результат операции над уже вычисленными аргументами
+    static runtime::ObjectHolder Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                       runtime::Context& context);
 };
 
 // Возвращает результат деления lhs и rhs
@@ -240,6 +257,10 @@ public:
     // Если lhs и rhs - не числа, выбрасывается исключение runtime_error
     // Если rhs равен 0, выбрасывается исключение runtime_error
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // Вычисляет результат операции над уже вычисленными аргументами
+    static runtime::ObjectHolder Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                       runtime::Context& context);
 };
 
 // Возвращает результат вычисления логической операции or над lhs и rhs
@@ -249,6 +270,10 @@ public:
     // Значение аргумента rhs вычисляется, только если значение lhs
     // после приведения к Bool равно False
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // Вычисляет результат операции над уже вычисленными аргументами
+    static runtime::ObjectHolder Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                       runtime::Context& context);
 };
 
 // Возвращает результат вычисления логической операции and над lhs и rhs
@@ -258,6 +283,10 @@ public:
     // Значение аргумента rhs вычисляется, только если значение lhs
     // после приведения к Bool равно True
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // Вычисляет результат операции над уже вычисленными аргументами
+    static runtime::ObjectHolder Apply(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs,
+                                       runtime::Context& context);
 };
 
 // Возвращает результат вычисления логической операции not над единственным аргументом операции
@@ -266,6 +295,9 @@ public:
     using UnaryOperation::UnaryOperation;
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // Вычисляет результат операции над уже вычисленным аргументом
+    static runtime::ObjectHolder Apply(const runtime::ObjectHolder& arg, runtime::Context& context);
 };
 
 // Составная инструкция (например: тело метода, содержимое ветки if, либо else)
@@ -286,9 +318,9 @@ public:
     // Последовательно выполняет добавленные инструкции. Возвращает None
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
     std::vector<std::unique_ptr<Statement>> args_;
 
+private:
     template <typename Arg, typename... Args>
     void ExtractArgs_(Arg&& arg, Args&&... args){
         args_.push_back(std::move(arg));
@@ -309,9 +341,8 @@ public:
     // В противном случае возвращает None
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
     std::unique_ptr<Statement> body_;
-
+    const SiteProfile* profile_site_ = nullptr;
 };
 
 // Выполняет инструкцию return с выражением statement
@@ -326,7 +357,6 @@ public:
     // внутри которого она была исполнена, должен вернуть результат вычисления выражения statement.
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
     std::unique_ptr<Statement> statement_;
 
 };
@@ -341,7 +371,6 @@ public:
     // конструктор
     runtime::ObjectHolder Execute(runtime::Closure& closure, [[maybe_unused]] runtime::Context& context) override;
 
-private:
     runtime::ObjectHolder cls_;
 
 };
@@ -355,11 +384,13 @@ public:
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
+    // Возвращает true, если значение условия приводится к True
+    static bool IsConditionTrue(const runtime::ObjectHolder& condition, runtime::Context& context);
+
     std::unique_ptr<Statement> condition_;
     std::unique_ptr<Statement> if_body_;
     std::unique_ptr<Statement> else_body_;
-    
+    const SiteProfile* profile_site_ = nullptr;
 };
 
 // Операция сравнения
@@ -375,7 +406,6 @@ public:
     // приведённый к типу runtime::Bool
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
     Comparator cmp_;
 
 };
@@ -129,7 +129,7 @@ void TestFieldAssignment() {
     ObjectHolder b = assign_y.Execute(closure, context);
     ASSERT(object.Fields().find("y"s) != object.Fields().end());
     FieldAssignment assign_yz(
-        VariableValue{vector<string>{"self"s, "y"s}}, "z"s,
+        VariableValue{vector<symbols::Symbol>{"self"s, "y"s}}, "z"s,
         make_unique<StringConst>(runtime::String("Hello, world! Hooray! Yes-yes!!!"s)));
     {
         ObjectHolder o = assign_yz.Execute(closure, context);        
@@ -318,13 +318,13 @@ void TestFields() {
                        {make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
                                                      make_unique<NumericConst>(0))}});
     methods.push_back(
-        {"value"s, {}, {make_unique<VariableValue>(vector<string>{"self"s, "value"s})}});
+        {"value"s, {}, {make_unique<VariableValue>(vector<symbols::Symbol>{"self"s, "value"s})}});
     methods.push_back(
         {"add"s,
          {"x"s},
          {make_unique<FieldAssignment>(
              VariableValue{"self"s}, "value"s,
-             make_unique<Add>(make_unique<VariableValue>(vector<string>{"self"s, "value"s}),
+             make_unique<Add>(make_unique<VariableValue>(vector<symbols::Symbol>{"self"s, "value"s}),
                               make_unique<VariableValue>("x"s)))}});
 
     runtime::Class cls("BoxedValue"s, std::move(methods), nullptr);
@@ -346,7 +346,7 @@ void TestFields() {
 
 void TestBaseClass() {
     vector<runtime::Method> methods;
-    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector{"self"s, "value"s})});
+    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector<symbols::Symbol>{"self"s, "value"s})});
     methods.push_back({"SetValue"s,
                        {"x"s},
                        make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
@@ -372,7 +372,7 @@ void TestBaseClass() {
 
 void TestInheritance() {
     vector<runtime::Method> methods;
-    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector{"self"s, "value"s})});
+    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector<symbols::Symbol>{"self"s, "value"s})});
     methods.push_back({"SetValue"s,
                        {"x"s},
                        make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
@@ -0,0 +1,373 @@
+#include "superinstructions.h"
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+ObjectHolder ApplyDelta(char op, const ObjectHolder& value, const ObjectHolder& delta,
+                        Context& context) {
+    if (auto* lhs = value.TryAs<runtime::Number>()){
+        if (auto* rhs = delta.TryAs<runtime::Number>()){
+            return ObjectHolder::Own(runtime::Number(
+                op == '+' ? lhs->GetValue() + rhs->GetValue() : lhs->GetValue() - rhs->GetValue()));
+        }
+    }
+    return op == '+' ? Add::Apply(value, delta, context) : Sub::Apply(value, delta, context);
+}
+
+bool IsSingleVariable(const Statement& node) {
+    auto* var = dynamic_cast<const VariableValue*>(&node);
+    return var && var->dotted_ids_.size() == 1;
+}
+
+bool IsSimpleOperand(const Statement& node) {
+    return IsSingleVariable(node) || dynamic_cast<const NumericConst*>(&node)
+        || dynamic_cast<const StringConst*>(&node) || dynamic_cast<const BoolConst*>(&node);
+}
+
+// Возвращает операцию '+'/'-' и операнды, если node - это Add или Sub
+char SplitAdditive(Statement& node, unique_ptr<Statement>*& lhs, unique_ptr<Statement>*& rhs) {
+    if (auto* add = dynamic_cast<Add*>(&node)){
+        lhs = &add->lhs_;
+        rhs = &add->rhs_;
+        return '+';
+    }
+    if (auto* sub = dynamic_cast<Sub*>(&node)){
+        lhs = &sub->lhs_;
+        rhs = &sub->rhs_;
+        return '-';
+    }
+    return 0;
+}
+
+class Fuser : public Rewriter {
+public:
+    FusionStats stats;
+
+protected:
+    void Leave(unique_ptr<Statement>& node) override {
+        if (auto* field = dynamic_cast<FieldAssignment*>(node.get())){
+            TryFuseFieldUpdate(node, *field);
+        } else if (auto* if_else = dynamic_cast<IfElse*>(node.get())){
+            TryFuseCompareBranch(node, *if_else);
+        } else if (auto* ret = dynamic_cast<Return*>(node.get())){
+            TryFuseReturnCall(node, *ret);
+        } else if (auto* print = dynamic_cast<Print*>(node.get())){
+            TryFusePrint(node, *print);
+        }
+    }
+
+private:
+    void TryFuseFieldUpdate(unique_ptr<Statement>& node, FieldAssignment& field) {
+        unique_ptr<Statement>* lhs = nullptr;
+        unique_ptr<Statement>* rhs = nullptr;
+        char op = SplitAdditive(*field.rv_, lhs, rhs);
+        if (!op || (!IsSingleVariable(**rhs) && !dynamic_cast<NumericConst*>(rhs->get()))){
+            return;
+        }
+
+        auto* read = dynamic_cast<VariableValue*>(lhs->get());
+        vector<symbols::Symbol> expected = field.object_.dotted_ids_;
+        expected.push_back(field.field_name_);
+        if (!read || read->dotted_ids_ != expected){
+            return;
+        }
+
+        node = make_unique<FieldUpdate>(std::move(field.object_), std::move(field.field_name_), op,
+                                        FusedOperand(std::move(*rhs)));
+        stats.field_updates++;
+    }
+
+    void TryFuseCompareBranch(unique_ptr<Statement>& node, IfElse& if_else) {
+        auto* cmp = dynamic_cast<Comparison*>(if_else.condition_.get());
+        if (!cmp || !GetCompareFunction(cmp->cmp_)){
+            return;
+        }
+        node = make_unique<CompareBranch>(GetCompareFunction(cmp->cmp_),
+                                          FusedOperand(std::move(cmp->lhs_)),
+                                          FusedOperand(std::move(cmp->rhs_)),
+                                          std::move(if_else.if_body_), std::move(if_else.else_body_));
+        stats.compare_branches++;
+    }
+
+    void TryFuseReturnCall(unique_ptr<Statement>& node, Return& ret) {
+        auto* call = dynamic_cast<MethodCall*>(ret.statement_.get());
+        if (!call){
+            return;
+        }
+
+        vector<FusedArgument> args;
+        args.reserve(call->args_.size());
+        for (auto& arg : call->args_){
+            unique_ptr<Statement>* lhs = nullptr;
+            unique_ptr<Statement>* rhs = nullptr;
+            char op = SplitAdditive(*arg, lhs, rhs);
+            if (auto* delta = op ? dynamic_cast<NumericConst*>(rhs->get()) : nullptr){
+                args.emplace_back(FusedOperand(std::move(*lhs)), op, delta->value_);
+            } else {
+                args.emplace_back(FusedOperand(std::move(arg)), 0, runtime::Number(0));
+            }
+        }
+        node = make_unique<ReturnCall>(std::move(call->object_), std::move(call->method_),
+                                       std::move(args));
+        stats.return_calls++;
+    }
+
+    void TryFusePrint(unique_ptr<Statement>& node, Print& print) {
+        if (print.args_.size() != 1 || !IsSingleVariable(*print.args_.front())){
+            return;
+        }
+        auto& var = static_cast<VariableValue&>(*print.args_.front());
+        node = make_unique<PrintVariable>(std::move(var.dotted_ids_.front()));
+        stats.prints++;
+    }
+};
+
+}  // namespace
+
+FusedOperand::FusedOperand(unique_ptr<Statement> expr)
+    : expr_(std::move(expr)) {
+    Analyze();
+}
+
+void FusedOperand::Analyze() {
+    name_ = nullptr;
+    constant_ = {};
+    if (IsSingleVariable(*expr_)){
+        name_ = &static_cast<VariableValue&>(*expr_).dotted_ids_.front();
+    } else if (auto* num = dynamic_cast<NumericConst*>(expr_.get())){
+        constant_ = ObjectHolder::Share(num->value_);
+    } else if (auto* str = dynamic_cast<StringConst*>(expr_.get())){
+        constant_ = ObjectHolder::Share(str->value_);
+    } else if (auto* boolean = dynamic_cast<BoolConst*>(expr_.get())){
+        constant_ = ObjectHolder::Share(boolean->value_);
+    }
+}
+
+const ObjectHolder& FusedOperand::Get(Closure& closure, Context& context, ObjectHolder& tmp) {
+    if (name_){
+        auto it = closure.find(*name_);
+        if (it == closure.end()){
+            throw std::runtime_error("Unknown variable"s);
+        }
+        return it->second;
+    }
+    if (constant_){
+        return constant_;
+    }
+    tmp = expr_->Execute(closure, context);
+    return tmp;
+}
+
+bool FusedOperand::IsSimple() const {
+    return IsSimpleOperand(*expr_);
+}
+
+void FusedOperand::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(expr_);
+    Analyze();
+}
+
+optional<FusedOperand> FusedOperand::Clone() const {
+    auto expr = ast::Clone(*expr_);
+    if (!expr){
+        return nullopt;
+    }
+    return FusedOperand(std::move(expr));
+}
+
+FusedArgument::FusedArgument(FusedOperand operand, char op, runtime::Number delta)
+    : operand_(std::move(operand)), op_(op), delta_(std::move(delta)) {
+
+}
+
+ObjectHolder FusedArgument::Evaluate(Closure& closure, Context& context) {
+    ObjectHolder tmp;
+    const ObjectHolder& value = operand_.Get(closure, context, tmp);
+    if (!op_){
+        return value;
+    }
+    return ApplyDelta(op_, value, ObjectHolder::Share(delta_), context);
+}
+
+FieldUpdate::FieldUpdate(VariableValue object, symbols::Symbol field_name, char op, FusedOperand value)
+    : object_(std::move(object)), field_name_(std::move(field_name)), op_(op),
+    value_(std::move(value)) {
+
+}
+
+ObjectHolder FieldUpdate::Execute(Closure& closure, Context& context) {
+    ObjectHolder object = object_.Execute(closure, context);
+    auto* instance = object.TryAs<runtime::ClassInstance>();
+    if (!instance){
+        return closure[field_name_];
+    }
+
+    Closure& fields = instance->Fields();
+    auto it = fields.find(field_name_);
+    if (it == fields.end()){
+        throw std::runtime_error("Unknown variable"s);
+    }
+    // Ссылки на элементы unordered_map остаются действительными при вставке новых полей
+    ObjectHolder& slot = it->second;
+
+    ObjectHolder tmp;
+    const ObjectHolder& value = value_.Get(closure, context, tmp);
+    slot = ApplyDelta(op_, slot, value, context);
+    return slot;
+}
+
+void FieldUpdate::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    value_.ForEachChild(fn);
+}
+
+unique_ptr<Statement> FieldUpdate::Clone() const {
+    auto value = value_.Clone();
+    if (!value){
+        return nullptr;
+    }
+    return make_unique<FieldUpdate>(object_, field_name_, op_, std::move(*value));
+}
+
+CompareBranch::CompareBranch(CompareFunction cmp, FusedOperand lhs, FusedOperand rhs,
+                             unique_ptr<Statement> if_body, unique_ptr<Statement> else_body)
+    : cmp_(cmp), int_cmp_(GetIntCompareFunction(cmp)), lhs_(std::move(lhs)), rhs_(std::move(rhs)),
+    if_body_(std::move(if_body)), else_body_(std::move(else_body)) {
+
+}
+
+ObjectHolder CompareBranch::Execute(Closure& closure, Context& context) {
+    ObjectHolder lhs_tmp;
+    ObjectHolder rhs_tmp;
+    const ObjectHolder* lhs = &lhs_.Get(closure, context, lhs_tmp);
+    if (!rhs_.IsSimple() && lhs != &lhs_tmp){
+        // Вычисление rhs может изменить переменную, на которую ссылается lhs
+        lhs_tmp = *lhs;
+        lhs = &lhs_tmp;
+    }
+    const ObjectHolder& rhs = rhs_.Get(closure, context, rhs_tmp);
+
+    bool result;
+    auto* left = lhs->TryAs<runtime::Number>();
+    auto* right = rhs.TryAs<runtime::Number>();
+    if (int_cmp_ && left && right){
+        result = int_cmp_(left->GetValue(), right->GetValue());
+    } else {
+        result = cmp_(*lhs, rhs, context);
+    }
+
+    if (result){
+        return if_body_->Execute(closure, context);
+    } else if (else_body_){
+        return else_body_->Execute(closure, context);
+    }
+    return {};
+}
+
+void CompareBranch::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    lhs_.ForEachChild(fn);
+    rhs_.ForEachChild(fn);
+    fn(if_body_);
+    if (else_body_){
+        fn(else_body_);
+    }
+}
+
+unique_ptr<Statement> CompareBranch::Clone() const {
+    auto lhs = lhs_.Clone();
+    auto rhs = rhs_.Clone();
+    auto if_body = ast::Clone(*if_body_);
+    unique_ptr<Statement> else_body;
+    if (else_body_){
+        else_body = ast::Clone(*else_body_);
+        if (!else_body){
+            return nullptr;
+        }
+    }
+    if (!lhs || !rhs || !if_body){
+        return nullptr;
+    }
+    return make_unique<CompareBranch>(cmp_, std::move(*lhs), std::move(*rhs), std::move(if_body),
+                                      std::move(else_body));
+}
+
+ReturnCall::ReturnCall(unique_ptr<Statement> object, symbols::Symbol method, vector<FusedArgument> args)
+    : object_(std::move(object)), method_(std::move(method)), args_(std::move(args)) {
+
+}
+
+ObjectHolder ReturnCall::Execute(Closure& closure, Context& context) {
+    ObjectHolder object = object_->Execute(closure, context);
+    auto* instance = object.TryAs<runtime::ClassInstance>();
+    if (!instance || !instance->HasMethod(method_, args_.size())){
+        throw ObjectThrow(ObjectHolder::None());
+    }
+
+    vector<ObjectHolder> args;
+    args.reserve(args_.size());
+    for (FusedArgument& arg : args_){
+        args.push_back(arg.Evaluate(closure, context));
+    }
+    throw ObjectThrow(instance->Call(method_, args, context));
+}
+
+void ReturnCall::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(object_);
+    for (FusedArgument& arg : args_){
+        arg.operand_.ForEachChild(fn);
+    }
+}
+
+unique_ptr<Statement> ReturnCall::Clone() const {
+    auto object = ast::Clone(*object_);
+    if (!object){
+        return nullptr;
+    }
+    vector<FusedArgument> args;
+    args.reserve(args_.size());
+    for (const FusedArgument& arg : args_){
+        auto operand = arg.operand_.Clone();
+        if (!operand){
+            return nullptr;
+        }
+        args.emplace_back(std::move(*operand), arg.op_, arg.delta_);
+    }
+    return make_unique<ReturnCall>(std::move(object), method_, std::move(args));
+}
+
+PrintVariable::PrintVariable(symbols::Symbol name)
+    : name_(std::move(name)) {
+
+}
+
+ObjectHolder PrintVariable::Execute(Closure& closure, Context& context) {
+    auto it = closure.find(name_);
+    if (it == closure.end()){
+        throw std::runtime_error("Unknown variable"s);
+    }
+    Print::PrintObject(it->second, context);
+    context.GetOutputStream() << std::endl;
+    return ObjectHolder::None();
+}
+
+void PrintVariable::ForEachChild([[maybe_unused]] const function<void(unique_ptr<Statement>&)>& fn) {
+
+}
+
+unique_ptr<Statement> PrintVariable::Clone() const {
+    return make_unique<PrintVariable>(name_);
+}
+
+FusionStats FuseSuperinstructions(unique_ptr<Statement>& program) {
+    Fuser fuser;
+    fuser.Rewrite(program);
+    return fuser.stats;
+}
+
+}  // namespace ast
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ast_utils.h"
+#include "statement.h"
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+Слитые инструкции (superinstructions) для частых шаблонов Mython-программ.
+Каждая такая инструкция выполняет работу нескольких узлов дерева за одну
+диспетчеризацию и не создаёт промежуточных ObjectHolder для операндов.
+Выражения операндов и ветки доступны обходам через ForEachChild.
+*/
+namespace ast {
+
+// Операнд слитой инструкции: простая переменная, константа либо произвольное выражение
+class FusedOperand {
+public:
+    explicit FusedOperand(std::unique_ptr<Statement> expr);
+
+    // Возвращает ссылку на значение операнда. Значение произвольного выражения
+    // сохраняется в tmp, значения переменных и констант не копируются
+    const runtime::ObjectHolder& Get(runtime::Closure& closure, runtime::Context& context,
+                                     runtime::ObjectHolder& tmp);
+
+    // Возвращает true, если вычисление операнда не имеет побочных эффектов
+    [[nodiscard]] bool IsSimple() const;
+
+    // Передаёт выражение операнда fn и обновляет сведения о нём: fn может заменить выражение
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn);
+
+    // Возвращает копию операнда либо std::nullopt, если выражение не поддерживает копирование
+    [[nodiscard]] std::optional<FusedOperand> Clone() const;
+
+    std::unique_ptr<Statement> expr_;
+    // Имя переменной, если операнд - переменная без точек
+    const symbols::Symbol* name_ = nullptr;
+    // Значение, если операнд - константа
+    runtime::ObjectHolder constant_;
+
+private:
+    // Заполняет name_ и constant_ по выражению expr_
+    void Analyze();
+};
+
+// Аргумент слитого вызова: операнд, к которому, возможно, прибавляется константа
+class FusedArgument {
+public:
+    // op - '+' или '-' для выражений вида x + k и x - k, либо 0 для прочих выражений
+    FusedArgument(FusedOperand operand, char op, runtime::Number delta);
+
+    runtime::ObjectHolder Evaluate(runtime::Closure& closure, runtime::Context& context);
+
+    FusedOperand operand_;
+    char op_;
+    runtime::Number delta_;
+};
+
+// object.field = object.field + value (либо - value), где value - переменная или константа
+class FieldUpdate : public Statement, public CompositeNode {
+public:
+    FieldUpdate(VariableValue object, symbols::Symbol field_name, char op, FusedOperand value);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    [[nodiscard]] std::unique_ptr<Statement> Clone() const override;
+
+    VariableValue object_;
+    symbols::Symbol field_name_;
+    char op_;
+    FusedOperand value_;
+};
+
+// if lhs <cmp> rhs: if_body else: else_body без создания промежуточного Bool
+class CompareBranch : public Statement, public CompositeNode {
+public:
+    CompareBranch(CompareFunction cmp, FusedOperand lhs, FusedOperand rhs,
+                  std::unique_ptr<Statement> if_body, std::unique_ptr<Statement> else_body);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    [[nodiscard]] std::unique_ptr<Statement> Clone() const override;
+
+    CompareFunction cmp_;
+    // Сравнение целых чисел, соответствующее cmp_
+    IntCompareFunction int_cmp_;
+    FusedOperand lhs_;
+    FusedOperand rhs_;
+    std::unique_ptr<Statement> if_body_;
+    std::unique_ptr<Statement> else_body_;
+};
+
+// return object.method(args)
+class ReturnCall : public Statement, public CompositeNode {
+public:
+    ReturnCall(std::unique_ptr<Statement> object, symbols::Symbol method,
+               std::vector<FusedArgument> args);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    [[nodiscard]] std::unique_ptr<Statement> Clone() const override;
+
+    std::unique_ptr<Statement> object_;
+    symbols::Symbol method_;
+    std::vector<FusedArgument> args_;
+};
+
+// print name для единственной переменной
+class PrintVariable : public Statement, public CompositeNode {
+public:
+    explicit PrintVariable(symbols::Symbol name);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    [[nodiscard]] std::unique_ptr<Statement> Clone() const override;
+
+    symbols::Symbol name_;
+};
+
+// Количество узлов, заменённых слитыми инструкциями каждого вида
+struct FusionStats {
+    size_t field_updates = 0;
+    size_t compare_branches = 0;
+    size_t return_calls = 0;
+    size_t prints = 0;
+
+    [[nodiscard]] size_t Total() const {
+        return field_updates + compare_branches + return_calls + prints;
+    }
+};
+
+// Заменяет в дереве program (включая тела методов классов) распознанные шаблоны
+// слитыми инструкциями
+FusionStats FuseSuperinstructions(std::unique_ptr<Statement>& program);
+
+}  // namespace ast
@@ -0,0 +1,157 @@
+#include "ast_utils.h"
+#include "parse.h"
+#include "pass_manager.h"
+#include "superinstructions.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+void TestFieldUpdate() {
+    const string program = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+    self.name = 'c'
+
+  def add(k):
+    self.value = self.value + k
+    self.value = self.value - 1
+    self.value = self.value + 10
+    self.name = self.name + 'x'
+
+x = Counter()
+x.add(5)
+x.add(2)
+print x.value, x.name
+)"s;
+    FusionStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, FuseSuperinstructions, stats), "25 cxx\n"s);
+    ASSERT_EQUAL(stats.field_updates, 3U);
+}
+
+void TestFieldUpdateUsesAddMethod() {
+    const string program = R"(
+class Money:
+  def __init__(v):
+    self.v = v
+
+  def __add__(rhs):
+    return str(self.v + rhs) + '$'
+
+class Wallet:
+  def __init__():
+    self.money = Money(1)
+
+  def put(k):
+    self.money = self.money + k
+
+w = Wallet()
+w.put(5)
+print w.money
+)"s;
+    FusionStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, FuseSuperinstructions, stats), "6$\n"s);
+    ASSERT_EQUAL(stats.field_updates, 1U);
+}
+
+void TestCompareBranchAndReturnCall() {
+    const string program = R"(
+class GCD:
+  def calc(a, b):
+    if a < b:
+      return self.calc(b, a)
+    if b == 0:
+      return a
+    return self.calc(a - b, b)
+
+class Fact:
+  def calc(n):
+    if n <= 1:
+      return 1
+    return n * self.calc(n - 1)
+
+x = GCD()
+f = Fact()
+s = 'abc'
+if s > 'abb':
+  print x.calc(510510, 18629977), f.calc(6)
+)"s;
+    FusionStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, FuseSuperinstructions, stats), "17 720\n"s);
+    ASSERT_EQUAL(stats.compare_branches, 4U);
+    ASSERT_EQUAL(stats.return_calls, 2U);
+}
+
+void TestPrintVariable() {
+    const string program = R"(
+x = 57
+y = None
+print x
+print y
+print x, y
+)"s;
+    FusionStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, FuseSuperinstructions, stats), "57\nNone\n57 None\n"s);
+    ASSERT_EQUAL(stats.prints, 2U);
+
+    auto tree = ParseFromString("print unknown\n"s);
+    FuseSuperinstructions(tree);
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    ASSERT_THROWS(tree->Execute(closure, context), std::runtime_error);
+}
+
+void TestFusedNodesAreTraversed() {
+    // Обходы заходят в операнды и ветки слитых инструкций, а копия дерева исполняется так же
+    const string program = R"(
+class Box:
+  def __init__():
+    self.n = 0
+
+  def twice(k):
+    return self.plus(k + k)
+
+  def plus(k):
+    self.n = self.n + k
+    return self.n
+
+x = 2
+if x < 3:
+  class Inner:
+    def get():
+      return 5
+  i = Inner()
+  print i.get()
+else:
+  print x
+b = Box()
+print b.twice(x)
+)"s;
+    auto tree = ParseFromString(program);
+    const size_t classes = CollectClasses(*tree).size();
+    const FusionStats stats = FuseSuperinstructions(tree);
+    ASSERT_EQUAL(stats.Total(), 4U);
+    ASSERT_EQUAL(CollectClasses(*tree).size(), classes);
+
+    auto copy = Clone(*tree);
+    ASSERT(copy != nullptr);
+    ASSERT_EQUAL(Execute(*copy), "5\n4\n"s);
+    ASSERT_EQUAL(Execute(*tree), "5\n4\n"s);
+}
+
+}  // namespace
+
+void RunSuperinstructionsTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestFieldUpdate);
+    RUN_TEST(tr, ast::TestFieldUpdateUsesAddMethod);
+    RUN_TEST(tr, ast::TestCompareBranchAndReturnCall);
+    RUN_TEST(tr, ast::TestPrintVariable);
+    RUN_TEST(tr, ast::TestFusedNodesAreTraversed);
+}
+
+}  // namespace ast
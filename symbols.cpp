@@ -0,0 +1,50 @@
+#include "symbols.h"
+
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace symbols {
+
+SymbolTable::SymbolTable(size_t capacity)
+    : capacity_(min(capacity, MAX_SIZE)) {
+    Intern(""sv);
+}
+
+SymbolId SymbolTable::Intern(string_view text) {
+    lock_guard lock(mutex_);
+    if (auto it = ids_.find(text); it != ids_.end()){
+        return it->second;
+    }
+    const size_t id = size_.load(memory_order_relaxed);
+    if (id >= capacity_){
+        throw length_error("Symbol table is full"s);
+    }
+    auto& chunk = chunks_[id >> CHUNK_BITS];
+    if (!chunk){
+        chunk = make_unique<string[]>(CHUNK_SIZE);
+    }
+    string& stored = chunk[id & (CHUNK_SIZE - 1)];
+    stored = text;
+    ids_.emplace(stored, static_cast<SymbolId>(id));
+    size_.store(id + 1, memory_order_release);
+    return static_cast<SymbolId>(id);
+}
+
+SymbolTable& Identifiers() {
+    static SymbolTable table;
+    return table;
+}
+
+SymbolTable& StringConstants() {
+    static SymbolTable table;
+    return table;
+}
+
+ostream& operator<<(ostream& out, Symbol symbol) {
+    return out << symbol.Str();
+}
+
+}  // namespace symbols
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+Интернирование строк: каждой различной строке таблица выдаёт номер, по которому
+текст можно получить обратно. Одинаковые строки получают один номер, поэтому
+строки сравниваются по номерам. Тексты хранятся, пока существует таблица, и не перемещаются.
+Таблицы Identifiers() и StringConstants() общие для всего процесса и не очищаются:
+каждая вмещает не более SymbolTable::MAX_SIZE различных строк за время работы процесса
+*/
+namespace symbols {
+
+using SymbolId = uint32_t;
+
+class SymbolTable {
+private:
+    // Тексты лежат в блоках фиксированного размера, которые не перемещаются при росте таблицы
+    static constexpr size_t CHUNK_BITS = 12;
+    static constexpr size_t CHUNK_SIZE = size_t{1} << CHUNK_BITS;
+    static constexpr size_t MAX_CHUNKS = 4096;
+
+public:
+    // Наибольшее количество строк в таблице, 2^24
+    static constexpr size_t MAX_SIZE = MAX_CHUNKS * CHUNK_SIZE;
+
+    // Таблица на capacity строк, не больше MAX_SIZE. Пустая строка всегда имеет номер 0
+    explicit SymbolTable(size_t capacity = MAX_SIZE);
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // Номер строки text. Выбрасывает std::length_error, если в таблице уже capacity строк.
+    // Можно вызывать из нескольких потоков
+    SymbolId Intern(std::string_view text);
+
+    // Текст строки с номером id, выданным Intern. Ссылка действительна, пока существует таблица.
+    // Безопасен одновременно с Intern из другого потока, если id получен до вызова
+    const std::string& Name(SymbolId id) const {
+        return chunks_[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+    }
+
+    // Количество различных строк в таблице
+    size_t Size() const {
+        return size_.load(std::memory_order_acquire);
+    }
+
+private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::unordered_map<std::string_view, SymbolId> ids_;
+    std::array<std::unique_ptr<std::string[]>, MAX_CHUNKS> chunks_;
+    std::atomic<size_t> size_ = 0;
+};
+
+// Таблица идентификаторов программы
+SymbolTable& Identifiers();
+
+// Таблица строковых констант программы
+SymbolTable& StringConstants();
+
+/*
+Имя из таблицы Identifiers(): идентификатор, имя метода, поля или параметра.
+Имена сравниваются и хешируются как целые числа. Имя создаётся из строки неявно,
+но каждое такое создание ищет строку в таблице, поэтому имена, используемые
+при исполнении программы, создаются заранее
+*/
+class Symbol {
+public:
+    // Пустое имя
+    Symbol() = default;
+
+    Symbol(std::string_view name)
+        : id_(Identifiers().Intern(name)) {
+    }
+
+    Symbol(const std::string& name)
+        : Symbol(std::string_view(name)) {
+    }
+
+    Symbol(const char* name)
+        : Symbol(std::string_view(name)) {
+    }
+
+    static Symbol FromId(SymbolId id) {
+        Symbol result;
+        result.id_ = id;
+        return result;
+    }
+
+    [[nodiscard]] SymbolId Id() const {
+        return id_;
+    }
+
+    [[nodiscard]] const std::string& Str() const {
+        return Identifiers().Name(id_);
+    }
+
+    [[nodiscard]] bool Empty() const {
+        return id_ == 0;
+    }
+
+private:
+    SymbolId id_ = 0;
+};
+
+inline bool operator==(Symbol lhs, Symbol rhs) {
+    return lhs.Id() == rhs.Id();
+}
+
+inline bool operator!=(Symbol lhs, Symbol rhs) {
+    return lhs.Id() != rhs.Id();
+}
+
+// Порядок номеров, а не алфавитный: имена, появившиеся раньше, меньше
+inline bool operator<(Symbol lhs, Symbol rhs) {
+    return lhs.Id() < rhs.Id();
+}
+
+std::ostream& operator<<(std::ostream& out, Symbol symbol);
+
+}  // namespace symbols
+
+template <>
+struct std::hash<symbols::Symbol> {
+    size_t operator()(symbols::Symbol symbol) const noexcept {
+        return symbol.Id();
+    }
+};
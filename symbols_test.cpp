@@ -0,0 +1,115 @@
+#include "symbols.h"
+#include "lexer.h"
+#include "test_runner_p.h"
+
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace symbols {
+
+namespace {
+
+void TestInternReturnsSameId() {
+    SymbolTable table;
+    const SymbolId x = table.Intern("x"sv);
+    const SymbolId y = table.Intern("y"sv);
+    ASSERT(x != y);
+    ASSERT_EQUAL(table.Intern(string("x")), x);
+    ASSERT_EQUAL(table.Name(x), "x"sv);
+    ASSERT_EQUAL(table.Name(y), "y"sv);
+    ASSERT_EQUAL(table.Size(), 3U);
+    ASSERT_EQUAL(table.Intern(""sv), 0U);
+}
+
+void TestNamesSurviveGrowth() {
+    SymbolTable table;
+    const string_view first = table.Name(table.Intern("first"sv));
+    const char* const first_data = first.data();
+    // Несколько блоков по 4096 строк
+    for (int i = 0; i < 10000; ++i){
+        ASSERT_EQUAL(table.Intern("name_"s + to_string(i)), static_cast<SymbolId>(i + 2));
+    }
+    ASSERT_EQUAL(table.Name(table.Intern("first"sv)).data(), first_data);
+    ASSERT_EQUAL(table.Name(9000), "name_8998"sv);
+}
+
+void TestCapacity() {
+    // Пустая строка занимает одно из трёх мест
+    SymbolTable table(3);
+    ASSERT_EQUAL(table.Intern("a"sv), 1U);
+    ASSERT_EQUAL(table.Intern("b"sv), 2U);
+    // Строки, уже находящиеся в полной таблице, по-прежнему выдаются
+    ASSERT_EQUAL(table.Intern("a"sv), 1U);
+    ASSERT_THROWS(table.Intern("c"sv), std::length_error);
+    ASSERT_EQUAL(table.Size(), 3U);
+}
+
+void TestConcurrentIntern() {
+    SymbolTable table;
+    constexpr int THREADS = 4;
+    constexpr int NAMES = 5000;
+    vector<vector<SymbolId>> ids(THREADS);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t){
+        threads.emplace_back([&table, &ids, t] {
+            for (int i = 0; i < NAMES; ++i){
+                ids[t].push_back(table.Intern("id"s + to_string(i)));
+            }
+        });
+    }
+    for (auto& thread : threads){
+        thread.join();
+    }
+    ASSERT_EQUAL(table.Size(), static_cast<size_t>(NAMES) + 1);
+    for (int t = 1; t < THREADS; ++t){
+        ASSERT(ids[t] == ids[0]);
+    }
+    ASSERT_EQUAL(table.Name(ids[2][123]), "id123"sv);
+}
+
+void TestSymbolsCompareById() {
+    const Symbol x("symbol_x"sv);
+    const Symbol same(string("symbol_x"));
+    const Symbol y("symbol_y");
+    ASSERT(x == same);
+    ASSERT(x != y);
+    ASSERT(x < y);
+    ASSERT_EQUAL(x.Id(), Identifiers().Intern("symbol_x"sv));
+    ASSERT_EQUAL(Symbol::FromId(y.Id()).Str(), "symbol_y"s);
+    ASSERT(Symbol().Empty());
+    ASSERT(Symbol(""sv).Empty());
+    ASSERT_EQUAL(hash<Symbol>{}(x), hash<Symbol>{}(same));
+}
+
+void TestTokensArePacked() {
+    using namespace parse;
+    const Token id = token_type::Id{"packed_name"sv};
+    const Token same = token_type::Id{string("packed_name")};
+    ASSERT(id == same);
+    ASSERT_EQUAL(id.Payload(), Identifiers().Intern("packed_name"sv));
+    ASSERT_EQUAL(id.As<token_type::Id>().value, "packed_name"sv);
+    ASSERT(!id.TryAs<token_type::String>());
+
+    const Token str = token_type::String{"packed_name"sv};
+    ASSERT(str != id);
+    ASSERT_EQUAL(str.As<token_type::String>().value, "packed_name"sv);
+
+    ASSERT_EQUAL(Token(token_type::Number{-5}).As<token_type::Number>().value, -5);
+    ASSERT_EQUAL(Token(token_type::Char{'\xff'}).As<token_type::Char>().value, '\xff');
+    ASSERT_THROWS((void)Token(token_type::Eof{}).As<token_type::Number>(), std::bad_variant_access);
+}
+
+}  // namespace
+
+void RunSymbolTableTests(TestRunner& tr) {
+    RUN_TEST(tr, symbols::TestInternReturnsSameId);
+    RUN_TEST(tr, symbols::TestNamesSurviveGrowth);
+    RUN_TEST(tr, symbols::TestCapacity);
+    RUN_TEST(tr, symbols::TestConcurrentIntern);
+    RUN_TEST(tr, symbols::TestSymbolsCompareById);
+    RUN_TEST(tr, symbols::TestTokensArePacked);
+}
+
+}  // namespace symbols
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "parse.h"
+#include "runtime.h"
+#include "statement.h"
+
+#include <string>
+
+// Исполнение программ Mython в тестах. Программы разбираются функцией ParseFromString из parse.h
+
+// Вывод программы, исполненной в пустом окружении
+inline std::string Execute(ast::Statement& program) {
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program.Execute(closure, context);
+    return context.output.str();
+}
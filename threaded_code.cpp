@@ -0,0 +1,543 @@
+#include "threaded_code.h"
+
+#include <array>
+#include <iterator>
+
+using namespace std;
+
+namespace threaded {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+class Compiler {
+public:
+    Compiler(Code& code, CompileStats* stats)
+        : code_(code), stats_(stats) {
+
+    }
+
+    // Генерирует код, оставляющий на стеке ровно одно значение - результат node
+    void CompileNode(runtime::Executable& node) {
+        if (stats_){
+            stats_->nodes++;
+        }
+
+        if (auto* num = dynamic_cast<ast::NumericConst*>(&node)){
+            EmitConst(ObjectHolder::Share(num->value_));
+        } else if (auto* str = dynamic_cast<ast::StringConst*>(&node)){
+            EmitConst(ObjectHolder::Share(str->value_));
+        } else if (auto* boolean = dynamic_cast<ast::BoolConst*>(&node)){
+            EmitConst(ObjectHolder::Share(boolean->value_));
+        } else if (dynamic_cast<ast::None*>(&node)){
+            Emit(OpCode::PushNone, 1);
+        } else if (auto* var = dynamic_cast<ast::VariableValue*>(&node)){
+            EmitLoadVar(*var);
+        } else if (auto* assign = dynamic_cast<ast::Assignment*>(&node)){
+            CompileNode(*assign->rv_);
+            Emit(OpCode::StoreVar, 0, AddName(assign->var_));
+        } else if (auto* field = dynamic_cast<ast::FieldAssignment*>(&node)){
+            CompileFieldAssignment(*field);
+        } else if (auto* print = dynamic_cast<ast::Print*>(&node)){
+            CompilePrint(*print);
+        } else if (auto* call = dynamic_cast<ast::MethodCall*>(&node)){
+            CompileMethodCall(*call);
+        } else if (auto* instance = dynamic_cast<ast::NewInstance*>(&node)){
+            CompileNewInstance(*instance);
+        } else if (auto* stringify = dynamic_cast<ast::Stringify*>(&node)){
+            CompileNode(*stringify->statement_);
+            Emit(OpCode::Stringify, 0);
+        } else if (auto* negation = dynamic_cast<ast::Not*>(&node)){
+            CompileNode(*negation->statement_);
+            Emit(OpCode::Not, 0);
+        } else if (auto* cmp = dynamic_cast<ast::Comparison*>(&node)){
+            CompileBinary(*cmp, OpCode::Compare, static_cast<uint32_t>(code_.comparators.size()));
+            code_.comparators.push_back(cmp->cmp_);
+        } else if (auto* add = dynamic_cast<ast::Add*>(&node)){
+            CompileBinary(*add, OpCode::Add);
+        } else if (auto* sub = dynamic_cast<ast::Sub*>(&node)){
+            CompileBinary(*sub, OpCode::Sub);
+        } else if (auto* mult = dynamic_cast<ast::Mult*>(&node)){
+            CompileBinary(*mult, OpCode::Mult);
+        } else if (auto* div = dynamic_cast<ast::Div*>(&node)){
+            CompileBinary(*div, OpCode::Div);
+        } else if (auto* disjunction = dynamic_cast<ast::Or*>(&node)){
+            CompileBinary(*disjunction, OpCode::Or);
+        } else if (auto* conjunction = dynamic_cast<ast::And*>(&node)){
+            CompileBinary(*conjunction, OpCode::And);
+        } else if (auto* compound = dynamic_cast<ast::Compound*>(&node)){
+            for (auto& statement : compound->args_){
+                CompileNode(*statement);
+                Emit(OpCode::Pop, -1);
+            }
+            Emit(OpCode::PushNone, 1);
+        } else if (auto* ret = dynamic_cast<ast::Return*>(&node)){
+            // Управление после return не продолжается, поэтому глубина стека
+            // считается такой же, как у любой другой инструкции со значением
+            CompileNode(*ret->statement_);
+            Emit(OpCode::Return, 0);
+        } else if (auto* definition = dynamic_cast<ast::ClassDefinition*>(&node)){
+            CompileClassDefinition(*definition);
+        } else if (auto* if_else = dynamic_cast<ast::IfElse*>(&node)){
+            CompileIfElse(*if_else);
+        } else {
+            Emit(OpCode::Exec, 1, static_cast<uint32_t>(code_.nodes.size()));
+            code_.nodes.push_back(&node);
+        }
+    }
+
+private:
+    Code& code_;
+    CompileStats* stats_;
+    int depth_ = 0;
+
+    uint32_t Emit(OpCode op, int stack_delta, uint32_t a = 0, uint32_t b = 0) {
+        code_.instructions.push_back({nullptr, op, a, b});
+        depth_ += stack_delta;
+        code_.max_stack = max(code_.max_stack, static_cast<size_t>(depth_));
+        return static_cast<uint32_t>(code_.instructions.size() - 1);
+    }
+
+    // Направляет переход инструкции at на следующую генерируемую инструкцию
+    void PatchJump(uint32_t at) {
+        code_.instructions.at(at).b = static_cast<uint32_t>(code_.instructions.size());
+    }
+
+    uint32_t AddName(symbols::Symbol name) {
+        code_.names.push_back(name);
+        return static_cast<uint32_t>(code_.names.size() - 1);
+    }
+
+    void EmitConst(ObjectHolder value) {
+        Emit(OpCode::PushConst, 1, static_cast<uint32_t>(code_.constants.size()));
+        code_.constants.push_back(std::move(value));
+    }
+
+    void EmitLoadVar(ast::VariableValue& var) {
+        Emit(OpCode::LoadVar, 1, static_cast<uint32_t>(code_.variables.size()));
+        code_.variables.push_back(&var);
+    }
+
+    void CompileBinary(ast::BinaryOperation& node, OpCode op, uint32_t a = 0) {
+        CompileNode(*node.lhs_);
+        CompileNode(*node.rhs_);
+        Emit(op, -1, a);
+    }
+
+    void CompileFieldAssignment(ast::FieldAssignment& node) {
+        if (stats_){
+            stats_->nodes++;
+        }
+        EmitLoadVar(node.object_);
+        uint32_t name = AddName(node.field_name_);
+        uint32_t target = Emit(OpCode::FieldTarget, 0, name);
+        CompileNode(*node.rv_);
+        Emit(OpCode::StoreField, -1, name);
+        PatchJump(target);
+    }
+
+    void CompilePrint(ast::Print& node) {
+        if (node.args_.empty()){
+            Emit(OpCode::PrintName, 1, AddName(node.name_));
+            return;
+        }
+        for (size_t i = 0; i < node.args_.size(); ++i){
+            CompileNode(*node.args_.at(i));
+            Emit(OpCode::PrintItem, -1, i + 1 == node.args_.size());
+        }
+        Emit(OpCode::PushNone, 1);
+    }
+
+    void CompileMethodCall(ast::MethodCall& node) {
+        uint32_t site = static_cast<uint32_t>(code_.calls.size());
+        code_.calls.push_back({node.method_, node.args_.size()});
+
+        CompileNode(*node.object_);
+        uint32_t prep = Emit(OpCode::CallPrep, 0, site);
+        for (auto& arg : node.args_){
+            CompileNode(*arg);
+        }
+        Emit(OpCode::Call, -static_cast<int>(node.args_.size()), site);
+        PatchJump(prep);
+    }
+
+    void CompileNewInstance(ast::NewInstance& node) {
+        uint32_t site = static_cast<uint32_t>(code_.news.size());
+        code_.news.push_back({node.obj_, node.args_.size()});
+
+        uint32_t prep = Emit(OpCode::NewPrep, 1, site);
+        for (auto& arg : node.args_){
+            CompileNode(*arg);
+        }
+        Emit(OpCode::NewInit, -static_cast<int>(node.args_.size()), site);
+        PatchJump(prep);
+    }
+
+    void CompileIfElse(ast::IfElse& node) {
+        CompileNode(*node.condition_);
+        uint32_t to_else = Emit(OpCode::JumpIfFalse, -1);
+        CompileNode(*node.if_body_);
+        uint32_t to_end = Emit(OpCode::Jump, -1);
+        PatchJump(to_else);
+        if (node.else_body_){
+            CompileNode(*node.else_body_);
+        } else {
+            Emit(OpCode::PushNone, 1);
+        }
+        PatchJump(to_end);
+    }
+
+    void CompileClassDefinition(ast::ClassDefinition& node) {
+        EmitConst(node.cls_);
+        code_.instructions.back().op = OpCode::ClassDef;
+
+        for (runtime::Method& method : node.cls_.TryAs<runtime::Class>()->Methods()){
+            auto* body = dynamic_cast<ast::MethodBody*>(method.body.get());
+            if (!body){
+                continue;
+            }
+            Code method_code = CompileStatement(*body->body_, true, stats_);
+            method.body = make_shared<ThreadedMethodBody>(std::move(method_code), method.body);
+            if (stats_){
+                stats_->methods++;
+            }
+        }
+    }
+};
+
+vector<ObjectHolder> PopArguments(ObjectHolder*& sp, size_t argc) {
+    vector<ObjectHolder> args(make_move_iterator(sp - argc), make_move_iterator(sp));
+    for (size_t i = 0; i < argc; ++i){
+        *--sp = ObjectHolder();
+    }
+    return args;
+}
+
+/*
+Цикл исполнения шитого кода. При вызове с table != nullptr только сообщает
+таблицу адресов обработчиков, которой компонуется код.
+*/
+ObjectHolder Dispatch(const Code* code_ptr, Closure* closure_ptr, Context* context_ptr,
+                      const void* const** table) {
+#ifdef MYTHON_COMPUTED_GOTO
+    static const void* const HANDLERS[] = {
+        &&op_PushConst, &&op_PushNone, &&op_LoadVar, &&op_StoreVar, &&op_FieldTarget,
+        &&op_StoreField, &&op_PrintName, &&op_PrintItem, &&op_CallPrep, &&op_Call,
+        &&op_NewPrep, &&op_NewInit, &&op_Stringify, &&op_Add, &&op_Sub,
+        &&op_Mult, &&op_Div, &&op_Or, &&op_And, &&op_Not,
+        &&op_Compare, &&op_ClassDef, &&op_JumpIfFalse, &&op_Jump, &&op_Pop,
+        &&op_Exec, &&op_Return, &&op_Halt,
+    };
+    static_assert(size(HANDLERS) == static_cast<size_t>(OpCode::Count_));
+    if (table){
+        *table = HANDLERS;
+        return {};
+    }
+#else
+    if (table){
+        *table = nullptr;
+        return {};
+    }
+#endif
+
+    const Code& code = *code_ptr;
+    Closure& closure = *closure_ptr;
+    Context& context = *context_ptr;
+
+    constexpr size_t INLINE_STACK_SIZE = 16;
+    array<ObjectHolder, INLINE_STACK_SIZE> inline_stack;
+    vector<ObjectHolder> heap_stack;
+    ObjectHolder* sp = inline_stack.data();
+    if (code.max_stack > INLINE_STACK_SIZE){
+        heap_stack.resize(code.max_stack);
+        sp = heap_stack.data();
+    }
+
+    const Instruction* const base = code.instructions.data();
+    const Instruction* ip = base;
+
+#ifdef MYTHON_COMPUTED_GOTO
+#define TARGET(op) op_##op:
+#define NEXT() goto *(++ip)->handler
+#define JUMP(target)                \
+    {                               \
+        ip = base + (target);       \
+        goto *ip->handler;          \
+    }
+    goto *ip->handler;
+#else
+#define TARGET(op) case OpCode::op:
+#define NEXT()  \
+    {           \
+        ++ip;   \
+        continue; \
+    }
+#define JUMP(target)          \
+    {                         \
+        ip = base + (target); \
+        continue;             \
+    }
+    for (;;) {
+        switch (ip->op) {
+#endif
+
+/*
+GCC не вызывает деструкторы при выходе из области видимости через вычисляемый
+goto (bug 37722), поэтому обработчики с локальными ObjectHolder и vector
+закрывают свою область до NEXT() и JUMP()
+*/
+#define BINARY(op)                                                      \
+    TARGET(op) {                                                        \
+        {                                                               \
+            ObjectHolder result = ast::op::Apply(sp[-2], sp[-1], context); \
+            *--sp = ObjectHolder();                                     \
+            sp[-1] = std::move(result);                                 \
+        }                                                               \
+        NEXT();                                                         \
+    }
+
+    TARGET(PushConst) {
+        *sp++ = code.constants[ip->a];
+        NEXT();
+    }
+    TARGET(PushNone) {
+        *sp++ = ObjectHolder::None();
+        NEXT();
+    }
+    TARGET(LoadVar) {
+        *sp++ = code.variables[ip->a]->ast::VariableValue::Execute(closure, context);
+        NEXT();
+    }
+    TARGET(StoreVar) {
+        ObjectHolder& slot = closure[code.names[ip->a]];
+        slot = std::move(sp[-1]);
+        sp[-1] = slot;
+        NEXT();
+    }
+    TARGET(FieldTarget) {
+        if (!sp[-1].TryAs<runtime::ClassInstance>()){
+            sp[-1] = closure[code.names[ip->a]];
+            JUMP(ip->b);
+        }
+        NEXT();
+    }
+    TARGET(StoreField) {
+        {
+            auto* instance = sp[-2].TryAs<runtime::ClassInstance>();
+            ObjectHolder& slot = instance->Fields()[code.names[ip->a]];
+            slot = std::move(sp[-1]);
+            ObjectHolder result = slot;
+            *--sp = ObjectHolder();
+            sp[-1] = std::move(result);
+        }
+        NEXT();
+    }
+    TARGET(PrintName) {
+        const symbols::Symbol name = code.names[ip->a];
+        if (auto it = closure.find(name); it != closure.end()){
+            it->second.Get()->Print(context.GetOutputStream(), context);
+            context.GetOutputStream() << endl;
+            *sp++ = it->second;
+        } else {
+            context.GetOutputStream() << "\n";
+            *sp++ = ObjectHolder::None();
+        }
+        NEXT();
+    }
+    TARGET(PrintItem) {
+        {
+            ObjectHolder value = std::move(*--sp);
+            ast::Print::PrintObject(value, context);
+        }
+        if (ip->a){
+            context.GetOutputStream() << endl;
+        } else {
+            context.GetOutputStream() << " ";
+        }
+        NEXT();
+    }
+    TARGET(CallPrep) {
+        const CallSite& site = code.calls[ip->a];
+        auto* instance = sp[-1].TryAs<runtime::ClassInstance>();
+        if (!instance || !instance->HasMethod(site.method, site.argc)){
+            sp[-1] = ObjectHolder::None();
+            JUMP(ip->b);
+        }
+        NEXT();
+    }
+    TARGET(Call) {
+        {
+            const CallSite& site = code.calls[ip->a];
+            vector<ObjectHolder> args = PopArguments(sp, site.argc);
+            ObjectHolder result
+                = sp[-1].TryAs<runtime::ClassInstance>()->Call(site.method, args, context);
+            sp[-1] = std::move(result);
+        }
+        NEXT();
+    }
+    TARGET(NewPrep) {
+        const NewSite& site = code.news[ip->a];
+        *sp++ = site.instance;
+        auto* instance = site.instance.TryAs<runtime::ClassInstance>();
+        if (!instance || !instance->HasMethod(runtime::names::INIT, site.argc)){
+            JUMP(ip->b);
+        }
+        NEXT();
+    }
+    TARGET(NewInit) {
+        {
+            const NewSite& site = code.news[ip->a];
+            vector<ObjectHolder> args = PopArguments(sp, site.argc);
+            sp[-1].TryAs<runtime::ClassInstance>()->Call(runtime::names::INIT, args, context);
+        }
+        NEXT();
+    }
+    TARGET(Stringify) {
+        sp[-1] = ast::Stringify::Apply(sp[-1], context);
+        NEXT();
+    }
+    BINARY(Add)
+    BINARY(Sub)
+    BINARY(Mult)
+    BINARY(Div)
+    BINARY(Or)
+    BINARY(And)
+    TARGET(Not) {
+        sp[-1] = ast::Not::Apply(sp[-1], context);
+        NEXT();
+    }
+    TARGET(Compare) {
+        bool result = code.comparators[ip->a](sp[-2], sp[-1], context);
+        *--sp = ObjectHolder();
+        sp[-1] = ObjectHolder::Own(runtime::Bool(result));
+        NEXT();
+    }
+    TARGET(ClassDef) {
+        const ObjectHolder& cls = code.constants[ip->a];
+        ObjectHolder& slot = closure[cls.TryAs<runtime::Class>()->GetName()];
+        slot = cls;
+        *sp++ = slot;
+        NEXT();
+    }
+    TARGET(JumpIfFalse) {
+        bool is_true;
+        {
+            ObjectHolder condition = std::move(*--sp);
+            is_true = ast::IfElse::IsConditionTrue(condition, context);
+        }
+        if (!is_true){
+            JUMP(ip->b);
+        }
+        NEXT();
+    }
+    TARGET(Jump) {
+        JUMP(ip->b);
+    }
+    TARGET(Pop) {
+        *--sp = ObjectHolder();
+        NEXT();
+    }
+    TARGET(Exec) {
+        *sp++ = code.nodes[ip->a]->Execute(closure, context);
+        NEXT();
+    }
+    TARGET(Return) {
+        ObjectHolder result = std::move(*--sp);
+        if (code.is_method_body){
+            return result;
+        }
+        throw ast::ObjectThrow(result);
+    }
+    TARGET(Halt) {
+        return std::move(*--sp);
+    }
+
+#ifndef MYTHON_COMPUTED_GOTO
+        case OpCode::Count_:
+            break;
+        }
+        throw runtime_error("Invalid threaded code instruction"s);
+    }
+#endif
+
+#undef BINARY
+#undef JUMP
+#undef NEXT
+#undef TARGET
+}
+
+const void* const* HandlerTable() {
+    static const void* const* table = [] {
+        const void* const* result = nullptr;
+        Dispatch(nullptr, nullptr, nullptr, &result);
+        return result;
+    }();
+    return table;
+}
+
+}  // namespace
+
+ObjectHolder Run(const Code& code, Closure& closure, Context& context) {
+    return Dispatch(&code, &closure, &context, nullptr);
+}
+
+ThreadedMethodBody::ThreadedMethodBody(Code code, shared_ptr<runtime::Executable> tree)
+    : code_(std::move(code)), tree_(std::move(tree)) {
+
+}
+
+ObjectHolder ThreadedMethodBody::Execute(Closure& closure, Context& context) {
+    try{
+        return Run(code_, closure, context);
+    } catch (ast::ObjectThrow& err) {
+        // return внутри узлов, исполняемых через Exec
+        return err.Get();
+    }
+}
+
+const Code& ThreadedMethodBody::GetCode() const {
+    return code_;
+}
+
+ThreadedProgram::ThreadedProgram(Code code, unique_ptr<runtime::Executable> tree)
+    : code_(std::move(code)), tree_(std::move(tree)) {
+
+}
+
+ObjectHolder ThreadedProgram::Execute(Closure& closure, Context& context) {
+    return Run(code_, closure, context);
+}
+
+const Code& ThreadedProgram::GetCode() const {
+    return code_;
+}
+
+Code CompileStatement(runtime::Executable& statement, bool is_method_body, CompileStats* stats) {
+    Code code;
+    code.is_method_body = is_method_body;
+
+    Compiler compiler(code, stats);
+    compiler.CompileNode(statement);
+    code.instructions.push_back({nullptr, OpCode::Halt, 0, 0});
+
+    if (const void* const* table = HandlerTable()){
+        for (Instruction& instruction : code.instructions){
+            instruction.handler = table[static_cast<size_t>(instruction.op)];
+        }
+    }
+    if (stats){
+        stats->instructions += code.instructions.size();
+    }
+    return code;
+}
+
+unique_ptr<runtime::Executable> Compile(unique_ptr<runtime::Executable> program,
+                                        CompileStats* stats) {
+    Code code = CompileStatement(*program, false, stats);
+    return make_unique<ThreadedProgram>(std::move(code), std::move(program));
+}
+
+}  // namespace threaded
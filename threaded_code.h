@@ -0,0 +1,149 @@
+#pragma once
+
+#include "statement.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+Шитый код (direct-threaded code) для инструкций из statement.h.
+
+Дерево разбора переводится в линейный массив инструкций стековой машины.
+Каждая инструкция хранит адрес своего обработчика, поэтому переход к следующей
+инструкции - это один косвенный переход goto *ip->handler без центрального switch.
+Если компилятор не поддерживает computed goto (расширение GCC/Clang),
+используется переносимый цикл со switch по коду операции.
+*/
+namespace threaded {
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MYTHON_COMPUTED_GOTO 1
+#endif
+
+// Коды операций. Комментарий описывает действие над стеком: [до] -> [после]
+enum class OpCode : uint8_t {
+    PushConst,     // [] -> [constants[a]]
+    PushNone,      // [] -> [None]
+    LoadVar,       // [] -> [значение variables[a]]
+    StoreVar,      // [v] -> [closure[names[a]] = v]
+    FieldTarget,   // [obj] -> [obj], либо [closure[names[a]]] и переход на b, если obj не объект
+    StoreField,    // [obj, v] -> [obj.fields[names[a]] = v]
+    PrintName,     // [] -> [результат Print::Variable(names[a])]
+    PrintItem,     // [v] -> [], выводит v, затем пробел (a == 0) или перевод строки (a == 1)
+    CallPrep,      // [obj] -> [obj], либо [None] и переход на b, если метода calls[a] нет
+    Call,          // [obj, args...] -> [obj.calls[a](args...)]
+    NewPrep,       // [] -> [instance], переход на b, если нет подходящего __init__
+    NewInit,       // [instance, args...] -> [instance], вызывает __init__
+    Stringify,     // [v] -> [str(v)]
+    Add,           // [l, r] -> [l + r]
+    Sub,           // [l, r] -> [l - r]
+    Mult,          // [l, r] -> [l * r]
+    Div,           // [l, r] -> [l / r]
+    Or,            // [l, r] -> [l or r]
+    And,           // [l, r] -> [l and r]
+    Not,           // [v] -> [not v]
+    Compare,       // [l, r] -> [comparators[a](l, r)]
+    ClassDef,      // [] -> [closure[имя класса constants[a]] = constants[a]]
+    JumpIfFalse,   // [cond] -> [], переход на b, если условие ложно
+    Jump,          // [] -> [], переход на b
+    Pop,           // [v] -> []
+    Exec,          // [] -> [nodes[a]->Execute(...)], для узлов без собственной инструкции
+    Return,        // [v] -> выход из тела метода со значением v
+    Halt,          // [v] -> завершение, возвращается v
+    Count_,
+};
+
+// Инструкция шитого кода
+struct Instruction {
+    // Адрес обработчика инструкции, заполняется при компоновке кода
+    const void* handler = nullptr;
+    OpCode op = OpCode::Halt;
+    uint32_t a = 0;
+    uint32_t b = 0;
+};
+
+// Место вызова метода
+struct CallSite {
+    symbols::Symbol method;
+    size_t argc = 0;
+};
+
+// Место создания экземпляра класса
+struct NewSite {
+    runtime::ObjectHolder instance;
+    size_t argc = 0;
+};
+
+// Скомпилированный линейный код программы либо тела метода
+struct Code {
+    std::vector<Instruction> instructions;
+    std::vector<runtime::ObjectHolder> constants;
+    std::vector<ast::VariableValue*> variables;
+    std::vector<symbols::Symbol> names;
+    std::vector<CallSite> calls;
+    std::vector<NewSite> news;
+    std::vector<ast::Comparison::Comparator> comparators;
+    std::vector<runtime::Executable*> nodes;
+    // Максимальная глубина стека операндов
+    size_t max_stack = 0;
+    // Код тела метода: инструкция return завершает выполнение кода,
+    // а не выбрасывает ast::ObjectThrow
+    bool is_method_body = false;
+};
+
+// Статистика компиляции
+struct CompileStats {
+    // Количество узлов дерева, переведённых в шитый код
+    size_t nodes = 0;
+    // Количество сгенерированных инструкций
+    size_t instructions = 0;
+    // Количество скомпилированных тел методов
+    size_t methods = 0;
+};
+
+// Выполняет скомпилированный код
+runtime::ObjectHolder Run(const Code& code, runtime::Closure& closure, runtime::Context& context);
+
+// Тело метода, исполняемое в виде шитого кода
+class ThreadedMethodBody : public runtime::Executable {
+public:
+    ThreadedMethodBody(Code code, std::shared_ptr<runtime::Executable> tree);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Code& GetCode() const;
+
+private:
+    Code code_;
+    // Исходное дерево владеет узлами, на которые ссылается code_
+    std::shared_ptr<runtime::Executable> tree_;
+};
+
+// Программа, исполняемая в виде шитого кода
+class ThreadedProgram : public runtime::Executable {
+public:
+    ThreadedProgram(Code code, std::unique_ptr<runtime::Executable> tree);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    [[nodiscard]] const Code& GetCode() const;
+
+private:
+    Code code_;
+    std::unique_ptr<runtime::Executable> tree_;
+};
+
+// Компилирует тело statement в шитый код. Дерево должно жить дольше кода
+Code CompileStatement(runtime::Executable& statement, bool is_method_body,
+                      CompileStats* stats = nullptr);
+
+/*
+Переводит программу в шитый код. Тела методов объявленных в программе классов
+заменяются на ThreadedMethodBody, поэтому методы также исполняются шитым кодом.
+*/
+std::unique_ptr<runtime::Executable> Compile(std::unique_ptr<runtime::Executable> program,
+                                             CompileStats* stats = nullptr);
+
+}  // namespace threaded
@@ -0,0 +1,206 @@
+#include "lexer.h"
+#include "parse.h"
+#include "threaded_code.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace threaded {
+
+namespace {
+
+string RunTree(const string& program) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    return context.output.str();
+}
+
+string RunThreaded(const string& program, CompileStats* stats = nullptr) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto code = Compile(ParseProgram(lexer), stats);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    code->Execute(closure, context);
+    return context.output.str();
+}
+
+void TestArithmeticsAndPrint() {
+    const string program = R"(
+x = 4
+y = 5
+print x + y, x - y, x * y, 20 / x, -x
+print 'a' + "b", str(x), not True, True and False, False or True
+print
+z = None
+print z
+)"s;
+    ASSERT_EQUAL(RunThreaded(program), RunTree(program));
+    ASSERT_EQUAL(RunThreaded(program), "9 -1 20 5 -4\nab 4 False False True\n\nNone\n"s);
+}
+
+void TestIfElse() {
+    const string program = R"(
+x = 4
+if x > 3:
+  print 'greater'
+else:
+  print 'less'
+if x == 1:
+  print 'one'
+if x != 1:
+  if x <= 4:
+    print 'le'
+  print 'not one'
+)"s;
+    ASSERT_EQUAL(RunThreaded(program), "greater\nle\nnot one\n"s);
+}
+
+void TestClassesAndMethods() {
+    const string program = R"(
+class GCD:
+  def __init__():
+    self.call_count = 0
+
+  def calc(a, b):
+    self.call_count = self.call_count + 1
+    if a < b:
+      return self.calc(b, a)
+    if b == 0:
+      return a
+    return self.calc(a - b, b)
+
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __str__():
+    return '(' + str(self.x) + '; ' + str(self.y) + ')'
+
+x = GCD()
+print x.calc(510510, 18629977)
+print x.calc(22, 17)
+print x.call_count
+p = Point(1, 2)
+print p, p.missing(1)
+)"s;
+    CompileStats stats;
+    ASSERT_EQUAL(RunThreaded(program, &stats), "17\n1\n115\n(1; 2) None\n"s);
+    ASSERT_EQUAL(stats.methods, 4U);
+    ASSERT(stats.instructions > stats.methods);
+}
+
+void TestInheritance() {
+    const string program = R"(
+class Shape:
+  def __str__():
+    return "Shape"
+
+  def area():
+    return 0
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+s = Shape()
+r = Rect(10, 20)
+print s, s.area(), r, r.area() > 100
+)"s;
+    ASSERT_EQUAL(RunThreaded(program), "Shape 0 Shape True\n"s);
+}
+
+void TestReturnOutsideMethodThrows() {
+    Code code;
+    {
+        ast::Return ret(make_unique<ast::NumericConst>(1));
+        code = CompileStatement(ret, false);
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        ASSERT_THROWS(Run(code, closure, context), ast::ObjectThrow);
+    }
+    {
+        ast::Return ret(make_unique<ast::NumericConst>(1));
+        code = CompileStatement(ret, true);
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        runtime::ObjectHolder result = Run(code, closure, context);
+        ASSERT(result.TryAs<runtime::Number>() && result.TryAs<runtime::Number>()->GetValue() == 1);
+    }
+}
+
+// Считает живые экземпляры, чтобы проверять, что шитый код не теряет ссылки
+class CountedObject : public runtime::Object {
+public:
+    inline static int live = 0;
+
+    CountedObject() {
+        ++live;
+    }
+
+    CountedObject(const CountedObject&) {
+        ++live;
+    }
+
+    ~CountedObject() override {
+        --live;
+    }
+
+    void Print(ostream& os, [[maybe_unused]] runtime::Context& context) override {
+        os << "True"s;
+    }
+};
+
+void TestHandlersReleaseValues() {
+    const string program = R"(
+class Holder:
+  def __init__(value):
+    self.value = value
+
+  def get(value):
+    if value:
+      return value
+    return None
+
+h = Holder(counted)
+x = h.get(counted)
+h.value = x
+print x
+)"s;
+    {
+        istringstream input(program);
+        parse::Lexer lexer(input);
+        auto code = Compile(ParseProgram(lexer));
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        closure["counted"] = runtime::ObjectHolder::Own(CountedObject());
+        code->Execute(closure, context);
+        ASSERT_EQUAL(context.output.str(), "True\n"s);
+    }
+    ASSERT_EQUAL(CountedObject::live, 0);
+}
+
+}  // namespace
+
+void RunThreadedCodeTests(TestRunner& tr) {
+    RUN_TEST(tr, threaded::TestArithmeticsAndPrint);
+    RUN_TEST(tr, threaded::TestIfElse);
+    RUN_TEST(tr, threaded::TestClassesAndMethods);
+    RUN_TEST(tr, threaded::TestInheritance);
+    RUN_TEST(tr, threaded::TestReturnOutsideMethodThrows);
+    RUN_TEST(tr, threaded::TestHandlersReleaseValues);
+}
+
+}  // namespace threaded
@@ -0,0 +1,215 @@
+#include "tiered.h"
+
+#include "ast_utils.h"
+#include "threaded_code.h"
+
+#include <ostream>
+
+using namespace std;
+
+namespace tiered {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+// Учитывает вход в тело метода на время его исполнения, в том числе при исключении
+class DepthGuard {
+public:
+    explicit DepthGuard(size_t& depth)
+        : depth_(depth) {
+        ++depth_;
+    }
+
+    DepthGuard(const DepthGuard&) = delete;
+    DepthGuard& operator=(const DepthGuard&) = delete;
+
+    ~DepthGuard() {
+        --depth_;
+    }
+
+private:
+    size_t& depth_;
+};
+
+class MethodInstaller : public ast::Visitor {
+public:
+    explicit MethodInstaller(TierManager& manager)
+        : manager_(manager) {
+
+    }
+
+    vector<shared_ptr<TieredMethodBody>> methods;
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(ast::ClassDefinition& node) override {
+        auto* cls = node.cls_.TryAs<runtime::Class>();
+        for (runtime::Method& method : cls->Methods()){
+            // Тела, уже заменённые другими средствами (шитый код, кэш результатов), не трогаются
+            if (auto tree = dynamic_pointer_cast<ast::MethodBody>(method.body)){
+                // Классы, вложенные в метод, получают свои тела до замены: после неё
+                // обход не заходит в тело метода
+                Walk(*tree->body_);
+                auto tiered = make_shared<TieredMethodBody>(std::move(tree),
+                                                            cls->GetName().Str() + '.' + method.name.Str(),
+                                                            manager_);
+                method.body = tiered;
+                methods.push_back(std::move(tiered));
+            }
+        }
+        return false;
+    }
+
+private:
+    TierManager& manager_;
+};
+
+}  // namespace
+
+TieredMethodBody::TieredMethodBody(shared_ptr<ast::MethodBody> tree, string name,
+                                   TierManager& manager)
+    : tree_(std::move(tree)), name_(std::move(name)), manager_(manager) {
+
+}
+
+ObjectHolder TieredMethodBody::Execute(Closure& closure, Context& context) {
+    ++calls_;
+    if (depth_){
+        ++recursive_calls_;
+    }
+    DepthGuard guard(depth_);
+    if (runtime::Executable* compiled = compiled_.load(memory_order_acquire)){
+        return compiled->Execute(closure, context);
+    }
+    if (!queued_ && calls_ + recursive_calls_ >= manager_.GetOptions().hot_threshold){
+        queued_ = true;
+        manager_.Submit(*this);
+    }
+    return tree_->Execute(closure, context);
+}
+
+const string& TieredMethodBody::GetName() const {
+    return name_;
+}
+
+size_t TieredMethodBody::GetCalls() const {
+    return calls_;
+}
+
+size_t TieredMethodBody::GetRecursiveCalls() const {
+    return recursive_calls_;
+}
+
+bool TieredMethodBody::IsCompiled() const {
+    return compiled_.load(memory_order_acquire) != nullptr;
+}
+
+TierManager::TierManager(TierOptions options)
+    : options_(options) {
+
+}
+
+TierManager::~TierManager() {
+    {
+        lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    has_work_.notify_one();
+    if (worker_.joinable()){
+        worker_.join();
+    }
+}
+
+size_t TierManager::Install(ast::Statement& program) {
+    MethodInstaller installer(*this);
+    installer.Walk(program);
+    const size_t installed = installer.methods.size();
+    for (auto& method : installer.methods){
+        methods_.push_back(std::move(method));
+    }
+    return installed;
+}
+
+void TierManager::Wait() {
+    unique_lock lock(mutex_);
+    idle_.wait(lock, [this] {
+        return queue_.empty() && !busy_;
+    });
+}
+
+const TierOptions& TierManager::GetOptions() const {
+    return options_;
+}
+
+const vector<shared_ptr<TieredMethodBody>>& TierManager::GetMethods() const {
+    return methods_;
+}
+
+void TierManager::PrintStatistics(ostream& out) const {
+    size_t compiled = 0;
+    for (const auto& method : methods_){
+        compiled += method->IsCompiled();
+    }
+    out << "tiers: "sv << compiled << " of "sv << methods_.size() << " methods compiled\n"sv;
+    for (const auto& method : methods_){
+        if (!method->GetCalls()){
+            continue;
+        }
+        out << "  "sv << method->GetName() << ": calls "sv << method->GetCalls() << ", recursive "sv
+            << method->GetRecursiveCalls() << ", "sv << (method->IsCompiled() ? "threaded"sv : "tree"sv)
+            << '\n';
+    }
+}
+
+void TierManager::Submit(TieredMethodBody& body) {
+    {
+        lock_guard lock(mutex_);
+        queue_.push_back(&body);
+        if (!worker_.joinable()){
+            worker_ = thread([this] {
+                Work();
+            });
+        }
+    }
+    has_work_.notify_one();
+}
+
+void TierManager::Work() {
+    unique_lock lock(mutex_);
+    while (true){
+        has_work_.wait(lock, [this] {
+            return stopping_ || !queue_.empty();
+        });
+        if (stopping_){
+            return;
+        }
+        TieredMethodBody* body = queue_.front();
+        queue_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        try {
+            // Код ссылается на узлы дерева, поэтому владеет им вместе с исходным телом метода.
+            // Методы вложенных классов уже заменены на TieredMethodBody, поэтому компиляция
+            // не переписывает их тела, которые в это время исполняет основной поток
+            threaded::Code code = threaded::CompileStatement(*body->tree_->body_, true);
+            body->compiled_owner_ = make_unique<threaded::ThreadedMethodBody>(std::move(code),
+                                                                             body->tree_);
+            body->compiled_.store(body->compiled_owner_.get(), memory_order_release);
+        } catch (const std::exception&) {
+            // Метод, который не удалось скомпилировать, продолжает исполняться деревом
+        }
+
+        lock.lock();
+        busy_ = false;
+        if (queue_.empty()){
+            idle_.notify_all();
+        }
+    }
+}
+
+}  // namespace tiered
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "statement.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Многоуровневое исполнение методов. Метод начинает исполняться обходом дерева, что не
+требует подготовки. Вызовы метода считаются; рекурсивные вызовы, заменяющие в Mython
+циклы, учитываются как обратные переходы. Когда метод становится горячим, его тело
+компилируется в шитый код в фоновом потоке, а готовый код подменяет дерево атомарно,
+без остановки исполнения
+*/
+namespace tiered {
+
+struct TierOptions {
+    // Метод становится горячим, когда сумма вызовов и рекурсивных вызовов достигает порога
+    size_t hot_threshold = 1000;
+};
+
+class TierManager;
+
+/*
+Тело метода с переключением уровней. Пока шитый код не готов, исполняет дерево tree;
+после публикации кода фоновым потоком все следующие вызовы исполняют код
+*/
+class TieredMethodBody : public runtime::Executable {
+public:
+    TieredMethodBody(std::shared_ptr<ast::MethodBody> tree, std::string name, TierManager& manager);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    // "Class.method"
+    [[nodiscard]] const std::string& GetName() const;
+
+    [[nodiscard]] size_t GetCalls() const;
+
+    // Вызовов, выполненных, пока метод уже исполнялся
+    [[nodiscard]] size_t GetRecursiveCalls() const;
+
+    [[nodiscard]] bool IsCompiled() const;
+
+private:
+    friend class TierManager;
+
+    std::shared_ptr<ast::MethodBody> tree_;
+    std::string name_;
+    TierManager& manager_;
+    // Счётчики изменяет только поток, исполняющий программу
+    size_t calls_ = 0;
+    size_t recursive_calls_ = 0;
+    size_t depth_ = 0;
+    bool queued_ = false;
+    // Код, опубликованный фоновым потоком. compiled_owner_ записывается до публикации
+    // и читается только через compiled_
+    std::atomic<runtime::Executable*> compiled_{nullptr};
+    std::unique_ptr<runtime::Executable> compiled_owner_;
+};
+
+/*
+Устанавливает многоуровневые тела методов и компилирует горячие методы в фоновом потоке.
+Менеджер должен жить, пока исполняется программа, в которой установлены его тела.
+Фоновый поток только читает дерево тела метода, которое исполнение не изменяет
+*/
+class TierManager {
+public:
+    explicit TierManager(TierOptions options = {});
+
+    TierManager(const TierManager&) = delete;
+    TierManager& operator=(const TierManager&) = delete;
+
+    // Останавливает фоновый поток. Методы, ожидающие компиляции, остаются на дереве
+    ~TierManager();
+
+    /*
+    Заменяет тела методов классов программы, исполняемые обходом дерева, многоуровневыми,
+    включая методы классов, вложенных в методы. Возвращает количество замещённых методов
+    */
+    size_t Install(ast::Statement& program);
+
+    // Дожидается окончания компиляции всех горячих методов, поставленных в очередь
+    void Wait();
+
+    [[nodiscard]] const TierOptions& GetOptions() const;
+
+    [[nodiscard]] const std::vector<std::shared_ptr<TieredMethodBody>>& GetMethods() const;
+
+    // Выводит счётчики вызванных методов и их уровень
+    void PrintStatistics(std::ostream& out) const;
+
+private:
+    friend class TieredMethodBody;
+
+    TierOptions options_;
+    std::vector<std::shared_ptr<TieredMethodBody>> methods_;
+
+    std::mutex mutex_;
+    std::condition_variable has_work_;
+    std::condition_variable idle_;
+    std::deque<TieredMethodBody*> queue_;
+    bool busy_ = false;
+    bool stopping_ = false;
+    // Поток запускается при появлении первого горячего метода
+    std::thread worker_;
+
+    void Submit(TieredMethodBody& body);
+
+    void Work();
+};
+
+}  // namespace tiered
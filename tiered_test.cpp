@@ -0,0 +1,141 @@
+#include "tiered.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace tiered {
+
+namespace {
+
+const TieredMethodBody& FindMethod(const TierManager& manager, const string& name) {
+    for (const auto& method : manager.GetMethods()){
+        if (method->GetName() == name){
+            return *method;
+        }
+    }
+    throw std::logic_error("No method "s + name);
+}
+
+const string PROGRAM = R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+class Greeter:
+  def __init__(name):
+    self.name = name
+
+  def greet():
+    return 'hello, ' + self.name
+
+f = Fib()
+g = Greeter('world')
+print f.calc(15), g.greet()
+print g.greet(), g.greet(), g.greet()
+)"s;
+
+void TestCountersAndPromotion() {
+    auto reference = ParseFromString(PROGRAM);
+    const string expected = Execute(*reference);
+
+    auto program = ParseFromString(PROGRAM);
+    TierManager manager(TierOptions{10});
+    ASSERT_EQUAL(manager.Install(*program), 3U);
+    ASSERT_EQUAL(Execute(*program), expected);
+    manager.Wait();
+
+    const TieredMethodBody& calc = FindMethod(manager, "Fib.calc"s);
+    ASSERT_EQUAL(calc.GetCalls(), 1973U);
+    // Все вызовы, кроме первого, выполнены изнутри calc
+    ASSERT_EQUAL(calc.GetRecursiveCalls(), 1972U);
+    ASSERT(calc.IsCompiled());
+
+    // Четыре нерекурсивных вызова не достигают порога
+    const TieredMethodBody& greet = FindMethod(manager, "Greeter.greet"s);
+    ASSERT_EQUAL(greet.GetCalls(), 4U);
+    ASSERT_EQUAL(greet.GetRecursiveCalls(), 0U);
+    ASSERT(!greet.IsCompiled());
+
+    // Повторное исполнение идёт по шитому коду
+    ASSERT_EQUAL(Execute(*program), expected);
+}
+
+void TestSwapDuringExecution() {
+    auto reference = ParseFromString(PROGRAM);
+    const string expected = Execute(*reference);
+
+    // При пороге 1 код публикуется, пока исполняются вызовы, начатые на дереве
+    for (auto level : {opt::OptimizationLevel::O0, opt::OptimizationLevel::O2}){
+        auto program = ParseFromString(PROGRAM);
+        opt::CreatePassManager(level).Run(program);
+        TierManager manager(TierOptions{1});
+        manager.Install(*program);
+        ASSERT_EQUAL(Execute(*program), expected);
+        manager.Wait();
+        ASSERT_EQUAL(Execute(*program), expected);
+        ASSERT(FindMethod(manager, "Fib.calc"s).IsCompiled());
+    }
+}
+
+void TestColdProgram() {
+    auto program = ParseFromString(PROGRAM);
+    TierManager manager(TierOptions{100000});
+    manager.Install(*program);
+    ASSERT_EQUAL(Execute(*program), "610 hello, world\nhello, world hello, world hello, world\n"s);
+    manager.Wait();
+    for (const auto& method : manager.GetMethods()){
+        ASSERT(!method->IsCompiled());
+    }
+
+    ostringstream out;
+    manager.PrintStatistics(out);
+    ASSERT_EQUAL(out.str(), "tiers: 0 of 3 methods compiled\n"
+                            "  Fib.calc: calls 1973, recursive 1972, tree\n"
+                            "  Greeter.__init__: calls 1, recursive 0, tree\n"
+                            "  Greeter.greet: calls 4, recursive 0, tree\n"s);
+}
+
+void TestNestedClasses() {
+    // define компилируется в фоне, пока основной поток вызывает метод вложенного класса
+    const string program_text = R"(
+class Outer:
+  def define():
+    class Inner:
+      def get(n):
+        return n + 1
+    return 0
+
+  def run(n):
+    if n > 0:
+      self.define()
+      i = Inner()
+      return i.get(n) + self.run(n - 1)
+    return 0
+
+o = Outer()
+print o.run(200)
+)"s;
+    auto program = ParseFromString(program_text);
+    TierManager manager(TierOptions{1});
+    ASSERT_EQUAL(manager.Install(*program), 3U);
+    ASSERT_EQUAL(Execute(*program), "20300\n"s);
+    manager.Wait();
+    ASSERT(FindMethod(manager, "Outer.define"s).IsCompiled());
+    ASSERT_EQUAL(FindMethod(manager, "Inner.get"s).GetCalls(), 200U);
+    ASSERT_EQUAL(Execute(*program), "20300\n"s);
+}
+
+}  // namespace
+
+void RunTieredTests(TestRunner& tr) {
+    RUN_TEST(tr, tiered::TestCountersAndPromotion);
+    RUN_TEST(tr, tiered::TestSwapDuringExecution);
+    RUN_TEST(tr, tiered::TestColdProgram);
+    RUN_TEST(tr, tiered::TestNestedClasses);
+}
+
+}  // namespace tiered
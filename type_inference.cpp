@@ -0,0 +1,772 @@
+#include "type_inference.h"
+
+#include "class_hierarchy.h"
+#include "common_subexpressions.h"
+#include "inlining.h"
+
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace {
+
+// Типы переменных в точке программы. Отсутствующая переменная имеет тип Unknown
+using TypeState = unordered_map<symbols::Symbol, StaticType>;
+// Имя метода и количество аргументов вызова
+using MethodKey = pair<symbols::Symbol, size_t>;
+
+// Наибольшее число итераций поиска типов параметров
+constexpr int MAX_ITERATIONS = 8;
+
+StaticType Join(StaticType lhs, StaticType rhs) {
+    if (lhs == StaticType::Unset){
+        return rhs;
+    }
+    if (rhs == StaticType::Unset){
+        return lhs;
+    }
+    return lhs == rhs ? lhs : StaticType::Unknown;
+}
+
+// Объединяет состояния двух ветвей. Переменная, присвоенная лишь в одной из ветвей,
+// может оказаться неопределённой, поэтому её тип становится неизвестным
+void JoinStates(TypeState& state, const TypeState& other) {
+    for (auto it = state.begin(); it != state.end();){
+        auto other_it = other.find(it->first);
+        if (other_it == other.end()){
+            it = state.erase(it);
+        } else {
+            it->second = Join(it->second, other_it->second);
+            ++it;
+        }
+    }
+}
+
+StaticType ArithmeticType(char op, StaticType lhs, StaticType rhs) {
+    if (lhs == StaticType::Unset || rhs == StaticType::Unset){
+        return StaticType::Unset;
+    }
+    if (lhs == StaticType::Int && rhs == StaticType::Int){
+        return StaticType::Int;
+    }
+    if (op == '+' && lhs == StaticType::Str && rhs == StaticType::Str){
+        return StaticType::Str;
+    }
+    return StaticType::Unknown;
+}
+
+char GetArithmeticOp(const Statement& node) {
+    if (dynamic_cast<const Add*>(&node)){
+        return '+';
+    }
+    if (dynamic_cast<const Sub*>(&node)){
+        return '-';
+    }
+    if (dynamic_cast<const Mult*>(&node)){
+        return '*';
+    }
+    if (dynamic_cast<const Div*>(&node)){
+        return '/';
+    }
+    return 0;
+}
+
+bool HasType(const ObjectHolder& value, StaticType type) {
+    switch (type){
+        case StaticType::Int:
+            return value.TryAs<runtime::Number>() != nullptr;
+        case StaticType::Str:
+            return value.TryAs<runtime::String>() != nullptr;
+        case StaticType::Bool:
+            return value.TryAs<runtime::Bool>() != nullptr;
+        default:
+            return true;
+    }
+}
+
+// Передаёт владение expr, если это узел типа T
+template <typename T>
+unique_ptr<T> TakeAs(unique_ptr<Statement>& expr) {
+    if (auto* typed = dynamic_cast<T*>(expr.get())){
+        expr.release();
+        return unique_ptr<T>(typed);
+    }
+    return nullptr;
+}
+
+// Имя переменной, если expr - переменная без точек, иначе nullptr
+const symbols::Symbol* GetVariableName(const Statement& expr) {
+    auto* var = dynamic_cast<const VariableValue*>(&expr);
+    return var && var->dotted_ids_.size() == 1 ? &var->dotted_ids_.front() : nullptr;
+}
+
+unique_ptr<IntExpression> ToInt(unique_ptr<Statement> expr) {
+    if (auto typed = TakeAs<IntExpression>(expr)){
+        return typed;
+    }
+    if (auto* num = dynamic_cast<NumericConst*>(expr.get())){
+        return make_unique<IntLiteral>(num->value_.GetValue());
+    }
+    if (const symbols::Symbol* name = GetVariableName(*expr)){
+        return make_unique<IntVariable>(*name);
+    }
+    return make_unique<IntOf>(std::move(expr));
+}
+
+unique_ptr<StrExpression> ToStr(unique_ptr<Statement> expr) {
+    if (auto typed = TakeAs<StrExpression>(expr)){
+        return typed;
+    }
+    if (auto* str = dynamic_cast<StringConst*>(expr.get())){
+        return make_unique<StrLiteral>(str->value_.GetValue());
+    }
+    if (const symbols::Symbol* name = GetVariableName(*expr)){
+        return make_unique<StrVariable>(*name);
+    }
+    return make_unique<StrStringify>(std::move(expr));
+}
+
+unique_ptr<BoolExpression> ToBool(unique_ptr<Statement> expr) {
+    if (auto typed = TakeAs<BoolExpression>(expr)){
+        return typed;
+    }
+    if (const symbols::Symbol* name = GetVariableName(*expr)){
+        return make_unique<BoolVariable>(*name);
+    }
+    return make_unique<BoolOf>(std::move(expr));
+}
+
+// Тип значения по имени типа из профиля
+StaticType GetProfiledType(const string& name) {
+    if (name == "%int"s){
+        return StaticType::Int;
+    }
+    if (name == "%str"s){
+        return StaticType::Str;
+    }
+    if (name == "%bool"s){
+        return StaticType::Bool;
+    }
+    return StaticType::Unknown;
+}
+
+class Specializer {
+public:
+    TypeSpecializationStats stats;
+
+    explicit Specializer(const ProgramProfile* profile)
+        : profile_(profile) {
+
+    }
+
+    void Run(unique_ptr<Statement>& program) {
+        vector<runtime::Method*> methods;
+        for (const ClassMethod& method : CollectMethods(*program)){
+            if (method.body){
+                methods.push_back(method.method);
+            }
+        }
+
+        // Типы параметров ищутся итеративно: типы аргументов внутри методов зависят
+        // от предполагаемых типов параметров этих методов
+        for (int i = 0; i < MAX_ITERATIONS; ++i){
+            const auto previous = evidence_;
+            TypeState state;
+            Process(program, state);
+            for (runtime::Method* method : methods){
+                TypeState method_state = GetParameterState(*method);
+                Process(static_cast<MethodBody&>(*method->body).body_, method_state);
+            }
+            if (evidence_ == previous){
+                break;
+            }
+        }
+
+        rewrite_ = true;
+        TypeState state;
+        Process(program, state);
+        for (runtime::Method* method : methods){
+            SpecializeMethod(*method);
+            guards_.clear();
+        }
+    }
+
+private:
+    const ProgramProfile* profile_;
+    bool rewrite_ = false;
+    // Типы аргументов в местах вызова методов с заданным именем и числом аргументов
+    map<MethodKey, vector<StaticType>> evidence_;
+    // Проверки типов параметров текущего метода
+    vector<pair<symbols::Symbol, StaticType>> guards_;
+
+    static size_t GetArity(const runtime::Method& method) {
+        const auto& params = method.formal_params;
+        return !params.empty() && params.front() == runtime::names::SELF ? params.size() - 1 : params.size();
+    }
+
+    // Состояние при входе в метод. При переписывании заполняет guards_ для
+    // параметров, тип которых предполагается
+    TypeState GetParameterState(const runtime::Method& method) {
+        const size_t arity = GetArity(method);
+        TypeState state;
+        auto it = evidence_.find(MethodKey{method.name, arity});
+        for (size_t i = 0; i < arity; ++i){
+            StaticType type = it != evidence_.end() ? it->second[i] : StaticType::Unset;
+            if (type == StaticType::Unknown && profile_){
+                // Тип, которого параметр придерживался в профиле, проверяется при входе в метод
+                const string* profiled = profile_->GetParameterType(*method.body,
+                                                                    method.formal_params[i]);
+                type = profiled ? GetProfiledType(*profiled) : type;
+            }
+            if (!rewrite_){
+                state[method.formal_params[i]] = type;
+            } else if (type != StaticType::Unset && type != StaticType::Unknown){
+                state[method.formal_params[i]] = type;
+                guards_.emplace_back(method.formal_params[i], type);
+            }
+        }
+        return state;
+    }
+
+    void SpecializeMethod(runtime::Method& method) {
+        auto& body = static_cast<MethodBody&>(*method.body);
+        TypeState method_state = GetParameterState(method);
+
+        if (!guards_.empty()){
+            const TypeSpecializationStats saved = stats;
+            if (auto specialized = Clone(*body.body_)){
+                Process(specialized, method_state);
+                if (stats.Total() > saved.Total()){
+                    TypeState generic_state;
+                    Process(body.body_, generic_state);
+                    body.body_ = make_unique<GuardedBody>(std::move(guards_), std::move(specialized),
+                                                          std::move(body.body_));
+                    stats.guarded_methods++;
+                    return;
+                }
+            }
+            stats = saved;
+        }
+
+        TypeState generic_state;
+        Process(body.body_, generic_state);
+    }
+
+    void RecordCall(symbols::Symbol method, const vector<StaticType>& types) {
+        auto [it, inserted] = evidence_.emplace(MethodKey{method, types.size()}, types);
+        if (!inserted){
+            for (size_t i = 0; i < types.size(); ++i){
+                it->second[i] = Join(it->second[i], types[i]);
+            }
+        }
+    }
+
+    vector<StaticType> ProcessArguments(vector<unique_ptr<Statement>>& args, TypeState& state) {
+        vector<StaticType> types;
+        types.reserve(args.size());
+        for (auto& arg : args){
+            types.push_back(Process(arg, state));
+        }
+        return types;
+    }
+
+    // Выводит тип выражения slot и обновляет типы переменных в state.
+    // При переписывании заменяет узлы с известным типом специализированными
+    StaticType Process(unique_ptr<Statement>& slot, TypeState& state) {
+        Statement& node = *slot;
+        if (dynamic_cast<NumericConst*>(&node) || dynamic_cast<IntExpression*>(&node)){
+            return StaticType::Int;
+        }
+        if (dynamic_cast<StringConst*>(&node) || dynamic_cast<StrExpression*>(&node)){
+            return StaticType::Str;
+        }
+        if (dynamic_cast<BoolConst*>(&node) || dynamic_cast<BoolExpression*>(&node)){
+            return StaticType::Bool;
+        }
+        if (auto* var = dynamic_cast<VariableValue*>(&node)){
+            if (var->dotted_ids_.size() == 1){
+                auto it = state.find(var->dotted_ids_.front());
+                return it != state.end() ? it->second : StaticType::Unknown;
+            }
+            return StaticType::Unknown;
+        }
+        if (dynamic_cast<None*>(&node)){
+            return StaticType::Unknown;
+        }
+        if (auto* assign = dynamic_cast<Assignment*>(&node)){
+            const StaticType type = Process(assign->rv_, state);
+            state[assign->var_] = type;
+            return type;
+        }
+        if (auto* field = dynamic_cast<FieldAssignment*>(&node)){
+            Process(field->rv_, state);
+            return StaticType::Unknown;
+        }
+        if (auto* print = dynamic_cast<Print*>(&node)){
+            ProcessArguments(print->args_, state);
+            return StaticType::Unknown;
+        }
+        if (auto* call = dynamic_cast<MethodCall*>(&node)){
+            Process(call->object_, state);
+            RecordCall(call->method_, ProcessArguments(call->args_, state));
+            return StaticType::Unknown;
+        }
+        if (auto* call = dynamic_cast<BoundMethodCall*>(&node)){
+            Process(call->object_, state);
+            RecordCall(call->method_, ProcessArguments(call->args_, state));
+            return StaticType::Unknown;
+        }
+        if (auto* load = dynamic_cast<ChainLoad*>(&node)){
+            state[load->slot_] = StaticType::Unknown;
+            return StaticType::Unknown;
+        }
+        if (auto* release = dynamic_cast<ReleaseSlots*>(&node)){
+            for (const symbols::Symbol slot : release->slots_){
+                state.erase(slot);
+            }
+            return StaticType::Unknown;
+        }
+        if (auto* instance = dynamic_cast<NewInstance*>(&node)){
+            RecordCall(runtime::names::INIT, ProcessArguments(instance->args_, state));
+            return StaticType::Unknown;
+        }
+        if (auto* stringify = dynamic_cast<Stringify*>(&node)){
+            Process(stringify->statement_, state);
+            if (rewrite_){
+                slot = make_unique<StrStringify>(std::move(stringify->statement_));
+                stats.str_nodes++;
+            }
+            return StaticType::Str;
+        }
+        if (auto* not_node = dynamic_cast<Not*>(&node)){
+            const StaticType type = Process(not_node->statement_, state);
+            if (rewrite_ && type == StaticType::Bool){
+                slot = make_unique<BoolNot>(ToBool(std::move(not_node->statement_)));
+                stats.bool_nodes++;
+            }
+            return StaticType::Bool;
+        }
+        if (auto* binary = dynamic_cast<BinaryOperation*>(&node)){
+            return ProcessBinary(slot, *binary, state);
+        }
+        if (auto* compound = dynamic_cast<Compound*>(&node)){
+            ProcessArguments(compound->args_, state);
+            return StaticType::Unknown;
+        }
+        if (auto* ret = dynamic_cast<Return*>(&node)){
+            Process(ret->statement_, state);
+            return StaticType::Unknown;
+        }
+        if (auto* body = dynamic_cast<MethodBody*>(&node)){
+            Process(body->body_, state);
+            return StaticType::Unknown;
+        }
+        if (auto* definition = dynamic_cast<ClassDefinition*>(&node)){
+            state[definition->cls_.TryAs<runtime::Class>()->GetName()] = StaticType::Unknown;
+            return StaticType::Unknown;
+        }
+        if (auto* if_else = dynamic_cast<IfElse*>(&node)){
+            ProcessIfElse(slot, *if_else, state);
+            return StaticType::Unknown;
+        }
+        if (auto* inlined = dynamic_cast<InlinedCall*>(&node)){
+            ProcessInlinedCall(*inlined, state);
+            return StaticType::Unknown;
+        }
+        // Неизвестный узел может присвоить значение любой переменной
+        state.clear();
+        return StaticType::Unknown;
+    }
+
+    StaticType ProcessBinary(unique_ptr<Statement>& slot, BinaryOperation& node, TypeState& state) {
+        const StaticType lhs = Process(node.lhs_, state);
+        const StaticType rhs = Process(node.rhs_, state);
+
+        if (auto* cmp = dynamic_cast<Comparison*>(&node)){
+            IntCompareFunction int_cmp = GetIntCompareFunction(GetCompareFunction(cmp->cmp_));
+            if (rewrite_ && int_cmp && lhs == StaticType::Int && rhs == StaticType::Int){
+                slot = make_unique<IntComparison>(int_cmp, ToInt(std::move(node.lhs_)),
+                                                  ToInt(std::move(node.rhs_)));
+                stats.bool_nodes++;
+            }
+            return StaticType::Bool;
+        }
+        if (dynamic_cast<Or*>(&node) || dynamic_cast<And*>(&node)){
+            if (rewrite_ && lhs == StaticType::Bool && rhs == StaticType::Bool){
+                const bool is_and = dynamic_cast<And*>(&node) != nullptr;
+                slot = make_unique<BoolLogic>(is_and, ToBool(std::move(node.lhs_)),
+                                              ToBool(std::move(node.rhs_)));
+                stats.bool_nodes++;
+            }
+            return StaticType::Bool;
+        }
+
+        const char op = GetArithmeticOp(node);
+        if (!op){
+            return StaticType::Unknown;
+        }
+        const StaticType result = ArithmeticType(op, lhs, rhs);
+        if (rewrite_ && result == StaticType::Int){
+            slot = make_unique<IntArithmetic>(op, ToInt(std::move(node.lhs_)),
+                                              ToInt(std::move(node.rhs_)));
+            stats.int_nodes++;
+        } else if (rewrite_ && result == StaticType::Str){
+            slot = make_unique<StrConcat>(ToStr(std::move(node.lhs_)), ToStr(std::move(node.rhs_)));
+            stats.str_nodes++;
+        }
+        return result;
+    }
+
+    // Слоты встроенного вызова получают типы аргументов. Если класс получателя не совпадёт,
+    // тело не исполняется, но и слоты тогда никто не читает
+    void ProcessInlinedCall(InlinedCall& node, TypeState& state) {
+        Process(node.object_, state);
+        const vector<StaticType> types = ProcessArguments(node.args_, state);
+        RecordCall(node.method_, types);
+        for (size_t i = 0; i < types.size(); ++i){
+            state[node.params_[i]] = types[i];
+        }
+        state.erase(node.self_);
+        ProcessArguments(node.body_, state);
+        if (node.result_){
+            Process(node.result_, state);
+        }
+    }
+
+    void ProcessIfElse(unique_ptr<Statement>& slot, IfElse& node, TypeState& state) {
+        const StaticType condition = Process(node.condition_, state);
+        TypeState else_state = state;
+        Process(node.if_body_, state);
+        if (node.else_body_){
+            Process(node.else_body_, else_state);
+        }
+        JoinStates(state, else_state);
+
+        if (rewrite_ && condition == StaticType::Bool){
+            slot = make_unique<BoolBranch>(ToBool(std::move(node.condition_)),
+                                           std::move(node.if_body_), std::move(node.else_body_));
+            stats.bool_nodes++;
+        }
+    }
+};
+
+// Операнды специализированных узлов имеют тип, проверенный при их создании
+// и сохраняемый ForEachChild
+int IntValue(Statement& operand, Closure& closure, Context& context) {
+    return static_cast<IntExpression&>(operand).EvaluateInt(closure, context);
+}
+
+bool BoolValue(Statement& operand, Closure& closure, Context& context) {
+    return static_cast<BoolExpression&>(operand).EvaluateBool(closure, context);
+}
+
+// Передаёт операнд fn. Если fn заменила его выражением общего вида, оно оборачивается
+// в узел, распаковывающий значение нужного типа
+void VisitIntOperand(unique_ptr<Statement>& operand, const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(operand);
+    if (!dynamic_cast<IntExpression*>(operand.get())){
+        operand = make_unique<IntOf>(std::move(operand));
+    }
+}
+
+void VisitBoolOperand(unique_ptr<Statement>& operand, const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(operand);
+    if (!dynamic_cast<BoolExpression*>(operand.get())){
+        operand = make_unique<BoolOf>(std::move(operand));
+    }
+}
+
+void VisitStrOperand(unique_ptr<Statement>& operand, const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(operand);
+    if (!dynamic_cast<StrExpression*>(operand.get())){
+        // str от строки - сама строка
+        operand = make_unique<StrStringify>(std::move(operand));
+    }
+}
+
+}  // namespace
+
+ObjectHolder IntExpression::Execute(Closure& closure, Context& context) {
+    return ObjectHolder::Own(runtime::Number(EvaluateInt(closure, context)));
+}
+
+ObjectHolder BoolExpression::Execute(Closure& closure, Context& context) {
+    return ObjectHolder::Own(runtime::Bool(EvaluateBool(closure, context)));
+}
+
+ObjectHolder StrExpression::Execute(Closure& closure, Context& context) {
+    string value;
+    AppendStr(closure, context, value);
+    return ObjectHolder::Own(runtime::String(std::move(value)));
+}
+
+IntLiteral::IntLiteral(int value)
+    : value_(value) {
+
+}
+
+int IntLiteral::EvaluateInt([[maybe_unused]] Closure& closure, [[maybe_unused]] Context& context) {
+    return value_;
+}
+
+IntVariable::IntVariable(symbols::Symbol name)
+    : name_(std::move(name)) {
+
+}
+
+int IntVariable::EvaluateInt(Closure& closure, [[maybe_unused]] Context& context) {
+    auto it = closure.find(name_);
+    if (it == closure.end()){
+        throw std::runtime_error("Unknown variable"s);
+    }
+    return static_cast<runtime::Number*>(it->second.Get())->GetValue();
+}
+
+IntOf::IntOf(unique_ptr<Statement> expr)
+    : expr_(std::move(expr)) {
+
+}
+
+int IntOf::EvaluateInt(Closure& closure, Context& context) {
+    ObjectHolder value = expr_->Execute(closure, context);
+    auto* number = value.TryAs<runtime::Number>();
+    if (!number){
+        throw std::logic_error("Expression of type Int evaluated to another type"s);
+    }
+    return number->GetValue();
+}
+
+void IntOf::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(expr_);
+}
+
+IntArithmetic::IntArithmetic(char op, unique_ptr<IntExpression> lhs, unique_ptr<IntExpression> rhs)
+    : op_(op), lhs_(std::move(lhs)), rhs_(std::move(rhs)) {
+
+}
+
+int IntArithmetic::EvaluateInt(Closure& closure, Context& context) {
+    const int lhs = IntValue(*lhs_, closure, context);
+    const int rhs = IntValue(*rhs_, closure, context);
+    switch (op_){
+        case '+':
+            return lhs + rhs;
+        case '-':
+            return lhs - rhs;
+        case '*':
+            return lhs * rhs;
+        default:
+            if (rhs == 0){
+                throw std::runtime_error("Division by zero"s);
+            }
+            return lhs / rhs;
+    }
+}
+
+void IntArithmetic::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    VisitIntOperand(lhs_, fn);
+    VisitIntOperand(rhs_, fn);
+}
+
+BoolVariable::BoolVariable(symbols::Symbol name)
+    : name_(std::move(name)) {
+
+}
+
+bool BoolVariable::EvaluateBool(Closure& closure, [[maybe_unused]] Context& context) {
+    auto it = closure.find(name_);
+    if (it == closure.end()){
+        throw std::runtime_error("Unknown variable"s);
+    }
+    return static_cast<runtime::Bool*>(it->second.Get())->GetValue();
+}
+
+BoolOf::BoolOf(unique_ptr<Statement> expr)
+    : expr_(std::move(expr)) {
+
+}
+
+bool BoolOf::EvaluateBool(Closure& closure, Context& context) {
+    ObjectHolder value = expr_->Execute(closure, context);
+    auto* boolean = value.TryAs<runtime::Bool>();
+    if (!boolean){
+        throw std::logic_error("Expression of type Bool evaluated to another type"s);
+    }
+    return boolean->GetValue();
+}
+
+void BoolOf::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(expr_);
+}
+
+IntComparison::IntComparison(IntCompareFunction cmp, unique_ptr<IntExpression> lhs,
+                             unique_ptr<IntExpression> rhs)
+    : cmp_(cmp), lhs_(std::move(lhs)), rhs_(std::move(rhs)) {
+
+}
+
+bool IntComparison::EvaluateBool(Closure& closure, Context& context) {
+    const int lhs = IntValue(*lhs_, closure, context);
+    return cmp_(lhs, IntValue(*rhs_, closure, context));
+}
+
+void IntComparison::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    VisitIntOperand(lhs_, fn);
+    VisitIntOperand(rhs_, fn);
+}
+
+BoolNot::BoolNot(unique_ptr<BoolExpression> arg)
+    : arg_(std::move(arg)) {
+
+}
+
+bool BoolNot::EvaluateBool(Closure& closure, Context& context) {
+    return !BoolValue(*arg_, closure, context);
+}
+
+void BoolNot::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    VisitBoolOperand(arg_, fn);
+}
+
+BoolLogic::BoolLogic(bool is_and, unique_ptr<BoolExpression> lhs, unique_ptr<BoolExpression> rhs)
+    : is_and_(is_and), lhs_(std::move(lhs)), rhs_(std::move(rhs)) {
+
+}
+
+bool BoolLogic::EvaluateBool(Closure& closure, Context& context) {
+    const bool lhs = BoolValue(*lhs_, closure, context);
+    const bool rhs = BoolValue(*rhs_, closure, context);
+    return is_and_ ? lhs && rhs : lhs || rhs;
+}
+
+void BoolLogic::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    VisitBoolOperand(lhs_, fn);
+    VisitBoolOperand(rhs_, fn);
+}
+
+StrLiteral::StrLiteral(string value)
+    : value_(std::move(value)) {
+
+}
+
+void StrLiteral::AppendStr([[maybe_unused]] Closure& closure, [[maybe_unused]] Context& context,
+                           string& out) {
+    out += value_;
+}
+
+StrVariable::StrVariable(symbols::Symbol name)
+    : name_(std::move(name)) {
+
+}
+
+void StrVariable::AppendStr(Closure& closure, [[maybe_unused]] Context& context, string& out) {
+    auto it = closure.find(name_);
+    if (it == closure.end()){
+        throw std::runtime_error("Unknown variable"s);
+    }
+    out += static_cast<runtime::String*>(it->second.Get())->GetValue();
+}
+
+StrConcat::StrConcat(unique_ptr<StrExpression> lhs, unique_ptr<StrExpression> rhs)
+    : lhs_(std::move(lhs)), rhs_(std::move(rhs)) {
+
+}
+
+void StrConcat::AppendStr(Closure& closure, Context& context, string& out) {
+    static_cast<StrExpression&>(*lhs_).AppendStr(closure, context, out);
+    static_cast<StrExpression&>(*rhs_).AppendStr(closure, context, out);
+}
+
+void StrConcat::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    VisitStrOperand(lhs_, fn);
+    VisitStrOperand(rhs_, fn);
+}
+
+StrStringify::StrStringify(unique_ptr<Statement> arg)
+    : arg_(std::move(arg)) {
+
+}
+
+void StrStringify::AppendStr(Closure& closure, Context& context, string& out) {
+    if (auto* number = dynamic_cast<IntExpression*>(arg_.get())){
+        out += to_string(number->EvaluateInt(closure, context));
+    } else if (auto* str = dynamic_cast<StrExpression*>(arg_.get())){
+        str->AppendStr(closure, context, out);
+    } else if (auto* boolean = dynamic_cast<BoolExpression*>(arg_.get())){
+        out += boolean->EvaluateBool(closure, context) ? "True"sv : "False"sv;
+    } else if (ObjectHolder value = arg_->Execute(closure, context)){
+        ostringstream str;
+        value->Print(str, context);
+        out += str.str();
+    } else {
+        out += "None"sv;
+    }
+}
+
+void StrStringify::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(arg_);
+}
+
+BoolBranch::BoolBranch(unique_ptr<BoolExpression> condition, unique_ptr<Statement> if_body,
+                       unique_ptr<Statement> else_body)
+    : condition_(std::move(condition)), if_body_(std::move(if_body)),
+    else_body_(std::move(else_body)) {
+
+}
+
+ObjectHolder BoolBranch::Execute(Closure& closure, Context& context) {
+    if (BoolValue(*condition_, closure, context)){
+        return if_body_->Execute(closure, context);
+    } else if (else_body_){
+        return else_body_->Execute(closure, context);
+    }
+    return {};
+}
+
+void BoolBranch::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    VisitBoolOperand(condition_, fn);
+    fn(if_body_);
+    if (else_body_){
+        fn(else_body_);
+    }
+}
+
+GuardedBody::GuardedBody(vector<pair<symbols::Symbol, StaticType>> guards, unique_ptr<Statement> specialized,
+                         unique_ptr<Statement> generic)
+    : guards_(std::move(guards)), specialized_(std::move(specialized)),
+    generic_(std::move(generic)) {
+
+}
+
+ObjectHolder GuardedBody::Execute(Closure& closure, Context& context) {
+    for (const auto& [name, type] : guards_){
+        auto it = closure.find(name);
+        if (it == closure.end() || !HasType(it->second, type)){
+            fallbacks_++;
+            return generic_->Execute(closure, context);
+        }
+    }
+    return specialized_->Execute(closure, context);
+}
+
+void GuardedBody::ForEachChild(const function<void(unique_ptr<Statement>&)>& fn) {
+    fn(specialized_);
+    fn(generic_);
+}
+
+TypeSpecializationStats SpecializeTypes(unique_ptr<Statement>& program,
+                                        const ProgramProfile* profile) {
+    Specializer specializer(profile);
+    specializer.Run(program);
+    return specializer.stats;
+}
+
+}  // namespace ast
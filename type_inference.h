@@ -0,0 +1,274 @@
+#pragma once
+
+#include "ast_utils.h"
+#include "profile.h"
+#include "statement.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+Вывод типов и специализированные узлы для выражений, тип которых известен до исполнения.
+Специализированные узлы вычисляют промежуточные значения без упаковки в ObjectHolder
+и без проверки типов операндов; результат упаковывается один раз, когда его
+запрашивают через Execute
+*/
+namespace ast {
+
+// Тип значения, установленный выводом типов
+enum class StaticType {
+    // Сведений о типе ещё нет (используется при поиске типов параметров методов)
+    Unset,
+    // О значении ничего не известно
+    Unknown,
+    Int,
+    Str,
+    Bool,
+};
+
+// Выражение, значение которого всегда целое число
+class IntExpression : public Statement {
+public:
+    virtual int EvaluateInt(runtime::Closure& closure, runtime::Context& context) = 0;
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+};
+
+// Выражение, значение которого всегда Bool
+class BoolExpression : public Statement {
+public:
+    virtual bool EvaluateBool(runtime::Closure& closure, runtime::Context& context) = 0;
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+};
+
+// Выражение, значение которого всегда строка
+class StrExpression : public Statement {
+public:
+    // Дописывает значение выражения в конец out
+    virtual void AppendStr(runtime::Closure& closure, runtime::Context& context,
+                           std::string& out) = 0;
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+};
+
+class IntLiteral : public IntExpression {
+public:
+    explicit IntLiteral(int value);
+
+    int EvaluateInt(runtime::Closure& closure, runtime::Context& context) override;
+
+    int value_;
+};
+
+// Переменная, которой на всех путях к месту чтения присвоено целое число
+class IntVariable : public IntExpression {
+public:
+    explicit IntVariable(symbols::Symbol name);
+
+    int EvaluateInt(runtime::Closure& closure, runtime::Context& context) override;
+
+    symbols::Symbol name_;
+};
+
+// Произвольное выражение, тип которого доказанно Int
+class IntOf : public IntExpression, public CompositeNode {
+public:
+    explicit IntOf(std::unique_ptr<Statement> expr);
+
+    int EvaluateInt(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    std::unique_ptr<Statement> expr_;
+};
+
+/*
+lhs op rhs над целыми числами, op - один из символов + - * /.
+Операнды этого и следующих узлов хранятся как Statement, чтобы проходы видели их
+через ForEachChild. Операнд, который проход заменил узлом общего вида, ForEachChild
+оборачивает в IntOf, BoolOf либо StrStringify, поэтому тип операнда сохраняется
+*/
+class IntArithmetic : public IntExpression, public CompositeNode {
+public:
+    IntArithmetic(char op, std::unique_ptr<IntExpression> lhs, std::unique_ptr<IntExpression> rhs);
+
+    // При делении на ноль выбрасывает runtime_error
+    int EvaluateInt(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    char op_;
+    std::unique_ptr<Statement> lhs_;
+    std::unique_ptr<Statement> rhs_;
+};
+
+class BoolVariable : public BoolExpression {
+public:
+    explicit BoolVariable(symbols::Symbol name);
+
+    bool EvaluateBool(runtime::Closure& closure, runtime::Context& context) override;
+
+    symbols::Symbol name_;
+};
+
+// Произвольное выражение, тип которого доказанно Bool (например, сравнение объектов)
+class BoolOf : public BoolExpression, public CompositeNode {
+public:
+    explicit BoolOf(std::unique_ptr<Statement> expr);
+
+    bool EvaluateBool(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    std::unique_ptr<Statement> expr_;
+};
+
+// Сравнение целых чисел; операнды - IntExpression
+class IntComparison : public BoolExpression, public CompositeNode {
+public:
+    IntComparison(IntCompareFunction cmp, std::unique_ptr<IntExpression> lhs,
+                  std::unique_ptr<IntExpression> rhs);
+
+    bool EvaluateBool(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    IntCompareFunction cmp_;
+    std::unique_ptr<Statement> lhs_;
+    std::unique_ptr<Statement> rhs_;
+};
+
+// Отрицание; операнд - BoolExpression
+class BoolNot : public BoolExpression, public CompositeNode {
+public:
+    explicit BoolNot(std::unique_ptr<BoolExpression> arg);
+
+    bool EvaluateBool(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    std::unique_ptr<Statement> arg_;
+};
+
+// lhs and rhs либо lhs or rhs над BoolExpression. Как и And и Or, вычисляет оба операнда
+class BoolLogic : public BoolExpression, public CompositeNode {
+public:
+    BoolLogic(bool is_and, std::unique_ptr<BoolExpression> lhs, std::unique_ptr<BoolExpression> rhs);
+
+    bool EvaluateBool(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    bool is_and_;
+    std::unique_ptr<Statement> lhs_;
+    std::unique_ptr<Statement> rhs_;
+};
+
+class StrLiteral : public StrExpression {
+public:
+    explicit StrLiteral(std::string value);
+
+    void AppendStr(runtime::Closure& closure, runtime::Context& context, std::string& out) override;
+
+    std::string value_;
+};
+
+class StrVariable : public StrExpression {
+public:
+    explicit StrVariable(symbols::Symbol name);
+
+    void AppendStr(runtime::Closure& closure, runtime::Context& context, std::string& out) override;
+
+    symbols::Symbol name_;
+};
+
+// Конкатенация StrExpression: промежуточные строки не создаются, части дописываются
+// в общий буфер
+class StrConcat : public StrExpression, public CompositeNode {
+public:
+    StrConcat(std::unique_ptr<StrExpression> lhs, std::unique_ptr<StrExpression> rhs);
+
+    void AppendStr(runtime::Closure& closure, runtime::Context& context, std::string& out) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    std::unique_ptr<Statement> lhs_;
+    std::unique_ptr<Statement> rhs_;
+};
+
+// str(arg). Целые числа, строки и Bool выводятся без создания промежуточного объекта
+class StrStringify : public StrExpression, public CompositeNode {
+public:
+    explicit StrStringify(std::unique_ptr<Statement> arg);
+
+    void AppendStr(runtime::Closure& closure, runtime::Context& context, std::string& out) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    std::unique_ptr<Statement> arg_;
+};
+
+// if с условием типа Bool: значение условия не упаковывается
+class BoolBranch : public Statement, public CompositeNode {
+public:
+    BoolBranch(std::unique_ptr<BoolExpression> condition, std::unique_ptr<Statement> if_body,
+               std::unique_ptr<Statement> else_body);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    // BoolExpression
+    std::unique_ptr<Statement> condition_;
+    std::unique_ptr<Statement> if_body_;
+    std::unique_ptr<Statement> else_body_;
+};
+
+/*
+Тело метода, специализированное под типы параметров. При входе в метод проверяет
+типы параметров и исполняет specialized_, если все проверки прошли, иначе generic_
+*/
+class GuardedBody : public Statement, public CompositeNode {
+public:
+    GuardedBody(std::vector<std::pair<symbols::Symbol, StaticType>> guards,
+                std::unique_ptr<Statement> specialized, std::unique_ptr<Statement> generic);
+
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    void ForEachChild(const std::function<void(std::unique_ptr<Statement>&)>& fn) override;
+
+    std::vector<std::pair<symbols::Symbol, StaticType>> guards_;
+    std::unique_ptr<Statement> specialized_;
+    std::unique_ptr<Statement> generic_;
+    // Количество входов в метод, при которых проверка типов не прошла
+    size_t fallbacks_ = 0;
+};
+
+// Результаты специализации
+struct TypeSpecializationStats {
+    // Созданных узлов над целыми числами, строками и Bool
+    size_t int_nodes = 0;
+    size_t str_nodes = 0;
+    size_t bool_nodes = 0;
+    // Методов, специализированных под типы параметров
+    size_t guarded_methods = 0;
+
+    [[nodiscard]] size_t Total() const {
+        return int_nodes + str_nodes + bool_nodes + guarded_methods;
+    }
+};
+
+/*
+Потоково-чувствительный вывод типов переменных верхнего уровня и локальных переменных
+методов. Выражения с доказанным типом заменяются специализированными узлами.
+Типы параметров методов предполагаются по аргументам в местах вызова методов с тем же
+именем и числом аргументов; такие методы получают GuardedBody с проверкой при входе.
+Если по местам вызова тип параметра неизвестен, используется тип из профиля
+*/
+TypeSpecializationStats SpecializeTypes(std::unique_ptr<Statement>& program,
+                                        const ProgramProfile* profile = nullptr);
+
+}  // namespace ast
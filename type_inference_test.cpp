@@ -0,0 +1,212 @@
+#include "ast_utils.h"
+#include "pass_manager.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+#include "type_inference.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+// Проход без профиля
+const auto SPECIALIZE = [](unique_ptr<Statement>& tree) {
+    return SpecializeTypes(tree);
+};
+
+// Находит все узлы GuardedBody в дереве
+class GuardedBodyCollector : public Visitor {
+public:
+    vector<GuardedBody*> bodies;
+
+protected:
+    using Visitor::Visit;
+
+    bool Visit(Statement& node) override {
+        if (auto* body = dynamic_cast<GuardedBody*>(&node)){
+            bodies.push_back(body);
+        }
+        return true;
+    }
+};
+
+// Заменяет литералы специализированных узлов константами общего вида
+class LiteralBoxer : public Rewriter {
+public:
+    size_t replaced = 0;
+
+protected:
+    void Leave(unique_ptr<Statement>& slot) override {
+        if (auto* number = dynamic_cast<IntLiteral*>(slot.get())){
+            slot = make_unique<NumericConst>(runtime::Number(number->value_));
+            replaced++;
+        } else if (auto* str = dynamic_cast<StrLiteral*>(slot.get())){
+            slot = make_unique<StringConst>(runtime::String(str->value_));
+            replaced++;
+        }
+    }
+};
+
+void TestTopLevelArithmetics() {
+    const string program = R"(
+x = 2
+y = x * 3 + 1
+s = 'y=' + str(y) + ';'
+print y, s, not y > 5, y / 2 - x
+)"s;
+    TypeSpecializationStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, SPECIALIZE, stats), "7 y=7; False 1\n"s);
+    // *, +, / и -
+    ASSERT_EQUAL(stats.int_nodes, 4U);
+    // str(y) и две конкатенации
+    ASSERT_EQUAL(stats.str_nodes, 3U);
+    // сравнение и not
+    ASSERT_EQUAL(stats.bool_nodes, 2U);
+}
+
+void TestFlowSensitivity() {
+    const string program = R"(
+x = 1
+c = True
+if c:
+  x = 'a'
+print x + x
+x = 5
+print x + x
+)"s;
+    TypeSpecializationStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, SPECIALIZE, stats), "aa\n10\n"s);
+    // После if тип x неизвестен, после повторного присваивания - снова Int
+    ASSERT_EQUAL(stats.int_nodes, 1U);
+    ASSERT_EQUAL(stats.str_nodes, 0U);
+    ASSERT_EQUAL(stats.bool_nodes, 1U);
+}
+
+void TestVariablesAssignedInOneBranch() {
+    const string program = R"(
+c = False
+if c:
+  y = 1
+else:
+  z = 2
+print 'done'
+)"s;
+    TypeSpecializationStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, SPECIALIZE, stats), "done\n"s);
+
+    auto tree = ParseFromString(program + "print y + 1\n"s);
+    SpecializeTypes(tree);
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    // y не присвоена, поэтому выражение остаётся обычным и выбрасывает ошибку
+    ASSERT_THROWS(tree->Execute(closure, context), std::runtime_error);
+}
+
+void TestGuardedMethods() {
+    const string program = R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+class Twice:
+  def __add__(v):
+    return str(v) + '/' + str(v + v)
+
+f = Fib()
+t = Twice()
+print f.calc(15)
+print t.__add__(4), t + 'ab'
+)"s;
+    TypeSpecializationStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, SPECIALIZE, stats), "610\n4/8 ab/abab\n"s);
+    ASSERT_EQUAL(stats.guarded_methods, 2U);
+
+    auto tree = ParseFromString(program);
+    SpecializeTypes(tree);
+    Execute(*tree);
+    GuardedBodyCollector collector;
+    collector.Walk(*tree);
+    ASSERT_EQUAL(collector.bodies.size(), 2U);
+    // Twice.__add__ вызывается со строкой через оператор +, и проверка типа не проходит
+    ASSERT_EQUAL(collector.bodies[0]->fallbacks_ + collector.bodies[1]->fallbacks_, 1U);
+}
+
+void TestConflictingArgumentsAreNotGuarded() {
+    const string program = R"(
+class Rep:
+  def twice(v):
+    return v + v
+
+r = Rep()
+print r.twice(2), r.twice('ab')
+)"s;
+    TypeSpecializationStats stats;
+    ASSERT_EQUAL(opt::RunVerified(program, SPECIALIZE, stats), "4 abab\n"s);
+    ASSERT_EQUAL(stats.guarded_methods, 0U);
+}
+
+void TestClone() {
+    const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __str__():
+    return '(' + str(self.x) + ', ' + str(self.y) + ')'
+
+p = Point(1, 2)
+if p.x < p.y and not False:
+  print p, p.x * 10
+else:
+  print 'no'
+)"s;
+    auto tree = ParseFromString(program);
+    auto copy = Clone(*tree);
+    ASSERT(copy != nullptr);
+    ASSERT_EQUAL(CountNodes(*copy), CountNodes(*tree));
+    ASSERT_EQUAL(Execute(*copy), "(1, 2) 10\n"s);
+    ASSERT_EQUAL(Execute(*tree), "(1, 2) 10\n"s);
+}
+
+void TestOperandsAreChildren() {
+    const string program = R"(
+x = 2
+y = x * 3 + 1
+if y > 5 and not y > 100:
+  print 'y=' + str(y) + ';'
+)"s;
+    // Узлы верхнего уровня заменяются один к одному, поэтому при подсчёте не теряются
+    // ни условие BoolBranch, ни операнды специализированных узлов
+    auto tree = ParseFromString(program);
+    const size_t nodes = CountNodes(*tree);
+    ASSERT(SpecializeTypes(tree).Total() > 0U);
+    ASSERT_EQUAL(CountNodes(*tree), nodes);
+
+    // Операнд, заменённый узлом общего вида, сохраняет свой тип
+    LiteralBoxer boxer;
+    const string output = opt::VerifyOptimization(program, [&boxer](unique_ptr<Statement>& tree) {
+        SpecializeTypes(tree);
+        boxer.Rewrite(tree);
+    }).output;
+    ASSERT_EQUAL(output, "y=7;\n"s);
+    // 3, 1, 5, 100, 'y=' и ';'
+    ASSERT_EQUAL(boxer.replaced, 6U);
+}
+
+}  // namespace
+
+void RunTypeInferenceTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestTopLevelArithmetics);
+    RUN_TEST(tr, ast::TestFlowSensitivity);
+    RUN_TEST(tr, ast::TestVariablesAssignedInOneBranch);
+    RUN_TEST(tr, ast::TestGuardedMethods);
+    RUN_TEST(tr, ast::TestConflictingArgumentsAreNotGuarded);
+    RUN_TEST(tr, ast::TestClone);
+    RUN_TEST(tr, ast::TestOperandsAreChildren);
+}
+
+}  // namespace ast